@@ -0,0 +1,231 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/**
+ * Benchmarks of the BRAINSABC kernels that dominate a segmentation run:
+ * the EM posterior computation, the kNN posteriors and the LLS bias field
+ * correction, on a two channel (T1, T2) phantom with smooth priors.
+ */
+#include "BRAINSBenchmark.h"
+#include "EMSegmentationFilter.h"
+#include "LLSBiasCorrector.h"
+#include "Log.h"
+
+#include "itkImageRegionIterator.h"
+
+/** Gives the benchmark access to the private posterior computations of
+ *  EMSegmentationFilter, which declares this class a friend */
+class EMSegmentationFilterBenchmarkAccess
+{
+public:
+  typedef EMSegmentationFilter<FloatImageType, FloatImageType> FilterType;
+  typedef FilterType::ProbabilityImageVectorType               ProbabilityImageVectorType;
+  typedef FilterType::MapOfInputImageVectors                   MapOfInputImageVectors;
+  typedef FilterType::IntVectorType                            IntVectorType;
+
+  static void ComputeEMPosteriors(FilterType *filter,
+                                  const ProbabilityImageVectorType & priors,
+                                  const vnl_vector<FloatingPrecision> & priorWeights,
+                                  const MapOfInputImageVectors & intensityImages,
+                                  std::vector<RegionStats> & classStatistics)
+  {
+    filter->ComputeEMPosteriors(priors, priorWeights, intensityImages, classStatistics);
+  }
+
+  static void ComputekNNPosteriors(FilterType *filter,
+                                   const ProbabilityImageVectorType & priors,
+                                   const MapOfInputImageVectors & intensityImages,
+                                   ByteImageType::Pointer & labels,
+                                   const IntVectorType & labelClasses,
+                                   const std::vector<bool> & priorIsForeground)
+  {
+    filter->ComputekNNPosteriors(priors, intensityImages, labels, labelClasses, priorIsForeground);
+  }
+};
+
+namespace
+{
+typedef EMSegmentationFilterBenchmarkAccess::FilterType             EMSegmentationFilterType;
+typedef EMSegmentationFilterBenchmarkAccess::MapOfInputImageVectors MapOfInputImageVectors;
+typedef EMSegmentationFilterBenchmarkAccess::IntVectorType          IntVectorType;
+
+/** The segmented classes; the phantom label codes double as kNN label codes */
+const BRAINSBenchmark::PhantomTissue ClassTissues[] =
+{
+  BRAINSBenchmark::PhantomWhiteMatter,
+  BRAINSBenchmark::PhantomGrayMatter,
+  BRAINSBenchmark::PhantomCSF,
+  BRAINSBenchmark::PhantomAir
+};
+const unsigned int NumberOfClasses = sizeof( ClassTissues ) / sizeof( ClassTissues[0] );
+
+struct SegmentationInputs
+{
+  MapOfInputImageVectors                  IntensityImages;
+  std::vector<FloatImageType::Pointer>    Priors;
+  std::vector<ByteImageType::Pointer>     CandidateRegions;
+  ByteImageType::Pointer                  Labels;
+  ByteImageType::Pointer                  BrainMask;
+  ByteImageType::Pointer                  HeadMask;
+  std::vector<RegionStats>                ClassStatistics;
+  double                                  NumberOfVoxels;
+};
+
+ByteImageType::Pointer MakeMask(const ByteImageType *labels, const std::vector<unsigned char> & tissues)
+{
+  ByteImageType::Pointer mask = ByteImageType::New();
+  mask->CopyInformation(labels);
+  mask->SetRegions(labels->GetLargestPossibleRegion() );
+  mask->Allocate();
+  itk::ImageRegionConstIterator<ByteImageType> labelIt( labels, labels->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator<ByteImageType>      maskIt( mask, mask->GetLargestPossibleRegion() );
+  for( ; !labelIt.IsAtEnd(); ++labelIt, ++maskIt )
+    {
+    const bool inside = std::find(tissues.begin(), tissues.end(), labelIt.Get() ) != tissues.end();
+    maskIt.Set(inside ? 1 : 0);
+    }
+  return mask;
+}
+
+SegmentationInputs CreateSegmentationInputs(const unsigned int size)
+{
+  SegmentationInputs inputs;
+  inputs.IntensityImages["T1"].push_back(BRAINSBenchmark::CreatePhantomImage<FloatImageType>(size, 0, 11) );
+  inputs.IntensityImages["T2"].push_back(BRAINSBenchmark::CreatePhantomImage<FloatImageType>(size, 1, 12) );
+  inputs.Labels = BRAINSBenchmark::CreatePhantomLabelImage<ByteImageType>(size);
+  inputs.NumberOfVoxels = inputs.Labels->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  std::vector<unsigned char> brainTissues;
+  brainTissues.push_back(BRAINSBenchmark::PhantomWhiteMatter);
+  brainTissues.push_back(BRAINSBenchmark::PhantomGrayMatter);
+  brainTissues.push_back(BRAINSBenchmark::PhantomCSF);
+  inputs.BrainMask = MakeMask(inputs.Labels, brainTissues);
+  brainTissues.push_back(BRAINSBenchmark::PhantomScalp);
+  brainTissues.push_back(BRAINSBenchmark::PhantomEye);
+  inputs.HeadMask = MakeMask(inputs.Labels, brainTissues);
+
+  for( unsigned int c = 0; c < NumberOfClasses; ++c )
+    {
+    inputs.Priors.push_back(BRAINSBenchmark::CreatePhantomPrior<FloatImageType>(size, ClassTissues[c]) );
+    inputs.CandidateRegions.push_back(MakeMask(inputs.Labels, std::vector<unsigned char>(1, ClassTissues[c]) ) );
+
+    RegionStats stats;
+    stats.resize(2);
+    stats.m_Means["T1"] = BRAINSBenchmark::GetPhantomIntensity(ClassTissues[c], 0);
+    stats.m_Means["T2"] = BRAINSBenchmark::GetPhantomIntensity(ClassTissues[c], 1);
+    stats.m_Covariance.set_identity();
+    stats.m_Covariance *= 40.0 * 40.0;
+    stats.m_Weighting = 1.0;
+    inputs.ClassStatistics.push_back(stats);
+    }
+  return inputs;
+}
+
+BRAINSBenchmark::Kernel EMPosteriorsKernel(const unsigned int size)
+{
+  const SegmentationInputs                inputs = CreateSegmentationInputs(size);
+  const EMSegmentationFilterType::Pointer filter = EMSegmentationFilterType::New();
+  const vnl_vector<FloatingPrecision>     priorWeights(NumberOfClasses, 1.0);
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = inputs.NumberOfVoxels * NumberOfClasses;
+  kernel.Run = [inputs, filter, priorWeights]()
+    {
+      std::vector<RegionStats> classStatistics(inputs.ClassStatistics);
+      EMSegmentationFilterBenchmarkAccess::ComputeEMPosteriors(filter, inputs.Priors, priorWeights,
+                                                               inputs.IntensityImages, classStatistics);
+    };
+  return kernel;
+}
+
+BRAINSBenchmark::Kernel KNNPosteriorsKernel(const unsigned int size)
+{
+  const SegmentationInputs                inputs = CreateSegmentationInputs(size);
+  const EMSegmentationFilterType::Pointer filter = EMSegmentationFilterType::New();
+
+  IntVectorType     labelClasses(NumberOfClasses);
+  std::vector<bool> priorIsForeground(NumberOfClasses, true);
+  for( unsigned int c = 0; c < NumberOfClasses; ++c )
+    {
+    labelClasses[c] = ClassTissues[c];
+    priorIsForeground[c] = ( ClassTissues[c] != BRAINSBenchmark::PhantomAir );
+    }
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = inputs.NumberOfVoxels;
+  kernel.Run = [inputs, filter, labelClasses, priorIsForeground]()
+    {
+      ByteImageType::Pointer labels = inputs.Labels;
+      EMSegmentationFilterBenchmarkAccess::ComputekNNPosteriors(filter, inputs.Priors, inputs.IntensityImages,
+                                                                labels, labelClasses, priorIsForeground);
+    };
+  return kernel;
+}
+
+BRAINSBenchmark::Kernel LLSBiasCorrectionKernel(const unsigned int size)
+{
+  const SegmentationInputs inputs = CreateSegmentationInputs(size);
+
+  // Like EMSegmentationFilter, the bias field is fitted on the brain classes only.
+  std::vector<FloatImageType::Pointer> biasPosteriors;
+  std::vector<ByteImageType::Pointer>  biasCandidateRegions;
+  for( unsigned int c = 0; c < NumberOfClasses; ++c )
+    {
+    if( ClassTissues[c] != BRAINSBenchmark::PhantomAir )
+      {
+      biasPosteriors.push_back(inputs.Priors[c]);
+      biasCandidateRegions.push_back(inputs.CandidateRegions[c]);
+      }
+    }
+
+  typedef LLSBiasCorrector<CorrectIntensityImageType, FloatImageType> BiasCorrectorType;
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = inputs.NumberOfVoxels;
+  kernel.Run = [inputs, biasPosteriors, biasCandidateRegions]()
+    {
+      BiasCorrectorType::Pointer biasCorrector = BiasCorrectorType::New();
+      biasCorrector->SetMaxDegree(4);
+      biasCorrector->SetSampleSpacing(1);
+      biasCorrector->SetWorkingSpacing(inputs.Labels->GetSpacing()[0]);
+      biasCorrector->SetForegroundBrainMask(inputs.BrainMask);
+      biasCorrector->SetAllTissueMask(inputs.HeadMask);
+      biasCorrector->SetProbabilities(biasPosteriors, biasCandidateRegions);
+      biasCorrector->SetInputImages(inputs.IntensityImages);
+      biasCorrector->CorrectImages(0);
+    };
+  return kernel;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  mu::Log::GetInstance()->EchoOff();
+
+  BRAINSBenchmark::BenchmarkRunner runner("BRAINSABC", argc, argv);
+
+  std::vector<unsigned int> imageSizes;
+  imageSizes.push_back(64);
+  imageSizes.push_back(128);
+  imageSizes.push_back(192);
+
+  runner.Add("EMPosteriors", imageSizes, EMPosteriorsKernel);
+  runner.Add("KNNPosteriors", imageSizes, KNNPosteriorsKernel);
+  runner.Add("LLSBiasCorrection", imageSizes, LLSBiasCorrectionKernel);
+  return runner.Execute();
+}
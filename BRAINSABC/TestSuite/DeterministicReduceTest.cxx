@@ -0,0 +1,137 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "itkCompensatedSummation.h"
+#include "tbb/task_arena.h"
+#include "BRAINSABCParallelReduce.h"
+
+typedef itk::CompensatedSummation<double> CompensatedSummationType;
+
+/** Terms of widely different magnitude, so that the rounding of the sum
+ *  depends on the order in which partial sums are combined */
+static double Term(const long index)
+{
+  return std::sin(0.37 * index) * std::pow(10.0, static_cast<double>( index % 13 ) - 6.0);
+}
+
+static double Reduce3D(const long size)
+{
+  return BRAINSABCParallelReduce(tbb::blocked_range3d<long>(0, size, 1, 0, size, size / 2, 0, size, 16),
+                                 CompensatedSummationType(),
+                                 [=](const tbb::blocked_range3d<long> & r, CompensatedSummationType sum)
+                                 -> CompensatedSummationType {
+                                   for( long kk = r.pages().begin(); kk < r.pages().end(); ++kk )
+                                     {
+                                     for( long jj = r.rows().begin(); jj < r.rows().end(); ++jj )
+                                       {
+                                       for( long ii = r.cols().begin(); ii < r.cols().end(); ++ii )
+                                         {
+                                         sum += Term( ( kk * size + jj ) * size + ii );
+                                         }
+                                       }
+                                     }
+                                   return sum;
+                                 },
+                                 [](CompensatedSummationType a, const CompensatedSummationType & b)
+                                 -> CompensatedSummationType {
+                                   a += b.GetSum();
+                                   return a;
+                                 }).GetSum();
+}
+
+static double Reduce1D(const std::vector<double> & values)
+{
+  typedef std::vector<double>::const_iterator IterType;
+  return BRAINSABCParallelReduce(tbb::blocked_range<IterType>(values.begin(), values.end(), 1),
+                                 0.0,
+                                 [](const tbb::blocked_range<IterType> & r, double sum) -> double {
+                                   for( IterType it = r.begin(); it != r.end(); ++it )
+                                     {
+                                     sum += *it;
+                                     }
+                                   return sum;
+                                 },
+                                 [](const double a, const double b) -> double {
+                                   return a + b;
+                                 });
+}
+
+static bool BitwiseEqual(const double a, const double b)
+{
+  return std::memcmp(&a, &b, sizeof( double ) ) == 0;
+}
+
+int main(int, char * *)
+{
+  SetDeterministicReductions(true);
+
+  std::vector<double> values(100003);
+  for( size_t i = 0; i < values.size(); ++i )
+    {
+    values[i] = Term(static_cast<long>( i ) );
+    }
+
+  const int threadCounts[] = { 1, 2, 3, 8 };
+  double    reference3D = 0.0;
+  double    reference1D = 0.0;
+  bool      passed = true;
+  for( unsigned int t = 0; t < sizeof( threadCounts ) / sizeof( threadCounts[0] ); ++t )
+    {
+    tbb::task_arena arena(threadCounts[t]);
+    for( unsigned int repetition = 0; repetition < 3; ++repetition )
+      {
+      double sum3D = 0.0;
+      double sum1D = 0.0;
+      arena.execute([&]() {
+                      sum3D = Reduce3D(48);
+                      sum1D = Reduce1D(values);
+                    });
+      if( t == 0 && repetition == 0 )
+        {
+        reference3D = sum3D;
+        reference1D = sum1D;
+        }
+      if( !BitwiseEqual(sum3D, reference3D) || !BitwiseEqual(sum1D, reference1D) )
+        {
+        std::cerr << "Reduction with " << threadCounts[t] << " threads differs: "
+                  << sum3D << " vs " << reference3D << ", " << sum1D << " vs " << reference1D << std::endl;
+        passed = false;
+        }
+      }
+    }
+
+  // The default TBB reduction agrees up to rounding.
+  SetDeterministicReductions(false);
+  const double tbbSum3D = Reduce3D(48);
+  if( std::abs(tbbSum3D - reference3D) > 1e-9 * std::abs(reference3D) + 1e-12 )
+    {
+    std::cerr << "TBB reduction " << tbbSum3D << " differs from " << reference3D << std::endl;
+    passed = false;
+    }
+
+  if( !passed )
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "PASSED" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "itkAffineTransform.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkResampleImageFilter.h"
+#include "BRAINSABCUtilities.h"
+
+typedef itk::AffineTransform<double, 3> AffineTransformType;
+
+/** A prior that is non-zero in a ball only, on a background of backgroundValue */
+static FloatImageType::Pointer MakePrior(const float backgroundValue)
+{
+  FloatImageType::SizeType size;
+  size.Fill(32);
+  FloatImageType::PointType origin;
+  origin.Fill(-16.0);
+  FloatImageType::Pointer prior = FloatImageType::New();
+  prior->SetRegions(size);
+  prior->SetOrigin(origin);
+  prior->Allocate();
+
+  FloatImageType::PointType center;
+  center[0] = 3.0;
+  center[1] = -2.0;
+  center[2] = 1.5;
+  for( itk::ImageRegionIteratorWithIndex<FloatImageType> it(prior, prior->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    FloatImageType::PointType point;
+    prior->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    const float ball = std::max(0.0, 1.0 - point.EuclideanDistanceTo(center) / 7.0);
+    it.Set(backgroundValue == 0 ? ball : 1.0F - ball);
+    }
+  return prior;
+}
+
+/** The subject grid: a different size, spacing and origin than the atlas */
+static FloatImageType::Pointer MakeSubject()
+{
+  FloatImageType::SizeType size;
+  size[0] = 27;
+  size[1] = 25;
+  size[2] = 23;
+  FloatImageType::SpacingType spacing;
+  spacing[0] = 1.1;
+  spacing[1] = 1.2;
+  spacing[2] = 1.3;
+  FloatImageType::PointType origin;
+  origin[0] = -14.3;
+  origin[1] = -15.1;
+  origin[2] = -13.7;
+  FloatImageType::Pointer subject = FloatImageType::New();
+  subject->SetRegions(size);
+  subject->SetSpacing(spacing);
+  subject->SetOrigin(origin);
+  subject->Allocate();
+  subject->FillBuffer(0);
+  return subject;
+}
+
+/** The dense reference: the uncropped prior through a plain ResampleImageFilter */
+static FloatImageType::Pointer DenseWarp(const FloatImageType::Pointer & prior,
+                                         const FloatImageType::Pointer & subject,
+                                         const float backgroundValue,
+                                         const GenericTransformType::Pointer & transform)
+{
+  typedef itk::ResampleImageFilter<FloatImageType, FloatImageType> ResamplerType;
+  ResamplerType::Pointer warper = ResamplerType::New();
+  warper->SetInput(prior);
+  warper->SetTransform(transform);
+  warper->SetOutputParametersFromImage(subject);
+  warper->SetDefaultPixelValue(backgroundValue);
+  warper->Update();
+  return warper->GetOutput();
+}
+
+static bool SameImage(const FloatImageType::Pointer & expected, const FloatImageType::Pointer & supportBuffered,
+                      const char *name)
+{
+  for( itk::ImageRegionConstIteratorWithIndex<FloatImageType> it(expected, expected->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const float value = GetSupportPixel(supportBuffered.GetPointer(), it.GetIndex() );
+    if( std::fabs(value - it.Get() ) > 1e-6 )
+      {
+      std::cerr << name << " differs at " << it.GetIndex() << ": " << value << " != " << it.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+int main(int, char * *)
+{
+  AffineTransformType::Pointer affine = AffineTransformType::New();
+  AffineTransformType::OutputVectorType axis;
+  axis[0] = 0.2;
+  axis[1] = 0.3;
+  axis[2] = 1.0;
+  affine->Rotate3D(axis, 0.17);
+  AffineTransformType::OutputVectorType translation;
+  translation[0] = 1.3;
+  translation[1] = -0.7;
+  translation[2] = 0.4;
+  affine->Translate(translation);
+  const GenericTransformType::Pointer transform = affine.GetPointer();
+
+  const FloatImageType::Pointer subject = MakeSubject();
+  bool                          passed = true;
+
+  const float backgroundValues[2] = { 0.0F, 1.0F };
+  std::vector<FloatImageType::Pointer> warpedPriors;
+  for( unsigned int b = 0; b < 2; ++b )
+    {
+    const float                   backgroundValue = backgroundValues[b];
+    const FloatImageType::Pointer prior = MakePrior(backgroundValue);
+    const FloatImageType::Pointer cropped = CropToNonBackgroundRegion<FloatImageType>(prior, backgroundValue);
+    if( cropped->GetBufferedRegion().GetNumberOfPixels() >= prior->GetBufferedRegion().GetNumberOfPixels() )
+      {
+      std::cerr << "The prior with background " << backgroundValue << " was not cropped" << std::endl;
+      passed = false;
+      }
+
+    const FloatImageType::Pointer expected = DenseWarp(prior, subject, backgroundValue, transform);
+    const FloatImageType::Pointer fromFull =
+      WarpProbabilityImageToSupport<FloatImageType>(prior, subject.GetPointer(), backgroundValue, transform);
+    const FloatImageType::Pointer fromCropped =
+      WarpProbabilityImageToSupport<FloatImageType>(cropped, subject.GetPointer(), backgroundValue, transform);
+    passed = SameImage(expected, fromFull, backgroundValue == 0 ? "warped full prior" : "warped full air prior")
+      && passed;
+    passed = SameImage(expected, fromCropped, backgroundValue == 0 ? "warped cropped prior" : "warped cropped air prior")
+      && passed;
+    passed = SameImage(expected, ExpandSupportBufferedImage<FloatImageType>(fromCropped), "expanded prior") && passed;
+    if( fromCropped->GetLargestPossibleRegion() != subject->GetLargestPossibleRegion() )
+      {
+      std::cerr << "The warped prior is not on the subject grid" << std::endl;
+      passed = false;
+      }
+    warpedPriors.push_back(fromCropped);
+    }
+
+  // The ball prior only keeps its support, the air prior stays dense.
+  if( warpedPriors[0]->GetBufferedRegion() == warpedPriors[0]->GetLargestPossibleRegion()
+      || warpedPriors[1]->GetBufferedRegion() != warpedPriors[1]->GetLargestPossibleRegion() )
+    {
+    std::cerr << "Unexpected buffered regions " << warpedPriors[0]->GetBufferedRegion()
+              << warpedPriors[1]->GetBufferedRegion() << std::endl;
+    passed = false;
+    }
+
+  // Voxels outside the support of every prior become uniform when
+  // normalized, so the support buffered priors grow to cover them.
+  std::vector<FloatImageType::Pointer> ballPriors;
+  ballPriors.push_back(warpedPriors[0]);
+  ballPriors.push_back(BufferOnRegion<FloatImageType>(warpedPriors[0].GetPointer(),
+                                                      warpedPriors[0]->GetBufferedRegion() ) );
+  NormalizeProbListInPlace<FloatImageType>(ballPriors);
+  for( itk::ImageRegionConstIteratorWithIndex<FloatImageType> it(subject, subject->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const double first = GetSupportPixel(ballPriors[0].GetPointer(), it.GetIndex() );
+    const double second = GetSupportPixel(ballPriors[1].GetPointer(), it.GetIndex() );
+    if( std::fabs(first - 0.5) > 1e-6 || std::fabs(second - 0.5) > 1e-6 )
+      {
+      std::cerr << "Normalized priors are " << first << " and " << second << " at " << it.GetIndex() << std::endl;
+      passed = false;
+      break;
+      }
+    }
+
+  if( !passed )
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "Warping cropped priors matches warping full priors" << std::endl;
+  return EXIT_SUCCESS;
+}
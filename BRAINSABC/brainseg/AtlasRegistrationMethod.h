@@ -48,7 +48,7 @@
 
 #include "BRAINSFitHelper.h"
 #include "BRAINSABCUtilities.h"
-#include "itkAverageImageFilter.h"
+#include "itkRunningAverageImageAccumulator.h"
 #include "itkBinaryThresholdImageFilter.h"
 #include <string>
 
@@ -114,22 +114,21 @@ AverageImageList(const std::vector<typename TImage::Pointer> & inputImageList)
   averageMask = multIF->GetOutput();
   }
 
-  typedef itk::AverageImageFilter<TImage,TImage> AvgFilterType;
-  typename AvgFilterType::Pointer filter = AvgFilterType::New();
+  // Each intensity matched image is released as soon as it is added.
+  typedef itk::RunningAverageImageAccumulator<TImage,TImage> AvgAccumulatorType;
+  typename AvgAccumulatorType::Pointer accumulator = AvgAccumulatorType::New();
   typename TImage::Pointer referenceScaleImg = inputImageList[0];
-  filter->SetInput(0,referenceScaleImg);
+  accumulator->AddImage(referenceScaleImg);
   for(unsigned int i = 1; i < inputImageList.size(); ++i)
     {
-      //Modify inputImageList in place.
       typename TImage::Pointer temp=LinearRegressionIntensityMatching<TImage,TImage>(referenceScaleImg.GetPointer(),
                                                           averageMask.GetPointer(),
                                                           inputImageList[i].GetPointer());
-      filter->SetInput(i,  temp);
+      accumulator->AddImage(temp);
     }
-  filter->Update();
   typename MultiplyFilterType::Pointer multIF = MultiplyFilterType::New();
   multIF->SetInput1(averageMask);
-  multIF->SetInput2(filter->GetOutput());
+  multIF->SetInput2(accumulator->GetAverage());
   multIF->Update();
 
   return multIF->GetOutput();
@@ -58,7 +58,9 @@
 
 #include <StandardizeMaskIntensity.h>
 #include "BRAINSABCCLP.h"
-#include "BRAINSThreadControl.h"
+#include "BRAINSABCParallelReduce.h"
+#include "BRAINSThreadBudget.h"
+#include "BRAINSTrace.h"
 
 // Use manually instantiated classes for the big program chunks
 #define MU_MANUAL_INSTANTIATION
@@ -176,16 +178,13 @@ CreateTypedMap(const AtlasRegType::StringVector &keys, const AtlasRegType::Strin
   return rval;
 }
 
-//For the BRAINSABC program, we also need to minimize num threads used by TBB
-#include "tbb/task_scheduler_init.h"
-
 int main(int argc, char * *argv)
 {
   PARSE_ARGS;
   BRAINSRegisterAlternateIO();
-  const BRAINSUtils::StackPushITKDefaultNumberOfThreads TempDefaultNumberOfThreadsHolder(numberOfThreads);
-  // Construct TBB task scheduler with matching threads to ITK threads
-  tbb::task_scheduler_init init( itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() );
+  // One budget for the ITK filters and the TBB loops of the EM iterations
+  BRAINSUtils::ThreadBudget threadBudget(numberOfThreads);
+  SetDeterministicReductions(deterministic);
 
   // TODO:  Need to figure out how to conserve memory better during the running
   // of this application:  itk::DataObject::GlobalReleaseDataFlagOn();
@@ -269,6 +268,7 @@ int main(int argc, char * *argv)
   //  EMSTimer* timer = new EMSTimer();
   itk::TimeProbe timer;
   timer.Start();
+  BRAINS_TRACE_SCOPE("BRAINSABC");
 
   // Directory separator string
   std::string separator = std::string("/");
@@ -878,6 +878,7 @@ int main(int argc, char * *argv)
   atlasreg->SetOutputDebugDir(outputDir);
   try
     {
+    BRAINS_TRACE_SCOPE("AtlasRegistration");
     atlasreg->Update();
     }
   catch( itk::ExceptionObject & e )
@@ -1134,7 +1135,11 @@ int main(int argc, char * *argv)
       gridSize[1],
       gridSize[2]);
 
-    segfilter->Update();
+      {
+      BRAINS_TRACE_SCOPE("EMSegmentation");
+      // All of the TBB loops of BRAINSABC run inside the segmentation filter
+      threadBudget.Execute( [&]() { segfilter->Update(); } );
+      }
 
     // Write the secondary outputs
     if( !writeLess )
@@ -1381,7 +1386,7 @@ int main(int argc, char * *argv)
       typedef itk::ImageFileWriter<FloatImageType> FloatWriterType;
       FloatWriterType::Pointer writer = FloatWriterType::New();
 
-      FloatImageType::Pointer currPosterior = segfilter->GetPosteriors()[probabilityIndex];
+      FloatImageType::Pointer currPosterior = segfilter->GetPosterior(probabilityIndex);
       writer->SetInput( currPosterior );
       writer->SetFileName( fn.c_str() );
       writer->UseCompressionOn();
@@ -0,0 +1,138 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/**
+ * Drop-in replacements for tbb::parallel_reduce used by the BRAINSABC
+ * floating point reductions.
+ *
+ * By default they call tbb::parallel_reduce, whose dynamic partitioning makes
+ * the order in which partial sums are combined, and therefore the last bits
+ * of the result, depend on scheduling.  With SetDeterministicReductions(true)
+ * the range is cut into fixed blocks (one slice of a 3D range, or
+ * DeterministicReductionBlockSize items of a 1D range), the blocks are still
+ * reduced in parallel, and the partial results are merged pairwise in block
+ * order.  The result is then identical from run to run and for any number of
+ * threads.
+ */
+#ifndef __BRAINSABCParallelReduce__h__
+#define __BRAINSABCParallelReduce__h__
+
+#include "tbb/blocked_range.h"
+#include "tbb/blocked_range3d.h"
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_reduce.h"
+
+#include <algorithm>
+#include <vector>
+
+/** Number of items per block of a deterministic 1D reduction */
+constexpr size_t DeterministicReductionBlockSize = 4096;
+
+inline bool & DeterministicReductionsFlag()
+{
+  static bool deterministicReductions = false;
+  return deterministicReductions;
+}
+
+/** Process wide switch between the TBB and the deterministic reductions */
+inline void SetDeterministicReductions(const bool deterministic)
+{
+  DeterministicReductionsFlag() = deterministic;
+}
+
+inline bool GetDeterministicReductions()
+{
+  return DeterministicReductionsFlag();
+}
+
+/** Merge the partial results in a fixed tree: ((0,1),(2,3)),((4,5),... */
+template <typename TValue, typename TJoin>
+TValue
+OrderedPairwiseMerge(std::vector<TValue> & partials, const TJoin & join)
+{
+  for( size_t stride = 1; stride < partials.size(); stride *= 2 )
+    {
+    for( size_t i = 0; i + stride < partials.size(); i += 2 * stride )
+      {
+      partials[i] = join(partials[i], partials[i + stride]);
+      }
+    }
+  return partials[0];
+}
+
+/** Reduce a 3D range; deterministic blocks are single slices (pages) */
+template <typename TIndex, typename TValue, typename TBody, typename TJoin>
+TValue
+BRAINSABCParallelReduce(const tbb::blocked_range3d<TIndex> & range, const TValue & identity,
+                        const TBody & body, const TJoin & join)
+{
+  if( !GetDeterministicReductions() )
+    {
+    return tbb::parallel_reduce(range, identity, body, join);
+    }
+  const size_t numberOfBlocks = range.pages().size();
+  if( numberOfBlocks == 0 )
+    {
+    return identity;
+    }
+  std::vector<TValue> partials(numberOfBlocks, identity);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, numberOfBlocks),
+                    [&](const tbb::blocked_range<size_t> & blocks) {
+                      for( size_t b = blocks.begin(); b < blocks.end(); ++b )
+                        {
+                        const TIndex page = range.pages().begin() + static_cast<TIndex>( b );
+                        const tbb::blocked_range3d<TIndex> slice(page, page + 1, 1,
+                                                                 range.rows().begin(), range.rows().end(), 1,
+                                                                 range.cols().begin(), range.cols().end(), 1);
+                        partials[b] = body(slice, identity);
+                        }
+                    });
+  return OrderedPairwiseMerge(partials, join);
+}
+
+/** Reduce a 1D range of indices or random access iterators */
+template <typename TValueOrIterator, typename TValue, typename TBody, typename TJoin>
+TValue
+BRAINSABCParallelReduce(const tbb::blocked_range<TValueOrIterator> & range, const TValue & identity,
+                        const TBody & body, const TJoin & join)
+{
+  if( !GetDeterministicReductions() )
+    {
+    return tbb::parallel_reduce(range, identity, body, join);
+    }
+  const size_t numberOfItems = range.size();
+  const size_t numberOfBlocks = ( numberOfItems + DeterministicReductionBlockSize - 1 ) / DeterministicReductionBlockSize;
+  if( numberOfBlocks == 0 )
+    {
+    return identity;
+    }
+  std::vector<TValue> partials(numberOfBlocks, identity);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, numberOfBlocks),
+                    [&](const tbb::blocked_range<size_t> & blocks) {
+                      for( size_t b = blocks.begin(); b < blocks.end(); ++b )
+                        {
+                        const size_t first = b * DeterministicReductionBlockSize;
+                        const size_t last = std::min(numberOfItems, first + DeterministicReductionBlockSize);
+                        const tbb::blocked_range<TValueOrIterator> block(range.begin() + first, range.begin() + last);
+                        partials[b] = body(block, identity);
+                        }
+                    });
+  return OrderedPairwiseMerge(partials, join);
+}
+
+#endif // __BRAINSABCParallelReduce__h__
@@ -34,6 +34,7 @@
 #include <vnl/vnl_vector.h>
 #include <vnl/algo/vnl_matrix_inverse.h>
 
+#include <array>
 #include <vector>
 #include <map>
 #include <csignal>
@@ -20,8 +20,96 @@
 #define __BRAINSABCUtilities__hxx__
 
 #include "ExtractSingleLargestRegion.h"
+#include "SupportBufferedImage.h"
+#include "itkRegionOfInterestImageFilter.h"
+#include "itkResampleImageFilter.h"
 #include "tbb/tbb.h"
 
+/**
+ * The bounding region of the voxels of the 3D scanRegion for which
+ * isInside(index) is true.  A region of size 0 is returned when there are
+ * none.
+ */
+template <class TRegion, class TPredicate>
+TRegion
+ComputeBoundingRegion(const TRegion & scanRegion, TPredicate isInside)
+{
+  typedef typename TRegion::IndexType      IndexType;
+  typedef typename TRegion::IndexValueType IndexValueType;
+  const IndexType                   start = scanRegion.GetIndex();
+  const typename TRegion::SizeType  size = scanRegion.GetSize();
+
+  // Per slice bounds, combined serially so that the result does not depend
+  // on scheduling: {minI, maxI, minJ, maxJ}, empty when minI > maxI.
+  std::vector<std::array<IndexValueType, 4> > sliceBounds(size[2]);
+  tbb::parallel_for(tbb::blocked_range<LOOPITERTYPE>(0, size[2], 1),
+                    [&](const tbb::blocked_range<LOOPITERTYPE> & r) {
+                      for( LOOPITERTYPE kk = r.begin(); kk < r.end(); ++kk )
+                        {
+                        std::array<IndexValueType, 4> & bounds = sliceBounds[kk];
+                        bounds = {{ start[0] + static_cast<IndexValueType>( size[0] ), start[0] - 1,
+                                    start[1] + static_cast<IndexValueType>( size[1] ), start[1] - 1 }};
+                        for( LOOPITERTYPE jj = 0; jj < size[1]; ++jj )
+                          {
+                          for( LOOPITERTYPE ii = 0; ii < size[0]; ++ii )
+                            {
+                            const IndexType currIndex = {{ start[0] + ii, start[1] + jj, start[2] + kk }};
+                            if( isInside(currIndex) )
+                              {
+                              bounds[0] = std::min(bounds[0], currIndex[0]);
+                              bounds[1] = std::max(bounds[1], currIndex[0]);
+                              bounds[2] = std::min(bounds[2], currIndex[1]);
+                              bounds[3] = std::max(bounds[3], currIndex[1]);
+                              }
+                            }
+                          }
+                        }
+                    });
+
+  IndexValueType lower[3] = { 0, 0, 0 };
+  IndexValueType upper[3] = { -1, -1, -1 };
+  bool           found = false;
+  for( LOOPITERTYPE kk = 0; kk < size[2]; ++kk )
+    {
+    const std::array<IndexValueType, 4> & bounds = sliceBounds[kk];
+    if( bounds[0] > bounds[1] )
+      {
+      continue;
+      }
+    const IndexValueType slice = start[2] + kk;
+    if( !found )
+      {
+      lower[0] = bounds[0];
+      upper[0] = bounds[1];
+      lower[1] = bounds[2];
+      upper[1] = bounds[3];
+      lower[2] = slice;
+      found = true;
+      }
+    lower[0] = std::min(lower[0], bounds[0]);
+    upper[0] = std::max(upper[0], bounds[1]);
+    lower[1] = std::min(lower[1], bounds[2]);
+    upper[1] = std::max(upper[1], bounds[3]);
+    upper[2] = slice;
+    }
+
+  TRegion region;
+  region.SetIndex(start);
+  if( !found )
+    {
+    typename TRegion::SizeType emptySize;
+    emptySize.Fill(0);
+    region.SetSize(emptySize);
+    return region;
+    }
+  for( unsigned int d = 0; d < 3; ++d )
+    {
+    region.SetIndex(d, lower[d]);
+    region.SetSize(d, static_cast<typename TRegion::SizeValueType>( upper[d] - lower[d] + 1 ) );
+    }
+  return region;
+}
+
 template <class TProbabilityImage>
 void ZeroNegativeValuesInPlace(std::vector<typename TProbabilityImage::Pointer> & priors)
 {
@@ -33,7 +121,7 @@ void ZeroNegativeValuesInPlace(std::vector<typename TProbabilityImage::Pointer>
                         // First copy value, and set negative values to zero.
                         for (LOOPITERTYPE iprior = r.begin(); iprior < r.end(); iprior++) {
                           for (itk::ImageRegionIterator<TProbabilityImage>
-                                                 priorIter(priors[iprior], priors[iprior]->GetLargestPossibleRegion());
+                                                 priorIter(priors[iprior], priors[iprior]->GetBufferedRegion());
                                !priorIter.IsAtEnd();
                                ++priorIter) {
                             typename TProbabilityImage::PixelType inputValue(priorIter.Get());
@@ -51,7 +139,35 @@ void NormalizeProbListInPlace(std::vector<typename TProbabilityImage::Pointer> &
 {
   const unsigned int numProbs = ProbList.size();
 
-  const typename TProbabilityImage::SizeType size = ProbList[0]->GetLargestPossibleRegion().GetSize();
+  const typename TProbabilityImage::RegionType largestRegion = ProbList[0]->GetLargestPossibleRegion();
+  const typename TProbabilityImage::SizeType   size = largestRegion.GetSize();
+
+  // Voxels where every probability is zero are set to the uniform
+  // distribution, so support buffered probabilities are first grown to
+  // cover them.
+  const typename TProbabilityImage::RegionType zeroSumRegion =
+    ComputeBoundingRegion(largestRegion,
+                          [&](const typename TProbabilityImage::IndexType & currIndex) -> bool {
+                            FloatingPrecision sumPrior = 0.0;
+                            for( unsigned int iprior = 0; iprior < numProbs; iprior++ )
+                              {
+                              sumPrior += GetSupportPixel(ProbList[iprior].GetPointer(), currIndex);
+                              }
+                            return sumPrior < 1e-20;
+                          });
+  if( zeroSumRegion.GetNumberOfPixels() > 0 )
+    {
+    for( unsigned int iprior = 0; iprior < numProbs; iprior++ )
+      {
+      const typename TProbabilityImage::RegionType bufferedRegion = ProbList[iprior]->GetBufferedRegion();
+      if( !bufferedRegion.IsInside(zeroSumRegion) )
+        {
+        ProbList[iprior] = BufferOnRegion<TProbabilityImage>(ProbList[iprior].GetPointer(),
+                                                             BoundingRegionUnion(bufferedRegion, zeroSumRegion) );
+        }
+      }
+    }
+
     {
     tbb::parallel_for(tbb::blocked_range3d<LOOPITERTYPE>(0,size[2],1,0,size[1],size[1]/2,0,size[0],512),
                       [=] (tbb::blocked_range3d<LOOPITERTYPE> &r) {
@@ -61,7 +177,8 @@ void NormalizeProbListInPlace(std::vector<typename TProbabilityImage::Pointer> &
                               const typename TProbabilityImage::IndexType currIndex = {{ii, jj, kk}};
                               FloatingPrecision sumPrior = 0.0;
                               for (unsigned int iprior = 0; iprior < numProbs; iprior++) {
-                                const FloatingPrecision &ProbListValue = ProbList[iprior]->GetPixel(currIndex);
+                                const FloatingPrecision ProbListValue =
+                                    GetSupportPixel(ProbList[iprior].GetPointer(), currIndex);
                                 CHECK_NAN(ProbListValue, __FILE__, __LINE__, "\n  sumPrior: " << sumPrior
                                                                              << "\n  currIndex: " << currIndex <<
                                                                              "\n ProbListValue: "
@@ -78,6 +195,10 @@ void NormalizeProbListInPlace(std::vector<typename TProbabilityImage::Pointer> &
                               else {
                                 const FloatingPrecision invSumPrior = 1.0 / sumPrior;
                                 for (unsigned int iprior = 0; iprior < numProbs; iprior++) {
+                                  // Zero stays zero outside the buffered support.
+                                  if (!ProbList[iprior]->GetBufferedRegion().IsInside(currIndex)) {
+                                    continue;
+                                  }
                                   const FloatingPrecision normValue =
                                       ProbList[iprior]->GetPixel(currIndex) * invSumPrior;
 
@@ -143,7 +264,7 @@ typename ByteImageType::Pointer ComputeForegroundProbMask(
                               for (unsigned int iprior = 0; iprior < numPriors; iprior++) {
                                 const bool fgflag = IsForegroundPriorVector[iprior];
                                 if (fgflag == true) {
-                                  tmp += probList[iprior]->GetPixel(currIndex);
+                                  tmp += GetSupportPixel(probList[iprior].GetPointer(), currIndex);
                                 }
                               }
                               if (tmp > 0.5) // Only include if the sum of the non-background
@@ -163,4 +284,127 @@ typename ByteImageType::Pointer ComputeForegroundProbMask(
   return currForegroundMask;
 }
 
+/**
+ * The bounding region of the voxels that differ from backgroundValue, grown
+ * by padding voxels and clipped to the image.  Only the buffered region is
+ * scanned.  A region of size 0 is returned when every voxel equals
+ * backgroundValue.
+ */
+template <class TProbabilityImage>
+typename TProbabilityImage::RegionType
+ComputeNonBackgroundRegion(const typename TProbabilityImage::Pointer & image,
+                           const typename TProbabilityImage::PixelType backgroundValue,
+                           const unsigned int padding)
+{
+  typedef typename TProbabilityImage::RegionType RegionType;
+  const RegionType largestRegion = image->GetLargestPossibleRegion();
+
+  RegionType region =
+    ComputeBoundingRegion(image->GetBufferedRegion(),
+                          [&](const typename TProbabilityImage::IndexType & currIndex) -> bool {
+                            return image->GetPixel(currIndex) != backgroundValue;
+                          });
+  if( region.GetNumberOfPixels() == 0 )
+    {
+    region.SetIndex(largestRegion.GetIndex() );
+    return region;
+    }
+  region.PadByRadius(padding);
+  region.Crop(largestRegion);
+  return region;
+}
+
+/**
+ * Crop a probability image to the voxels that differ from its background
+ * value, keeping its physical space.  One voxel of background is kept
+ * around the support, so that linear interpolation of the cropped image,
+ * with backgroundValue as the default value outside it, reproduces the
+ * interpolation of the full image.  Images whose support covers most of
+ * the volume are returned unchanged.
+ */
+template <class TProbabilityImage>
+typename TProbabilityImage::Pointer
+CropToNonBackgroundRegion(const typename TProbabilityImage::Pointer & image,
+                          const typename TProbabilityImage::PixelType backgroundValue)
+{
+  typename TProbabilityImage::RegionType support =
+    ComputeNonBackgroundRegion<TProbabilityImage>(image, backgroundValue, 1);
+  if( support.GetNumberOfPixels() == 0 )
+    {
+    // A single background voxel interpolates to the background everywhere.
+    typename TProbabilityImage::SizeType oneVoxel;
+    oneVoxel.Fill(1);
+    support.SetSize(oneVoxel);
+    }
+  const typename TProbabilityImage::RegionType::SizeValueType numberOfPixels =
+    image->GetLargestPossibleRegion().GetNumberOfPixels();
+  if( support.GetNumberOfPixels() * 10 > numberOfPixels * 9 )
+    {
+    return image;
+    }
+
+  typedef itk::RegionOfInterestImageFilter<TProbabilityImage, TProbabilityImage> ROIFilterType;
+  typename ROIFilterType::Pointer roiFilter = ROIFilterType::New();
+  roiFilter->SetInput(image);
+  roiFilter->SetRegionOfInterest(support);
+  roiFilter->Update();
+  typename TProbabilityImage::Pointer cropped = roiFilter->GetOutput();
+  cropped->DisconnectPipeline();
+  return cropped;
+}
+
+/**
+ * Keep a probability image buffered only on the bounding region of its
+ * non-zero voxels (see SupportBufferedImage.h).  Images whose support
+ * covers most of the volume are kept dense.
+ */
+template <class TProbabilityImage>
+typename TProbabilityImage::Pointer
+CropToSupport(const typename TProbabilityImage::Pointer & image)
+{
+  typename TProbabilityImage::RegionType support = ComputeNonBackgroundRegion<TProbabilityImage>(image, 0, 0);
+  if( support.GetNumberOfPixels() == 0 )
+    {
+    // An all zero image still keeps a buffer of one voxel.
+    typename TProbabilityImage::SizeType oneVoxel;
+    oneVoxel.Fill(1);
+    support.SetIndex(image->GetBufferedRegion().GetIndex() );
+    support.SetSize(oneVoxel);
+    }
+  if( support.GetNumberOfPixels() * 10 > image->GetLargestPossibleRegion().GetNumberOfPixels() * 9 )
+    {
+    return ExpandSupportBufferedImage<TProbabilityImage>(image);
+    }
+  if( support == image->GetBufferedRegion() )
+    {
+    return image;
+    }
+  return BufferOnRegion<TProbabilityImage>(image.GetPointer(), support);
+}
+
+/**
+ * Resample a probability image onto the grid of referenceOutput, with
+ * backgroundValue outside of it, and keep the result buffered on its
+ * support only.  The input may be cropped with CropToNonBackgroundRegion.
+ */
+template <class TProbabilityImage, class TReferenceImage>
+typename TProbabilityImage::Pointer
+WarpProbabilityImageToSupport(const typename TProbabilityImage::Pointer & image,
+                              const TReferenceImage *referenceOutput,
+                              const typename TProbabilityImage::PixelType backgroundValue,
+                              const GenericTransformType::Pointer & warpTransform)
+{
+  typedef itk::ResampleImageFilter<TProbabilityImage, TProbabilityImage> ResamplerType;
+  typename ResamplerType::Pointer warper = ResamplerType::New();
+  warper->SetInput(image);
+  warper->SetTransform(warpTransform);
+  // warper->SetInterpolator(linearInt); // Default is linear
+  warper->SetOutputParametersFromImage(referenceOutput);
+  warper->SetDefaultPixelValue(backgroundValue);
+  warper->Update();
+  typename TProbabilityImage::Pointer warped = warper->GetOutput();
+  warped->DisconnectPipeline();
+  return CropToSupport<TProbabilityImage>(warped);
+}
+
 #endif // __BRAINSABCUtilities__hxx__
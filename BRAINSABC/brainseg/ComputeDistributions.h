@@ -19,6 +19,7 @@
 #ifndef __ComputeDistributions__h_
 #define __ComputeDistributions__h_
 #include "BRAINSABCUtilities.h"
+#include "BRAINSABCParallelReduce.h"
 #include <vector>
 #include <list>
 #include <map>
@@ -78,7 +79,7 @@ CombinedComputeDistributions( const std::vector<typename ByteImageType::Pointer>
                             SubjectCandidateRegions[iclass].GetPointer();
 
                         // NOTE:  vnl_math:eps is too small vnl_math::eps;
-                        CompensatedSummationType tmp_accumC = tbb::parallel_reduce(tbb::blocked_range3d<long>(0,size[2],1,
+                        CompensatedSummationType tmp_accumC = BRAINSABCParallelReduce(tbb::blocked_range3d<long>(0,size[2],1,
                                                                                        0,size[1],size[1]/2,
                                                                                        0,size[0],512),
                                                CompensatedSummationType(),
@@ -89,7 +90,7 @@ CombinedComputeDistributions( const std::vector<typename ByteImageType::Pointer>
                                                        const typename TProbabilityImage::IndexType currIndex = {{ii, jj, kk}};
                                                        // Here pure plugs mask implicitly comes in! as CandidateRegions are multiplied by purePlugsMask!
                                                        if (currentCandidateRegion->GetPixel(currIndex)) {
-                                                         const double currentProbValue = currentProbImage->GetPixel( currIndex);
+                                                         const double currentProbValue = GetSupportPixel(currentProbImage.GetPointer(), currIndex);
                                                          tmp += currentProbValue;
                                                        }
                                                      }
@@ -130,7 +131,7 @@ CombinedComputeDistributions( const std::vector<typename ByteImageType::Pointer>
                             im1Interp->SetInputImage(im1);
 
                             const CompensatedSummationType muSumFinal =
-                            tbb::parallel_reduce(tbb::blocked_range3d<long>(0,size[2],1,
+                            BRAINSABCParallelReduce(tbb::blocked_range3d<long>(0,size[2],1,
                                                                             0,size[1],size[1]/2,
                                                                             0,size[0],512),
                             CompensatedSummationType(),
@@ -144,7 +145,7 @@ CombinedComputeDistributions( const std::vector<typename ByteImageType::Pointer>
                                     PosteriorsList[0]->TransformIndexToPhysicalPoint(currIndex, currPoint);
                                     // Here pure plugs mask comes in, since CandidateRegions are multiplied by purePlugsMask!
                                     if (currentCandidateRegion->GetPixel(currIndex)) {
-                                      const double currentProbValue = currentProbImage->GetPixel(currIndex);
+                                      const double currentProbValue = GetSupportPixel(currentProbImage.GetPointer(), currIndex);
                                       // input volumes may have a different voxel lattice than the probability image
                                       double currentInputValue = 1;
                                       if (im1Interp->IsInsideBuffer(currPoint)) {
@@ -253,7 +254,7 @@ CombinedComputeDistributions( const std::vector<typename ByteImageType::Pointer>
                                     InputImageNNInterpolationType::New();
                                 im2Interp->SetInputImage(im2);
 
-                                CompensatedSummationType reduced_varC = tbb::parallel_reduce
+                                CompensatedSummationType reduced_varC = BRAINSABCParallelReduce
                                     (tbb::blocked_range3d<long>(0,size[2],1,
                                                                 0,size[1],size[1]/2,
                                                                 0,size[0],512),
@@ -270,8 +271,8 @@ CombinedComputeDistributions( const std::vector<typename ByteImageType::Pointer>
                                                                                                               currPoint);
                                                              // Here pure plugs mask comes in, since CandidateRegions are multiplied by purePlugsMask!
                                                              if (currentCandidateRegion->GetPixel(currIndex)) {
-                                                               const double currentProbValue = currentProbImage->GetPixel(
-                                                                   currIndex);
+                                                               const double currentProbValue = GetSupportPixel(
+                                                                   currentProbImage.GetPointer(), currIndex);
                                                                // input image values should be evaluated in physical space.
                                                                double inputValue1 = 1;
                                                                double inputValue2 = 1;
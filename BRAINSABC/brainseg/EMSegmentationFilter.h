@@ -37,6 +37,7 @@
 #include <map>
 #include <list>
 class AtlasDefinition;
+class EMSegmentationFilterBenchmarkAccess;
 
 /**
  * \class EMSegmentationFilter
@@ -215,8 +216,12 @@ public:
 
   ByteImagePointer GetThresholdedOutput(void);
 
+  /** The posteriors at full size */
   ProbabilityImageVectorType GetPosteriors();
 
+  /** One posterior at full size, without expanding the others */
+  ProbabilityImagePointer GetPosterior(const unsigned int index);
+
   MapOfInputImageVectors GetCorrected();
 
   MapOfInputImageVectors  GetRawCorrected();
@@ -276,11 +281,13 @@ protected:
   ByteImageVectorType
   UpdateIntensityBasedClippingOfPriors(const unsigned int CurrentEMIteration,
                                        const MapOfInputImageVectors  &intensityList,
-                                       const ProbabilityImageVectorType &WarpedPriorsList,
+                                       ProbabilityImageVectorType &WarpedPriorsList,
                                        ByteImagePointer &NonAirRegion);
 
   ByteImageVectorType ForceToOne(ProbabilityImageVectorType &WarpedPriorsList);
 private:
+  /** Times the posterior computations; see BRAINSABC/Benchmarks */
+  friend class EMSegmentationFilterBenchmarkAccess;
 
   void WritePartitionTable(const unsigned int CurrentEMIteration) const;
 
@@ -403,8 +410,13 @@ private:
       return count;
     }
 
+  // The warped priors and the posteriors only buffer the support of each
+  // class, see SupportBufferedImage.h.
   ProbabilityImageVectorType m_WarpedPriors;
-  ProbabilityImageVectorType m_OriginalSpacePriors;
+  // The atlas space priors are kept cropped to the support of each class;
+  // m_OriginalSpacePriorsSizes holds their full sizes.
+  ProbabilityImageVectorType            m_OriginalSpacePriors;
+  std::vector<ProbabilityImageSizeType> m_OriginalSpacePriorsSizes;
   ProbabilityImageVectorType m_Posteriors;
 
   std::string m_AtlasTransformType;
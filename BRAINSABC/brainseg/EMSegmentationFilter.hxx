@@ -27,21 +27,21 @@
 #include <cmath>
 #include <cstdlib>
 #include <algorithm>
+#include <functional>
 
 #include "itkAverageImageFilter.h"
-#include "itkSqrtImageFilter.h"
 #include "itkBSplineDownsampleImageFilter.h"
 #include "itkBinaryBallStructuringElement.h"
 #include "itkBinaryDilateImageFilter.h"
 #include "itkBinaryErodeImageFilter.h"
 #include "itkBinaryThresholdImageFilter.h"
-#include "itkBlendImageFilter.h"
 #include "itkConnectedComponentImageFilter.h"
 #include "itkDiscreteGaussianImageFilter.h"
 #include "itkHistogramMatchingImageFilter.h"
 #include "itkImageDuplicator.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
 #include "itkMinimumMaximumImageCalculator.h"
 #include "itkMultiModeHistogramThresholdBinaryImageFilter.h"
 #include "itkMultiplyImageFilter.h"
@@ -60,6 +60,7 @@
 #include "BRAINSFitSyN.h"
 #endif
 #include "BRAINSABCUtilities.h"
+#include "BRAINSTrace.h"
 #include "LLSBiasCorrector.h"
 
 // #include "QHullMSTClusteringProcess.h"
@@ -386,11 +387,11 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
          }
 
        // Here we find out that the prior with maximum value belongs to background or foreground
-       double maxPriorClassValue = Priors[0]->GetPixel( *vit );
+       double maxPriorClassValue = GetSupportPixel( Priors[0].GetPointer(), *vit );
        unsigned int       indexMaxPosteriorClassValue = 0;
        for( unsigned int iclass = 1; iclass < labelClasses.size() ; ++iclass)
          {
-         const double currentPriorClassValue = Priors[iclass]->GetPixel( *vit );
+         const double currentPriorClassValue = GetSupportPixel( Priors[iclass].GetPointer(), *vit );
          if( currentPriorClassValue > maxPriorClassValue )
            {
            maxPriorClassValue = currentPriorClassValue;
@@ -407,7 +408,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
          {
          //mv.push_back( Priors[c_indx]->GetPixel( *vit ) );
          // foreground and background classes should be added exclusively
-         mv[mvIndx] = (  Priors[c_indx]->GetPixel( *vit ) > 0.01 &&
+         mv[mvIndx] = (  GetSupportPixel( Priors[c_indx].GetPointer(), *vit ) > 0.01 &&
                          priorIsForegroundPriorVector[c_indx] == fgflag ) ? 1 : 0;
          ++mvIndx;
          }
@@ -490,10 +491,11 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                             const typename InputImageType::IndexType currTestIndex = {{ii, jj, kk}};
                             const LOOPITERTYPE rowIndex = pageRowOffset + ii;
                             // Here we find out that the prior, with maximum value at the current index, belongs to background or foreground
-                            double maxPriorClassValue = Priors[0]->GetPixel(currTestIndex);
+                            double maxPriorClassValue = GetSupportPixel(Priors[0].GetPointer(), currTestIndex);
                             unsigned int indexMaxPosteriorClassValue = 0;
                             for (unsigned int iclass = 1; iclass < labelClasses.size(); ++iclass) {
-                              const double currentPriorClassValue = Priors[iclass]->GetPixel(currTestIndex);
+                              const double currentPriorClassValue =
+                                  GetSupportPixel(Priors[iclass].GetPointer(), currTestIndex);
                               if (currentPriorClassValue > maxPriorClassValue) {
                                 maxPriorClassValue = currentPriorClassValue;
                                 indexMaxPosteriorClassValue = iclass;
@@ -525,8 +527,8 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                             while (colIndex - numOfInputImages < labelClasses.size()) // Add 15 more features from EM posteriors
                             {
                               // first input image and posteriors are in the same voxel space
-                              testMatrix(rowIndex, colIndex) = (Priors[colIndex - numOfInputImages]->GetPixel(
-                                  currTestIndex) > 0.01 &&
+                              testMatrix(rowIndex, colIndex) = (GetSupportPixel(
+                                  Priors[colIndex - numOfInputImages].GetPointer(), currTestIndex) > 0.01 &&
                                                                 priorIsForegroundPriorVector[colIndex -
                                                                                              numOfInputImages] ==
                                                                 fgflag) ? 1 : 0;
@@ -559,8 +561,9 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
 
   for( unsigned int iclass = 0; iclass < numClasses; iclass++ )
     {
-    Posteriors[iclass] = this->assignVectorToImage( Priors[iclass],
-                                                    liklihoodMatrix.get_column(iclass) );
+    // Only one class is dense at a time.
+    Posteriors[iclass] = CropToSupport<TProbabilityImage>(
+      this->assignVectorToImage( Priors[iclass], liklihoodMatrix.get_column(iclass) ) );
     /*
     // Smoothing filter
     typename SmoothingFilterType::Pointer smoothingFilter = SmoothingFilterType::New();
@@ -627,6 +630,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
 
   m_WarpedPriors.clear();
   m_OriginalSpacePriors.clear();
+  m_OriginalSpacePriorsSizes.clear();
   m_Posteriors.clear();
 
   m_InputImages.clear();
@@ -804,7 +808,9 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                         << std::distance(this->m_OriginalSpacePriors.begin(),imIt)
                         << "] has invalid dimension: only supports 3D images" << std::endl );
       }
-    const ProbabilityImageSizeType psize = (*imIt)->GetLargestPossibleRegion().GetSize();
+    // The priors are cropped, compare the size they were given with.
+    const ProbabilityImageSizeType psize =
+      this->m_OriginalSpacePriorsSizes[std::distance(this->m_OriginalSpacePriors.begin(),imIt)];
     if( atlasSize != psize )
       {
       itkExceptionMacro(<< "Normalized prior ["
@@ -899,7 +905,7 @@ void EMSegmentationFilter<TInputImage, TProbabilityImage>
         + this->m_PriorNames[iprob] + "_LEVEL_" + write_posteriors_level_stream.str() + ".nii.gz";
 
       muLogMacro(<< "Writing posterior images... " << fn <<  std::endl);
-      writer->SetInput(Posteriors[iprob]);
+      writer->SetInput(ExpandSupportBufferedImage<TProbabilityImage>(Posteriors[iprob]) );
       writer->SetFileName(fn);
       writer->UseCompressionOn();
       writer->Update();
@@ -919,6 +925,11 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
   ZeroNegativeValuesInPlace<TProbabilityImage>(this->m_OriginalSpacePriors);
   NormalizeProbListInPlace<TProbabilityImage>(this->m_OriginalSpacePriors);
   this->m_OriginalSpacePriors = priors;
+  this->m_OriginalSpacePriorsSizes.resize(priors.size() );
+  for( unsigned int i = 0; i < priors.size(); ++i )
+    {
+    this->m_OriginalSpacePriorsSizes[i] = priors[i]->GetLargestPossibleRegion().GetSize();
+    }
   this->Modified();
   m_UpdateRequired = true;
 }
@@ -1061,7 +1072,20 @@ std::vector<
 EMSegmentationFilter<TInputImage, TProbabilityImage>
 ::GetPosteriors()
 {
-  return m_Posteriors;
+  ProbabilityImageVectorType posteriors(m_Posteriors.size() );
+  for( unsigned int i = 0; i < m_Posteriors.size(); ++i )
+    {
+    posteriors[i] = this->GetPosterior(i);
+    }
+  return posteriors;
+}
+
+template <class TInputImage, class TProbabilityImage>
+typename EMSegmentationFilter<TInputImage, TProbabilityImage>::ProbabilityImagePointer
+EMSegmentationFilter<TInputImage, TProbabilityImage>
+::GetPosterior(const unsigned int index)
+{
+  return ExpandSupportBufferedImage<TProbabilityImage>(m_Posteriors[index]);
 }
 
 template <class TInputImage, class TProbabilityImage>
@@ -1115,6 +1139,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
 ::ComputeDistributions(const ByteImageVectorType & SubjectCandidateRegions,
                        const ProbabilityImageVectorType & probAllDistributions)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::ComputeDistributions");
   std::cout << "\n^^^^^^^^^^^^^^^^^^^^^^^^^^^" << std::endl;
   muLogMacro(<< "Computing Distributions..." << std::endl );
   std::cout << "^^^^^^^^^^^^^^^^^^^^^^^^^^^" << std::endl;
@@ -1208,10 +1233,19 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
   CHECK_NAN(invdenom, __FILE__, __LINE__, "\n  denom:" << denom );
   const MatrixType invcov = MatrixInverseType(currCovariance);
 
-  typename TProbabilityImage::Pointer post = TProbabilityImage::New();
-  post->CopyInformation(prior);
-  post->SetRegions(prior->GetLargestPossibleRegion() );
-  post->Allocate();
+  // The posterior is zero wherever the prior is zero, so it is only
+  // evaluated, and buffered, on the support of the prior.
+  const typename TProbabilityImage::RegionType support =
+    ComputeNonBackgroundRegion<TProbabilityImage>(prior, 0, 0);
+  if( support.GetNumberOfPixels() == 0 )
+    {
+    typename TProbabilityImage::SizeType oneVoxel;
+    oneVoxel.Fill(1);
+    return AllocateSupportBufferedImage<TProbabilityImage>(
+      prior.GetPointer(), typename TProbabilityImage::RegionType(prior->GetBufferedRegion().GetIndex(), oneVoxel) );
+    }
+  typename TProbabilityImage::Pointer post =
+    AllocateSupportBufferedImage<TProbabilityImage>(prior.GetPointer(), support);
 
   // create a map of input image interpolators
   MapOfInputImageInterpolatorVectors inputImageNNInterpolatorsList;
@@ -1230,11 +1264,12 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
       }
     }
 
-  const typename TProbabilityImage::SizeType size = post->GetLargestPossibleRegion().GetSize();
+  const typename TProbabilityImage::IndexType start = support.GetIndex();
+  const typename TProbabilityImage::SizeType  size = support.GetSize();
 
-  tbb::parallel_for(tbb::blocked_range3d<LOOPITERTYPE>(0,size[2],1,
-                                                       0,size[1],size[1]/2,
-                                                       0,size[0],512),
+  tbb::parallel_for(tbb::blocked_range3d<LOOPITERTYPE>(start[2],start[2] + size[2],1,
+                                                       start[1],start[1] + size[1],std::max<LOOPITERTYPE>(size[1]/2,1),
+                                                       start[0],start[0] + size[0],512),
                     [=](const tbb::blocked_range3d<LOOPITERTYPE> &r) {
                       for (LOOPITERTYPE kk = r.pages().begin(); kk < r.pages().end(); ++kk) {
                         for (LOOPITERTYPE jj = r.rows().begin(); jj < r.rows().end(); ++jj) {
@@ -1373,6 +1408,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                     typename ByteImageType::Pointer & nonAirRegion,
                     const unsigned int IterationID)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::ComputePosteriors");
   std::cout << "\n^^^^^^^^^^^^^^^^^^^^^^^^" << std::endl;
   muLogMacro(<< "Computing posteriors..." << std::endl);
   std::cout << "^^^^^^^^^^^^^^^^^^^^^^^^" << std::endl;
@@ -1438,17 +1474,28 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
     //
     for(size_t pp = 0 ; pp < KNNPosteriors.size(); ++pp )
       {
-      typedef itk::MultiplyImageFilter<TProbabilityImage,TProbabilityImage> MultiplyFilterType;
-      typename MultiplyFilterType::Pointer filter = MultiplyFilterType::New();
-      filter->SetInput(0,EMPosteriors[pp]);
-      filter->SetInput(1,KNNPosteriors[pp]);
-      filter->Update();
-
-      typedef itk::SqrtImageFilter<TProbabilityImage,TProbabilityImage> SqrtFilterType;
-      typename SqrtFilterType::Pointer sqrtFilter = SqrtFilterType::New();
-      sqrtFilter->SetInput( filter->GetOutput() );
-      sqrtFilter->Update();
-      AveragePosteriors[pp] = sqrtFilter->GetOutput();
+      // The geometric mean is zero outside the support of either posterior.
+      typename TProbabilityImage::RegionType averageRegion = EMPosteriors[pp]->GetBufferedRegion();
+      if( !averageRegion.Crop(KNNPosteriors[pp]->GetBufferedRegion() ) )
+        {
+        typename TProbabilityImage::SizeType oneVoxel;
+        oneVoxel.Fill(1);
+        averageRegion.SetSize(oneVoxel);
+        }
+      AveragePosteriors[pp] =
+        AllocateSupportBufferedImage<TProbabilityImage>(EMPosteriors[pp].GetPointer(), averageRegion);
+      for( itk::ImageRegionIteratorWithIndex<TProbabilityImage> it(AveragePosteriors[pp], averageRegion);
+           !it.IsAtEnd(); ++it )
+        {
+        const typename TProbabilityImage::IndexType currIndex = it.GetIndex();
+        const typename TProbabilityImage::PixelType product =
+          GetSupportPixel(EMPosteriors[pp].GetPointer(), currIndex)
+          * GetSupportPixel(KNNPosteriors[pp].GetPointer(), currIndex);
+        it.Set(static_cast<typename TProbabilityImage::PixelType>( std::sqrt(static_cast<double>( product ) ) ) );
+        }
+      // Release the inputs of this class before averaging the next one.
+      EMPosteriors[pp] = nullptr;
+      KNNPosteriors[pp] = nullptr;
       }
     // Normalize probability list such that all posterior values will sum up to 1.
     NormalizeProbListInPlace<TProbabilityImage>( AveragePosteriors );
@@ -1547,11 +1594,12 @@ FloatingPrecision
 EMSegmentationFilter<TInputImage, TProbabilityImage>
 ::ComputeLogLikelihood() const
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::ComputeLogLikelihood");
   const InputImageSizeType size = m_Posteriors[0]->GetLargestPossibleRegion().GetSize();
   const unsigned int computeInitialNumClasses = m_Posteriors.size();
 
   const CompensatedSummationType logLikelihoodFinal =
-      tbb::parallel_reduce(tbb::blocked_range3d<LOOPITERTYPE>(0, size[2], 1,
+      BRAINSABCParallelReduce(tbb::blocked_range3d<LOOPITERTYPE>(0, size[2], 1,
                                                               0, size[1], size[1]/2,
                                                               0, size[0], 512),
                            CompensatedSummationType(),
@@ -1569,7 +1617,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                                        // compute the
                                        // foreground.
                                      {
-                                       tmp += m_Posteriors[iclass]->GetPixel(currIndex);
+                                       tmp += GetSupportPixel(m_Posteriors[iclass].GetPointer(), currIndex);
                                      }
                                    }
                                    logLikelihood += std::log(tmp.GetSum());
@@ -1635,24 +1683,20 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                 const BackgroundValueVector & backgroundValues,
                 const GenericTransformType::Pointer warpTransform)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::WarpImageList");
   if( originalList.size() != backgroundValues.size() )
     {
     itkGenericExceptionMacro(<< "ERROR:  originalList and backgroundValues arrays sizes do not match" << std::endl);
     }
-  std::vector<typename TInputImage::Pointer> warpedList(originalList.size() );
+  ProbabilityImageVectorType warpedList(originalList.size() );
 
-  typedef itk::ResampleImageFilter<TInputImage, TInputImage> ResamplerType;
+  // Each class is cropped to its support as soon as it is warped, so only
+  // one of them is dense at a time.
   for( unsigned int vIndex = 0; vIndex < originalList.size(); vIndex++ )
     {
-    typename ResamplerType::Pointer warper = ResamplerType::New();
-    warper->SetInput(originalList[vIndex]);
-    warper->SetTransform(warpTransform);
-
-    // warper->SetInterpolator(linearInt); // Default is linear
-    warper->SetOutputParametersFromImage(referenceOutput);
-    warper->SetDefaultPixelValue(backgroundValues[vIndex]);
-    warper->Update();
-    warpedList[vIndex] = warper->GetOutput();
+    warpedList[vIndex] =
+      WarpProbabilityImageToSupport<TProbabilityImage>(originalList[vIndex], referenceOutput.GetPointer(),
+                                                       backgroundValues[vIndex], warpTransform);
     }
   return warpedList;
 }
@@ -1664,6 +1708,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                 const InputImagePointer referenceOutput,
                 const GenericTransformType::Pointer warpTransform)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::WarpImageList");
   typedef itk::ResampleImageFilter<TInputImage, TInputImage> ResamplerType;
 
   MapOfInputImageVectors warpedList;
@@ -1748,9 +1793,10 @@ typename EMSegmentationFilter<TInputImage, TProbabilityImage>::ByteImageVectorTy
 EMSegmentationFilter<TInputImage, TProbabilityImage>
 ::UpdateIntensityBasedClippingOfPriors(const unsigned int CurrentEMIteration,
                                        const MapOfInputImageVectors &intensityList,
-                                       const ProbabilityImageVectorType &WarpedPriorsList,
+                                       ProbabilityImageVectorType &WarpedPriorsList,
                                        typename ByteImageType::Pointer &ForegroundBrainRegion)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::UpdateIntensityBasedClippingOfPriors");
   // #################################################################
   // #################################################################
   // #################################################################
@@ -1764,175 +1810,251 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
   subjectCandidateRegions.resize(WarpedPriorsList.size() );
 
   { // StartValid Regions Section
-
-    tbb::mutex   stdoutMutex;
-    tbb::parallel_for(tbb::blocked_range<LOOPITERTYPE>(0,WarpedPriorsList.size(),1),
-                      [=,&stdoutMutex,&subjectCandidateRegions](const tbb::blocked_range<LOOPITERTYPE> &r) {
-                        for (LOOPITERTYPE i = r.begin(); i < r.end(); ++i) {
-                          std::ostringstream logMessage("\n*********************************************\n");
-                          typename ByteImageType::Pointer probThreshImage = nullptr;
-
-                          typedef itk::BinaryThresholdImageFilter<TProbabilityImage, ByteImageType> ProbThresholdType;
-                          typename ProbThresholdType::Pointer probThresh = ProbThresholdType::New();
-                          probThresh->SetInput(WarpedPriorsList[i]);
-                          probThresh->SetInsideValue(1);
-                          probThresh->SetOutsideValue(0);
-                          probThresh->SetLowerThreshold(0.1); // Derived empirically based on experiments on BrainWeb data
-                          // chance of being this structure
-                          // from the spatial probabilities
-                          probThresh->SetUpperThreshold(
-                              std::numeric_limits<typename TProbabilityImage::PixelType>::max());
-                          // No upper limit needed, values
-                          // should be between 0 and 1
-                          probThresh->Update();
-                          probThreshImage = probThresh->GetOutput();
-                          if (this->m_DebugLevel > 9) {
-                            std::stringstream CurrentEMIteration_stream("");
-                            CurrentEMIteration_stream << CurrentEMIteration;
-                            // Write the subject candidate regions
-
-                            std::ostringstream oss;
-                            oss << this->m_OutputDebugDir << "CANDIDIDATE_PROBTHRESH_" << this->m_PriorNames[i] <<
-                            "_LEVEL_"
-                            << CurrentEMIteration_stream.str() << ".nii.gz" << std::ends;
-                            std::string fn = oss.str();
-                            std::cout << "------------------------" << std::endl;
-                            logMessage << "Writing Subject Candidate Region: " << fn << std::endl;
-                            logMessage << std::endl;
-
-                            typedef itk::ImageFileWriter<ByteImageType> ByteWriterType;
-                            typename ByteWriterType::Pointer writer = ByteWriterType::New();
-                            writer->SetInput(probThreshImage);
-                            writer->SetFileName(fn.c_str());
-                            writer->UseCompressionOn();
-                            writer->Update();
-                          }
-
-                          // All input images to the MultiModeHistogramThresholdBinaryImageFilter
-                          // need to be at the same voxel space, so all input image map are resampled
-                          // to the lattice of the first key image using identity transform, since
-                          // they are already aligned in physical space.
-                          const MapOfInputImageVectors intensityImagesList =
-                              ResampleImageListToFirstKeyImage("Linear", intensityList);
-
-                          const unsigned int numberOfModes = TotalMapSize(intensityImagesList);
-
-                          typedef typename itk::MultiModeHistogramThresholdBinaryImageFilter<InputImageType,
-                              ByteImageType> ThresholdRegionFinderType;
-                          typename ThresholdRegionFinderType::ThresholdArrayType QuantileLowerThreshold(numberOfModes);
-                          typename ThresholdRegionFinderType::ThresholdArrayType QuantileUpperThreshold(numberOfModes);
-                          typename ThresholdRegionFinderType::Pointer thresholdRegionFinder = ThresholdRegionFinderType::New();
-                          // TODO:  Need to define PortionMaskImage from deformed probspace
-                          thresholdRegionFinder->SetBinaryPortionImage(ForegroundBrainRegion);
-                          unsigned int modeIndex = 0;
-                          for (typename MapOfInputImageVectors::const_iterator mapIt = intensityImagesList.begin();
-                               mapIt != intensityImagesList.end(); ++mapIt) {
-                            for (typename InputImageVector::const_iterator imIt = mapIt->second.begin();
-                                 imIt != mapIt->second.end(); ++imIt, ++modeIndex) {
-                              thresholdRegionFinder->SetInput(modeIndex, (*imIt));
-                              const std::string imageType = mapIt->first;
-                              const std::string priorType = this->m_PriorNames[i];
-                              if (m_TissueTypeThresholdMapsRange[priorType].find(imageType) ==
-                                  m_TissueTypeThresholdMapsRange[priorType].end()) {
-                                logMessage << "NOT FOUND:" << "[" << priorType << "," << imageType
-                                               << "]: [" << 0.00 << "," << 1.00 << "]"
-                                               <<  std::endl;
-                                QuantileLowerThreshold.SetElement(modeIndex, 0.00);
-                                QuantileUpperThreshold.SetElement(modeIndex, 1.00);
-                              }
-                              else {
-                                const float lower = m_TissueTypeThresholdMapsRange[priorType][imageType].GetLower();
-                                const float upper = m_TissueTypeThresholdMapsRange[priorType][imageType].GetUpper();
-                                logMessage <<  "[" << priorType << "," << imageType
-                                           << "]: [" << lower << "," << upper << "]" <<  std::endl;
-                                QuantileLowerThreshold.SetElement(modeIndex, lower);
-                                QuantileUpperThreshold.SetElement(modeIndex, upper);
-                                m_TissueTypeThresholdMapsRange[priorType][imageType].Print();
-                              }
-                            }
-                          }
-                          // Assume upto (2*0.025)% of intensities are noise that corrupts the image
-                          // min/max values
-                          thresholdRegionFinder->SetLinearQuantileThreshold(0.025);
-                          thresholdRegionFinder->SetQuantileLowerThreshold(QuantileLowerThreshold);
-                          thresholdRegionFinder->SetQuantileUpperThreshold(QuantileUpperThreshold);
-                          // thresholdRegionFinder->SetInsideValue(1);
-                          // thresholdRegionFinder->SetOutsideValue(0);//Greatly reduce the value to
-                          // zero.
-                          thresholdRegionFinder->Update();
-                          if (this->m_DebugLevel > 8) {
-                            std::stringstream CurrentEMIteration_stream("");
-                            CurrentEMIteration_stream << CurrentEMIteration;
-                            // Write the subject candidate regions
-
-                            std::ostringstream oss;
-                            oss << this->m_OutputDebugDir << "CANDIDIDATE_INTENSITY_REGION_" << this->m_PriorNames[i] <<
-                            "_LEVEL_"
-                            << CurrentEMIteration_stream.str() << ".nii.gz" << std::ends;
-                            std::string fn = oss.str();
-                            logMessage << "Writing Subject Candidate Region: " << fn << std::endl;
-                            logMessage << std::endl;
-
-                            typedef itk::ImageFileWriter<ByteImageType> ByteWriterType;
-                            typename ByteWriterType::Pointer writer = ByteWriterType::New();
-                            writer->SetInput(thresholdRegionFinder->GetOutput());
-                            writer->SetFileName(fn.c_str());
-                            writer->UseCompressionOn();
-                            writer->Update();
-                          }
-
-                          // Now multiply the warped priors by the subject candidate regions.
-                          typename itk::MultiplyImageFilter<ByteImageType, ByteImageType, ByteImageType>::Pointer multFilter =
-                              itk::MultiplyImageFilter<ByteImageType, ByteImageType, ByteImageType>::New();
-                          multFilter->SetInput1(probThreshImage);
-                          multFilter->SetInput2(thresholdRegionFinder->GetOutput());
-                          multFilter->Update();
-                          subjectCandidateRegions[i] = multFilter->GetOutput();
-                          {
-                          tbb::mutex::scoped_lock lock(stdoutMutex);  // Implements locking this entire section to one thread at a time
-                          muLogMacro(<< "\n==" << this->m_PriorNames[i] << "=========================\n" << logMessage.str() << std::endl);
-                          //lock implicity released when it goes out of scope
-                          }
-                        } // End loop over all warped priors
-                      });
-
-  { // Ensure that every candidate region has some value
-  const unsigned int candiateVectorSize = subjectCandidateRegions.size();
-  itk::ImageRegionIteratorWithIndex<ByteImageType>
-    firstCandidateIter(subjectCandidateRegions[0], subjectCandidateRegions[0]->GetLargestPossibleRegion() );
-  size_t AllZeroCounts = 0;
-  while( !firstCandidateIter.IsAtEnd() )
-    {
-    const typename ByteImageType::IndexType myIndex = firstCandidateIter.GetIndex();
-    bool AllPixelsAreZero = true;
-
-    for( unsigned int k = 0; ( k < candiateVectorSize ) && AllPixelsAreZero; k++ )
+  // All input images need to be at the same voxel space, so all input image
+  // map are resampled to the lattice of the first key image using identity
+  // transform, since they are already aligned in physical space.
+  const MapOfInputImageVectors intensityImagesList = ResampleImageListToFirstKeyImage("Linear", intensityList);
+
+  InputImageVector         modeImages;
+  std::vector<std::string> modeImageTypes;
+  for( typename MapOfInputImageVectors::const_iterator mapIt = intensityImagesList.begin();
+       mapIt != intensityImagesList.end(); ++mapIt )
+    {
+    for( typename InputImageVector::const_iterator imIt = mapIt->second.begin();
+         imIt != mapIt->second.end(); ++imIt )
       {
-      const typename ByteImageType::PixelType value = subjectCandidateRegions[k]->GetPixel(myIndex);
-      if( value > 0 )
+      modeImages.push_back(*imIt);
+      modeImageTypes.push_back(mapIt->first);
+      }
+    }
+  const unsigned int numberOfModes = modeImages.size();
+  const unsigned int numberOfPriors = WarpedPriorsList.size();
+
+  // The histogram quantiles of a modality within the foreground do not
+  // depend on the prior, compute them once per modality.
+  typedef typename itk::MultiModeHistogramThresholdBinaryImageFilter<InputImageType, ByteImageType>
+    ThresholdRegionFinderType;
+  typedef typename ThresholdRegionFinderType::QuantileCalculatorType QuantileCalculatorType;
+  // Assume upto (2*0.025)% of intensities are noise that corrupts the image
+  // min/max values
+  constexpr double linearQuantileThreshold = 0.025;
+  std::vector<typename QuantileCalculatorType::Pointer> quantileCalculators(numberOfModes);
+  for( unsigned int m = 0; m < numberOfModes; ++m )
+    {
+    quantileCalculators[m] = QuantileCalculatorType::New();
+    quantileCalculators[m]->SetImage(modeImages[m]);
+    quantileCalculators[m]->SetQuantileLowerThreshold(linearQuantileThreshold);
+    quantileCalculators[m]->SetQuantileUpperThreshold(1.0 - linearQuantileThreshold);
+    // TODO:  Need to define PortionMaskImage from deformed probspace
+    quantileCalculators[m]->SetBinaryPortionImage(ForegroundBrainRegion);
+    quantileCalculators[m]->Calculate();
+    }
+
+  // Intensity window of every prior in every modality, indexed [prior * numberOfModes + mode]
+  std::vector<InputImagePixelType> intensityLower(numberOfPriors * numberOfModes);
+  std::vector<InputImagePixelType> intensityUpper(numberOfPriors * numberOfModes);
+  for( unsigned int i = 0; i < numberOfPriors; ++i )
+    {
+    std::ostringstream logMessage("\n*********************************************\n");
+    const std::string  priorType = this->m_PriorNames[i];
+    for( unsigned int m = 0; m < numberOfModes; ++m )
+      {
+      const std::string imageType = modeImageTypes[m];
+      double            quantileLower = 0.00;
+      double            quantileUpper = 1.00;
+      if( m_TissueTypeThresholdMapsRange[priorType].find(imageType) ==
+          m_TissueTypeThresholdMapsRange[priorType].end() )
+        {
+        logMessage << "NOT FOUND:" << "[" << priorType << "," << imageType
+                   << "]: [" << 0.00 << "," << 1.00 << "]" << std::endl;
+        }
+      else
         {
-        AllPixelsAreZero = false;
+        quantileLower = m_TissueTypeThresholdMapsRange[priorType][imageType].GetLower();
+        quantileUpper = m_TissueTypeThresholdMapsRange[priorType][imageType].GetUpper();
+        logMessage << "[" << priorType << "," << imageType
+                   << "]: [" << quantileLower << "," << quantileUpper << "]" << std::endl;
+        m_TissueTypeThresholdMapsRange[priorType][imageType].Print();
         }
+      ThresholdRegionFinderType::ComputeIntensityThresholds(quantileCalculators[m], linearQuantileThreshold,
+                                                            quantileLower, quantileUpper,
+                                                            intensityLower[i * numberOfModes + m],
+                                                            intensityUpper[i * numberOfModes + m]);
       }
+    muLogMacro(<< "\n==" << priorType << "=========================\n" << logMessage.str() << std::endl);
+    }
+
+  const typename TProbabilityImage::SizeType size = WarpedPriorsList[0]->GetLargestPossibleRegion().GetSize();
+  for( unsigned int m = 0; m < numberOfModes; ++m )
+    {
+    if( modeImages[m]->GetLargestPossibleRegion().GetSize() != size )
+      {
+      itkExceptionMacro(<< "Image data size mismatch " << modeImages[m]->GetLargestPossibleRegion().GetSize()
+                        << " != " << size << "." << std::endl );
+      }
+    }
+  for( unsigned int i = 0; i < numberOfPriors; ++i )
+    {
+    subjectCandidateRegions[i] = ByteImageType::New();
+    subjectCandidateRegions[i]->CopyInformation(WarpedPriorsList[i]);
+    subjectCandidateRegions[i]->SetRegions(WarpedPriorsList[i]->GetLargestPossibleRegion() );
+    subjectCandidateRegions[i]->Allocate();
+    }
 
-    if( AllPixelsAreZero ) // If all candidate regions are zero, then force
-                           // to most likely background value.
+  constexpr typename TProbabilityImage::PixelType minimumPriorValue = 0.1;
+  if( this->m_DebugLevel > 8 )
+    {
+    // The two factors of each candidate region, only formed when written.
+    std::stringstream CurrentEMIteration_stream("");
+    CurrentEMIteration_stream << CurrentEMIteration;
+    for( unsigned int i = 0; i < numberOfPriors; ++i )
       {
-      AllZeroCounts++;
-      for( unsigned int k = 0; k < candiateVectorSize; k++ )
+      typename ByteImageType::Pointer probThreshImage = ByteImageType::New();
+      probThreshImage->CopyInformation(WarpedPriorsList[i]);
+      probThreshImage->SetRegions(WarpedPriorsList[i]->GetLargestPossibleRegion() );
+      probThreshImage->Allocate();
+      typename ByteImageType::Pointer intensityRegionImage = ByteImageType::New();
+      intensityRegionImage->CopyInformation(WarpedPriorsList[i]);
+      intensityRegionImage->SetRegions(WarpedPriorsList[i]->GetLargestPossibleRegion() );
+      intensityRegionImage->Allocate();
+      for( itk::ImageRegionIteratorWithIndex<ByteImageType> it(intensityRegionImage,
+                                                               intensityRegionImage->GetLargestPossibleRegion() );
+           !it.IsAtEnd(); ++it )
         {
-        if( this->m_PriorIsForegroundPriorVector[k] == false )
+        const typename ByteImageType::IndexType currIndex = it.GetIndex();
+        bool inside = true;
+        for( unsigned int m = 0; m < numberOfModes && inside; ++m )
           {
-          subjectCandidateRegions[k]->SetPixel(myIndex, 1);
-          WarpedPriorsList[k]->SetPixel(myIndex, 0.05);
+          const InputImagePixelType value = modeImages[m]->GetPixel(currIndex);
+          inside = intensityLower[i * numberOfModes + m] <= value && value <= intensityUpper[i * numberOfModes + m];
           }
+        it.Set(inside ? 1 : 0);
+        probThreshImage->SetPixel(currIndex,
+                                  GetSupportPixel(WarpedPriorsList[i].GetPointer(), currIndex) >= minimumPriorValue ? 1 : 0);
+        }
+
+      typedef itk::ImageFileWriter<ByteImageType> ByteWriterType;
+      typename ByteWriterType::Pointer writer = ByteWriterType::New();
+      writer->UseCompressionOn();
+      if( this->m_DebugLevel > 9 )
+        {
+        std::ostringstream oss;
+        oss << this->m_OutputDebugDir << "CANDIDIDATE_PROBTHRESH_" << this->m_PriorNames[i] << "_LEVEL_"
+            << CurrentEMIteration_stream.str() << ".nii.gz" << std::ends;
+        muLogMacro(<< "Writing Subject Candidate Region: " << oss.str() << std::endl);
+        writer->SetInput(probThreshImage);
+        writer->SetFileName(oss.str().c_str() );
+        writer->Update();
         }
+      std::ostringstream oss;
+      oss << this->m_OutputDebugDir << "CANDIDIDATE_INTENSITY_REGION_" << this->m_PriorNames[i] << "_LEVEL_"
+          << CurrentEMIteration_stream.str() << ".nii.gz" << std::ends;
+      muLogMacro(<< "Writing Subject Candidate Region: " << oss.str() << std::endl);
+      writer->SetInput(intensityRegionImage);
+      writer->SetFileName(oss.str().c_str() );
+      writer->Update();
       }
-    ++firstCandidateIter;
     }
 
+  // One sweep computes the candidate region of every prior: a voxel is a
+  // candidate when the prior is at least 0.1 (derived empirically based on
+  // experiments on BrainWeb data) and every modality is within the intensity
+  // window of the prior.  Voxels that are a candidate for no prior are
+  // counted and bounded here, and forced to the background priors below.
+  struct NoCandidateVoxels
+    {
+    size_t                    count;
+    ByteImageType::RegionType bounds;
+    };
+  NoCandidateVoxels noCandidateIdentity;
+  noCandidateIdentity.count = 0;
+  ByteImageType::SizeType oneVoxel;
+  oneVoxel.Fill(1);
+  const NoCandidateVoxels noCandidate =
+    tbb::parallel_reduce(tbb::blocked_range3d<LOOPITERTYPE>(0,size[2],1,0,size[1],size[1]/2,0,size[0],512),
+                         noCandidateIdentity,
+                         [&](const tbb::blocked_range3d<LOOPITERTYPE> & r, NoCandidateVoxels found) -> NoCandidateVoxels {
+                           std::vector<InputImagePixelType> modeValues(numberOfModes);
+                           for (LOOPITERTYPE kk = r.pages().begin(); kk < r.pages().end(); ++kk) {
+                             for (LOOPITERTYPE jj = r.rows().begin(); jj < r.rows().end(); ++jj) {
+                               for (LOOPITERTYPE ii = r.cols().begin(); ii < r.cols().end(); ++ii) {
+                                 const typename ByteImageType::IndexType currIndex = {{ii, jj, kk}};
+                                 for (unsigned int m = 0; m < numberOfModes; ++m) {
+                                   modeValues[m] = modeImages[m]->GetPixel(currIndex);
+                                 }
+                                 bool AllPixelsAreZero = true;
+                                 for (unsigned int i = 0; i < numberOfPriors; ++i) {
+                                   bool inside =
+                                     GetSupportPixel(WarpedPriorsList[i].GetPointer(), currIndex) >= minimumPriorValue;
+                                   const InputImagePixelType *lower = &intensityLower[i * numberOfModes];
+                                   const InputImagePixelType *upper = &intensityUpper[i * numberOfModes];
+                                   for (unsigned int m = 0; m < numberOfModes && inside; ++m) {
+                                     inside = lower[m] <= modeValues[m] && modeValues[m] <= upper[m];
+                                   }
+                                   subjectCandidateRegions[i]->SetPixel(currIndex, inside ? 1 : 0);
+                                   AllPixelsAreZero = AllPixelsAreZero && !inside;
+                                 }
+                                 if (AllPixelsAreZero) {
+                                   ++found.count;
+                                   found.bounds = BoundingRegionUnion(found.bounds,
+                                                                      ByteImageType::RegionType(currIndex, oneVoxel));
+                                 }
+                               }
+                             }
+                           }
+                           return found;
+                         },
+                         [](NoCandidateVoxels a, const NoCandidateVoxels & b) -> NoCandidateVoxels {
+                           a.count += b.count;
+                           a.bounds = BoundingRegionUnion(a.bounds, b.bounds);
+                           return a;
+                         });
+  const size_t AllZeroCounts = noCandidate.count;
+
   if( AllZeroCounts != 0 )
     {
+    // If all candidate regions are zero, then force to most likely
+    // background value.  The background priors may only be buffered on
+    // their support, so they are first grown to cover these voxels.
+    for( unsigned int k = 0; k < numberOfPriors; ++k )
+      {
+      const typename TProbabilityImage::RegionType bufferedRegion = WarpedPriorsList[k]->GetBufferedRegion();
+      if( this->m_PriorIsForegroundPriorVector[k] == false && !bufferedRegion.IsInside(noCandidate.bounds) )
+        {
+        WarpedPriorsList[k] = BufferOnRegion<TProbabilityImage>(WarpedPriorsList[k].GetPointer(),
+                                                                BoundingRegionUnion(bufferedRegion, noCandidate.bounds) );
+        }
+      }
+    const LOOPITERTYPE boundsStart[3] = { static_cast<LOOPITERTYPE>( noCandidate.bounds.GetIndex(0) ),
+                                          static_cast<LOOPITERTYPE>( noCandidate.bounds.GetIndex(1) ),
+                                          static_cast<LOOPITERTYPE>( noCandidate.bounds.GetIndex(2) ) };
+    const LOOPITERTYPE boundsEnd[3] = { boundsStart[0] + static_cast<LOOPITERTYPE>( noCandidate.bounds.GetSize(0) ),
+                                        boundsStart[1] + static_cast<LOOPITERTYPE>( noCandidate.bounds.GetSize(1) ),
+                                        boundsStart[2] + static_cast<LOOPITERTYPE>( noCandidate.bounds.GetSize(2) ) };
+    tbb::parallel_for(tbb::blocked_range<LOOPITERTYPE>(boundsStart[2], boundsEnd[2], 1),
+                      [&](const tbb::blocked_range<LOOPITERTYPE> & r) {
+                        for (LOOPITERTYPE kk = r.begin(); kk < r.end(); ++kk) {
+                          for (LOOPITERTYPE jj = boundsStart[1]; jj < boundsEnd[1]; ++jj) {
+                            for (LOOPITERTYPE ii = boundsStart[0]; ii < boundsEnd[0]; ++ii) {
+                              const typename ByteImageType::IndexType currIndex = {{ii, jj, kk}};
+                              bool AllPixelsAreZero = true;
+                              for (unsigned int i = 0; i < numberOfPriors && AllPixelsAreZero; ++i) {
+                                AllPixelsAreZero = subjectCandidateRegions[i]->GetPixel(currIndex) == 0;
+                              }
+                              if (!AllPixelsAreZero) {
+                                continue;
+                              }
+                              for (unsigned int k = 0; k < numberOfPriors; ++k) {
+                                if (this->m_PriorIsForegroundPriorVector[k] == false) {
+                                  subjectCandidateRegions[k]->SetPixel(currIndex, 1);
+                                  WarpedPriorsList[k]->SetPixel(currIndex, 0.05);
+                                }
+                              }
+                            }
+                          }
+                        }
+                      });
+
     std::cout << "^^^^^^^^^^^^^^^^" << std::endl;
     std::cout << "^^^^^^^^^^^^^^^^" << std::endl;
     std::cout << "^^^^^^^^^^^^^^^^" << std::endl;
@@ -1947,7 +2069,6 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
     std::cout << "^^^^^^^^^^^^^^^^" << std::endl;
     std::cout << "^^^^^^^^^^^^^^^^" << std::endl;
     }
-  }
   if( this->m_DebugLevel > 5 )
     {
     std::stringstream CurrentEMIteration_stream("");
@@ -2017,6 +2138,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
                            const ProbabilityImageVectorType & ProbList2,
                            ProbabilityImageVectorType & ReturnBlendedProbList)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::BlendPosteriorsAndPriors");
   for( unsigned int k = 0; k < ProbList2.size(); k++ )
     {
     std::cout << "Start Blending Prior:" << k << std::endl;
@@ -2043,14 +2165,20 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
       // break things apart artificially.
       std::cout << "\nBlending Priors with Posteriors with formula: " << (blendPosteriorPercentage)
                 << "*Posterior + " << (1.0 - blendPosteriorPercentage) << "*Prior" << std::endl;
-      typedef itk::BlendImageFilter<TProbabilityImage, TProbabilityImage> BlenderType;
-      typename BlenderType::Pointer myBlender = BlenderType::New();
-      myBlender->SetInput1(ProbList1[k]);
-      myBlender->SetInput2(ProbList2[k]);
-      myBlender->SetBlend1(blendPosteriorPercentage);
-      myBlender->SetBlend2(1.0 - blendPosteriorPercentage);
-      myBlender->Update();
-      multInputImage = myBlender->GetOutput();
+      // The blend is zero outside the support of both inputs.
+      const typename TProbabilityImage::RegionType blendRegion =
+        BoundingRegionUnion(ProbList1[k]->GetBufferedRegion(), ProbList2[k]->GetBufferedRegion() );
+      multInputImage = AllocateSupportBufferedImage<TProbabilityImage>(ProbList2[k].GetPointer(), blendRegion);
+      for( itk::ImageRegionIteratorWithIndex<TProbabilityImage> it(multInputImage, blendRegion);
+           !it.IsAtEnd(); ++it )
+        {
+        const typename TProbabilityImage::IndexType currIndex = it.GetIndex();
+        double acc = static_cast<double>( GetSupportPixel(ProbList1[k].GetPointer(), currIndex) )
+          * blendPosteriorPercentage;
+        acc += static_cast<double>( GetSupportPixel(ProbList2[k].GetPointer(), currIndex) )
+          * ( 1.0 - blendPosteriorPercentage );
+        it.Set(static_cast<typename TProbabilityImage::PixelType>( acc ) );
+        }
       }
     else
       {
@@ -2099,7 +2227,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
         template_index_stream << this->m_PriorNames[vIndex];
         const std::string fn = this->m_OutputDebugDir + "/WARPED_PRIOR_" + template_index_stream.str() + "_LEVEL_"
         + CurrentEMIteration_stream.str() + ".nii.gz";
-        writer->SetInput(m_WarpedPriors[vIndex]);
+        writer->SetInput(ExpandSupportBufferedImage<TProbabilityImage>(m_WarpedPriors[vIndex]) );
         writer->SetFileName(fn.c_str() );
         writer->Update();
         muLogMacro( << "DEBUG:  Wrote image " << fn <<  std::endl);
@@ -2131,7 +2259,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
       // "PRIOR_INDEX_"+prior_index_stream.str()+"_LEVEL_"+CurrentEMIteration_stream.str()+".nii.gz";
       const std::string fn = this->m_OutputDebugDir + "BLENDCLIPPED_PRIOR_INDEX_" + this->m_PriorNames[k] + "_LEVEL_"
         + CurrentEMIteration_stream.str() + ".nii.gz";
-      writer->SetInput(m_WarpedPriors[k]);
+      writer->SetInput(ExpandSupportBufferedImage<TProbabilityImage>(m_WarpedPriors[k]) );
       writer->SetFileName(fn.c_str() );
       writer->Update();
       muLogMacro( << "DEBUG:  Wrote image " << fn <<  std::endl);
@@ -2144,6 +2272,7 @@ void
 EMSegmentationFilter<TInputImage, TProbabilityImage>
 ::UpdateTransformation(const unsigned int /*CurrentEMIteration*/)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::UpdateTransformation");
   if( m_AtlasTransformType == "SyN" )
     {
     muLogMacro(<< "HACK: " << m_AtlasTransformType <<  " not instumented for transformation update."  << std::endl );
@@ -2404,6 +2533,15 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
     //
     m_PriorsBackgroundValues[this->GetAirIndex()] = 1;
     }
+    // Most classes are background over most of the atlas.  Only the support
+    // of each prior is needed to warp it, so the rest is released for the
+    // duration of the EM loop.
+    for( unsigned int i = 0; i < this->m_OriginalSpacePriors.size(); ++i )
+      {
+      this->m_OriginalSpacePriors[i] =
+        CropToNonBackgroundRegion<TProbabilityImage>(this->m_OriginalSpacePriors[i],
+                                                     this->m_PriorsBackgroundValues[i]);
+      }
 
     this->EMLoop();
     m_UpdateRequired = false;
@@ -2420,6 +2558,7 @@ void
 EMSegmentationFilter<TInputImage, TProbabilityImage>
 ::EMLoop()
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::EMLoop");
   if( this->m_TemplateGenericTransform.IsNull() )
     {
     itkExceptionMacro( << "ERROR:  Must suppply an intial transformation!" );
@@ -2573,7 +2712,9 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
   unsigned int CurrentEMIteration = 1;
   while( !converged && ( CurrentEMIteration <= m_MaximumIterations ) )
     {
-    // Recompute posteriors, not at full resolution
+    // Recompute posteriors, not at full resolution.  The previous ones are
+    // not used by ComputePosteriors, release them first.
+    this->m_Posteriors.clear();
     this->m_Posteriors =
       this->ComputePosteriors(this->m_WarpedPriors, this->m_PriorWeights,
                               this->m_CorrectedImages,
@@ -2605,6 +2746,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
     // value of
     //
     // m_TemplateGenericTransform.
+    this->m_WarpedPriors.clear();
     this->m_WarpedPriors =
       WarpImageList(this->m_OriginalSpacePriors,
                     this->GetFirstInputImage(),
@@ -2673,6 +2815,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
 
   muLogMacro(<< "Done computing posteriors with " << CurrentEMIteration << " iterations" << std::endl);
 
+  this->m_Posteriors.clear();
   this->m_Posteriors = this->ComputePosteriors(this->m_WarpedPriors, this->m_PriorWeights,
                                                this->m_CorrectedImages,
                                                this->m_ListOfClassStatistics,
@@ -2732,6 +2875,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>
               const int DebugLevel,
               const std::string& OutputDebugDir)
 {
+  BRAINS_TRACE_SCOPE("EMSegmentationFilter::CorrectBias");
 
   if( degree == 0 )
     {
@@ -341,7 +341,7 @@ LLSBiasCorrector<TInputImage, TProbabilityImage>
 
   {
       const std::vector<CompensatedSummationType> local_XStd_final =
-          tbb::parallel_reduce(tbb::blocked_range<IterType>(m_ValidIndicies.begin(), m_ValidIndicies.end(),1),
+          BRAINSABCParallelReduce(tbb::blocked_range<IterType>(m_ValidIndicies.begin(), m_ValidIndicies.end(),1),
           std::vector<CompensatedSummationType>(),
       [=](const tbb::blocked_range<IterType> &rng,
           std::vector<CompensatedSummationType> local_XStd) -> std::vector<CompensatedSummationType> {
@@ -610,7 +610,7 @@ LLSBiasCorrector<TInputImage, TProbabilityImage>
                   const MatrixType &invCov = invCovars[iclass];
 
                   const double w =
-                      m_BiasPosteriors[iclass]->GetPixel(currProbIndex) * invCov(modality1, modality2);
+                      GetSupportPixel(m_BiasPosteriors[iclass].GetPointer(), currProbIndex) * invCov(modality1, modality2);
                   sumW += w;
                   recon += w * this->m_ListOfClassStatistics[iclass].m_Means[mapIt2->first];
                 }
@@ -665,7 +665,7 @@ LLSBiasCorrector<TInputImage, TProbabilityImage>
                                 double sumW = DBL_EPSILON;
                                 for (unsigned int iclass = 0; iclass < numClasses; iclass++) {
                                   const MatrixType &invCov = invCovars[iclass];
-                                  double w = m_BiasPosteriors[iclass]->GetPixel(currProbIndex)
+                                  double w = GetSupportPixel(m_BiasPosteriors[iclass].GetPointer(), currProbIndex)
                                              * invCov(ichan, jchan);
                                   sumW += w;
                                 }
@@ -0,0 +1,512 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __BRAINSBenchmark_h
+#define __BRAINSBenchmark_h
+
+#include "BRAINSThreadBudget.h"
+#include "BRAINSTrace.h"
+#include "BRAINSToolsVersion.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include <itksys/SystemInformation.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace BRAINSBenchmark
+{
+/** A prepared benchmark: the call that is timed, and how many items
+ *  (voxels, points, ...) one call processes. */
+struct Kernel
+{
+  Kernel() : NumberOfItems(0.0)
+  {
+  }
+
+  std::function<void()> Run;
+  double                NumberOfItems;
+};
+
+/** Builds the synthetic inputs of a benchmark for one problem size.  It is
+ *  called inside the thread budget being measured, so objects that size their
+ *  thread pools at construction see the right count; it is never timed. */
+typedef std::function<Kernel(unsigned int size)> KernelFactory;
+
+/**
+ * \class BenchmarkRunner
+ *
+ * Command line driven timing harness shared by the *Benchmark programs.
+ * Every registered benchmark is run for each size and each thread budget
+ * (ITK, TBB and OpenCV together, see BRAINSUtils::ThreadBudget): one untimed
+ * warm-up call, then the timed repetitions.  One JSON object per line is
+ * written for every (benchmark, size, threads) combination so results can be
+ * collected across builds and compared.
+ *
+ * Memory comes from the process high-water mark (ru_maxrss), which never
+ * decreases.  processPeakRSSKiB is that mark after the combination, so it
+ * includes every combination run before it in the same process.
+ * peakRSSGrowthKiB is how far the combination, inputs included, raised the
+ * mark.  It is 0 when the combination stayed below an earlier peak, so run
+ * one combination per process (--filter, --sizes, --threads) to measure it
+ * in isolation.
+ *
+ *   --sizes 64,128      problem sizes, in the unit of each benchmark
+ *                       (voxels per side unless noted); default per benchmark
+ *   --threads 1,8       thread budgets; default 1 and all available cores
+ *   --repetitions N     timed calls per combination (default 3)
+ *   --output file       append the JSON lines to file instead of stdout
+ *   --filter text       only run benchmarks whose name contains text
+ *   --quick             smallest default size, 1 thread, 1 repetition
+ *   --list              print the benchmark names and exit
+ */
+class BenchmarkRunner
+{
+public:
+  BenchmarkRunner(const std::string & suiteName, int argc, char *argv[]) :
+    m_SuiteName(suiteName),
+    m_Repetitions(3),
+    m_Quick(false),
+    m_List(false),
+    m_ArgumentsAreValid(true)
+  {
+    for( int i = 1; i < argc; ++i )
+      {
+      const std::string argument(argv[i]);
+      const bool        hasValue = ( i + 1 < argc );
+      if( argument == "--sizes" && hasValue )
+        {
+        m_Sizes = ParseList<unsigned int>(argv[++i]);
+        }
+      else if( argument == "--threads" && hasValue )
+        {
+        m_Threads = ParseList<int>(argv[++i]);
+        }
+      else if( argument == "--repetitions" && hasValue )
+        {
+        m_Repetitions = std::max(std::atoi(argv[++i]), 1);
+        }
+      else if( argument == "--output" && hasValue )
+        {
+        m_OutputFileName = argv[++i];
+        }
+      else if( argument == "--filter" && hasValue )
+        {
+        m_Filter = argv[++i];
+        }
+      else if( argument == "--quick" )
+        {
+        m_Quick = true;
+        }
+      else if( argument == "--list" )
+        {
+        m_List = true;
+        }
+      else
+        {
+        std::cerr << "Unknown or incomplete argument: " << argument << std::endl
+                  << "Usage: " << argv[0] << " [--sizes n,...] [--threads n,...] [--repetitions n]"
+                  << " [--output file] [--filter text] [--quick] [--list]" << std::endl;
+        m_ArgumentsAreValid = false;
+        }
+      }
+  }
+
+  /** Register a benchmark with its default problem sizes */
+  void Add(const std::string & name, const std::vector<unsigned int> & defaultSizes, const KernelFactory & factory)
+  {
+    BenchmarkEntry entry;
+    entry.Name = name;
+    entry.DefaultSizes = defaultSizes;
+    entry.Factory = factory;
+    m_Benchmarks.push_back(entry);
+  }
+
+  /** Run every selected benchmark; the return value is the exit status */
+  int Execute()
+  {
+    if( !m_ArgumentsAreValid )
+      {
+      return EXIT_FAILURE;
+      }
+    if( m_List )
+      {
+      for( size_t b = 0; b < m_Benchmarks.size(); ++b )
+        {
+        std::cout << m_Benchmarks[b].Name << std::endl;
+        }
+      return EXIT_SUCCESS;
+      }
+
+    std::ofstream outputFile;
+    if( !m_OutputFileName.empty() )
+      {
+      outputFile.open(m_OutputFileName.c_str(), std::ios::out | std::ios::app);
+      if( !outputFile.is_open() )
+        {
+        std::cerr << "Could not open benchmark output file " << m_OutputFileName << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    std::ostream & output = outputFile.is_open() ? static_cast<std::ostream &>( outputFile ) : std::cout;
+
+    std::vector<int> threadCounts = m_Threads;
+    if( m_Quick )
+      {
+      threadCounts.assign(1, 1);
+      }
+    else if( threadCounts.empty() )
+      {
+      threadCounts.push_back(1);
+      const int available = BRAINSUtils::GetAvailableNumberOfThreads();
+      if( available > 1 )
+        {
+        threadCounts.push_back(available);
+        }
+      }
+    const unsigned int repetitions = m_Quick ? 1 : m_Repetitions;
+
+    int numberOfFailures = 0;
+    for( size_t b = 0; b < m_Benchmarks.size(); ++b )
+      {
+      const BenchmarkEntry & entry = m_Benchmarks[b];
+      if( !m_Filter.empty() && entry.Name.find(m_Filter) == std::string::npos )
+        {
+        continue;
+        }
+      std::vector<unsigned int> sizes = m_Sizes.empty() ? entry.DefaultSizes : m_Sizes;
+      if( m_Quick && !entry.DefaultSizes.empty() )
+        {
+        sizes.assign(1, entry.DefaultSizes.front() );
+        }
+      for( size_t s = 0; s < sizes.size(); ++s )
+        {
+        for( size_t t = 0; t < threadCounts.size(); ++t )
+          {
+          try
+            {
+            this->RunOne(entry, sizes[s], threadCounts[t], repetitions, output);
+            }
+          catch( itk::ExceptionObject & err )
+            {
+            std::cerr << "Benchmark " << entry.Name << " failed at size " << sizes[s] << ":" << std::endl
+                      << err << std::endl;
+            ++numberOfFailures;
+            }
+          catch( std::exception & err )
+            {
+            std::cerr << "Benchmark " << entry.Name << " failed at size " << sizes[s] << ": "
+                      << err.what() << std::endl;
+            ++numberOfFailures;
+            }
+          }
+        }
+      }
+    return ( numberOfFailures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+private:
+  struct BenchmarkEntry
+  {
+    std::string               Name;
+    std::vector<unsigned int> DefaultSizes;
+    KernelFactory             Factory;
+  };
+
+  template <typename TValue>
+  static std::vector<TValue> ParseList(const std::string & text)
+  {
+    std::vector<TValue> values;
+    std::istringstream  stream(text);
+    std::string         item;
+    while( std::getline(stream, item, ',') )
+      {
+      if( !item.empty() )
+        {
+        values.push_back( static_cast<TValue>( std::atoi( item.c_str() ) ) );
+        }
+      }
+    return values;
+  }
+
+  static std::string JSONString(const std::string & text)
+  {
+    std::string quoted("\"");
+    for( std::string::const_iterator c = text.begin(); c != text.end(); ++c )
+      {
+      if( *c == '"' || *c == '\\' )
+        {
+        quoted += '\\';
+        }
+      quoted += ( static_cast<unsigned char>( *c ) < 0x20 ) ? ' ' : *c;
+      }
+    return quoted + "\"";
+  }
+
+  static std::string CurrentTimeStamp()
+  {
+    const std::time_t now = std::time(nullptr);
+    char              buffer[32];
+    std::strftime(buffer, sizeof( buffer ), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now) );
+    return buffer;
+  }
+
+  void RunOne(const BenchmarkEntry & entry, const unsigned int size, const int threads,
+              const unsigned int repetitions, std::ostream & output) const
+  {
+    const long                startPeakRSSKiB = BRAINSUtils::GetPeakResidentSetSizeKiB();
+    BRAINSUtils::ThreadBudget threadBudget(threads);
+    const Kernel              kernel = entry.Factory(size);
+
+    threadBudget.Execute(kernel.Run); // warm up caches, lazy initialization and the thread pools
+
+    std::vector<double> seconds(repetitions);
+    for( unsigned int r = 0; r < repetitions; ++r )
+      {
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      threadBudget.Execute(kernel.Run);
+      seconds[r] = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      }
+    std::vector<double> sorted(seconds);
+    std::sort(sorted.begin(), sorted.end() );
+    double total = 0.0;
+    for( size_t r = 0; r < seconds.size(); ++r )
+      {
+      total += seconds[r];
+      }
+    const double median = ( sorted.size() % 2 == 1 ) ? sorted[sorted.size() / 2]
+      : 0.5 * ( sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2] );
+
+    const long processPeakRSSKiB = BRAINSUtils::GetPeakResidentSetSizeKiB();
+
+    itksys::SystemInformation systemInformation;
+    systemInformation.RunOSCheck();
+
+    std::ostringstream line;
+    line << std::setprecision(std::numeric_limits<double>::digits10 + 1)
+         << "{\"suite\":" << JSONString(m_SuiteName)
+         << ",\"benchmark\":" << JSONString(entry.Name)
+         << ",\"size\":" << size
+         << ",\"threads\":" << threadBudget.GetNumberOfThreads()
+         << ",\"repetitions\":" << repetitions
+         << ",\"items\":" << kernel.NumberOfItems
+         << ",\"minSeconds\":" << sorted.front()
+         << ",\"medianSeconds\":" << median
+         << ",\"meanSeconds\":" << total / seconds.size()
+         << ",\"maxSeconds\":" << sorted.back()
+         << ",\"itemsPerSecond\":" << ( ( median > 0.0 ) ? kernel.NumberOfItems / median : 0.0 )
+         << ",\"processPeakRSSKiB\":" << processPeakRSSKiB
+         << ",\"peakRSSGrowthKiB\":" << processPeakRSSKiB - startPeakRSSKiB
+         << ",\"version\":" << JSONString( BRAINSTools::Version::ExtendedVersionString() )
+         << ",\"host\":" << JSONString( systemInformation.GetHostname() )
+         << ",\"timestamp\":" << JSONString( CurrentTimeStamp() )
+         << "}";
+    output << line.str() << std::endl;
+  }
+
+  std::string                 m_SuiteName;
+  std::vector<BenchmarkEntry> m_Benchmarks;
+  std::vector<unsigned int>   m_Sizes;
+  std::vector<int>            m_Threads;
+  unsigned int                m_Repetitions;
+  std::string                 m_OutputFileName;
+  std::string                 m_Filter;
+  bool                        m_Quick;
+  bool                        m_List;
+  bool                        m_ArgumentsAreValid;
+};
+
+/**
+ * Synthetic head phantom.  The head is an ellipsoid in a 256 mm field of
+ * view centered on the origin: scalp, CSF, a gray matter ribbon with a
+ * folded inner boundary, white matter, lateral ventricles and two eyes in
+ * front of the brain.  The problem size only changes the sampling, so the
+ * anatomy (and the work per mm^3) is the same at every size.
+ */
+enum PhantomTissue
+  {
+  PhantomAir = 0,
+  PhantomScalp,
+  PhantomCSF,
+  PhantomGrayMatter,
+  PhantomWhiteMatter,
+  PhantomEye,
+  NumberOfPhantomTissues
+  };
+
+inline PhantomTissue GetPhantomTissue(const itk::Point<double, 3> & point)
+{
+  const double eyeRadius = 12.0;
+  for( int side = -1; side <= 1; side += 2 )
+    {
+    const double dx = point[0] - side * 32.0;
+    const double dy = point[1] + 78.0;
+    const double dz = point[2] + 30.0;
+    if( dx * dx + dy * dy + dz * dz <= eyeRadius * eyeRadius )
+      {
+      return PhantomEye;
+      }
+    }
+  const double head = ( point[0] / 85.0 ) * ( point[0] / 85.0 ) + ( point[1] / 105.0 ) * ( point[1] / 105.0 )
+    + ( point[2] / 95.0 ) * ( point[2] / 95.0 );
+  if( head > 1.0 )
+    {
+    return PhantomAir;
+    }
+  const double radius = std::sqrt(head);
+  if( radius > 0.93 )
+    {
+    return PhantomScalp;
+    }
+  if( radius > 0.86 )
+    {
+    return PhantomCSF;
+    }
+  const double ventricleX = ( std::abs(point[0]) - 10.0 ) / 6.0;
+  const double ventricleY = point[1] / 25.0;
+  const double ventricleZ = ( point[2] - 10.0 ) / 10.0;
+  if( ventricleX * ventricleX + ventricleY * ventricleY + ventricleZ * ventricleZ <= 1.0 )
+    {
+    return PhantomCSF;
+    }
+  const double folding = 0.06 * std::sin(0.15 * point[0]) * std::sin(0.15 * point[1]) * std::sin(0.15 * point[2]);
+  if( radius > 0.72 + folding )
+    {
+    return PhantomGrayMatter;
+    }
+  return PhantomWhiteMatter;
+}
+
+/** Mean intensity of a tissue for a T1 like (contrast 0) or T2 like (contrast 1) image */
+inline double GetPhantomIntensity(const PhantomTissue tissue, const unsigned int contrast)
+{
+  static const double T1Intensities[NumberOfPhantomTissues] = { 0.0, 600.0, 250.0, 550.0, 800.0, 150.0 };
+  static const double T2Intensities[NumberOfPhantomTissues] = { 0.0, 400.0, 900.0, 600.0, 450.0, 950.0 };
+
+  return ( contrast == 0 ) ? T1Intensities[tissue] : T2Intensities[tissue];
+}
+
+/** Allocate image as a size^3 lattice covering the phantom field of view */
+template <typename TImage>
+void AllocatePhantomLattice(TImage *image, const unsigned int size)
+{
+  const double fieldOfView = 256.0;
+
+  typename TImage::SizeType size3D;
+  size3D.Fill(size);
+  typename TImage::SpacingType spacing;
+  spacing.Fill(fieldOfView / size);
+  typename TImage::PointType origin;
+  origin.Fill(-0.5 * fieldOfView + 0.5 * spacing[0]);
+  typename TImage::DirectionType direction;
+  direction.SetIdentity();
+
+  image->SetRegions(size3D);
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
+  image->SetDirection(direction);
+  image->Allocate();
+}
+
+/** Phantom intensity image with a smooth multiplicative bias field and
+ *  Gaussian noise; the same seed always gives the same image. */
+template <typename TImage>
+typename TImage::Pointer CreatePhantomImage(const unsigned int size, const unsigned int contrast,
+                                            const unsigned int seed, const double noiseSigma = 20.0)
+{
+  typename TImage::Pointer image = TImage::New();
+  AllocatePhantomLattice(image.GetPointer(), size);
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize(seed);
+
+  typename TImage::PointType point;
+  for( itk::ImageRegionIteratorWithIndex<TImage> it( image, image->GetLargestPossibleRegion() ); !it.IsAtEnd(); ++it )
+    {
+    image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    const PhantomTissue tissue = GetPhantomTissue(point);
+    const double        bias = 1.0 + 0.1 * point[0] / 128.0 + 0.05 * point[2] / 128.0;
+    double              value = GetPhantomIntensity(tissue, contrast) * bias;
+    if( tissue != PhantomAir )
+      {
+      value += noiseSigma * random->GetNormalVariate();
+      }
+    it.Set( static_cast<typename TImage::PixelType>( std::max(value, 0.0) ) );
+    }
+  return image;
+}
+
+/** Phantom tissue label image (PhantomTissue codes) */
+template <typename TImage>
+typename TImage::Pointer CreatePhantomLabelImage(const unsigned int size)
+{
+  typename TImage::Pointer image = TImage::New();
+  AllocatePhantomLattice(image.GetPointer(), size);
+
+  typename TImage::PointType point;
+  for( itk::ImageRegionIteratorWithIndex<TImage> it( image, image->GetLargestPossibleRegion() ); !it.IsAtEnd(); ++it )
+    {
+    image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    it.Set( static_cast<typename TImage::PixelType>( GetPhantomTissue(point) ) );
+    }
+  return image;
+}
+
+/** Smooth probability map of one phantom tissue, like a warped atlas prior */
+template <typename TImage>
+typename TImage::Pointer CreatePhantomPrior(const unsigned int size, const PhantomTissue tissue,
+                                            const double sigmaInMillimeters = 4.0)
+{
+  typename TImage::Pointer indicator = TImage::New();
+  AllocatePhantomLattice(indicator.GetPointer(), size);
+
+  typename TImage::PointType point;
+  for( itk::ImageRegionIteratorWithIndex<TImage> it( indicator, indicator->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    indicator->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    it.Set( ( GetPhantomTissue(point) == tissue ) ? 1 : 0 );
+    }
+
+  typedef itk::SmoothingRecursiveGaussianImageFilter<TImage, TImage> SmoothingFilterType;
+  typename SmoothingFilterType::Pointer smoother = SmoothingFilterType::New();
+  smoother->SetInput(indicator);
+  smoother->SetSigma(sigmaInMillimeters);
+  smoother->Update();
+  typename TImage::Pointer prior = smoother->GetOutput();
+  prior->DisconnectPipeline();
+  return prior;
+}
+}
+
+#endif // __BRAINSBenchmark_h
@@ -24,7 +24,7 @@
 #include <itkImage.h>
 #include <vnl/vnl_vector.h>
 #include "ExtractSingleLargestRegion.h"
-#include "itkMultiplyImageFilter.h"
+#include "SupportBufferedImage.h"
 
 #include "itkLabelStatisticsImageFilter.h"
 
@@ -33,7 +33,8 @@ typedef itk::Image<unsigned char, 3>       ByteImageType;
 extern LabelCountMapType GetMinLabelCount(ByteImageType::Pointer & labelsImage,
                                           const vnl_vector<unsigned int> & PriorLabelCodeVector);
 // Labeling using maximum a posteriori, also do brain stripping using
-// mathematical morphology and connected component
+// mathematical morphology and connected component.  The posteriors may be
+// support buffered (see SupportBufferedImage.h).
 template <class TProbabilityImage, class TByteImage,
           typename TFloatingPrecision>
 void ComputeLabels(
@@ -100,11 +101,12 @@ void ComputeLabels(
               continue;
               }
 
-            TFloatingPrecision maxPosteriorClassValue = Posteriors[0]->GetPixel(currIndex);
+            TFloatingPrecision maxPosteriorClassValue = GetSupportPixel(Posteriors[0].GetPointer(), currIndex);
             unsigned int       indexMaxPosteriorClassValue = 0;
             for( unsigned int iclass = 1; iclass < numClasses; iclass++ )
               {
-              const TFloatingPrecision currentPosteriorClassValue = Posteriors[iclass]->GetPixel(currIndex);
+              const TFloatingPrecision currentPosteriorClassValue =
+                GetSupportPixel(Posteriors[iclass].GetPointer(), currIndex);
               if( currentPosteriorClassValue > maxPosteriorClassValue )
                 {
                 maxPosteriorClassValue = currentPosteriorClassValue;
@@ -147,12 +149,8 @@ void ComputeLabels(
                     << "\n            because too few samples found."
                     << "\n           " <<  currentLabelCount << " < " <<  minLabelSizeAllowed << std::endl;
           //Multiply this prior by 1.1 to increase it's importance.
-          typedef itk::MultiplyImageFilter<TProbabilityImage,TProbabilityImage> MultiplyFilterType;
-          typename MultiplyFilterType::Pointer filter = MultiplyFilterType::New();
-          filter->SetInput1( Posteriors[reverseLabelMap[it->first]] );
-          filter->SetInput2(1.1); //Multiply by 1.1 to increase it's importance
-          filter->Update();
-          Posteriors[reverseLabelMap[it->first]] = filter->GetOutput();
+          Posteriors[reverseLabelMap[it->first]] =
+            ScaleSupportBufferedImage<TProbabilityImage>(Posteriors[reverseLabelMap[it->first]].GetPointer(), 1.1);
 
           }
       }
@@ -19,8 +19,10 @@
 
 #include "BRAINSFitUtils.h"
 #include "BRAINSFitHelper.h"
+#include "BRAINSTrace.h"
 
 #include "genericRegistrationHelper.h"
+#include "itkBRAINSMattesMutualInformationImageToImageMetricv4.h"
 #include "itkCorrelationImageToImageMetricv4.h"
 #include "itkMeanSquaresImageToImageMetricv4.h"
 #include "itkKullbackLeiblerCompareHistogramImageToImageMetric.h"
@@ -46,6 +48,20 @@ void debug_catch(void)
   return;
 }
 
+// Shrink factors are converted to unsigned by the registration helpers, so
+// values below 1 must be rejected while they are still signed.
+static void CheckShrinkFactorsPerLevel(const std::vector<int> & shrinkFactorsPerLevel, const char *name)
+{
+  for( size_t level = 0; level < shrinkFactorsPerLevel.size(); ++level )
+    {
+    if( shrinkFactorsPerLevel[level] < 1 )
+      {
+      itkGenericExceptionMacro(<< "ERROR:  " << name << " must be >= 1, but level " << level
+                               << " has shrink factor " << shrinkFactorsPerLevel[level]);
+      }
+    }
+}
+
 // convert spatial object to image
 itk::Image<unsigned char,3>::ConstPointer
 ExtractConstPointerToImageMaskFromImageSpatialObject( SpatialObjectType::ConstPointer inputSpatialObject )
@@ -116,6 +132,10 @@ BRAINSFitHelper::BRAINSFitHelper() :
   m_InitializeTransformMode("Off"),
   m_MaskInferiorCutOffFromCenter(1000),
   m_SplineGridSize(3, 10),
+  m_ShrinkFactorsPerLevel(1, 1),
+  m_SmoothingSigmasPerLevel(1, 0.0),
+  m_BSplineShrinkFactorsPerLevel(1, 1),
+  m_BSplineSmoothingSigmasPerLevel(1, 0.0),
   m_CostFunctionConvergenceFactor(1e+9),
   m_ProjectedGradientTolerance(1e-5),
   m_MaxBSplineDisplacement(0.0),
@@ -245,6 +265,9 @@ DoHistogramEqualization( typename FixedImageType::Pointer & inputFixedImage,
 void
 BRAINSFitHelper::Update(void)
 {
+  BRAINS_TRACE_SCOPE("BRAINSFitHelper::Update");
+  CheckShrinkFactorsPerLevel(this->m_ShrinkFactorsPerLevel, "ShrinkFactorsPerLevel");
+  CheckShrinkFactorsPerLevel(this->m_BSplineShrinkFactorsPerLevel, "BSplineShrinkFactorsPerLevel");
   // Do remove intensity outliers if requested
   if(  m_RemoveIntensityOutliers > std::numeric_limits<float>::epsilon() )
     {
@@ -406,7 +429,9 @@ BRAINSFitHelper::Update(void)
   GenericMetricType::Pointer metric;
   if( this->m_CostMetricName == "MMI" )
     {
-    typedef itk::MattesMutualInformationImageToImageMetricv4<FixedImageType, MovingImageType, FixedImageType, RealType> MIMetricType;
+    // Evaluates the rigid and affine stages with its own masked, threaded
+    // kernel and defers the BSpline stage to itkMattesMutualInformationImageToImageMetricv4.
+    typedef itk::BRAINSMattesMutualInformationImageToImageMetricv4<FixedImageType, MovingImageType, FixedImageType, RealType> MIMetricType;
     MIMetricType::Pointer mutualInformationMetric = MIMetricType::New();
     //The next line was a hack for early ITKv4 mattes mutual informaiton
     //that was using a lot of memory
@@ -563,6 +588,30 @@ BRAINSFitHelper::PrintSelf(std::ostream & os, Indent indent) const
     os << this->m_SplineGridSize[q] << " ";
     }
   os << "]" << std::endl;
+  os << indent << "ShrinkFactorsPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_ShrinkFactorsPerLevel.size(); ++q )
+    {
+    os << this->m_ShrinkFactorsPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
+  os << indent << "SmoothingSigmasPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_SmoothingSigmasPerLevel.size(); ++q )
+    {
+    os << this->m_SmoothingSigmasPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
+  os << indent << "BSplineShrinkFactorsPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_BSplineShrinkFactorsPerLevel.size(); ++q )
+    {
+    os << this->m_BSplineShrinkFactorsPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
+  os << indent << "BSplineSmoothingSigmasPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_BSplineSmoothingSigmasPerLevel.size(); ++q )
+    {
+    os << this->m_BSplineSmoothingSigmasPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
 
   if( m_CurrentGenericTransform.IsNotNull() )
     {
@@ -760,6 +809,46 @@ BRAINSFitHelper::PrintCommandLine(const bool dumpTempVolumes, const std::string
       }
     }
   oss << " \\" << std::endl;
+  oss << "--shrinkFactorsPerLevel ";
+  for( unsigned int q = 0; q < this->m_ShrinkFactorsPerLevel.size(); ++q )
+    {
+    oss << this->m_ShrinkFactorsPerLevel[q];
+    if( q < this->m_ShrinkFactorsPerLevel.size() - 1 )
+      {
+      oss << ",";
+      }
+    }
+  oss << " \\" << std::endl;
+  oss << "--smoothingSigmasPerLevel ";
+  for( unsigned int q = 0; q < this->m_SmoothingSigmasPerLevel.size(); ++q )
+    {
+    oss << this->m_SmoothingSigmasPerLevel[q];
+    if( q < this->m_SmoothingSigmasPerLevel.size() - 1 )
+      {
+      oss << ",";
+      }
+    }
+  oss << " \\" << std::endl;
+  oss << "--bsplineShrinkFactorsPerLevel ";
+  for( unsigned int q = 0; q < this->m_BSplineShrinkFactorsPerLevel.size(); ++q )
+    {
+    oss << this->m_BSplineShrinkFactorsPerLevel[q];
+    if( q < this->m_BSplineShrinkFactorsPerLevel.size() - 1 )
+      {
+      oss << ",";
+      }
+    }
+  oss << " \\" << std::endl;
+  oss << "--bsplineSmoothingSigmasPerLevel ";
+  for( unsigned int q = 0; q < this->m_BSplineSmoothingSigmasPerLevel.size(); ++q )
+    {
+    oss << this->m_BSplineSmoothingSigmasPerLevel[q];
+    if( q < this->m_BSplineSmoothingSigmasPerLevel.size() - 1 )
+      {
+      oss << ",";
+      }
+    }
+  oss << " \\" << std::endl;
 
   if( m_CurrentGenericTransform.IsNotNull() )
     {
@@ -188,6 +188,15 @@ public:
   itkSetMacro(RestoreState,  CompositeTransformType::Pointer);
   itkGetConstMacro(RestoreState,  CompositeTransformType::Pointer);
   VECTORitkSetMacro(SplineGridSize, std::vector<int>       );
+  /** Shrink factors and smoothing sigmas (mm) of the image pyramid used by
+    * the linear stages, one entry per level from coarse to fine. */
+  VECTORitkSetMacro(ShrinkFactorsPerLevel, std::vector<int>    );
+  VECTORitkSetMacro(SmoothingSigmasPerLevel, std::vector<double> );
+  /** Shrink factors and smoothing sigmas (mm) of the coarse-to-fine BSpline
+    * stage.  The finest level uses SplineGridSize; every coarser level
+    * halves the control point mesh. */
+  VECTORitkSetMacro(BSplineShrinkFactorsPerLevel, std::vector<int>    );
+  VECTORitkSetMacro(BSplineSmoothingSigmasPerLevel, std::vector<double> );
 
   itkGetConstMacro(ActualNumberOfIterations,      unsigned int);
   itkGetConstMacro(PermittedNumberOfIterations,   unsigned int);
@@ -300,6 +309,10 @@ private:
   std::string              m_InitializeTransformMode;
   double                   m_MaskInferiorCutOffFromCenter;
   std::vector<int>         m_SplineGridSize;
+  std::vector<int>         m_ShrinkFactorsPerLevel;
+  std::vector<double>      m_SmoothingSigmasPerLevel;
+  std::vector<int>         m_BSplineShrinkFactorsPerLevel;
+  std::vector<double>      m_BSplineSmoothingSigmasPerLevel;
   double                   m_CostFunctionConvergenceFactor;
   double                   m_ProjectedGradientTolerance;
   double                   m_MaxBSplineDisplacement;
@@ -451,6 +464,10 @@ BRAINSFitHelper::SetupRegistration(GenericMetricType *costMetric)
   myHelper->SetCurrentGenericTransform(this->m_CurrentGenericTransform);
   myHelper->SetRestoreState(this->m_RestoreState);
   myHelper->SetSplineGridSize(this->m_SplineGridSize);
+  myHelper->SetShrinkFactorsPerLevel(this->m_ShrinkFactorsPerLevel);
+  myHelper->SetSmoothingSigmasPerLevel(this->m_SmoothingSigmasPerLevel);
+  myHelper->SetBSplineShrinkFactorsPerLevel(this->m_BSplineShrinkFactorsPerLevel);
+  myHelper->SetBSplineSmoothingSigmasPerLevel(this->m_BSplineSmoothingSigmasPerLevel);
   myHelper->SetCostFunctionConvergenceFactor(this->m_CostFunctionConvergenceFactor);
   myHelper->SetProjectedGradientTolerance(this->m_ProjectedGradientTolerance);
   myHelper->SetMaxBSplineDisplacement(this->m_MaxBSplineDisplacement);
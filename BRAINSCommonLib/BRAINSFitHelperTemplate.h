@@ -215,6 +215,15 @@ public:
   VECTORitkSetMacro(TransformType, std::vector<std::string> );
   // cppcheck-suppress unusedFunction
   VECTORitkSetMacro(SplineGridSize, std::vector<int>       );
+  /** Shrink factors and smoothing sigmas (mm) of the image pyramid used by
+    * the linear stages, one entry per level from coarse to fine. */
+  VECTORitkSetMacro(ShrinkFactorsPerLevel, std::vector<int>    );
+  VECTORitkSetMacro(SmoothingSigmasPerLevel, std::vector<double> );
+  /** Shrink factors and smoothing sigmas (mm) of the coarse-to-fine BSpline
+    * stage.  The finest level uses SplineGridSize; every coarser level
+    * halves the control point mesh. */
+  VECTORitkSetMacro(BSplineShrinkFactorsPerLevel, std::vector<int>    );
+  VECTORitkSetMacro(BSplineSmoothingSigmasPerLevel, std::vector<double> );
 
   itkGetConstMacro(ActualNumberOfIterations,      unsigned int);
   itkGetConstMacro(PermittedNumberOfIterations,   unsigned int);
@@ -314,6 +323,10 @@ private:
   std::string              m_InitializeTransformMode;
   double                   m_MaskInferiorCutOffFromCenter;
   std::vector<int>         m_SplineGridSize;
+  std::vector<int>         m_ShrinkFactorsPerLevel;
+  std::vector<double>      m_SmoothingSigmasPerLevel;
+  std::vector<int>         m_BSplineShrinkFactorsPerLevel;
+  std::vector<double>      m_BSplineSmoothingSigmasPerLevel;
   double                   m_CostFunctionConvergenceFactor;
   double                   m_ProjectedGradientTolerance;
   double                   m_MaxBSplineDisplacement;
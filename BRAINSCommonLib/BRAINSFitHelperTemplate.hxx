@@ -24,10 +24,12 @@
 #endif
 
 #include "BRAINSFitUtils.h"
+#include "BRAINSTrace.h"
 #include "itkEuler3DTransform.h"
 #include "itkCheckerBoardImageFilter.h"
 #include "itkOtsuHistogramMatchingImageFilter.h"
 #include <fstream>
+#include <algorithm>
 #include "BRAINSFitHelperTemplate.h"
 #include "itkConjugateGradientLineSearchOptimizerv4.h"
 #include "itkLBFGSBOptimizerv4.h"
@@ -138,6 +140,75 @@ ValidateTransformRankOrdering(const std::vector<std::string> & transformType)
     }
 }
 
+/**
+  * The control point mesh of the BSpline transform is refined at the start of
+  * every level of a multi-level BSpline registration, which changes the number
+  * of parameters.  This observer resizes the LBFGSB bounds to match before the
+  * optimizer restarts.
+  */
+template <typename TRegistration>
+class BSplineLevelBoundsCommand : public Command
+{
+public:
+  typedef BSplineLevelBoundsCommand Self;
+  typedef Command                   Superclass;
+  typedef SmartPointer<Self>        Pointer;
+  itkNewMacro(Self);
+
+  itkSetMacro(MaxBSplineDisplacement, double);
+
+  void Execute(const Object *, const EventObject &) override
+  {
+  }
+
+  void Execute(Object *caller, const EventObject & event) override
+  {
+    if( !MultiResolutionIterationEvent().CheckEvent( &event ) )
+      {
+      return;
+      }
+    TRegistration *registration = dynamic_cast<TRegistration *>( caller );
+    if( registration == nullptr )
+      {
+      return;
+      }
+    LBFGSBOptimizerv4 *optimizer = dynamic_cast<LBFGSBOptimizerv4 *>( registration->GetModifiableOptimizer() );
+    if( optimizer == nullptr )
+      {
+      return;
+      }
+    const SizeValueType numberOfParameters = registration->GetModifiableTransform()->GetNumberOfParameters();
+    std::cout << "*** BSpline level " << registration->GetCurrentLevel() + 1
+              << " of " << registration->GetNumberOfLevels()
+              << ": " << numberOfParameters << " parameters ***" << std::endl;
+
+    LBFGSBOptimizerv4::BoundSelectionType boundSelect( numberOfParameters );
+    if( std::abs(m_MaxBSplineDisplacement) < 1e-12 )
+      {
+      boundSelect.Fill( LBFGSBOptimizerv4::UNBOUNDED );
+      }
+    else
+      {
+      boundSelect.Fill( LBFGSBOptimizerv4::BOTHBOUNDED );
+      }
+    LBFGSBOptimizerv4::BoundValueType upperBound( numberOfParameters );
+    upperBound.Fill(m_MaxBSplineDisplacement);
+    LBFGSBOptimizerv4::BoundValueType lowerBound( numberOfParameters );
+    lowerBound.Fill(-m_MaxBSplineDisplacement);
+    optimizer->SetBoundSelection(boundSelect);
+    optimizer->SetUpperBound(upperBound);
+    optimizer->SetLowerBound(lowerBound);
+  }
+
+protected:
+  BSplineLevelBoundsCommand() : m_MaxBSplineDisplacement(0.0)
+  {
+  }
+
+private:
+  double m_MaxBSplineDisplacement;
+};
+
 template <class FixedImageType, class MovingImageType, class TransformType,
           class SpecificInitializerType, typename DoCenteredInitializationMetricType>
 typename TransformType::Pointer
@@ -152,6 +223,7 @@ DoCenteredInitialization( typename FixedImageType::Pointer & orientedFixedVolume
                           std::string & initializeTransformMode,
                           typename DoCenteredInitializationMetricType::Pointer & CostMetricObject )
 {
+  BRAINS_TRACE_SCOPE("BRAINSFit::CenteredInitialization");
   typedef itk::Image<unsigned char, 3>                               MaskImageType;
   typedef itk::ImageMaskSpatialObject<MaskImageType::ImageDimension> ImageMaskSpatialObjectType;
 
@@ -545,6 +617,10 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::BRAINSFitHelperTemplat
   m_InitializeTransformMode("Off"),
   m_MaskInferiorCutOffFromCenter(1000),
   m_SplineGridSize(3, 10),
+  m_ShrinkFactorsPerLevel(1, 1),
+  m_SmoothingSigmasPerLevel(1, 0.0),
+  m_BSplineShrinkFactorsPerLevel(1, 1),
+  m_BSplineSmoothingSigmasPerLevel(1, 0.0),
   m_CostFunctionConvergenceFactor(1e+9),
   m_ProjectedGradientTolerance(1e-5),
   m_MaxBSplineDisplacement(0.0),
@@ -604,6 +680,9 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::FitCommonCode(
   appMutualRegistration->SetTranslationScale( m_TranslationScale );
   appMutualRegistration->SetReproportionScale( m_ReproportionScale );
   appMutualRegistration->SetSkewScale( m_SkewScale );
+  appMutualRegistration->SetShrinkFactorsPerLevel(
+    std::vector<unsigned int>( m_ShrinkFactorsPerLevel.begin(), m_ShrinkFactorsPerLevel.end() ) );
+  appMutualRegistration->SetSmoothingSigmasPerLevel( m_SmoothingSigmasPerLevel );
 
   // NOTE: binary masks are set for the cost metric object!!!
   appMutualRegistration->SetFixedImage(    m_FixedVolume    );
@@ -821,6 +900,7 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
     //
     if( currentTransformType == "Rigid" )
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::Rigid");
       //  Choose TransformType for the itk registration class template:
       typedef itk::RegularStepGradientDescentOptimizerv4<double> OptimizerType;
       //
@@ -907,6 +987,7 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
       }
     else if( currentTransformType == "ScaleVersor3D" )
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::ScaleVersor3D");
       //  Choose TransformType for the itk registration class template:
       typedef itk::ScaleVersor3DTransform<double>                          TransformType; // NumberOfEstimatedParameter = 9;
       typedef itk::RegularStepGradientDescentOptimizerv4<double>  OptimizerType;
@@ -1001,6 +1082,7 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
       }
     else if( currentTransformType == "ScaleSkewVersor3D" )
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::ScaleSkewVersor3D");
       //  Choose TransformType for the itk registration class template:
       typedef itk::ScaleSkewVersor3DTransform<double>                       TransformType;  // NumberOfEstimatedParameter = 15;
       typedef itk::RegularStepGradientDescentOptimizerv4<double>   OptimizerType;
@@ -1097,6 +1179,7 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
       }
     else if( currentTransformType == "Affine" )
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::Affine");
       //  Choose TransformType for the itk registration class template:
       typedef itk::AffineTransform<double, Dimension>                      TransformType;
       typedef itk::ConjugateGradientLineSearchOptimizerv4Template<double>  OptimizerType;
@@ -1192,6 +1275,7 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
       }
     else if( currentTransformType == "BSpline" )
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::BSpline");
       constexpr unsigned int SpaceDimension = 3;
       constexpr unsigned int SplineOrder = 3;
       typedef itk::BSplineTransform<double, SpaceDimension, SplineOrder> BSplineTransformType;
@@ -1274,16 +1358,34 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
         initializationImage = this->m_FixedVolume;
         }
 
+      // Coarse-to-fine BSpline: one level per shrink factor.  The finest
+      // level uses the requested SplineGridSize and every coarser level halves
+      // the control point mesh, so each refinement can be represented exactly
+      // whenever the grid size is divisible by two.
+      if( m_BSplineShrinkFactorsPerLevel.empty()
+          || m_BSplineShrinkFactorsPerLevel.size() != m_BSplineSmoothingSigmasPerLevel.size() )
+        {
+        itkGenericExceptionMacro(<< "ERROR:  BSplineShrinkFactorsPerLevel and BSplineSmoothingSigmasPerLevel "
+                                 << "must have the same, non-zero number of levels.");
+        }
+      const unsigned int numberOfLevels = static_cast<unsigned int>( m_BSplineShrinkFactorsPerLevel.size() );
+      std::vector<typename BSplineTransformType::MeshSizeType> meshSizePerLevel( numberOfLevels );
+      for( unsigned int level = 0; level < numberOfLevels; ++level )
+        {
+        const unsigned int halvings = numberOfLevels - 1 - level;
+        for( unsigned int i = 0; i < SpaceDimension; i++ )
+          {
+          const unsigned int finestMeshSize = static_cast<unsigned int>( m_SplineGridSize[i] );
+          meshSizePerLevel[level][i] = std::max( 1U, ( finestMeshSize + ( 1U << halvings ) - 1 ) >> halvings );
+          }
+        }
+
       typename BSplineTransformType::Pointer bsplineTx =
                                                 BSplineTransformType::New();
       // Initialize the BSpline transform
       // Using BSplineTransformInitializer
       //
-      BSplineTransformType::MeshSizeType    meshSize;
-      for( unsigned int i=0; i< SpaceDimension; i++ )
-        {
-        meshSize[i] = m_SplineGridSize[i];
-        }
+      const typename BSplineTransformType::MeshSizeType meshSize = meshSizePerLevel[0];
 
       typedef itk::BSplineTransformInitializer< BSplineTransformType,
                                                 FixedImageType>         InitializerType;
@@ -1521,20 +1623,53 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
           }
         }
 
-      // we have a 1 level BSpline registration.
-      constexpr unsigned int numberOfLevels = 1;
-
       typename BSplineRegistrationType::ShrinkFactorsArrayType shrinkFactorsPerLevel;
-      shrinkFactorsPerLevel.SetSize( 1 );
-      shrinkFactorsPerLevel[0] = 1;
-
+      shrinkFactorsPerLevel.SetSize( numberOfLevels );
       typename BSplineRegistrationType::SmoothingSigmasArrayType smoothingSigmasPerLevel;
-      smoothingSigmasPerLevel.SetSize( 1 );
-      smoothingSigmasPerLevel[0] = 0;
+      smoothingSigmasPerLevel.SetSize( numberOfLevels );
+
+      // The v4 registration method refines the transform with these adaptors
+      // at the start of each level.
+      typedef itk::BSplineTransformParametersAdaptor<BSplineTransformType> BSplineAdaptorType;
+      typename BSplineRegistrationType::TransformParametersAdaptorsContainerType adaptors;
+      for( unsigned int level = 0; level < numberOfLevels; ++level )
+        {
+        if( m_BSplineShrinkFactorsPerLevel[level] < 1 || m_BSplineSmoothingSigmasPerLevel[level] < 0.0 )
+          {
+          itkGenericExceptionMacro(<< "ERROR:  Invalid BSpline level " << level << ": shrink factor "
+                                   << m_BSplineShrinkFactorsPerLevel[level] << ", smoothing sigma "
+                                   << m_BSplineSmoothingSigmasPerLevel[level]);
+          }
+        shrinkFactorsPerLevel[level] = m_BSplineShrinkFactorsPerLevel[level];
+        smoothingSigmasPerLevel[level] = m_BSplineSmoothingSigmasPerLevel[level];
+
+        typename BSplineAdaptorType::Pointer adaptor = BSplineAdaptorType::New();
+        adaptor->SetRequiredTransformDomainOrigin( bsplineTx->GetTransformDomainOrigin() );
+        adaptor->SetRequiredTransformDomainPhysicalDimensions( bsplineTx->GetTransformDomainPhysicalDimensions() );
+        adaptor->SetRequiredTransformDomainDirection( bsplineTx->GetTransformDomainDirection() );
+        adaptor->SetRequiredTransformDomainMeshSize( meshSizePerLevel[level] );
+        adaptors.push_back( adaptor.GetPointer() );
+        }
 
       bsplineRegistration->SetNumberOfLevels( numberOfLevels );
       bsplineRegistration->SetSmoothingSigmasPerLevel( smoothingSigmasPerLevel );
       bsplineRegistration->SetShrinkFactorsPerLevel( shrinkFactorsPerLevel );
+      bsplineRegistration->SetTransformParametersAdaptorsPerLevel( adaptors );
+      if( numberOfLevels > 1 )
+        {
+        typedef BSplineLevelBoundsCommand<BSplineRegistrationType> BoundsCommandType;
+        typename BoundsCommandType::Pointer boundsCommand = BoundsCommandType::New();
+        boundsCommand->SetMaxBSplineDisplacement( m_MaxBSplineDisplacement );
+        bsplineRegistration->AddObserver( itk::MultiResolutionIterationEvent(), boundsCommand );
+        }
+      if( BRAINSFit::RegistrationTrace::GetInstance().IsEnabled() )
+        {
+        typedef BRAINSFit::RegistrationTraceCommand<RegisterImageType> TraceCommandType;
+        typename TraceCommandType::Pointer traceCommand = TraceCommandType::New();
+        traceCommand->SetStage( bsplineTx->GetNameOfClass() );
+        LBFGSBoptimizer->AddObserver( itk::IterationEvent(), traceCommand );
+        bsplineRegistration->AddObserver( itk::MultiResolutionIterationEvent(), traceCommand );
+        }
       bsplineRegistration->SetSmoothingSigmasAreSpecifiedInPhysicalUnits( true );
       bsplineRegistration->SetMetricSamplingStrategy(
                           static_cast<typename BSplineRegistrationType::MetricSamplingStrategyType>( m_SamplingStrategy ) );
@@ -1544,7 +1679,8 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
 
       try
         {
-        std::cout << "*** Running bspline registration (meshSizeAtBaseLevel = " << meshSize << ") ***"
+        std::cout << "*** Running bspline registration (meshSizeAtBaseLevel = " << meshSize
+                  << ", meshSizeAtFinalLevel = " << meshSizePerLevel[numberOfLevels - 1] << ") ***"
                   << std::endl << std::endl;
         bsplineRegistration->Update();
 
@@ -1568,6 +1704,7 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::Update(void)
       }
     else if( currentTransformType == "SyN" )
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::SyN");
 #ifdef USE_ANTS
       //
       // SyN registration metric
@@ -1778,6 +1915,30 @@ BRAINSFitHelperTemplate<FixedImageType, MovingImageType>::PrintSelf(std::ostream
     os << this->m_SplineGridSize[q] << " ";
     }
   os << "]" << std::endl;
+  os << indent << "ShrinkFactorsPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_ShrinkFactorsPerLevel.size(); ++q )
+    {
+    os << this->m_ShrinkFactorsPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
+  os << indent << "SmoothingSigmasPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_SmoothingSigmasPerLevel.size(); ++q )
+    {
+    os << this->m_SmoothingSigmasPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
+  os << indent << "BSplineShrinkFactorsPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_BSplineShrinkFactorsPerLevel.size(); ++q )
+    {
+    os << this->m_BSplineShrinkFactorsPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
+  os << indent << "BSplineSmoothingSigmasPerLevel:     [";
+  for( unsigned int q = 0; q < this->m_BSplineSmoothingSigmasPerLevel.size(); ++q )
+    {
+    os << this->m_BSplineSmoothingSigmasPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
 
   if( m_CurrentGenericTransform.IsNotNull() )
     {
@@ -0,0 +1,110 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef BRAINSThreadBudget_h
+#define BRAINSThreadBudget_h
+
+#include "BRAINSThreadControl.h"
+
+// BRAINSCommonLib itself links neither TBB nor OpenCV; the libraries that do
+// (BRAINSABCCOMMONLIB, BRAINSCutCOMMONLIB) export these definitions so that
+// their programs get the corresponding parts of the budget.
+#ifdef BRAINS_THREAD_BUDGET_USE_TBB
+#include "tbb/task_arena.h"
+#include "tbb/task_scheduler_init.h"
+#endif
+#ifdef BRAINS_THREAD_BUDGET_USE_OPENCV
+#include "opencv2/core.hpp"
+#endif
+
+namespace BRAINSUtils
+{
+/**
+ * One thread budget for every threading runtime used by a program.
+ *
+ * The --numberOfThreads value (or, when it is <= 0, the cgroup and affinity
+ * aware GetAvailableNumberOfThreads()) is applied to the ITK global default,
+ * to the TBB scheduler of the calling thread together with a task_arena of
+ * the same size, and to OpenCV's parallel backend.  Without this the ITK
+ * filters, the tbb::parallel_for loops and the OpenCV ML training each size
+ * their own pool to the whole machine.  TBB work is run through Execute() so
+ * that it stays in the budget's arena, whichever thread starts it.  All
+ * settings are restored at destruction, like
+ * StackPushITKDefaultNumberOfThreads.
+ */
+class ThreadBudget
+{
+public:
+  explicit ThreadBudget(const int desiredCount) :
+    m_ITKThreads(desiredCount),
+    m_NumberOfThreads( itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() )
+#ifdef BRAINS_THREAD_BUDGET_USE_TBB
+    , m_TBBScheduler( m_NumberOfThreads ),
+    m_TaskArena( m_NumberOfThreads )
+#endif
+#ifdef BRAINS_THREAD_BUDGET_USE_OPENCV
+    , m_OriginalOpenCVThreads( cv::getNumThreads() )
+#endif
+  {
+#ifdef BRAINS_THREAD_BUDGET_USE_OPENCV
+    cv::setNumThreads( m_NumberOfThreads );
+#endif
+  }
+
+  ~ThreadBudget()
+  {
+#ifdef BRAINS_THREAD_BUDGET_USE_OPENCV
+    cv::setNumThreads( m_OriginalOpenCVThreads );
+#endif
+  }
+
+  int GetNumberOfThreads() const
+  {
+    return m_NumberOfThreads;
+  }
+
+  /** Run work with its TBB parallelism confined to the budget */
+  template <typename TFunction>
+  void Execute(const TFunction & work)
+  {
+#ifdef BRAINS_THREAD_BUDGET_USE_TBB
+    m_TaskArena.execute( work );
+#else
+    work();
+#endif
+  }
+
+protected:
+  ThreadBudget();                                 // Purposefully not implemented
+  ThreadBudget(const ThreadBudget &);             // Purposefully not implemented
+  ThreadBudget & operator=(const ThreadBudget &); // Purposefully not implemented
+
+private:
+  const StackPushITKDefaultNumberOfThreads m_ITKThreads;
+  const int                                m_NumberOfThreads;
+#ifdef BRAINS_THREAD_BUDGET_USE_TBB
+  tbb::task_scheduler_init m_TBBScheduler;
+  tbb::task_arena          m_TaskArena;
+#endif
+#ifdef BRAINS_THREAD_BUDGET_USE_OPENCV
+  const int m_OriginalOpenCVThreads;
+#endif
+};
+}
+
+#endif // BRAINSThreadBudget_h
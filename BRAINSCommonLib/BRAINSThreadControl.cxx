@@ -19,9 +19,145 @@
 
 #include "BRAINSThreadControl.h"
 #include "itksys/SystemInformation.hxx"
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+#if defined( __linux__ )
+#include <sched.h>
+#endif
 
 namespace BRAINSUtils
 {
+namespace
+{
+struct ParallelizeRangeStruct
+  {
+  const RangeFunctionType *Work;
+  itk::SizeValueType       NumberOfItems;
+  };
+
+ITK_THREAD_RETURN_TYPE ParallelizeRangeThreaderCallback(void *arg)
+{
+  typedef itk::MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType *              threadInfo = static_cast<ThreadInfoType *>( arg );
+  const itk::ThreadIdType       threadId = threadInfo->ThreadID;
+  const itk::ThreadIdType       threadCount = threadInfo->NumberOfThreads;
+  const ParallelizeRangeStruct *str = static_cast<const ParallelizeRangeStruct *>( threadInfo->UserData );
+
+  const itk::SizeValueType begin = str->NumberOfItems * threadId / threadCount;
+  const itk::SizeValueType end = str->NumberOfItems * ( threadId + 1 ) / threadCount;
+  if( begin < end )
+    {
+    ( *str->Work )( begin, end );
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+}
+
+int GetCGroupCPULimit(const std::string & cgroupRoot)
+{
+  // cgroup v2: "max 100000" or "<quota> <period>"
+  std::ifstream cpuMax( ( cgroupRoot + "/cpu.max" ).c_str() );
+  if( cpuMax.is_open() )
+    {
+    std::string quota;
+    double      period = 0.0;
+    cpuMax >> quota >> period;
+    if( quota != "max" && period > 0.0 )
+      {
+      const double quotaValue = std::atof( quota.c_str() );
+      if( quotaValue > 0.0 )
+        {
+        return std::max( static_cast<int>( std::ceil( quotaValue / period ) ), 1 );
+        }
+      }
+    return 0;
+    }
+  // cgroup v1: a quota of -1 means unlimited
+  std::ifstream quotaFile( ( cgroupRoot + "/cpu/cpu.cfs_quota_us" ).c_str() );
+  std::ifstream periodFile( ( cgroupRoot + "/cpu/cpu.cfs_period_us" ).c_str() );
+  if( quotaFile.is_open() && periodFile.is_open() )
+    {
+    double quota = -1.0;
+    double period = 0.0;
+    quotaFile >> quota;
+    periodFile >> period;
+    if( quota > 0.0 && period > 0.0 )
+      {
+      return std::max( static_cast<int>( std::ceil( quota / period ) ), 1 );
+      }
+    }
+  return 0;
+}
+
+int GetAffinityCPULimit()
+{
+#if defined( __linux__ ) && defined( CPU_COUNT )
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if( sched_getaffinity(0, sizeof( cpuSet ), &cpuSet) == 0 )
+    {
+    return CPU_COUNT(&cpuSet);
+    }
+#endif
+  return 0;
+}
+
+int GetAvailableNumberOfThreads()
+{
+  itksys::SystemInformation mySys;
+  mySys.RunCPUCheck();
+  mySys.RunOSCheck();
+  mySys.RunMemoryCheck();
+  // Avoid using hyperthreading cores.
+  int threadCount = mySys.GetNumberOfPhysicalCPU();
+    {
+    // Process the NSLOTS environmental varialble set by the SGE batch
+    // processing system
+    std::string numThreads;
+    if( itksys::SystemTools::GetEnv("NSLOTS", numThreads) )
+      {
+      int               NSLOTSThreadCount(threadCount);
+      std::istringstream s(numThreads, std::istringstream::in);
+      s >> NSLOTSThreadCount;
+      threadCount = NSLOTSThreadCount;
+      }
+    }
+  const int affinityLimit = GetAffinityCPULimit();
+  if( affinityLimit > 0 )
+    {
+    threadCount = std::min(threadCount, affinityLimit);
+    }
+  const int cgroupLimit = GetCGroupCPULimit("/sys/fs/cgroup");
+  if( cgroupLimit > 0 )
+    {
+    threadCount = std::min(threadCount, cgroupLimit);
+    }
+  return std::max(threadCount, 1);
+}
+
+void ParallelizeRange(const itk::SizeValueType numberOfItems, const RangeFunctionType & work)
+{
+  if( numberOfItems == 0 )
+    {
+    return;
+    }
+  ParallelizeRangeStruct str;
+  str.Work = &work;
+  str.NumberOfItems = numberOfItems;
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  threader->SetNumberOfThreads( static_cast<itk::ThreadIdType>(
+                                  std::min( static_cast<itk::SizeValueType>( threader->GetNumberOfThreads() ),
+                                            numberOfItems ) ) );
+  threader->SetSingleMethod( ParallelizeRangeThreaderCallback, &str );
+  threader->SingleMethodExecute();
+}
+
 StackPushITKDefaultNumberOfThreads::StackPushITKDefaultNumberOfThreads(const int desiredCount) :
   m_originalThreadValue( itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() )
 {
@@ -36,27 +172,7 @@ StackPushITKDefaultNumberOfThreads::StackPushITKDefaultNumberOfThreads(const int
     {                                          // If user set desiredCount <= 0, then use evnironmentanl or internal
                                                // ITKv4 values.
     // OLD ITK default threadCount = this->m_originalThreadValue; // This is the old default.
-    itksys::SystemInformation mySys;
-    mySys.RunCPUCheck();
-    mySys.RunOSCheck();
-    mySys.RunMemoryCheck();
-    threadCount = mySys.GetNumberOfPhysicalCPU();
-      // Avoid using hyperthreading cores.
-      {
-      // Process the NSLOTS environmental varialble set by the SGE batch
-      // processing system
-      int NSLOTSThreadCount(threadCount);
-      std::string numThreads;
-      if( itksys::SystemTools::GetEnv("NSLOTS", numThreads) )
-        {
-        std::istringstream s(numThreads, std::istringstream::in);
-        s >> NSLOTSThreadCount;
-        }
-      if( NSLOTSThreadCount != threadCount )
-        {
-        threadCount = NSLOTSThreadCount;
-        }
-      }
+    threadCount = GetAvailableNumberOfThreads();
     }
   if( threadCount > 0 )
     {
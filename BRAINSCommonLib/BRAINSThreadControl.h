@@ -20,11 +20,54 @@
 #define BRAINSThreadControl_h
 
 #include <itksys/SystemTools.hxx>
+#include <functional>
 #include <sstream>
+#include <string>
 #include "itkMultiThreader.h"
 
 namespace BRAINSUtils
 {
+/**
+ * Number of threads this process may usefully run: the physical cores,
+ * reduced to the CPUs of the scheduler affinity mask and to the CPU quota
+ * of the enclosing cgroup (v1 or v2), so that jobs in containers or batch
+ * slots do not oversubscribe the node.  The NSLOTS variable of the SGE
+ * batch system, when set, replaces the core count before those limits are
+ * applied.
+ */
+int GetAvailableNumberOfThreads();
+
+/**
+ * CPU quota of the cgroup mounted at cgroupRoot (normally /sys/fs/cgroup),
+ * rounded up to whole CPUs, or 0 when it is unlimited or unknown.  Both the
+ * cgroup v2 cpu.max and the cgroup v1 cpu/cpu.cfs_quota_us files are read.
+ */
+int GetCGroupCPULimit(const std::string & cgroupRoot);
+
+/** Number of CPUs in the scheduler affinity mask, or 0 when unknown */
+int GetAffinityCPULimit();
+
+typedef std::function<void (itk::SizeValueType, itk::SizeValueType)> RangeFunctionType;
+
+/**
+ * Calls work(begin, end) on one contiguous block of [0, numberOfItems) per
+ * thread of an ITK MultiThreaderBase, using at most numberOfItems threads.
+ * Returns after every block is done.
+ */
+void ParallelizeRange(const itk::SizeValueType numberOfItems, const RangeFunctionType & work);
+
+/** The part of region whose last index is in [begin, end) */
+template <typename TRegion>
+TRegion SliceRange(const TRegion & region, const itk::SizeValueType begin, const itk::SizeValueType end)
+{
+  const unsigned int lastDimension = TRegion::ImageDimension - 1;
+  TRegion            slab = region;
+  slab.SetIndex( lastDimension,
+                 region.GetIndex(lastDimension) + static_cast<itk::IndexValueType>( begin ) );
+  slab.SetSize( lastDimension, end - begin );
+  return slab;
+}
+
 /**
  * This class is designed so that
  * the ITK number of threads can be
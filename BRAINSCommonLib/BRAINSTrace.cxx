@@ -0,0 +1,203 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "BRAINSTrace.h"
+#include "itksys/SystemInformation.hxx"
+#include "itksys/SystemTools.hxx"
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#if !defined( _WIN32 )
+#include <sys/resource.h>
+#endif
+
+namespace BRAINSUtils
+{
+long GetPeakResidentSetSizeKiB()
+{
+#if !defined( _WIN32 )
+  struct rusage usage;
+  if( getrusage(RUSAGE_SELF, &usage) == 0 )
+    {
+#if defined( __APPLE__ )
+    return static_cast<long>( usage.ru_maxrss / 1024 ); // bytes on macOS
+#else
+    return static_cast<long>( usage.ru_maxrss );
+#endif
+    }
+#endif
+  return 0;
+}
+
+namespace
+{
+/** Small, stable trace id of the calling thread (1 for the first thread seen) */
+unsigned int GetTraceThreadId()
+{
+  static std::atomic<unsigned int> nextThreadId(1);
+  thread_local const unsigned int  threadId = nextThreadId++;
+  return threadId;
+}
+
+thread_local unsigned int traceDepth = 0;
+
+std::string JSONString(const char *text)
+{
+  std::string quoted("\"");
+  for( const char *c = text; *c != '\0'; ++c )
+    {
+    if( *c == '"' || *c == '\\' )
+      {
+      quoted += '\\';
+      }
+    quoted += ( static_cast<unsigned char>( *c ) < 0x20 ) ? ' ' : *c;
+    }
+  return quoted + "\"";
+}
+}
+
+class Trace::EventBuffer
+{
+public:
+  struct Event
+  {
+    const char   *Name;
+    const char   *Category;
+    double        Start;
+    double        Duration;
+    unsigned int  ThreadId;
+    unsigned int  Depth;
+    long          PeakRSSKiB;
+  };
+
+  std::mutex         Mutex;
+  std::vector<Event> Events;
+};
+
+Trace & Trace::GetInstance()
+{
+  static Trace instance;
+  return instance;
+}
+
+Trace::Trace() :
+  m_Enabled(false),
+  m_StartTime(std::chrono::steady_clock::now() ),
+  m_Events(new EventBuffer)
+{
+  std::string fileName;
+  if( itksys::SystemTools::GetEnv("BRAINS_TRACE", fileName) && !fileName.empty() )
+    {
+    itksys::SystemInformation systemInformation;
+    std::ostringstream        processId;
+    processId << systemInformation.GetProcessId();
+    itksys::SystemTools::ReplaceString(fileName, "%p", processId.str().c_str() );
+    m_FileName = fileName;
+    m_Enabled = true;
+    }
+}
+
+Trace::~Trace()
+{
+  if( m_Enabled )
+    {
+    this->Flush();
+    }
+  delete m_Events;
+}
+
+double Trace::GetTimeStamp() const
+{
+  return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - m_StartTime ).count();
+}
+
+void Trace::AddScope(const char *name, const char *category, const double start, const double duration,
+                     const unsigned int depth)
+{
+  EventBuffer::Event event;
+  event.Name = name;
+  event.Category = category;
+  event.Start = start;
+  event.Duration = duration;
+  event.ThreadId = GetTraceThreadId();
+  event.Depth = depth;
+  event.PeakRSSKiB = GetPeakResidentSetSizeKiB();
+
+  std::lock_guard<std::mutex> lock(m_Events->Mutex);
+  m_Events->Events.push_back(event);
+}
+
+void Trace::Flush()
+{
+  if( !m_Enabled )
+    {
+    return;
+    }
+  std::lock_guard<std::mutex> lock(m_Events->Mutex);
+  std::ofstream               traceFile(m_FileName.c_str() );
+  if( !traceFile.is_open() )
+    {
+    std::cerr << "WARNING: could not write trace file " << m_FileName << std::endl;
+    return;
+    }
+
+  itksys::SystemInformation systemInformation;
+  const unsigned long       processId = systemInformation.GetProcessId();
+
+  traceFile << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  const char *separator = "\n";
+  for( std::vector<EventBuffer::Event>::const_iterator event = m_Events->Events.begin();
+       event != m_Events->Events.end(); ++event )
+    {
+    traceFile << separator
+              << "{\"name\":" << JSONString(event->Name)
+              << ",\"cat\":" << JSONString(event->Category)
+              << ",\"ph\":\"X\",\"ts\":" << event->Start
+              << ",\"dur\":" << event->Duration
+              << ",\"pid\":" << processId
+              << ",\"tid\":" << event->ThreadId
+              << ",\"args\":{\"depth\":" << event->Depth
+              << ",\"peakRSSKiB\":" << event->PeakRSSKiB << "}}";
+    separator = ",\n";
+    traceFile << separator
+              << "{\"name\":\"peakRSS\",\"ph\":\"C\",\"ts\":" << event->Start + event->Duration
+              << ",\"pid\":" << processId
+              << ",\"args\":{\"KiB\":" << event->PeakRSSKiB << "}}";
+    }
+  traceFile << "\n]}\n";
+}
+
+void ScopedTrace::Begin()
+{
+  m_Depth = traceDepth++;
+  m_Start = Trace::GetInstance().GetTimeStamp();
+}
+
+void ScopedTrace::End()
+{
+  Trace & trace = Trace::GetInstance();
+  trace.AddScope(m_Name, m_Category, m_Start, trace.GetTimeStamp() - m_Start, m_Depth);
+  --traceDepth;
+}
+}
@@ -0,0 +1,134 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef BRAINSTrace_h
+#define BRAINSTrace_h
+
+#include <chrono>
+#include <string>
+
+namespace BRAINSUtils
+{
+/** Peak resident set size of this process in KiB, 0 when unknown */
+long GetPeakResidentSetSizeKiB();
+
+/**
+ * \class Trace
+ *
+ * Process wide recorder of timed scopes, written as a Chrome trace
+ * (chrome://tracing, Perfetto) when the program exits.  Tracing is enabled
+ * by setting the environment variable BRAINS_TRACE to the output file name,
+ * in which %p is replaced by the process id so that the tools of a pipeline
+ * do not overwrite each other's traces; otherwise a ScopedTrace costs one
+ * test of a cached flag.
+ *
+ * Every scope becomes a complete ("X") event with the thread that ran it,
+ * its nesting depth and the peak resident set size at its end; the peak
+ * RSS is also recorded as a counter track.
+ */
+class Trace
+{
+public:
+  static Trace & GetInstance();
+
+  /** True when BRAINS_TRACE names an output file */
+  static bool IsEnabled()
+  {
+    static const bool enabled = GetInstance().m_Enabled;
+    return enabled;
+  }
+
+  /** Microseconds since the start of the trace */
+  double GetTimeStamp() const;
+
+  void AddScope(const char *name, const char *category, const double start, const double duration,
+                const unsigned int depth);
+
+  /** Write the events recorded so far; called automatically at exit */
+  void Flush();
+
+  ~Trace();
+
+private:
+  Trace();
+  Trace(const Trace &);             // Purposefully not implemented
+  Trace & operator=(const Trace &); // Purposefully not implemented
+
+  class EventBuffer;
+
+  bool                                  m_Enabled;
+  std::string                           m_FileName;
+  std::chrono::steady_clock::time_point m_StartTime;
+  EventBuffer                          *m_Events;
+};
+
+/**
+ * \class ScopedTrace
+ *
+ * Records the lifetime of the enclosing scope in the Trace.  name and
+ * category must outlive the program (string literals), e.g.
+ *   BRAINS_TRACE_SCOPE("EMSegmentation");
+ */
+class ScopedTrace
+{
+public:
+  explicit ScopedTrace(const char *name, const char *category = "BRAINSTools") :
+    m_Name(name),
+    m_Category(category),
+    m_Start(0.0),
+    m_Depth(0),
+    m_Enabled(Trace::IsEnabled() )
+  {
+    if( m_Enabled )
+      {
+      this->Begin();
+      }
+  }
+
+  ~ScopedTrace()
+  {
+    if( m_Enabled )
+      {
+      this->End();
+      }
+  }
+
+private:
+  ScopedTrace(const ScopedTrace &);             // Purposefully not implemented
+  ScopedTrace & operator=(const ScopedTrace &); // Purposefully not implemented
+
+  void Begin();
+
+  void End();
+
+  const char  *m_Name;
+  const char  *m_Category;
+  double       m_Start;
+  unsigned int m_Depth;
+  const bool   m_Enabled;
+};
+}
+
+#define BRAINS_TRACE_CONCATENATE_DETAIL(a, b) a ## b
+#define BRAINS_TRACE_CONCATENATE(a, b) BRAINS_TRACE_CONCATENATE_DETAIL(a, b)
+
+/** Trace the rest of the enclosing scope under the given name */
+#define BRAINS_TRACE_SCOPE(name) \
+  const BRAINSUtils::ScopedTrace BRAINS_TRACE_CONCATENATE(brainsTraceScope, __LINE__)(name)
+
+#endif // BRAINSTrace_h
@@ -0,0 +1,200 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/**
+ * Benchmarks of the BRAINSCommonLib kernels shared by the registration and
+ * diffusion tools: the Mattes mutual information metric used by BRAINSFit,
+ * GenericTransformImage resampling, and the masked DTI tensor fit used by
+ * gtractTensor.
+ */
+#include "BRAINSBenchmark.h"
+#include "GenericTransformImage.h"
+#include "itkDiffusionTensor3DReconstructionWithMaskImageFilter.h"
+
+#include "itkAffineTransform.h"
+#include "itkMattesMutualInformationImageToImageMetricv4.h"
+#include "itkVectorImage.h"
+#include "itkVersorRigid3DTransform.h"
+
+namespace
+{
+typedef itk::Image<float, 3>                 FloatImageType;
+typedef itk::Image<short, 3>                 ShortImageType;
+typedef itk::Image<itk::Vector<float, 3>, 3> DisplacementFieldType;
+
+BRAINSBenchmark::Kernel MattesMutualInformationKernel(const unsigned int size)
+{
+  const FloatImageType::Pointer fixedImage = BRAINSBenchmark::CreatePhantomImage<FloatImageType>(size, 0, 1);
+  const FloatImageType::Pointer movingImage = BRAINSBenchmark::CreatePhantomImage<FloatImageType>(size, 1, 2);
+
+  typedef itk::AffineTransform<double, 3> TransformType;
+  TransformType::Pointer      transform = TransformType::New();
+  TransformType::OutputVectorType translation;
+  translation[0] = 2.5;
+  translation[1] = -1.5;
+  translation[2] = 1.0;
+  transform->Translate(translation);
+  transform->Rotate3D(TransformType::OutputVectorType(1.0), 0.05);
+
+  typedef itk::MattesMutualInformationImageToImageMetricv4<FloatImageType, FloatImageType> MetricType;
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetNumberOfHistogramBins(50);
+  metric->SetFixedImage(fixedImage);
+  metric->SetMovingImage(movingImage);
+  metric->SetMovingTransform(transform);
+  metric->Initialize();
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = fixedImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  kernel.Run = [metric]()
+    {
+      MetricType::MeasureType    value;
+      MetricType::DerivativeType derivative;
+      metric->GetValueAndDerivative(value, derivative);
+    };
+  return kernel;
+}
+
+BRAINSBenchmark::Kernel GenericTransformImageKernel(const unsigned int size)
+{
+  const FloatImageType::Pointer image = BRAINSBenchmark::CreatePhantomImage<FloatImageType>(size, 0, 3);
+
+  typedef itk::VersorRigid3DTransform<double> TransformType;
+  TransformType::Pointer transform = TransformType::New();
+  TransformType::AxisType axis;
+  axis[0] = 0.2;
+  axis[1] = 0.3;
+  axis[2] = 0.9;
+  transform->SetRotation(axis, 0.1);
+  TransformType::OutputVectorType translation;
+  translation.Fill(3.0);
+  transform->SetTranslation(translation);
+  const itk::Transform<double, 3, 3>::ConstPointer genericTransform = transform.GetPointer();
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  kernel.Run = [image, genericTransform]()
+    {
+      GenericTransformImage<FloatImageType, FloatImageType, DisplacementFieldType>(
+        image.GetPointer(), image.GetPointer(), genericTransform, 0.0, "Linear", false);
+    };
+  return kernel;
+}
+
+BRAINSBenchmark::Kernel DiffusionTensorFitKernel(const unsigned int size)
+{
+  typedef itk::DiffusionTensor3DReconstructionWithMaskImageFilter<short, short, double> TensorFilterType;
+  typedef TensorFilterType::GradientImagesType                                      DWIImageType;
+  typedef TensorFilterType::GradientDirectionContainerType                          GradientContainerType;
+  typedef TensorFilterType::GradientDirectionType                                   GradientType;
+
+  const unsigned int numberOfGradients = 30;
+  const double       bValue = 1000.0;
+
+  // One baseline and numberOfGradients directions spread over the sphere.
+  GradientContainerType::Pointer gradients = GradientContainerType::New();
+  gradients->InsertElement(0, GradientType(0.0) );
+  for( unsigned int g = 0; g < numberOfGradients; ++g )
+    {
+    const double z = 1.0 - ( 2.0 * g + 1.0 ) / numberOfGradients;
+    const double radius = std::sqrt(1.0 - z * z);
+    const double phi = g * 2.399963229728653; // golden angle
+    GradientType direction;
+    direction[0] = radius * std::cos(phi);
+    direction[1] = radius * std::sin(phi);
+    direction[2] = z;
+    gradients->InsertElement(g + 1, direction);
+    }
+
+  const ShortImageType::Pointer baseline = BRAINSBenchmark::CreatePhantomImage<ShortImageType>(size, 1, 4);
+  const ShortImageType::Pointer labels = BRAINSBenchmark::CreatePhantomLabelImage<ShortImageType>(size);
+
+  DWIImageType::Pointer dwi = DWIImageType::New();
+  dwi->CopyInformation(baseline);
+  dwi->SetRegions(baseline->GetLargestPossibleRegion() );
+  dwi->SetNumberOfComponentsPerPixel(numberOfGradients + 1);
+  dwi->Allocate();
+
+  // Mean diffusivities in mm^2/s; white matter is anisotropic along a
+  // direction that turns with position, the other tissues are isotropic.
+  itk::VariableLengthVector<short> signal(numberOfGradients + 1);
+  ShortImageType::PointType         point;
+  for( itk::ImageRegionIteratorWithIndex<ShortImageType> it( baseline, baseline->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const ShortImageType::IndexType index = it.GetIndex();
+    const short                     tissue = labels->GetPixel(index);
+    baseline->TransformIndexToPhysicalPoint(index, point);
+    const double angle = 0.02 * ( point[1] + point[2] );
+    const double fiber[3] = { std::cos(angle), std::sin(angle), 0.0 };
+    signal[0] = it.Get();
+    for( unsigned int g = 1; g <= numberOfGradients; ++g )
+      {
+      const GradientType & direction = gradients->GetElement(g);
+      double               diffusivity = 0.0;
+      switch( tissue )
+        {
+        case BRAINSBenchmark::PhantomWhiteMatter:
+          {
+          const double cosine = direction[0] * fiber[0] + direction[1] * fiber[1] + direction[2] * fiber[2];
+          diffusivity = 0.3e-3 + ( 1.7e-3 - 0.3e-3 ) * cosine * cosine;
+          break;
+          }
+        case BRAINSBenchmark::PhantomGrayMatter:
+          diffusivity = 0.8e-3;
+          break;
+        case BRAINSBenchmark::PhantomCSF:
+        case BRAINSBenchmark::PhantomEye:
+          diffusivity = 3.0e-3;
+          break;
+        default:
+          diffusivity = 1.0e-3;
+        }
+      signal[g] = static_cast<short>( it.Get() * std::exp(-bValue * diffusivity) );
+      }
+    dwi->SetPixel(index, signal);
+    }
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = baseline->GetLargestPossibleRegion().GetNumberOfPixels();
+  kernel.Run = [dwi, gradients, bValue]()
+    {
+      TensorFilterType::Pointer tensorFilter = TensorFilterType::New();
+      tensorFilter->SetGradientImage(gradients, dwi);
+      tensorFilter->SetBValue(bValue);
+      tensorFilter->SetThreshold(10);
+      tensorFilter->Update();
+    };
+  return kernel;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  BRAINSBenchmark::BenchmarkRunner runner("BRAINSCommonLib", argc, argv);
+
+  std::vector<unsigned int> imageSizes;
+  imageSizes.push_back(64);
+  imageSizes.push_back(128);
+  imageSizes.push_back(192);
+
+  runner.Add("MattesMutualInformation", imageSizes, MattesMutualInformationKernel);
+  runner.Add("GenericTransformImageLinear", imageSizes, GenericTransformImageKernel);
+  runner.Add("DiffusionTensorFit", imageSizes, DiffusionTensorFitKernel);
+  return runner.Execute();
+}
@@ -92,6 +92,41 @@ macro(MakeTestDriverFromSEMTool SEMToolName SEMToolTestSourceName)
   endif()
 endmacro()
 
+###############################################################################
+## BRAINSToolsAddBenchmark
+## Build a benchmark program made with BRAINSBenchmark.h and add a
+## Run<NAME> target, run by BRAINSToolsBenchmarks, that appends its results
+## to ${BRAINSTools_BENCHMARK_RESULTS_DIR}/<NAME>.jsonl.  A --quick run is
+## registered as a test so that the benchmarks keep working.
+macro(BRAINSToolsAddBenchmark)
+  set(options)
+  set(oneValueArgs NAME)
+  set(multiValueArgs SOURCES TARGET_LIBRARIES)
+  cmake_parse_arguments(BENCHMARK "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+  add_executable(${BENCHMARK_NAME} ${BENCHMARK_SOURCES})
+  target_link_libraries(${BENCHMARK_NAME} ${BENCHMARK_TARGET_LIBRARIES})
+  set_target_properties(${BENCHMARK_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}")
+  if(DEFINED MODULE_FOLDER)
+    set_target_properties(${BENCHMARK_NAME} PROPERTIES FOLDER ${MODULE_FOLDER})
+  endif()
+
+  add_custom_target(Run${BENCHMARK_NAME}
+    COMMAND ${CMAKE_COMMAND} -E make_directory ${BRAINSTools_BENCHMARK_RESULTS_DIR}
+    COMMAND $<TARGET_FILE:${BENCHMARK_NAME}> --output ${BRAINSTools_BENCHMARK_RESULTS_DIR}/${BENCHMARK_NAME}.jsonl ${BRAINSTools_BENCHMARK_ARGS}
+    DEPENDS ${BENCHMARK_NAME}
+    USES_TERMINAL
+    COMMENT "Running ${BENCHMARK_NAME}"
+    )
+  add_dependencies(BRAINSToolsBenchmarks Run${BENCHMARK_NAME})
+
+  if(BUILD_TESTING AND NOT BRAINSTools_DISABLE_TESTING)
+    add_test(NAME ${BENCHMARK_NAME}Quick
+      COMMAND ${LAUNCH_EXE} $<TARGET_FILE:${BENCHMARK_NAME}> --quick
+        --output ${CMAKE_CURRENT_BINARY_DIR}/${BENCHMARK_NAME}Quick.jsonl)
+  endif()
+endmacro()
+
 # DebugImageViewer Macro
 if(USE_DebugImageViewer)
 
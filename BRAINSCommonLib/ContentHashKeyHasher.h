@@ -0,0 +1,77 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __ContentHashKeyHasher_h
+#define __ContentHashKeyHasher_h
+
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+/** FNV-1a hash accumulator used to build content addressed cache keys */
+class ContentHashKeyHasher
+{
+public:
+  ContentHashKeyHasher() : m_Hash(14695981039346656037ULL)
+  {
+  }
+
+  void Add(const void *data, const size_t length)
+  {
+    const unsigned char *bytes = static_cast<const unsigned char *>( data );
+    for( size_t i = 0; i < length; ++i )
+      {
+      m_Hash ^= bytes[i];
+      m_Hash *= 1099511628211ULL;
+      }
+  }
+
+  void Add(const std::string & value)
+  {
+    this->Add(value.c_str(), value.size() + 1);
+  }
+
+  void Add(const double value)
+  {
+    this->Add(&value, sizeof(value) );
+  }
+
+  template <typename TArray>
+  void AddArray(const TArray & values, const size_t length)
+  {
+    const double count = length;
+    this->Add(count);
+    for( size_t i = 0; i < length; ++i )
+      {
+      this->Add(static_cast<double>( values[i] ) );
+      }
+  }
+
+  std::string GetKey() const
+  {
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << m_Hash;
+    return key.str();
+  }
+
+private:
+  unsigned long long m_Hash;
+};
+
+#endif // __ContentHashKeyHasher_h
@@ -0,0 +1,256 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __ForegroundMaskCache_h
+#define __ForegroundMaskCache_h
+
+#include "ContentHashKeyHasher.h"
+
+#include <itkImage.h>
+#include <itkImageDuplicator.h>
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itksys/SystemTools.hxx>
+#include <itksys/SystemInformation.hxx>
+
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+/**
+  * \class ForegroundMaskCache
+  *
+  * Process wide cache of the head/brain masks produced by
+  * LargestForegroundFilledMaskImageFilter.  BRAINSROIAuto, FindCenterOfBrain
+  * and BRAINSFit's useCenterOfHeadAlign all mask the same volumes with the
+  * same parameters, so masks are keyed by a hash of the input voxels, the
+  * image geometry and the filter parameters.  Only filters with UseMaskCache
+  * on (BRAINSROIAutoImageFilter and FindCenterOfBrainFilter) use it.
+  *
+  * The most recently used masks are kept in memory.  When the environment
+  * variable BRAINS_FOREGROUND_MASK_CACHE names a directory, masks are also
+  * stored there as compressed NRRD files so that later processes of the same
+  * pipeline can reuse them.
+  */
+class ForegroundMaskCache
+{
+public:
+  /** Number of masks kept in memory before the oldest one is dropped */
+  static constexpr size_t MaximumNumberOfMemoryEntries = 8;
+
+  static std::string GetCacheDirectory()
+  {
+    std::string cacheDirectory;
+    itksys::SystemTools::GetEnv("BRAINS_FOREGROUND_MASK_CACHE", cacheDirectory);
+    return cacheDirectory;
+  }
+
+  /** Hash the geometry and every voxel of the buffered region of image */
+  template <typename TImage>
+  static void AddImageToKey(ContentHashKeyHasher & hasher, const TImage *image)
+  {
+    const unsigned int Dimension = TImage::ImageDimension;
+
+    hasher.Add(static_cast<double>( sizeof( typename TImage::PixelType ) ) );
+    hasher.AddArray(image->GetLargestPossibleRegion().GetSize(), Dimension);
+    hasher.AddArray(image->GetLargestPossibleRegion().GetIndex(), Dimension);
+    hasher.AddArray(image->GetOrigin(), Dimension);
+    hasher.AddArray(image->GetSpacing(), Dimension);
+    for( unsigned int i = 0; i < Dimension; ++i )
+      {
+      hasher.AddArray(image->GetDirection()[i], Dimension);
+      }
+    if( image->GetBufferedRegion() == image->GetLargestPossibleRegion() )
+      {
+      hasher.Add(image->GetBufferPointer(),
+                 image->GetBufferedRegion().GetNumberOfPixels() * sizeof( typename TImage::PixelType ) );
+      }
+    else
+      {
+      for( itk::ImageRegionConstIterator<TImage> it( image, image->GetBufferedRegion() ); !it.IsAtEnd(); ++it )
+        {
+        const typename TImage::PixelType value = it.Get();
+        hasher.Add(&value, sizeof( value ) );
+        }
+      }
+  }
+
+  /**
+    * Return a private copy of the mask stored under key, or a null pointer.
+    * The mask must have the size of referenceImage, whose geometry it takes.
+    */
+  template <typename TMaskImage>
+  static typename TMaskImage::Pointer Find(const std::string & key,
+                                           const itk::ImageBase<TMaskImage::ImageDimension> *referenceImage)
+  {
+    typename TMaskImage::Pointer found;
+      {
+      std::lock_guard<std::mutex> lock( GetMutex() );
+      MemoryStoreType::const_iterator entry = GetMemoryStore().find(key);
+      if( entry != GetMemoryStore().end() )
+        {
+        found = Duplicate( dynamic_cast<const TMaskImage *>( entry->second.GetPointer() ) );
+        }
+      }
+
+    const std::string cacheFileName = GetCacheFileName(key);
+    if( found.IsNull() && !cacheFileName.empty() && itksys::SystemTools::FileExists(cacheFileName.c_str(), true) )
+      {
+      try
+        {
+        typedef itk::ImageFileReader<TMaskImage> ReaderType;
+        typename ReaderType::Pointer reader = ReaderType::New();
+        reader->SetFileName(cacheFileName);
+        reader->Update();
+        found = reader->GetOutput();
+        found->DisconnectPipeline();
+        StoreInMemory<TMaskImage>(key, found);
+        }
+      catch( itk::ExceptionObject & err )
+        {
+        std::cerr << "WARNING: ignoring unreadable foreground mask cache entry "
+                  << cacheFileName << std::endl << err << std::endl;
+        found = nullptr;
+        }
+      }
+
+    if( found.IsNull()
+        || found->GetLargestPossibleRegion().GetSize() != referenceImage->GetLargestPossibleRegion().GetSize() )
+      {
+      return nullptr;
+      }
+    // Take the exact geometry of the input rather than the NRRD round trip.
+    found->CopyInformation(referenceImage);
+    found->SetRegions( referenceImage->GetLargestPossibleRegion() );
+    return found;
+  }
+
+  /** Remember a copy of mask under key, in memory and in the cache directory */
+  template <typename TMaskImage>
+  static void Store(const std::string & key, const TMaskImage *mask)
+  {
+    StoreInMemory<TMaskImage>(key, Duplicate(mask) );
+
+    const std::string cacheFileName = GetCacheFileName(key);
+    if( cacheFileName.empty() || itksys::SystemTools::FileExists(cacheFileName.c_str(), true) )
+      {
+      return;
+      }
+    // Write to a process specific name and rename, so concurrent tools never
+    // see a partially written cache entry.
+    itksys::SystemInformation systemInformation;
+    std::ostringstream temporaryFileName;
+    temporaryFileName << GetCacheDirectory() << "/" << key << "." << systemInformation.GetProcessId() << ".tmp.nrrd";
+    try
+      {
+      itksys::SystemTools::MakeDirectory( GetCacheDirectory().c_str() );
+      typedef itk::ImageFileWriter<TMaskImage> WriterType;
+      typename WriterType::Pointer writer = WriterType::New();
+      writer->SetInput(mask);
+      writer->SetFileName( temporaryFileName.str() );
+      writer->UseCompressionOn();
+      writer->Update();
+      if( std::rename(temporaryFileName.str().c_str(), cacheFileName.c_str() ) != 0 )
+        {
+        itksys::SystemTools::RemoveFile( temporaryFileName.str().c_str() );
+        }
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      std::cerr << "WARNING: could not store foreground mask cache entry "
+                << cacheFileName << std::endl << err << std::endl;
+      }
+  }
+
+  /** Drop every mask held in memory; the cache directory is left untouched */
+  static void ClearMemory()
+  {
+    std::lock_guard<std::mutex> lock( GetMutex() );
+    GetMemoryStore().clear();
+    GetMemoryOrder().clear();
+  }
+
+private:
+  typedef std::map<std::string, itk::DataObject::ConstPointer> MemoryStoreType;
+
+  static std::string GetCacheFileName(const std::string & key)
+  {
+    const std::string cacheDirectory = GetCacheDirectory();
+    if( cacheDirectory.empty() )
+      {
+      return std::string();
+      }
+    return cacheDirectory + "/" + key + ".nrrd";
+  }
+
+  template <typename TMaskImage>
+  static typename TMaskImage::Pointer Duplicate(const TMaskImage *mask)
+  {
+    if( mask == nullptr )
+      {
+      return nullptr;
+      }
+    typedef itk::ImageDuplicator<TMaskImage> DuplicatorType;
+    typename DuplicatorType::Pointer duplicator = DuplicatorType::New();
+    duplicator->SetInputImage(mask);
+    duplicator->Update();
+    return duplicator->GetOutput();
+  }
+
+  template <typename TMaskImage>
+  static void StoreInMemory(const std::string & key, const TMaskImage *mask)
+  {
+    std::lock_guard<std::mutex> lock( GetMutex() );
+    MemoryStoreType & store = GetMemoryStore();
+    std::deque<std::string> & order = GetMemoryOrder();
+    if( store.find(key) == store.end() )
+      {
+      order.push_back(key);
+      }
+    store[key] = mask;
+    while( order.size() > MaximumNumberOfMemoryEntries )
+      {
+      store.erase( order.front() );
+      order.pop_front();
+      }
+  }
+
+  static std::mutex & GetMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static MemoryStoreType & GetMemoryStore()
+  {
+    static MemoryStoreType store;
+    return store;
+  }
+
+  static std::deque<std::string> & GetMemoryOrder()
+  {
+    static std::deque<std::string> order;
+    return order;
+  }
+};
+
+#endif // __ForegroundMaskCache_h
@@ -24,6 +24,8 @@
 #include "itkResampleInPlaceImageFilter.h"
 #include "itkConstantBoundaryCondition.h"
 #include "itkIO.h"
+#include "itkDisplacementFieldTransform.h"
+#include "TransformToDisplacementField.h"
 
 template <class InputImageType, class OutputImageType>
 typename OutputImageType::Pointer
@@ -406,13 +408,29 @@ typename OutputImageType::Pointer GenericTransformImage(
       }
     else
       {
+      typename itk::Transform<double, 3, 3>::ConstPointer resampleTransform = genericTransform;
+      // Non-linear transforms are evaluated once per reference grid and reused from the
+      // displacement field cache; at the voxel centers the field transform reproduces
+      // the cached displacements exactly.
+      const std::string cacheDirectory = GetDisplacementFieldCacheDirectory();
+      if( !cacheDirectory.empty()
+          && genericTransform->GetTransformCategory() != itk::Transform<double, 3, 3>::Linear )
+        {
+        typedef itk::DisplacementFieldTransform<double, 3>                  DisplacementFieldTransformType;
+        typedef DisplacementFieldTransformType::DisplacementFieldType       CachedDisplacementFieldType;
+        DisplacementFieldTransformType::Pointer cachedFieldTransform = DisplacementFieldTransformType::New();
+        cachedFieldTransform->SetDisplacementField(
+          CachedTransformToDisplacementField<typename CachedDisplacementFieldType::Pointer>(
+            ReferenceImage, genericTransform.GetPointer(), cacheDirectory) );
+        resampleTransform = cachedFieldTransform.GetPointer();
+        }
       TransformedImage = TransformResample<InputImageType, OutputImageType>(
         PrincipalOperandImage.GetPointer(),
         //TODO:  Change function signature to be a ConstPointer instead of a raw pointer ReferenceImage.GetPointer(),
         ReferenceImage,
         suggestedDefaultValue,
         GetInterpolatorFromString<InputImageType>(interpolationMode).GetPointer(),
-        genericTransform.GetPointer());
+        resampleTransform.GetPointer());
       }
     }
 
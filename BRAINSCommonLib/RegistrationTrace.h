@@ -0,0 +1,297 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __RegistrationTrace_h
+#define __RegistrationTrace_h
+
+#include "itkCommand.h"
+#include "itkGradientDescentOptimizerBasev4.h"
+#include "itkGradientDescentOptimizerv4.h"
+#include "itkRegularStepGradientDescentOptimizerv4.h"
+#include "itkLBFGSBOptimizerv4.h"
+#include "itkImageToImageMetricv4.h"
+#include "itkObjectToObjectMultiMetricv4.h"
+#include <itksys/SystemTools.hxx>
+#include <itksys/SystemInformation.hxx>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace BRAINSFit
+{
+/** One optimizer iteration of one registration stage */
+struct RegistrationTraceRecord
+{
+  std::string   Stage;
+  unsigned int  Level;
+  unsigned long Iteration;
+  double        MetricValue;
+  double        StepSize;
+  double        GradientNorm;
+  double        WallTime;
+  unsigned long NumberOfSampledPoints;
+};
+
+/**
+  * \class RegistrationTrace
+  *
+  * Process wide, machine readable log of every optimizer iteration of every
+  * registration stage.  The trace is enabled by SetFileName() (the BRAINSFit
+  * --registrationTraceFile option) or by the BRAINS_REGISTRATION_TRACE
+  * environment variable.  Files ending in .csv get one comma separated line
+  * per iteration after a header line; any other name gets one JSON object per
+  * line.  Records are appended, so a single file can collect many runs; the
+  * process id column tells them apart.
+  */
+class RegistrationTrace
+{
+public:
+  static RegistrationTrace & GetInstance()
+  {
+    static RegistrationTrace instance;
+    return instance;
+  }
+
+  void SetFileName(const std::string & fileName)
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    this->OpenLocked(fileName);
+  }
+
+  bool IsEnabled()
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stream.is_open();
+  }
+
+  void Record(const RegistrationTraceRecord & record)
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if( !m_Stream.is_open() )
+      {
+      return;
+      }
+    m_Stream << std::setprecision(std::numeric_limits<double>::digits10 + 1);
+    if( m_CSV )
+      {
+      m_Stream << m_ProcessId << "," << record.Stage << "," << record.Level << "," << record.Iteration << ","
+               << record.MetricValue << "," << record.StepSize << "," << record.GradientNorm << ","
+               << record.WallTime << "," << record.NumberOfSampledPoints << "\n";
+      }
+    else
+      {
+      m_Stream << "{\"pid\":" << m_ProcessId
+               << ",\"stage\":\"" << record.Stage << "\""
+               << ",\"level\":" << record.Level
+               << ",\"iteration\":" << record.Iteration
+               << ",\"metric\":" << JSONNumber(record.MetricValue)
+               << ",\"step\":" << JSONNumber(record.StepSize)
+               << ",\"gradientNorm\":" << JSONNumber(record.GradientNorm)
+               << ",\"wallTime\":" << JSONNumber(record.WallTime)
+               << ",\"sampledPoints\":" << record.NumberOfSampledPoints << "}\n";
+      }
+    m_Stream.flush();
+  }
+
+private:
+  RegistrationTrace() : m_CSV(false), m_ProcessId(0)
+  {
+    itksys::SystemInformation systemInformation;
+    m_ProcessId = systemInformation.GetProcessId();
+    std::string fileName;
+    if( itksys::SystemTools::GetEnv("BRAINS_REGISTRATION_TRACE", fileName) && !fileName.empty() )
+      {
+      this->OpenLocked(fileName);
+      }
+  }
+
+  void OpenLocked(const std::string & fileName)
+  {
+    if( m_Stream.is_open() )
+      {
+      m_Stream.close();
+      }
+    if( fileName.empty() )
+      {
+      return;
+      }
+    m_CSV = ( itksys::SystemTools::GetFilenameLastExtension(fileName) == ".csv" );
+    const bool writeHeader = m_CSV && ( !itksys::SystemTools::FileExists(fileName.c_str(), true)
+                                        || itksys::SystemTools::FileLength(fileName.c_str() ) == 0 );
+    m_Stream.open(fileName.c_str(), std::ios::out | std::ios::app);
+    if( !m_Stream.is_open() )
+      {
+      std::cerr << "WARNING: could not open registration trace file " << fileName << std::endl;
+      return;
+      }
+    if( writeHeader )
+      {
+      m_Stream << "pid,stage,level,iteration,metric,step,gradientNorm,wallTime,sampledPoints\n";
+      }
+  }
+
+  /** JSON has no NaN or infinity literals */
+  static std::string JSONNumber(const double value)
+  {
+    if( value != value || value > std::numeric_limits<double>::max() || value < -std::numeric_limits<double>::max() )
+      {
+      return "null";
+      }
+    std::ostringstream number;
+    number << std::setprecision(std::numeric_limits<double>::digits10 + 1) << value;
+    return number.str();
+  }
+
+  std::mutex    m_Mutex;
+  std::ofstream m_Stream;
+  bool          m_CSV;
+  unsigned long m_ProcessId;
+};
+
+typedef itk::ObjectToObjectOptimizerBaseTemplate<double> RegistrationTraceOptimizerType;
+
+/** Step size taken by the optimizer in the last iteration, NaN when unknown */
+inline double RegistrationTraceStepSize(const RegistrationTraceOptimizerType *optimizer)
+{
+  const itk::RegularStepGradientDescentOptimizerv4<double> *regularStep =
+    dynamic_cast<const itk::RegularStepGradientDescentOptimizerv4<double> *>( optimizer );
+  if( regularStep != nullptr )
+    {
+    return regularStep->GetLearningRate() * regularStep->GetCurrentLearningRateRelaxation();
+    }
+  const itk::GradientDescentOptimizerv4Template<double> *gradientDescent =
+    dynamic_cast<const itk::GradientDescentOptimizerv4Template<double> *>( optimizer );
+  if( gradientDescent != nullptr )
+    {
+    return gradientDescent->GetLearningRate();
+    }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+/** Norm of the last metric gradient seen by the optimizer, NaN when unknown */
+inline double RegistrationTraceGradientNorm(const RegistrationTraceOptimizerType *optimizer)
+{
+  const itk::GradientDescentOptimizerBasev4Template<double> *gradientDescent =
+    dynamic_cast<const itk::GradientDescentOptimizerBasev4Template<double> *>( optimizer );
+  if( gradientDescent != nullptr )
+    {
+    return gradientDescent->GetGradient().two_norm();
+    }
+  const itk::LBFGSBOptimizerv4 *lbfgsb = dynamic_cast<const itk::LBFGSBOptimizerv4 *>( optimizer );
+  if( lbfgsb != nullptr )
+    {
+    return lbfgsb->GetCachedDerivative().two_norm();
+    }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+  * \class RegistrationTraceCommand
+  *
+  * Observer that feeds RegistrationTrace.  Add it to the optimizer for
+  * IterationEvent and to the ImageRegistrationMethodv4 for
+  * MultiResolutionIterationEvent so that the level is known.  Works with
+  * any v4 optimizer and metric: step size and gradient norm are reported
+  * for the optimizers that expose them, and the number of sampled points is
+  * read from the ImageToImageMetricv4 (or the first component of a multi
+  * metric).
+  */
+template <typename TImage>
+class RegistrationTraceCommand : public itk::Command
+{
+public:
+  typedef RegistrationTraceCommand Self;
+  typedef itk::Command             Superclass;
+  typedef itk::SmartPointer<Self>  Pointer;
+  itkNewMacro(Self);
+
+  typedef RegistrationTraceOptimizerType OptimizerType;
+  typedef itk::ImageToImageMetricv4<TImage, TImage, TImage, double>                                ImageMetricType;
+  typedef itk::ObjectToObjectMultiMetricv4<TImage::ImageDimension, TImage::ImageDimension, TImage, double> MultiMetricType;
+
+  void SetStage(const std::string & stage)
+  {
+    m_Stage = stage;
+  }
+
+  void Execute(itk::Object *caller, const itk::EventObject & event) override
+  {
+    this->Execute( (const itk::Object *)caller, event );
+  }
+
+  void Execute(const itk::Object *object, const itk::EventObject & event) override
+  {
+    if( itk::MultiResolutionIterationEvent().CheckEvent(&event) )
+      {
+      ++m_Level;
+      return;
+      }
+    if( !itk::IterationEvent().CheckEvent(&event) )
+      {
+      return;
+      }
+    const OptimizerType *optimizer = dynamic_cast<const OptimizerType *>( object );
+    if( optimizer == nullptr )
+      {
+      return;
+      }
+
+    RegistrationTraceRecord record;
+    record.Stage = m_Stage;
+    record.Level = ( m_Level < 0 ) ? 0 : static_cast<unsigned int>( m_Level );
+    record.Iteration = optimizer->GetCurrentIteration();
+    record.MetricValue = optimizer->GetValue();
+    record.StepSize = RegistrationTraceStepSize(optimizer);
+    record.GradientNorm = RegistrationTraceGradientNorm(optimizer);
+    record.WallTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - m_StartTime ).count();
+    record.NumberOfSampledPoints = this->GetNumberOfSampledPoints(optimizer);
+    RegistrationTrace::GetInstance().Record(record);
+  }
+
+protected:
+  RegistrationTraceCommand() : m_Stage("Registration"),
+    m_Level(-1),
+    m_StartTime(std::chrono::steady_clock::now() )
+  {
+  }
+
+private:
+  unsigned long GetNumberOfSampledPoints(const OptimizerType *optimizer) const
+  {
+    const itk::Object *metric = optimizer->GetMetric();
+    const MultiMetricType *multiMetric = dynamic_cast<const MultiMetricType *>( metric );
+    if( multiMetric != nullptr && multiMetric->GetNumberOfMetrics() > 0 )
+      {
+      metric = multiMetric->GetMetricQueue()[0].GetPointer();
+      }
+    const ImageMetricType *imageMetric = dynamic_cast<const ImageMetricType *>( metric );
+    return ( imageMetric != nullptr ) ? imageMetric->GetNumberOfValidPoints() : 0;
+  }
+
+  std::string                                        m_Stage;
+  int                                                m_Level;
+  std::chrono::time_point<std::chrono::steady_clock> m_StartTime;
+};
+} // end namespace BRAINSFit
+
+#endif // __RegistrationTrace_h
@@ -0,0 +1,133 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __SupportBufferedImage_h
+#define __SupportBufferedImage_h
+
+#include <itkImage.h>
+#include <itkImageAlgorithm.h>
+#include <itkImageRegionIterator.h>
+#include <itkNumericTraits.h>
+
+#include <algorithm>
+
+/**
+ * Helpers for "support buffered" images: probability images whose
+ * LargestPossibleRegion is the whole image grid, but whose BufferedRegion
+ * only covers the voxels where the image is non-zero.  Voxels outside the
+ * buffer are implicitly zero.  Dense images, with the buffer covering the
+ * whole grid, are a special case, so every helper also accepts them.
+ *
+ * Pipeline filters request the LargestPossibleRegion of their inputs, so a
+ * support buffered image is expanded with ExpandSupportBufferedImage before
+ * it is handed to a filter or a writer.
+ */
+
+/** The value at index, zero outside the buffered region */
+template <class TImage>
+inline typename TImage::PixelType
+GetSupportPixel(const TImage *image, const typename TImage::IndexType & index)
+{
+  if( image->GetBufferedRegion().IsInside(index) )
+    {
+    return image->GetPixel(index);
+    }
+  return itk::NumericTraits<typename TImage::PixelType>::ZeroValue();
+}
+
+/** A zero filled image with the information of reference, buffered on region */
+template <class TImage>
+typename TImage::Pointer
+AllocateSupportBufferedImage(const TImage *reference, const typename TImage::RegionType & region)
+{
+  typename TImage::Pointer image = TImage::New();
+  image->CopyInformation(reference);
+  image->SetBufferedRegion(region);
+  image->SetRequestedRegion(region);
+  image->Allocate();
+  image->FillBuffer(itk::NumericTraits<typename TImage::PixelType>::ZeroValue() );
+  return image;
+}
+
+/** A copy of image buffered on region, which may be smaller or larger than
+ *  the current buffer.  Voxels that were not buffered are zero. */
+template <class TImage>
+typename TImage::Pointer
+BufferOnRegion(const TImage *image, const typename TImage::RegionType & region)
+{
+  typename TImage::Pointer rebuffered = AllocateSupportBufferedImage<TImage>(image, region);
+  typename TImage::RegionType overlap = region;
+  if( overlap.Crop(image->GetBufferedRegion() ) )
+    {
+    itk::ImageAlgorithm::Copy(image, rebuffered.GetPointer(), overlap, overlap);
+    }
+  return rebuffered;
+}
+
+/** The smallest region that contains both a and b */
+template <class TRegion>
+TRegion
+BoundingRegionUnion(const TRegion & a, const TRegion & b)
+{
+  if( a.GetNumberOfPixels() == 0 )
+    {
+    return b;
+    }
+  if( b.GetNumberOfPixels() == 0 )
+    {
+    return a;
+    }
+  TRegion bounds;
+  for( unsigned int d = 0; d < TRegion::ImageDimension; ++d )
+    {
+    const typename TRegion::IndexValueType first = std::min(a.GetIndex(d), b.GetIndex(d) );
+    const typename TRegion::IndexValueType last =
+      std::max(a.GetIndex(d) + static_cast<typename TRegion::IndexValueType>( a.GetSize(d) ),
+               b.GetIndex(d) + static_cast<typename TRegion::IndexValueType>( b.GetSize(d) ) );
+    bounds.SetIndex(d, first);
+    bounds.SetSize(d, static_cast<typename TRegion::SizeValueType>( last - first ) );
+    }
+  return bounds;
+}
+
+/** A dense copy of image, or image itself when it is already dense */
+template <class TImage>
+typename TImage::Pointer
+ExpandSupportBufferedImage(const typename TImage::Pointer & image)
+{
+  if( image->GetBufferedRegion() == image->GetLargestPossibleRegion() )
+    {
+    return image;
+    }
+  return BufferOnRegion<TImage>(image.GetPointer(), image->GetLargestPossibleRegion() );
+}
+
+/** A copy of image multiplied by scale, buffered on the same region */
+template <class TImage>
+typename TImage::Pointer
+ScaleSupportBufferedImage(const TImage *image, const double scale)
+{
+  typename TImage::Pointer scaled = BufferOnRegion<TImage>(image, image->GetBufferedRegion() );
+  for( itk::ImageRegionIterator<TImage> it(scaled, scaled->GetBufferedRegion() ); !it.IsAtEnd(); ++it )
+    {
+    it.Set(static_cast<typename TImage::PixelType>( it.Get() * scale ) );
+    }
+  return scaled;
+}
+
+#endif // __SupportBufferedImage_h
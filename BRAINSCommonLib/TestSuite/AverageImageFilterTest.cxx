@@ -8,6 +8,47 @@
 #include <itkStatisticsImageFilter.h>
 
 #include "itkAverageImageFilter.h"
+#include "itkRunningAverageImageAccumulator.h"
+
+// the running average of the same images, adding one image at a time
+template <typename TImage>
+static bool RunningAverageMatches(const std::vector<typename TImage::Pointer> & inputImages,
+                                  TImage *testAvg, const double _eps)
+{
+  typedef itk::RunningAverageImageAccumulator<TImage,TImage> AccumulatorType;
+  typedef itk::SubtractImageFilter<TImage> SubtractFilterType;
+  typedef itk::StatisticsImageFilter<TImage> StatFilterType;
+
+  typename AccumulatorType::Pointer accumulator = AccumulatorType::New();
+  for(unsigned i = 0; i < inputImages.size(); ++i)
+    {
+    accumulator->AddImage(inputImages[i]);
+    }
+  if(accumulator->GetNumberOfImages() != inputImages.size())
+    {
+    std::cout << "Wrong number of accumulated images" << std::endl;
+    return false;
+    }
+
+  typename SubtractFilterType::Pointer subFilter =
+    SubtractFilterType::New();
+  subFilter->SetInput1(testAvg);
+  subFilter->SetInput2(accumulator->GetAverage());
+
+  typename StatFilterType::Pointer statFilter = StatFilterType::New();
+  statFilter->SetInput(subFilter->GetOutput());
+
+  statFilter->Update();
+
+  std::cout << "Running average Min("
+            << statFilter->GetMinimum() << ") Max("
+            << statFilter->GetMaximum() << ") Mean ("
+            << statFilter->GetMean() << ")" << std::endl;
+
+  return vcl_abs(statFilter->GetMinimum()) < _eps &&
+    vcl_abs(statFilter->GetMaximum()) < _eps &&
+    vcl_abs(statFilter->GetMean()) < _eps;
+}
 
 int main( int , char * [] )
 {
@@ -90,7 +131,8 @@ int main( int , char * [] )
   const double _eps(0.00000001);
   if(vcl_abs(statFilter->GetMinimum()) < _eps &&
      vcl_abs(statFilter->GetMaximum()) < _eps &&
-     vcl_abs(statFilter->GetMean()) < _eps)
+     vcl_abs(statFilter->GetMean()) < _eps &&
+     RunningAverageMatches<FloatImage2DType>(inputImages, testAvg, _eps))
     {
     return EXIT_SUCCESS;
     }
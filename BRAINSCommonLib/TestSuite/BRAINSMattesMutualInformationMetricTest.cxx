@@ -0,0 +1,217 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "itkAffineTransform.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkVersorRigid3DTransform.h"
+#include "itkBRAINSMattesMutualInformationImageToImageMetricv4.h"
+
+typedef itk::Image<float, 3>                 ImageType;
+typedef itk::ImageMaskSpatialObject<3>       MaskSpatialObjectType;
+typedef MaskSpatialObjectType::ImageType     MaskImageType;
+
+/** Two overlapping Gaussian blobs of different brightness, moved by shift (mm) */
+static ImageType::Pointer CreateBlobImage(const double shift)
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::SizeType size;
+  size.Fill(32);
+  image->SetRegions(size);
+  ImageType::SpacingType spacing;
+  spacing.Fill(1.5);
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+    {
+    ImageType::PointType point;
+    image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    const double x = point[0] - 24.0 - shift;
+    const double y = point[1] - 22.0;
+    const double z = point[2] - 23.0;
+    const double large = std::exp( -( x * x + y * y + z * z ) / 120.0 );
+    const double small = std::exp( -( ( x - 6.0 ) * ( x - 6.0 ) + y * y + ( z + 4.0 ) * ( z + 4.0 ) ) / 20.0 );
+    it.Set( static_cast<float>( 100.0 * large + 60.0 * small + 0.05 * point[1] ) );
+    }
+  return image;
+}
+
+/** A ball mask on the grid of image, cutting through the blobs so that
+ * samples at its edge interpolate from voxels outside the masked range */
+static MaskSpatialObjectType::Pointer CreateBallMask(const ImageType *image, const double centerX,
+                                                     const double radius)
+{
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->CopyInformation(image);
+  maskImage->SetRegions( image->GetLargestPossibleRegion() );
+  maskImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<MaskImageType> it( maskImage, maskImage->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+    {
+    MaskImageType::PointType point;
+    maskImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    const double x = point[0] - centerX;
+    const double y = point[1] - 22.0;
+    const double z = point[2] - 23.0;
+    it.Set( ( x * x + y * y + z * z ) < radius * radius ? 1 : 0 );
+    }
+
+  MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+  mask->SetImage(maskImage);
+  return mask;
+}
+
+template <typename TTransform>
+static bool CompareWithMattes(const ImageType *fixedImage, const ImageType *movingImage, TTransform *transform,
+                              const MaskSpatialObjectType *fixedMask, const MaskSpatialObjectType *movingMask)
+{
+  typedef itk::MattesMutualInformationImageToImageMetricv4<ImageType, ImageType>      MattesMetricType;
+  typedef itk::BRAINSMattesMutualInformationImageToImageMetricv4<ImageType, ImageType> BRAINSMetricType;
+
+  typename MattesMetricType::Pointer mattesMetric = MattesMetricType::New();
+  typename BRAINSMetricType::Pointer brainsMetric = BRAINSMetricType::New();
+  MattesMetricType * metrics[2] = { mattesMetric.GetPointer(), brainsMetric.GetPointer() };
+  for( unsigned int i = 0; i < 2; ++i )
+    {
+    metrics[i]->SetFixedImage(fixedImage);
+    metrics[i]->SetMovingImage(movingImage);
+    metrics[i]->SetMovingTransform(transform);
+    metrics[i]->SetNumberOfHistogramBins(32);
+    metrics[i]->SetUseMovingImageGradientFilter(false);
+    metrics[i]->SetUseFixedImageGradientFilter(false);
+    metrics[i]->SetFixedImageMask(fixedMask);
+    metrics[i]->SetMovingImageMask(movingMask);
+    metrics[i]->Initialize();
+    }
+  if( brainsMetric->GetNumberOfLinearKernelSamples() == 0 )
+    {
+    std::cerr << transform->GetNameOfClass() << ": the linear kernel was not used" << std::endl;
+    return false;
+    }
+
+  MattesMetricType::MeasureType    mattesValue;
+  MattesMetricType::DerivativeType mattesDerivative;
+  mattesMetric->GetValueAndDerivative(mattesValue, mattesDerivative);
+  MattesMetricType::MeasureType    brainsValue;
+  MattesMetricType::DerivativeType brainsDerivative;
+  brainsMetric->GetValueAndDerivative(brainsValue, brainsDerivative);
+  const MattesMetricType::MeasureType brainsValueOnly = brainsMetric->GetValue();
+
+  // Both metrics scale the derivative by the same -1 / (binSize * N), so the
+  // derivatives agree element by element.
+  double maximumDerivative = 0.0;
+  for( unsigned int p = 0; p < mattesDerivative.Size(); ++p )
+    {
+    maximumDerivative = std::max( maximumDerivative, std::abs(mattesDerivative[p]) );
+    }
+  bool derivativesMatch = brainsDerivative.Size() == transform->GetNumberOfParameters()
+    && brainsDerivative.Size() == mattesDerivative.Size();
+  for( unsigned int p = 0; derivativesMatch && p < mattesDerivative.Size(); ++p )
+    {
+    const double tolerance = 1e-5 * ( std::abs(mattesDerivative[p]) + 1e-3 * maximumDerivative );
+    if( std::abs(brainsDerivative[p] - mattesDerivative[p]) > tolerance )
+      {
+      std::cerr << "Derivative " << p << ": Mattes " << mattesDerivative[p] << ", BRAINS "
+                << brainsDerivative[p] << std::endl;
+      derivativesMatch = false;
+      }
+    }
+
+  std::cout << transform->GetNameOfClass() << ( fixedMask != nullptr ? " (masked)" : "" ) << ": Mattes "
+            << mattesValue << ", BRAINS " << brainsValue << ", valid points " << mattesMetric->GetNumberOfValidPoints()
+            << " / " << brainsMetric->GetNumberOfValidPoints() << std::endl;
+
+  bool passed = true;
+  if( std::abs(brainsValue - mattesValue) > 1e-8 * std::abs(mattesValue) )
+    {
+    std::cerr << "Metric values differ" << std::endl;
+    passed = false;
+    }
+  if( mattesMetric->GetNumberOfValidPoints() != brainsMetric->GetNumberOfValidPoints() )
+    {
+    std::cerr << "Numbers of valid points differ" << std::endl;
+    passed = false;
+    }
+  if( std::abs(brainsValueOnly - brainsValue) > 1e-12 * std::abs(brainsValue) )
+    {
+    std::cerr << "GetValue() differs from GetValueAndDerivative()" << std::endl;
+    passed = false;
+    }
+  if( !derivativesMatch )
+    {
+    std::cerr << "Metric derivatives differ" << std::endl;
+    passed = false;
+    }
+  return passed;
+}
+
+int main(int, char * *)
+{
+  const ImageType::Pointer fixedImage = CreateBlobImage(0.0);
+  const ImageType::Pointer movingImage = CreateBlobImage(2.0);
+
+  ImageType::PointType center;
+  center[0] = 24.0; center[1] = 22.0; center[2] = 23.0;
+
+  typedef itk::VersorRigid3DTransform<double> RigidTransformType;
+  RigidTransformType::Pointer rigidTransform = RigidTransformType::New();
+  rigidTransform->SetCenter(center);
+  RigidTransformType::ParametersType rigidParameters = rigidTransform->GetParameters();
+  rigidParameters[0] = 0.02;
+  rigidParameters[2] = -0.03;
+  rigidParameters[4] = 0.5;
+  rigidTransform->SetParameters(rigidParameters);
+
+  typedef itk::AffineTransform<double, 3> AffineTransformType;
+  AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+  affineTransform->SetCenter(center);
+  AffineTransformType::ParametersType affineParameters = affineTransform->GetParameters();
+  affineParameters[0] = 1.05;
+  affineParameters[1] = 0.02;
+  affineParameters[5] = -0.03;
+  affineParameters[9] = 0.7;
+  affineTransform->SetParameters(affineParameters);
+
+  // The moving ball is smaller than the blob, so the masked moving range
+  // excludes values that edge samples interpolate from outside the mask.
+  const MaskSpatialObjectType::Pointer fixedMask = CreateBallMask(fixedImage.GetPointer(), 24.0, 14.0);
+  const MaskSpatialObjectType::Pointer movingMask = CreateBallMask(movingImage.GetPointer(), 26.0, 11.0);
+
+  bool passed = true;
+  for( unsigned int masked = 0; masked < 2; ++masked )
+    {
+    const MaskSpatialObjectType *fixedImageMask = masked ? fixedMask.GetPointer() : nullptr;
+    const MaskSpatialObjectType *movingImageMask = masked ? movingMask.GetPointer() : nullptr;
+    passed = CompareWithMattes(fixedImage.GetPointer(), movingImage.GetPointer(), rigidTransform.GetPointer(),
+                               fixedImageMask, movingImageMask) && passed;
+    passed = CompareWithMattes(fixedImage.GetPointer(), movingImage.GetPointer(), affineTransform.GetPointer(),
+                               fixedImageMask, movingImageMask) && passed;
+    }
+  if( !passed )
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "PASSED" << std::endl;
+  return EXIT_SUCCESS;
+}
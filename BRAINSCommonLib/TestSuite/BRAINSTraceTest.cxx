@@ -0,0 +1,105 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "itksys/SystemTools.hxx"
+#include "BRAINSTrace.h"
+
+static unsigned int CountOccurrences(const std::string & text, const std::string & pattern)
+{
+  unsigned int           count = 0;
+  std::string::size_type position = text.find(pattern);
+  while( position != std::string::npos )
+    {
+    ++count;
+    position = text.find(pattern, position + pattern.size() );
+    }
+  return count;
+}
+
+int main(int argc, char * *argv)
+{
+  if( argc < 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " <traceFile>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string traceFileName = argv[1];
+
+  // The trace reads BRAINS_TRACE once, when it is first used.
+  itksys::SystemTools::PutEnv(std::string("BRAINS_TRACE=") + traceFileName);
+  if( !BRAINSUtils::Trace::IsEnabled() )
+    {
+    std::cerr << "BRAINS_TRACE did not enable the trace" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+    {
+    BRAINS_TRACE_SCOPE("Outer");
+      {
+      BRAINS_TRACE_SCOPE("Inner");
+      }
+    std::thread worker([]()
+                         {
+                         BRAINS_TRACE_SCOPE("Worker");
+                         });
+    worker.join();
+    }
+  BRAINSUtils::Trace::GetInstance().Flush();
+
+  std::ifstream traceFile(traceFileName.c_str() );
+  if( !traceFile.is_open() )
+    {
+    std::cerr << "Trace file " << traceFileName << " was not written" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::stringstream contents;
+  contents << traceFile.rdbuf();
+  const std::string trace = contents.str();
+
+  int status = EXIT_SUCCESS;
+  if( trace.find("\"traceEvents\":[") == std::string::npos )
+    {
+    std::cerr << "Missing traceEvents array" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  if( CountOccurrences(trace, "\"ph\":\"X\"") != 3 || CountOccurrences(trace, "\"ph\":\"C\"") != 3 )
+    {
+    std::cerr << "Expected three scopes and three peak RSS counters" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  if( trace.find("\"name\":\"Inner\",\"cat\":\"BRAINSTools\",\"ph\":\"X\"") == std::string::npos
+      || trace.find("\"depth\":1") == std::string::npos )
+    {
+    std::cerr << "Nested scope was not recorded at depth 1" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  if( trace.find("\"tid\":2") == std::string::npos )
+    {
+    std::cerr << "Worker thread scope was not recorded on its own thread" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  if( status == EXIT_SUCCESS )
+    {
+    std::cout << "PASSED" << std::endl;
+    }
+  return status;
+}
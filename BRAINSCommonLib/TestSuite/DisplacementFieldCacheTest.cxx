@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <iostream>
+#include "itkBSplineTransform.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "TransformToDisplacementField.h"
+
+int main(int argc, char * *argv)
+{
+  if( argc < 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " <cacheDirectory>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string cacheDirectory = argv[1];
+
+  typedef itk::Image<short, 3>                      ReferenceImageType;
+  typedef itk::Image<itk::Vector<float, 3>, 3>      DisplacementFieldType;
+  typedef itk::BSplineTransform<double, 3, 3>       BSplineTransformType;
+
+  ReferenceImageType::Pointer referenceImage = ReferenceImageType::New();
+  ReferenceImageType::SizeType size;
+  size.Fill(16);
+  referenceImage->SetRegions(size);
+  ReferenceImageType::SpacingType spacing;
+  spacing[0] = 1.0; spacing[1] = 1.5; spacing[2] = 2.0;
+  referenceImage->SetSpacing(spacing);
+
+  BSplineTransformType::PhysicalDimensionsType physicalDimensions;
+  BSplineTransformType::MeshSizeType           meshSize;
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    physicalDimensions[i] = spacing[i] * ( size[i] - 1 );
+    }
+  meshSize.Fill(2);
+  BSplineTransformType::Pointer bspline = BSplineTransformType::New();
+  bspline->SetTransformDomainOrigin(referenceImage->GetOrigin() );
+  bspline->SetTransformDomainPhysicalDimensions(physicalDimensions);
+  bspline->SetTransformDomainMeshSize(meshSize);
+  bspline->SetTransformDomainDirection(referenceImage->GetDirection() );
+  BSplineTransformType::ParametersType parameters(bspline->GetNumberOfParameters() );
+  for( unsigned int p = 0; p < parameters.Size(); ++p )
+    {
+    parameters[p] = 0.01 * ( p % 17 );
+    }
+  bspline->SetParameters(parameters);
+
+  const std::string firstKey =
+    ComputeDisplacementFieldCacheKey<DisplacementFieldType, 3>(referenceImage.GetPointer(), bspline.GetPointer() );
+  const std::string cacheFileName = cacheDirectory + "/" + firstKey + ".nrrd";
+  itksys::SystemTools::RemoveFile(cacheFileName.c_str() );
+
+  DisplacementFieldType::Pointer computed =
+    CachedTransformToDisplacementField<DisplacementFieldType::Pointer>(referenceImage.GetPointer(),
+                                                                       bspline.GetPointer(), cacheDirectory);
+  if( !itksys::SystemTools::FileExists(cacheFileName.c_str(), true) )
+    {
+    std::cerr << "Cache entry " << cacheFileName << " was not written" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Mark one voxel of the cache entry on disk, so the second call can only
+  // return the marker if it loaded the entry instead of recomputing it.
+  DisplacementFieldType::IndexType markerIndex;
+  markerIndex.Fill(3);
+  DisplacementFieldType::PixelType marker;
+  marker[0] = 123.0F; marker[1] = -45.0F; marker[2] = 6.5F;
+  computed->SetPixel(markerIndex, marker);
+  typedef itk::ImageFileWriter<DisplacementFieldType> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(computed);
+  writer->SetFileName(cacheFileName);
+  writer->UseCompressionOff();
+  writer->Update();
+
+  DisplacementFieldType::Pointer cached =
+    CachedTransformToDisplacementField<DisplacementFieldType::Pointer>(referenceImage.GetPointer(),
+                                                                       bspline.GetPointer(), cacheDirectory);
+  if( cached->GetPixel(markerIndex) != marker )
+    {
+    std::cerr << "The second call recomputed the displacement field instead of loading " << cacheFileName
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::ImageRegionConstIterator<DisplacementFieldType> computedIt(computed, computed->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator<DisplacementFieldType> cachedIt(cached, cached->GetLargestPossibleRegion() );
+  for( ; !computedIt.IsAtEnd(); ++computedIt, ++cachedIt )
+    {
+    if( computedIt.Get() != cachedIt.Get() )
+      {
+      std::cerr << "Cached displacement differs at " << computedIt.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  parameters[0] += 0.5;
+  bspline->SetParameters(parameters);
+  const std::string secondKey =
+    ComputeDisplacementFieldCacheKey<DisplacementFieldType, 3>(referenceImage.GetPointer(), bspline.GetPointer() );
+  if( secondKey == firstKey )
+    {
+    std::cerr << "Changing the transform parameters did not change the cache key" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::cout << "Displacement field cache key: " << firstKey << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <iostream>
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLargestForegroundFilledMaskImageFilter.h"
+#include <itksys/Directory.hxx>
+
+typedef itk::Image<short, 3>         HeadImageType;
+typedef itk::Image<unsigned char, 3> MaskImageType;
+
+static MaskImageType::Pointer ComputeMask(const HeadImageType *head)
+{
+  typedef itk::LargestForegroundFilledMaskImageFilter<HeadImageType, MaskImageType> LFFMaskFilterType;
+  LFFMaskFilterType::Pointer LFF = LFFMaskFilterType::New();
+  LFF->SetInput(head);
+  LFF->SetOtsuPercentileThreshold(0.01);
+  LFF->SetClosingSize(3.0);
+  LFF->UseMaskCacheOn();
+  LFF->Update();
+  return LFF->GetOutput();
+}
+
+static bool SameMask(const MaskImageType *a, const MaskImageType *b)
+{
+  itk::ImageRegionConstIterator<MaskImageType> aIt(a, a->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator<MaskImageType> bIt(b, b->GetLargestPossibleRegion() );
+  for( ; !aIt.IsAtEnd(); ++aIt, ++bIt )
+    {
+    if( aIt.Get() != bIt.Get() )
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+int main(int argc, char * *argv)
+{
+  if( argc < 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " <cacheDirectory>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string cacheDirectory = argv[1];
+  itksys::SystemTools::RemoveADirectory(cacheDirectory.c_str() );
+  itksys::SystemTools::PutEnv( ( "BRAINS_FOREGROUND_MASK_CACHE=" + cacheDirectory ).c_str() );
+
+  // A bright ellipsoidal "head" with a dark hole, on a noisy dark background.
+  HeadImageType::Pointer head = HeadImageType::New();
+  HeadImageType::SizeType size;
+  size[0] = 40; size[1] = 48; size[2] = 36;
+  head->SetRegions(size);
+  head->Allocate();
+  for( itk::ImageRegionIteratorWithIndex<HeadImageType> it( head, head->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const HeadImageType::IndexType index = it.GetIndex();
+    const double x = ( index[0] - 20.0 ) / 14.0;
+    const double y = ( index[1] - 24.0 ) / 17.0;
+    const double z = ( index[2] - 18.0 ) / 12.0;
+    const double r = x * x + y * y + z * z;
+    short value = static_cast<short>( ( index[0] * 7 + index[1] * 3 + index[2] ) % 11 );
+    if( r < 1.0 && r > 0.05 )
+      {
+      value += 1000;
+      }
+    it.Set(value);
+    }
+
+  MaskImageType::Pointer computed = ComputeMask(head);
+  ForegroundMaskCache::ClearMemory();
+  MaskImageType::Pointer fromDisk = ComputeMask(head);
+  MaskImageType::Pointer fromMemory = ComputeMask(head);
+  if( !SameMask(computed, fromDisk) || !SameMask(computed, fromMemory) )
+    {
+    std::cerr << "Cached foreground mask differs from the computed one" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itksys::Directory cacheListing;
+  cacheListing.Load(cacheDirectory.c_str() );
+  unsigned int numberOfEntries = 0;
+  for( unsigned long i = 0; i < cacheListing.GetNumberOfFiles(); ++i )
+    {
+    if( itksys::SystemTools::GetFilenameLastExtension(cacheListing.GetFile(i) ) == ".nrrd" )
+      {
+      ++numberOfEntries;
+      }
+    }
+  if( numberOfEntries != 1 )
+    {
+    std::cerr << "Expected one cache entry in " << cacheDirectory << ", found " << numberOfEntries << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Changing a voxel must produce a different key.
+  ContentHashKeyHasher before;
+  ForegroundMaskCache::AddImageToKey(before, head.GetPointer() );
+  HeadImageType::IndexType corner;
+  corner.Fill(0);
+  head->SetPixel(corner, head->GetPixel(corner) + 1);
+  ContentHashKeyHasher after;
+  ForegroundMaskCache::AddImageToKey(after, head.GetPointer() );
+  if( before.GetKey() == after.GetKey() )
+    {
+    std::cerr << "Changing the image content did not change the cache key" << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <fstream>
+#include <iostream>
+#include "itksys/SystemTools.hxx"
+#include "BRAINSThreadControl.h"
+
+#if defined( __linux__ )
+#include <sched.h>
+#endif
+
+static void WriteFile(const std::string & fileName, const std::string & contents)
+{
+  std::ofstream file(fileName.c_str() );
+  file << contents << std::endl;
+}
+
+static bool CheckCGroupLimit(const std::string & cgroupRoot, const int expected, const char *description)
+{
+  const int limit = BRAINSUtils::GetCGroupCPULimit(cgroupRoot);
+  if( limit != expected )
+    {
+    std::cerr << description << ": expected a limit of " << expected << ", got " << limit << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int main(int argc, char * *argv)
+{
+  if( argc < 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " <scratchDirectory>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string cgroupRoot = std::string(argv[1]) + "/cgroup";
+  itksys::SystemTools::RemoveADirectory(cgroupRoot);
+  itksys::SystemTools::MakeDirectory(cgroupRoot + "/cpu");
+
+  bool passed = CheckCGroupLimit(cgroupRoot, 0, "no cgroup files");
+
+  // cgroup v1: quota and period in two files, -1 is unlimited
+  WriteFile(cgroupRoot + "/cpu/cpu.cfs_period_us", "100000");
+  WriteFile(cgroupRoot + "/cpu/cpu.cfs_quota_us", "-1");
+  passed = CheckCGroupLimit(cgroupRoot, 0, "unlimited v1 quota") && passed;
+  WriteFile(cgroupRoot + "/cpu/cpu.cfs_quota_us", "250000");
+  passed = CheckCGroupLimit(cgroupRoot, 3, "v1 quota of 2.5 CPUs") && passed;
+
+  // cgroup v2: cpu.max takes precedence over the v1 files
+  WriteFile(cgroupRoot + "/cpu.max", "max 100000");
+  passed = CheckCGroupLimit(cgroupRoot, 0, "unlimited v2 quota") && passed;
+  WriteFile(cgroupRoot + "/cpu.max", "200000 100000");
+  passed = CheckCGroupLimit(cgroupRoot, 2, "v2 quota of 2 CPUs") && passed;
+  WriteFile(cgroupRoot + "/cpu.max", "50000 100000");
+  passed = CheckCGroupLimit(cgroupRoot, 1, "v2 quota of half a CPU") && passed;
+
+#if defined( __linux__ ) && defined( CPU_COUNT )
+  // Restricting the affinity mask to one CPU restricts the available threads to one.
+  cpu_set_t originalSet;
+  CPU_ZERO(&originalSet);
+  if( sched_getaffinity(0, sizeof( originalSet ), &originalSet) != 0 )
+    {
+    std::cerr << "sched_getaffinity failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( BRAINSUtils::GetAffinityCPULimit() != CPU_COUNT(&originalSet) )
+    {
+    std::cerr << "The affinity limit " << BRAINSUtils::GetAffinityCPULimit()
+              << " is not the size of the affinity mask " << CPU_COUNT(&originalSet) << std::endl;
+    passed = false;
+    }
+  int firstCPU = 0;
+  while( !CPU_ISSET(firstCPU, &originalSet) )
+    {
+    ++firstCPU;
+    }
+  cpu_set_t singleSet;
+  CPU_ZERO(&singleSet);
+  CPU_SET(firstCPU, &singleSet);
+  if( sched_setaffinity(0, sizeof( singleSet ), &singleSet) != 0 )
+    {
+    std::cerr << "sched_setaffinity failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( BRAINSUtils::GetAffinityCPULimit() != 1 || BRAINSUtils::GetAvailableNumberOfThreads() != 1 )
+    {
+    std::cerr << "With one CPU in the affinity mask the affinity limit is " << BRAINSUtils::GetAffinityCPULimit()
+              << " and the available threads are " << BRAINSUtils::GetAvailableNumberOfThreads() << std::endl;
+    passed = false;
+    }
+  sched_setaffinity(0, sizeof( originalSet ), &originalSet);
+#endif
+
+  if( !passed )
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "PASSED" << std::endl;
+  return EXIT_SUCCESS;
+}
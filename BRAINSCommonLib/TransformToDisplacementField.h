@@ -21,15 +21,22 @@
 
 #include "itkIO.h"
 #include "CrossOverAffineSystem.h"
+#include "ContentHashKeyHasher.h"
 
 #include <itkTransformToDisplacementFieldFilter.h>
+#include <itkCompositeTransform.h>
+#include <itksys/SystemTools.hxx>
+#include <itksys/SystemInformation.hxx>
+
+#include <cstdio>
+#include <sstream>
 
 /**
   * Go from any subclass of Transform, to the corresponding deformation field
   */
 template <typename DisplacementFieldPointerType, typename TransformPointerType>
 DisplacementFieldPointerType
-TransformToDisplacementField(itk::ImageBase<DisplacementFieldPointerType::ObjectType::ImageDimension> *templateImage,
+TransformToDisplacementField(const itk::ImageBase<DisplacementFieldPointerType::ObjectType::ImageDimension> *templateImage,
                              TransformPointerType xfrm)
 {
   typedef typename DisplacementFieldPointerType::ObjectType OutputType;
@@ -49,4 +56,139 @@ TransformToDisplacementField(itk::ImageBase<DisplacementFieldPointerType::Object
   return todef->GetOutput();
 }
 
+/**
+  * Environment variable naming the directory of the on-disk displacement field cache.
+  * When it is unset, displacement fields are always recomputed.
+  */
+inline std::string GetDisplacementFieldCacheDirectory()
+{
+  std::string cacheDirectory;
+  itksys::SystemTools::GetEnv("BRAINS_DISPLACEMENT_FIELD_CACHE", cacheDirectory);
+  return cacheDirectory;
+}
+
+/**
+  * Hash the transform type and parameters (every component of a composite), the
+  * reference grid and the displacement component size.  Transforms read from
+  * different files with the same content share a key.
+  */
+template <unsigned int VDimension>
+void AddTransformToDisplacementFieldCacheKey(ContentHashKeyHasher & hasher,
+                                             const itk::TransformBase *xfrm)
+{
+  typedef itk::CompositeTransform<double, VDimension> CompositeTransformType;
+  const CompositeTransformType *composite = dynamic_cast<const CompositeTransformType *>( xfrm );
+  hasher.Add(std::string(xfrm->GetNameOfClass() ) );
+  if( composite != nullptr )
+    {
+    for( unsigned int n = 0; n < composite->GetNumberOfTransforms(); ++n )
+      {
+      AddTransformToDisplacementFieldCacheKey<VDimension>(hasher, composite->GetNthTransformConstPointer(n) );
+      }
+    return;
+    }
+  const itk::TransformBase::FixedParametersType & fixedParameters = xfrm->GetFixedParameters();
+  hasher.AddArray(fixedParameters, fixedParameters.Size() );
+  const itk::TransformBase::ParametersType & parameters = xfrm->GetParameters();
+  hasher.AddArray(parameters, parameters.Size() );
+}
+
+template <typename DisplacementFieldType, unsigned int VDimension>
+std::string ComputeDisplacementFieldCacheKey(const itk::ImageBase<VDimension> *templateImage,
+                                             const itk::TransformBase *xfrm)
+{
+  ContentHashKeyHasher hasher;
+  hasher.Add(static_cast<double>( sizeof( typename DisplacementFieldType::PixelType::ValueType ) ) );
+  hasher.AddArray(templateImage->GetLargestPossibleRegion().GetSize(), VDimension);
+  hasher.AddArray(templateImage->GetLargestPossibleRegion().GetIndex(), VDimension);
+  hasher.AddArray(templateImage->GetOrigin(), VDimension);
+  hasher.AddArray(templateImage->GetSpacing(), VDimension);
+  for( unsigned int i = 0; i < VDimension; ++i )
+    {
+    hasher.AddArray(templateImage->GetDirection()[i], VDimension);
+    }
+  AddTransformToDisplacementFieldCacheKey<VDimension>(hasher, xfrm);
+  return hasher.GetKey();
+}
+
+/**
+  * Same as TransformToDisplacementField, but the dense field is looked up in (and
+  * stored to) a content addressed cache directory. Cached fields are written as
+  * uncompressed single file NRRD, so the voxel data is one contiguous block at the
+  * end of the file that can be memory mapped. An empty cacheDirectory disables
+  * the cache.
+  */
+template <typename DisplacementFieldPointerType, typename TScalarType>
+DisplacementFieldPointerType
+CachedTransformToDisplacementField(const itk::ImageBase<DisplacementFieldPointerType::ObjectType::ImageDimension> *templateImage,
+                                   const itk::Transform<TScalarType,
+                                                        DisplacementFieldPointerType::ObjectType::ImageDimension,
+                                                        DisplacementFieldPointerType::ObjectType::ImageDimension> *xfrm,
+                                   const std::string & cacheDirectory = GetDisplacementFieldCacheDirectory() )
+{
+  typedef typename DisplacementFieldPointerType::ObjectType                          OutputType;
+  typedef typename itk::TransformToDisplacementFieldFilter<OutputType, TScalarType> TodefType;
+
+  std::string cacheKey;
+  std::string cacheFileName;
+  if( !cacheDirectory.empty() )
+    {
+    cacheKey = ComputeDisplacementFieldCacheKey<OutputType, OutputType::ImageDimension>(templateImage, xfrm);
+    cacheFileName = cacheDirectory + "/" + cacheKey + ".nrrd";
+    }
+  if( !cacheFileName.empty() && itksys::SystemTools::FileExists(cacheFileName.c_str(), true) )
+    {
+    try
+      {
+      typedef itk::ImageFileReader<OutputType> ReaderType;
+      typename ReaderType::Pointer reader = ReaderType::New();
+      reader->SetFileName(cacheFileName);
+      reader->Update();
+      return reader->GetOutput();
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      std::cerr << "WARNING: ignoring unreadable displacement field cache entry "
+                << cacheFileName << std::endl << err << std::endl;
+      }
+    }
+
+  typename TodefType::Pointer todef( TodefType::New() );
+  todef->SetUseReferenceImage(true);
+  todef->SetReferenceImage(templateImage);
+  todef->SetTransform(xfrm);
+  todef->Update();
+  DisplacementFieldPointerType displacementField = todef->GetOutput();
+  if( cacheFileName.empty() )
+    {
+    return displacementField;
+    }
+
+  // Write to a process specific name and rename, so concurrent tools never see a
+  // partially written cache entry.
+  itksys::SystemInformation systemInformation;
+  std::ostringstream temporaryFileName;
+  temporaryFileName << cacheDirectory << "/" << cacheKey << "." << systemInformation.GetProcessId() << ".tmp.nrrd";
+  try
+    {
+    itksys::SystemTools::MakeDirectory(cacheDirectory.c_str() );
+    typedef itk::ImageFileWriter<OutputType> WriterType;
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetInput(displacementField);
+    writer->SetFileName(temporaryFileName.str() );
+    writer->UseCompressionOff();
+    writer->Update();
+    if( std::rename(temporaryFileName.str().c_str(), cacheFileName.c_str() ) != 0 )
+      {
+      itksys::SystemTools::RemoveFile(temporaryFileName.str().c_str() );
+      }
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "WARNING: could not store displacement field cache entry "
+              << cacheFileName << std::endl << err << std::endl;
+    }
+  return displacementField;
+}
+
 #endif // TransformToDisplacementField_h
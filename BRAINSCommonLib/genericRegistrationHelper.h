@@ -34,6 +34,8 @@
 #define __genericRegistrationHelper_h
 
 #include "BRAINSCommonLib.h"
+#include "BRAINSMacro.h"
+#include "RegistrationTrace.h"
 
 #include "itkImageToImageMetricv4.h"
 #include "itkMattesMutualInformationImageToImageMetricv4.h"
@@ -54,6 +56,7 @@
 #include <iomanip>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "itkMultiThreader.h"
 #include "itkResampleImageFilter.h"
@@ -492,6 +495,15 @@ public:
   itkSetMacro(SamplingStrategy,SamplingStrategyType);
   itkGetConstMacro(SamplingStrategy,SamplingStrategyType);
 
+  /** Image pyramid of the registration: one shrink factor and one smoothing
+    * sigma (in mm) per level, coarsest level first.  The optimizer runs up to
+    * NumberOfIterations at each level.  The default is a single full
+    * resolution level without smoothing. */
+  VECTORitkSetMacro(ShrinkFactorsPerLevel,   std::vector<unsigned int> );
+  VECTORitkGetConstMacro(ShrinkFactorsPerLevel,   std::vector<unsigned int> );
+  VECTORitkSetMacro(SmoothingSigmasPerLevel, std::vector<double> );
+  VECTORitkGetConstMacro(SmoothingSigmasPerLevel, std::vector<double> );
+
   /** Returns the transform resulting from the registration process  */
   const TransformOutputType * GetOutput() const;
 
@@ -551,6 +563,9 @@ private:
 
   SamplingStrategyType m_SamplingStrategy;
 
+  std::vector<unsigned int> m_ShrinkFactorsPerLevel;
+  std::vector<double>       m_SmoothingSigmasPerLevel;
+
   ModifiedTimeType m_InternalTransformTime;
 };
 } // end namespace itk
@@ -91,6 +91,8 @@ MultiModal3DMutualRegistrationHelper<TTransformType, TOptimizer, TFixedImage,
   m_FinalMetricValue(0),
   m_ObserveIterations(true),
   m_SamplingStrategy(AffineRegistrationType::NONE),
+  m_ShrinkFactorsPerLevel(1, 1),
+  m_SmoothingSigmasPerLevel(1, 0.0),
   m_InternalTransformTime(0)
 {
   this->SetNumberOfRequiredOutputs(1);    // for the Transform
@@ -305,47 +307,40 @@ MultiModal3DMutualRegistrationHelper<TTransformType, TOptimizer, TFixedImage,
   m_Registration->SetMetric(this->m_CostMetricObject);
   m_Registration->SetOptimizer(optimizer);
 
-////////////////////////HARD CODED PART//////////////////////
-  constexpr unsigned int numberOfLevels = 1;
+  // Multi-resolution pyramid: the registration method smooths and shrinks
+  // both images once per level and the optimizer works through the levels
+  // from coarse to fine, so most iterations run on the small images.
+  if( m_ShrinkFactorsPerLevel.empty() || m_ShrinkFactorsPerLevel.size() != m_SmoothingSigmasPerLevel.size() )
+    {
+    itkExceptionMacro(<< "ShrinkFactorsPerLevel (" << m_ShrinkFactorsPerLevel.size()
+                      << " levels) and SmoothingSigmasPerLevel (" << m_SmoothingSigmasPerLevel.size()
+                      << " levels) must describe the same, non-zero number of levels.");
+    }
+  const unsigned int numberOfLevels = static_cast<unsigned int>( m_ShrinkFactorsPerLevel.size() );
 
   m_Registration->SetNumberOfLevels( numberOfLevels );
 
-  std::vector<unsigned int>  factors( numberOfLevels );
-  factors[0] = 1;
   typedef typename RegistrationType::ShrinkFactorsPerDimensionContainerType ShrinkFactorsPerDimensionContainerType;
-  std::vector<ShrinkFactorsPerDimensionContainerType> shrinkFactorsPerDimensionForAllLevels;
-  for( unsigned int n = 0; n < numberOfLevels; n++ )
+  typename RegistrationType::SmoothingSigmasArrayType smoothingSigmasPerLevel;
+  smoothingSigmasPerLevel.SetSize( numberOfLevels );
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
     {
-    ShrinkFactorsPerDimensionContainerType shrinkFactorsPerDimension(3);
-    shrinkFactorsPerDimension.Fill(0);
+    if( m_ShrinkFactorsPerLevel[level] < 1 || m_SmoothingSigmasPerLevel[level] < 0.0 )
+      {
+      itkExceptionMacro(<< "Invalid pyramid level " << level << ": shrink factor "
+                        << m_ShrinkFactorsPerLevel[level] << ", smoothing sigma "
+                        << m_SmoothingSigmasPerLevel[level]);
+      }
+    ShrinkFactorsPerDimensionContainerType shrinkFactorsPerDimension;
     for (unsigned int d = 0; d <  3; ++d) // here we set all dimensions have the same shrink factor
       {
-      shrinkFactorsPerDimension[d] = factors[n];
+      shrinkFactorsPerDimension[d] = m_ShrinkFactorsPerLevel[level];
       }
-    shrinkFactorsPerDimensionForAllLevels.push_back( shrinkFactorsPerDimension );
-#if 0
-    std::cout << "  Shrink factors (level " << n+1 << " out of " << numberOfLevels << "): " << shrinkFactorsPerDimension << std::endl;
-#endif
-    }
-
-   // Get smoothing sigmas
-  std::vector<float> sigmas( numberOfLevels );
-  sigmas[0] = 0;
-  typename RegistrationType::SmoothingSigmasArrayType smoothingSigmasPerLevel;
-  smoothingSigmasPerLevel.SetSize( sigmas.size() );
-  for( unsigned int n = 0; n < smoothingSigmasPerLevel.Size(); n++ )
-    {
-    smoothingSigmasPerLevel[n] = sigmas[n];
-    }
-
-  // set smoothing sigma and shrink factors
-  for( unsigned int level = 0; level < numberOfLevels; ++level )
-    {
-    m_Registration->SetShrinkFactorsPerDimension( level, shrinkFactorsPerDimensionForAllLevels[level] );
+    m_Registration->SetShrinkFactorsPerDimension( level, shrinkFactorsPerDimension );
+    smoothingSigmasPerLevel[level] = m_SmoothingSigmasPerLevel[level];
     }
   m_Registration->SetSmoothingSigmasPerLevel( smoothingSigmasPerLevel );
   m_Registration->SetSmoothingSigmasAreSpecifiedInPhysicalUnits( true );
-////////////////////////////////////////////////////////////
 
   m_Registration->SetMetricSamplingStrategy(
                 static_cast<typename RegistrationType::MetricSamplingStrategyType>( m_SamplingStrategy ));
@@ -377,6 +372,14 @@ MultiModal3DMutualRegistrationHelper<TTransformType, TOptimizer, TFixedImage,
       }
     optimizer->AddObserver(itk::IterationEvent(), observer);
     }
+  if( BRAINSFit::RegistrationTrace::GetInstance().IsEnabled() )
+    {
+    typedef BRAINSFit::RegistrationTraceCommand<FixedImageType> TraceCommandType;
+    typename TraceCommandType::Pointer traceCommand = TraceCommandType::New();
+    traceCommand->SetStage( m_Transform->GetNameOfClass() );
+    optimizer->AddObserver(itk::IterationEvent(), traceCommand);
+    m_Registration->AddObserver(itk::MultiResolutionIterationEvent(), traceCommand);
+    }
 
   std::cout << std::flush;
 }
@@ -688,6 +691,18 @@ MultiModal3DMutualRegistrationHelper<TTransformType, TOptimizer, TFixedImage,
     os << indent << "Fixed Image2: IS NULL" << std::endl;
     os << indent << "Moving Image2: IS NULL" << std::endl;
     }
+  os << indent << "ShrinkFactorsPerLevel: [";
+  for( unsigned int q = 0; q < this->m_ShrinkFactorsPerLevel.size(); ++q )
+    {
+    os << this->m_ShrinkFactorsPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
+  os << indent << "SmoothingSigmasPerLevel: [";
+  for( unsigned int q = 0; q < this->m_SmoothingSigmasPerLevel.size(); ++q )
+    {
+    os << this->m_SmoothingSigmasPerLevel[q] << " ";
+    }
+  os << "]" << std::endl;
 }
 } // end namespace itk
 
@@ -40,6 +40,13 @@ namespace itk
  * is assigned the average of the values from the corresponding input image
  * pixels.
  *
+ * The sum of every output pixel is accumulated with compensated (Kahan)
+ * summation.  The output is computed in threads over the requested region,
+ * and only that region of the inputs is requested, so the filter streams.
+ *
+ * When the inputs do not fit in memory together, use
+ * RunningAverageImageAccumulator, which adds them one at a time.
+ *
  * \par LIMITATIONS
  * For integer output pixel types, the result of the averaging is converted
  * to that type by a cast operation. There is currently no rounding
@@ -59,14 +59,20 @@ AverageImageFilter< TInputImage, TOutputImage >
     }
 
   OutIteratorType out = OutIteratorType( output, outputRegionForThread );
+  typedef typename NumericTraits<OutputPixelType>::RealType RealType;
   for( out.GoToBegin(); !out.IsAtEnd(); ++out )
     {
-    typename NumericTraits<OutputPixelType>::RealType sum = it[0].Get();
+    RealType sum = it[0].Get();
     ++it[0];
 
+    // Kahan summation; compensation holds the low order bits lost by sum.
+    RealType compensation = NumericTraits<RealType>::ZeroValue(sum);
     for( unsigned int i = 1; i < numberOfInputFiles; ++i)
       {
-      sum += it[i].Get();
+      const RealType y = static_cast<RealType>( it[i].Get() ) - compensation;
+      const RealType t = sum + y;
+      compensation = ( t - sum ) - y;
+      sum = t;
       ++(it[i]);
       }
 
@@ -0,0 +1,202 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBRAINSMattesMutualInformationImageToImageMetricv4_h
+#define __itkBRAINSMattesMutualInformationImageToImageMetricv4_h
+
+#include "itkMattesMutualInformationImageToImageMetricv4.h"
+#include "itkCentralDifferenceImageFunction.h"
+#include "itkCompositeTransform.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMatrixOffsetTransformBase.h"
+#include "itkMultiThreaderBase.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class BRAINSMattesMutualInformationImageToImageMetricv4
+ * \brief Mattes mutual information specialised for the linear stages of BRAINSFit.
+ *
+ * When the moving transform is a single MatrixOffsetTransformBase
+ * (VersorRigid3D, ScaleVersor3D, ScaleSkewVersor3D, Affine), possibly wrapped
+ * in the composite transform of ImageRegistrationMethodv4, the fixed
+ * transform is the identity and the moving image gradient filter is off (the
+ * BRAINSFit settings), the metric is evaluated by its own kernel:
+ *
+ * - The fixed samples (virtual point and fixed histogram bin) are computed
+ *   once per Initialize(), so neither the fixed image nor the fixed mask is
+ *   visited while optimizing.
+ * - A moving ImageMaskSpatialObject is tested by an index lookup in its image
+ *   instead of a virtual IsInside() call per sample.
+ * - The Jacobian of these transforms is affine in the point, so the metric
+ *   derivative is linear in the outer product of the moving image gradient
+ *   and the homogeneous sample point.  That 3x4 product is accumulated per
+ *   joint histogram bin and mapped to the transform parameters once per
+ *   evaluation, with the Jacobian obtained in closed form from four
+ *   ComputeJacobianWithRespectToParameters() calls.
+ * - Every thread fills its own joint PDF and joint PDF derivatives, which are
+ *   summed in thread order, so no locks are taken and the result does not
+ *   depend on scheduling.
+ * - The four cubic B-spline Parzen weights and their derivatives are
+ *   evaluated as polynomials of the fractional bin position, in fixed size
+ *   loops the compiler vectorizes.
+ *
+ * Values and gradients are interpolated linearly and by central differences,
+ * the defaults of the superclass.  Any other configuration (BSpline or
+ * composite moving transforms, gradient filters) is evaluated by the
+ * superclass.
+ *
+ * \ingroup RegistrationMetrics
+ */
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage = TFixedImage,
+          typename TInternalComputationValueType = double>
+class BRAINSMattesMutualInformationImageToImageMetricv4 :
+  public MattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                     TInternalComputationValueType>
+{
+public:
+  /** Standard class typedefs */
+  typedef BRAINSMattesMutualInformationImageToImageMetricv4 Self;
+  typedef MattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                      TInternalComputationValueType> Superclass;
+  typedef SmartPointer<Self>                                              Pointer;
+  typedef SmartPointer<const Self>                                        ConstPointer;
+
+  /** Method for creation through the object factory */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods) */
+  itkTypeMacro( BRAINSMattesMutualInformationImageToImageMetricv4, MattesMutualInformationImageToImageMetricv4 );
+
+  typedef typename Superclass::FixedImageType           FixedImageType;
+  typedef typename Superclass::MovingImageType          MovingImageType;
+  typedef typename Superclass::VirtualImageType         VirtualImageType;
+  typedef typename Superclass::MeasureType              MeasureType;
+  typedef typename Superclass::DerivativeType           DerivativeType;
+  typedef typename Superclass::MovingTransformType      MovingTransformType;
+  typedef typename Superclass::FixedSampledPointSetType FixedSampledPointSetType;
+  typedef typename VirtualImageType::PointType          VirtualPointType;
+  typedef TInternalComputationValueType                 PDFValueType;
+
+  static constexpr unsigned int ImageDimension = TVirtualImage::ImageDimension;
+
+  typedef MatrixOffsetTransformBase<TInternalComputationValueType, ImageDimension, ImageDimension>
+  LinearTransformType;
+  typedef CompositeTransform<TInternalComputationValueType, ImageDimension> CompositeTransformType;
+
+  void Initialize() override;
+
+  MeasureType GetValue() const override;
+
+  void GetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const override;
+
+  /** Number of fixed samples of the linear kernel, 0 when the superclass
+   *  evaluates the metric */
+  SizeValueType GetNumberOfLinearKernelSamples() const
+  {
+    return this->m_LinearKernelReady ? static_cast<SizeValueType>( this->m_FixedSamples.size() ) : 0;
+  }
+
+protected:
+  BRAINSMattesMutualInformationImageToImageMetricv4();
+  ~BRAINSMattesMutualInformationImageToImageMetricv4() override
+  {
+  }
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BRAINSMattesMutualInformationImageToImageMetricv4);
+
+  /** Histogram bins kept free on both sides of the intensity range, as in the superclass */
+  static constexpr OffsetValueType HistogramPadding = 2;
+
+  /** Terms of the homogeneous gradient-point product: ImageDimension x (ImageDimension + 1) */
+  static constexpr unsigned int NumberOfJacobianTerms = ImageDimension * ( ImageDimension + 1 );
+
+  typedef LinearInterpolateImageFunction<FixedImageType, TInternalComputationValueType>  FixedInterpolatorType;
+  typedef LinearInterpolateImageFunction<MovingImageType, TInternalComputationValueType> MovingInterpolatorType;
+  typedef CentralDifferenceImageFunction<MovingImageType, TInternalComputationValueType>
+  MovingGradientCalculatorType;
+  typedef ImageMaskSpatialObject<ImageDimension>                   MovingImageMaskSpatialObjectType;
+  typedef typename MovingImageMaskSpatialObjectType::ImageType     MovingMaskImageType;
+
+  /** A fixed image sample inside the fixed mask and buffer */
+  struct FixedSample
+    {
+    VirtualPointType Point;
+    OffsetValueType  FixedIndex;
+    };
+
+  /** Per thread histograms, summed after every evaluation */
+  struct ThreadAccumulator
+    {
+    std::vector<PDFValueType> JointPDF;
+    std::vector<PDFValueType> JointPDFDerivatives;
+    SizeValueType             NumberOfValidPoints;
+    };
+
+  struct LinearKernelStruct
+    {
+    const Self *     Metric;
+    PDFValueType     Matrix[ImageDimension][ImageDimension];
+    PDFValueType     Offset[ImageDimension];
+    VirtualPointType JacobianOrigin;
+    bool             ComputeDerivative;
+    };
+
+  /** The moving transform when the linear kernel can evaluate it, nullptr otherwise */
+  const LinearTransformType * GetLinearMovingTransform() const;
+
+  /** True for an identity fixed transform, also when wrapped in a composite */
+  bool FixedTransformIsIdentity() const;
+
+  template <typename TImage>
+  void ComputeIntensityRange(const TImage *image, const SpatialObject<ImageDimension> *mask,
+                             PDFValueType & minimum, PDFValueType & maximum) const;
+
+  void InitializeLinearKernel();
+
+  void ComputeLinearKernel(const LinearTransformType *linearTransform, MeasureType & value,
+                           DerivativeType *derivative) const;
+
+  void AccumulateSamples(const LinearKernelStruct & str, const SizeValueType begin, const SizeValueType end,
+                         ThreadAccumulator & accumulator) const;
+
+  static ITK_THREAD_RETURN_TYPE LinearKernelThreaderCallback(void *arg);
+
+  bool                                                m_LinearKernelReady;
+  std::vector<FixedSample>                            m_FixedSamples;
+  PDFValueType                                        m_LinearMovingImageTrueMin;
+  PDFValueType                                        m_LinearMovingImageTrueMax;
+  PDFValueType                                        m_LinearMovingImageBinSize;
+  PDFValueType                                        m_LinearMovingImageNormalizedMin;
+  typename MovingInterpolatorType::Pointer            m_LinearMovingInterpolator;
+  typename MovingGradientCalculatorType::Pointer      m_LinearMovingGradientCalculator;
+  typename MovingMaskImageType::ConstPointer          m_LinearMovingMaskImage;
+  mutable std::vector<ThreadAccumulator>              m_ThreadAccumulators;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBRAINSMattesMutualInformationImageToImageMetricv4.hxx"
+#endif
+
+#endif
@@ -0,0 +1,587 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBRAINSMattesMutualInformationImageToImageMetricv4_hxx
+#define __itkBRAINSMattesMutualInformationImageToImageMetricv4_hxx
+
+#include "itkBRAINSMattesMutualInformationImageToImageMetricv4.h"
+#include "itkIdentityTransform.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace itk
+{
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::BRAINSMattesMutualInformationImageToImageMetricv4() :
+  m_LinearKernelReady( false ),
+  m_LinearMovingImageTrueMin( 0.0 ),
+  m_LinearMovingImageTrueMax( 0.0 ),
+  m_LinearMovingImageBinSize( 0.0 ),
+  m_LinearMovingImageNormalizedMin( 0.0 )
+{
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+void
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::Initialize()
+{
+  Superclass::Initialize();
+  this->InitializeLinearKernel();
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+typename BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                           TInternalComputationValueType>::MeasureType
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::GetValue() const
+{
+  const LinearTransformType *linearTransform = this->m_LinearKernelReady ? this->GetLinearMovingTransform() : nullptr;
+  if( linearTransform == nullptr )
+    {
+    return Superclass::GetValue();
+    }
+  MeasureType value;
+  this->ComputeLinearKernel(linearTransform, value, nullptr);
+  return value;
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+void
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::GetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const
+{
+  const LinearTransformType *linearTransform = this->m_LinearKernelReady ? this->GetLinearMovingTransform() : nullptr;
+  if( linearTransform == nullptr )
+    {
+    Superclass::GetValueAndDerivative(value, derivative);
+    return;
+    }
+  this->ComputeLinearKernel(linearTransform, value, &derivative);
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+const typename BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                                 TInternalComputationValueType>::LinearTransformType
+* BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                    TInternalComputationValueType>
+::GetLinearMovingTransform() const
+  {
+  const MovingTransformType *   movingTransform = this->GetMovingTransform();
+  const CompositeTransformType *compositeTransform = dynamic_cast<const CompositeTransformType *>( movingTransform );
+  if( compositeTransform != nullptr )
+    {
+    // ImageRegistrationMethodv4 wraps the transform it optimizes in a
+    // composite; with a moving initial transform in front of it the
+    // superclass has to evaluate the whole chain.
+    if( compositeTransform->GetNumberOfTransforms() != 1 || !compositeTransform->GetNthTransformToOptimize(0) )
+      {
+      return nullptr;
+      }
+    movingTransform = compositeTransform->GetNthTransformConstPointer(0);
+    }
+  const LinearTransformType *linearTransform = dynamic_cast<const LinearTransformType *>( movingTransform );
+  if( linearTransform == nullptr || linearTransform->GetNumberOfParameters() != this->GetNumberOfParameters() )
+    {
+    return nullptr;
+    }
+  return linearTransform;
+  }
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+bool
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::FixedTransformIsIdentity() const
+{
+  typedef IdentityTransform<TInternalComputationValueType, ImageDimension> IdentityTransformType;
+
+  const typename Superclass::FixedTransformType *fixedTransform = this->GetFixedTransform();
+  const CompositeTransformType *compositeTransform = dynamic_cast<const CompositeTransformType *>( fixedTransform );
+  if( compositeTransform != nullptr )
+    {
+    for( SizeValueType n = 0; n < compositeTransform->GetNumberOfTransforms(); ++n )
+      {
+      if( dynamic_cast<const IdentityTransformType *>( compositeTransform->GetNthTransformConstPointer(n) ) == nullptr )
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+  return dynamic_cast<const IdentityTransformType *>( fixedTransform ) != nullptr;
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+template <typename TImage>
+void
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::ComputeIntensityRange(const TImage *image, const SpatialObject<ImageDimension> *mask,
+                        PDFValueType & minimum, PDFValueType & maximum) const
+{
+  minimum = NumericTraits<PDFValueType>::max();
+  maximum = NumericTraits<PDFValueType>::NonpositiveMin();
+
+  ImageRegionConstIteratorWithIndex<TImage> it( image, image->GetBufferedRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    if( mask != nullptr )
+      {
+      typename TImage::PointType point;
+      image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+      if( !mask->IsInside(point) )
+        {
+        continue;
+        }
+      }
+    const PDFValueType value = static_cast<PDFValueType>( it.Get() );
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+    }
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+void
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::InitializeLinearKernel()
+{
+  this->m_LinearKernelReady = false;
+  this->m_FixedSamples.clear();
+  this->m_ThreadAccumulators.clear();
+
+  if( this->GetLinearMovingTransform() == nullptr || this->GetUseMovingImageGradientFilter()
+      || !this->FixedTransformIsIdentity() )
+    {
+    return;
+    }
+
+  const FixedImageType *  fixedImage = this->GetFixedImage();
+  const MovingImageType * movingImage = this->GetMovingImage();
+  const OffsetValueType   numberOfBins = static_cast<OffsetValueType>( this->GetNumberOfHistogramBins() );
+
+  PDFValueType fixedImageMin;
+  PDFValueType fixedImageMax;
+  this->ComputeIntensityRange(fixedImage, this->GetFixedImageMask(), fixedImageMin, fixedImageMax);
+  PDFValueType movingImageMin;
+  PDFValueType movingImageMax;
+  this->ComputeIntensityRange(movingImage, this->GetMovingImageMask(), movingImageMin, movingImageMax);
+  if( !( fixedImageMax > fixedImageMin ) || !( movingImageMax > movingImageMin ) )
+    {
+    return;
+    }
+
+  const PDFValueType fixedImageBinSize =
+    ( fixedImageMax - fixedImageMin ) / static_cast<PDFValueType>( numberOfBins - 2 * HistogramPadding );
+  const PDFValueType fixedImageNormalizedMin = fixedImageMin / fixedImageBinSize - HistogramPadding;
+  this->m_LinearMovingImageTrueMin = movingImageMin;
+  this->m_LinearMovingImageTrueMax = movingImageMax;
+  this->m_LinearMovingImageBinSize =
+    ( movingImageMax - movingImageMin ) / static_cast<PDFValueType>( numberOfBins - 2 * HistogramPadding );
+  this->m_LinearMovingImageNormalizedMin = movingImageMin / this->m_LinearMovingImageBinSize - HistogramPadding;
+
+  typename FixedInterpolatorType::Pointer fixedInterpolator = FixedInterpolatorType::New();
+  fixedInterpolator->SetInputImage(fixedImage);
+  const typename Superclass::FixedImageMaskType *fixedImageMask = this->GetFixedImageMask();
+
+  // With the identity fixed transform the virtual and fixed points coincide.
+  std::vector<VirtualPointType> virtualPoints;
+  if( this->GetUseFixedSampledPointSet() )
+    {
+    const typename FixedSampledPointSetType::PointsContainer *points = this->GetFixedSampledPointSet()->GetPoints();
+    virtualPoints.reserve( points->Size() );
+    for( typename FixedSampledPointSetType::PointsContainer::ConstIterator pointIt = points->Begin();
+         pointIt != points->End(); ++pointIt )
+      {
+      virtualPoints.push_back( pointIt.Value() );
+      }
+    }
+  else
+    {
+    const VirtualImageType *virtualImage = this->GetVirtualImage();
+    virtualPoints.reserve( this->GetVirtualRegion().GetNumberOfPixels() );
+    ImageRegionConstIteratorWithIndex<VirtualImageType> it( virtualImage, this->GetVirtualRegion() );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      VirtualPointType point;
+      virtualImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+      virtualPoints.push_back(point);
+      }
+    }
+
+  this->m_FixedSamples.reserve( virtualPoints.size() );
+  for( typename std::vector<VirtualPointType>::const_iterator pointIt = virtualPoints.begin();
+       pointIt != virtualPoints.end(); ++pointIt )
+    {
+    if( ( fixedImageMask != nullptr && !fixedImageMask->IsInside(*pointIt) )
+        || !fixedInterpolator->IsInsideBuffer(*pointIt) )
+      {
+      continue;
+      }
+    // Like the superclass, drop samples outside the (masked) histogram range,
+    // e.g. at a mask edge interpolating from voxels outside the mask.
+    const PDFValueType fixedImageValue = fixedInterpolator->Evaluate(*pointIt);
+    if( fixedImageValue < fixedImageMin || fixedImageValue > fixedImageMax )
+      {
+      continue;
+      }
+    OffsetValueType    fixedIndex = static_cast<OffsetValueType>(
+        std::floor( fixedImageValue / fixedImageBinSize - fixedImageNormalizedMin ) );
+    fixedIndex = std::max(fixedIndex, static_cast<OffsetValueType>( HistogramPadding ) );
+    fixedIndex = std::min(fixedIndex, static_cast<OffsetValueType>( numberOfBins - HistogramPadding - 1 ) );
+
+    FixedSample sample;
+    sample.Point = *pointIt;
+    sample.FixedIndex = fixedIndex;
+    this->m_FixedSamples.push_back(sample);
+    }
+
+  this->m_LinearMovingInterpolator = MovingInterpolatorType::New();
+  this->m_LinearMovingInterpolator->SetInputImage(movingImage);
+  this->m_LinearMovingGradientCalculator = MovingGradientCalculatorType::New();
+  this->m_LinearMovingGradientCalculator->SetInputImage(movingImage);
+
+  // BRAINSFit masks are ImageMaskSpatialObjects built directly on the mask
+  // image, whose IsInside() is a rounded index lookup in that image.
+  this->m_LinearMovingMaskImage = nullptr;
+  const MovingImageMaskSpatialObjectType *movingImageMask =
+    dynamic_cast<const MovingImageMaskSpatialObjectType *>( this->GetMovingImageMask() );
+  if( movingImageMask != nullptr )
+    {
+    this->m_LinearMovingMaskImage = movingImageMask->GetImage();
+    }
+
+  this->m_LinearKernelReady = true;
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+void
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::ComputeLinearKernel(const LinearTransformType *linearTransform, MeasureType & value,
+                      DerivativeType *derivative) const
+{
+  const SizeValueType numberOfBins = this->GetNumberOfHistogramBins();
+  const SizeValueType numberOfParameters = linearTransform->GetNumberOfParameters();
+
+  LinearKernelStruct str;
+  str.Metric = this;
+  str.ComputeDerivative = ( derivative != nullptr );
+  const typename LinearTransformType::MatrixType &       matrix = linearTransform->GetMatrix();
+  const typename LinearTransformType::OutputVectorType & offset = linearTransform->GetOffset();
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    for( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      str.Matrix[i][j] = matrix[i][j];
+      }
+    str.Offset[i] = offset[i];
+    str.JacobianOrigin[i] = linearTransform->GetCenter()[i];
+    }
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  const itk::ThreadIdType         numberOfThreads = static_cast<itk::ThreadIdType>(
+      std::max( static_cast<size_t>( 1 ),
+                std::min( static_cast<size_t>( threader->GetNumberOfThreads() ), this->m_FixedSamples.size() ) ) );
+  this->m_ThreadAccumulators.resize( numberOfThreads );
+  for( itk::ThreadIdType t = 0; t < numberOfThreads; ++t )
+    {
+    ThreadAccumulator & accumulator = this->m_ThreadAccumulators[t];
+    accumulator.JointPDF.assign( numberOfBins * numberOfBins, 0.0 );
+    accumulator.JointPDFDerivatives.assign( str.ComputeDerivative ?
+                                            numberOfBins * numberOfBins * NumberOfJacobianTerms : 0, 0.0 );
+    accumulator.NumberOfValidPoints = 0;
+    }
+  threader->SetNumberOfThreads( numberOfThreads );
+  threader->SetSingleMethod( Self::LinearKernelThreaderCallback, &str );
+  threader->SingleMethodExecute();
+
+  // Sum the thread histograms in thread order.
+  std::vector<PDFValueType> jointPDF( this->m_ThreadAccumulators[0].JointPDF );
+  std::vector<PDFValueType> jointPDFDerivatives( this->m_ThreadAccumulators[0].JointPDFDerivatives );
+  SizeValueType             numberOfValidPoints = this->m_ThreadAccumulators[0].NumberOfValidPoints;
+  for( itk::ThreadIdType t = 1; t < numberOfThreads; ++t )
+    {
+    const ThreadAccumulator & accumulator = this->m_ThreadAccumulators[t];
+    for( size_t i = 0; i < jointPDF.size(); ++i )
+      {
+      jointPDF[i] += accumulator.JointPDF[i];
+      }
+    for( size_t i = 0; i < jointPDFDerivatives.size(); ++i )
+      {
+      jointPDFDerivatives[i] += accumulator.JointPDFDerivatives[i];
+      }
+    numberOfValidPoints += accumulator.NumberOfValidPoints;
+    }
+  this->m_NumberOfValidPoints = numberOfValidPoints;
+
+  if( derivative != nullptr )
+    {
+    derivative->SetSize( numberOfParameters );
+    derivative->Fill( NumericTraits<typename DerivativeType::ValueType>::ZeroValue() );
+    }
+  if( numberOfValidPoints == 0 )
+    {
+    itkWarningMacro(<< "No valid points were found during metric evaluation.");
+    value = NumericTraits<MeasureType>::max();
+    this->m_Value = value;
+    return;
+    }
+
+  PDFValueType jointPDFSum = 0.0;
+  for( size_t i = 0; i < jointPDF.size(); ++i )
+    {
+    jointPDFSum += jointPDF[i];
+    }
+  const PDFValueType normalizationFactor = 1.0 / jointPDFSum;
+  std::vector<PDFValueType> fixedImageMarginalPDF( numberOfBins, 0.0 );
+  std::vector<PDFValueType> movingImageMarginalPDF( numberOfBins, 0.0 );
+  for( SizeValueType f = 0; f < numberOfBins; ++f )
+    {
+    for( SizeValueType m = 0; m < numberOfBins; ++m )
+      {
+      PDFValueType & jointPDFValue = jointPDF[f * numberOfBins + m];
+      jointPDFValue *= normalizationFactor;
+      fixedImageMarginalPDF[f] += jointPDFValue;
+      movingImageMarginalPDF[m] += jointPDFValue;
+      }
+    }
+
+  // value = -MI.  The derivative is dMI/dp (the v4 convention of returning
+  // the direction that decreases the value), with
+  //   dp(f,m)/dp = -(1 / (binSize * N)) sum_i beta3'(m - term_i) (dM/dx)_i J(x_i)
+  // and the sum over (f,m) weighted by log(p(f,m) / p_m(m)).
+  const PDFValueType closeToZero = std::numeric_limits<PDFValueType>::epsilon();
+  PDFValueType       sum = 0.0;
+  PDFValueType       gradientTerms[NumberOfJacobianTerms];
+  std::fill( gradientTerms, gradientTerms + NumberOfJacobianTerms, 0.0 );
+  for( SizeValueType f = 0; f < numberOfBins; ++f )
+    {
+    const PDFValueType fixedImagePDFValue = fixedImageMarginalPDF[f];
+    for( SizeValueType m = 0; m < numberOfBins; ++m )
+      {
+      const PDFValueType jointPDFValue = jointPDF[f * numberOfBins + m];
+      const PDFValueType movingImagePDFValue = movingImageMarginalPDF[m];
+      if( jointPDFValue > closeToZero && movingImagePDFValue > closeToZero )
+        {
+        const PDFValueType pRatio = std::log(jointPDFValue / movingImagePDFValue);
+        if( fixedImagePDFValue > closeToZero )
+          {
+          sum += jointPDFValue * ( pRatio - std::log(fixedImagePDFValue) );
+          }
+        if( derivative != nullptr )
+          {
+          const PDFValueType *binDerivatives =
+            &jointPDFDerivatives[( f * numberOfBins + m ) * NumberOfJacobianTerms];
+          for( unsigned int q = 0; q < NumberOfJacobianTerms; ++q )
+            {
+            gradientTerms[q] += pRatio * binDerivatives[q];
+            }
+          }
+        }
+      }
+    }
+  value = -sum;
+  this->m_Value = value;
+
+  if( derivative != nullptr )
+    {
+    // The Jacobian is affine in the point: J(x) = J(c) + sum_j (x - c)_j (J(c + e_j) - J(c)).
+    typename LinearTransformType::JacobianType centerJacobian;
+    typename LinearTransformType::JacobianType axisJacobian;
+    linearTransform->ComputeJacobianWithRespectToParameters(str.JacobianOrigin, centerJacobian);
+    const PDFValueType derivativeFactor = -normalizationFactor / this->m_LinearMovingImageBinSize;
+    for( unsigned int j = 0; j <= ImageDimension; ++j )
+      {
+      if( j < ImageDimension )
+        {
+        typename LinearTransformType::InputPointType axisPoint = str.JacobianOrigin;
+        axisPoint[j] += 1.0;
+        linearTransform->ComputeJacobianWithRespectToParameters(axisPoint, axisJacobian);
+        }
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+        const PDFValueType gradientTerm = derivativeFactor * gradientTerms[j * ImageDimension + d];
+        for( SizeValueType p = 0; p < numberOfParameters; ++p )
+          {
+          const PDFValueType jacobianTerm = ( j < ImageDimension ) ?
+            axisJacobian(d, p) - centerJacobian(d, p) : centerJacobian(d, p);
+          ( *derivative )[p] += gradientTerm * jacobianTerm;
+          }
+        }
+      }
+    }
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+void
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::AccumulateSamples(const LinearKernelStruct & str, const SizeValueType begin, const SizeValueType end,
+                    ThreadAccumulator & accumulator) const
+{
+  const OffsetValueType     numberOfBins = static_cast<OffsetValueType>( this->GetNumberOfHistogramBins() );
+  const OffsetValueType     maximumMovingIndex = numberOfBins - HistogramPadding - 1;
+  const PDFValueType        movingImageBinSize = this->m_LinearMovingImageBinSize;
+  const PDFValueType        movingImageNormalizedMin = this->m_LinearMovingImageNormalizedMin;
+  const PDFValueType        movingImageTrueMin = this->m_LinearMovingImageTrueMin;
+  const PDFValueType        movingImageTrueMax = this->m_LinearMovingImageTrueMax;
+  const MovingInterpolatorType *       movingInterpolator = this->m_LinearMovingInterpolator.GetPointer();
+  const MovingGradientCalculatorType * gradientCalculator = this->m_LinearMovingGradientCalculator.GetPointer();
+  const MovingMaskImageType *          movingMaskImage = this->m_LinearMovingMaskImage.GetPointer();
+  const typename Superclass::MovingImageMaskType *movingImageMask = this->GetMovingImageMask();
+
+  PDFValueType *jointPDF = &accumulator.JointPDF[0];
+  PDFValueType *jointPDFDerivatives = str.ComputeDerivative ? &accumulator.JointPDFDerivatives[0] : nullptr;
+
+  for( SizeValueType s = begin; s < end; ++s )
+    {
+    const FixedSample & sample = this->m_FixedSamples[s];
+
+    typename MovingImageType::PointType mappedPoint;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      PDFValueType mapped = str.Offset[i];
+      for( unsigned int j = 0; j < ImageDimension; ++j )
+        {
+        mapped += str.Matrix[i][j] * sample.Point[j];
+        }
+      mappedPoint[i] = mapped;
+      }
+
+    if( movingMaskImage != nullptr )
+      {
+      typename MovingMaskImageType::IndexType maskIndex;
+      if( !movingMaskImage->TransformPhysicalPointToIndex(mappedPoint, maskIndex)
+          || movingMaskImage->GetPixel(maskIndex) == 0 )
+        {
+        continue;
+        }
+      }
+    else if( movingImageMask != nullptr && !movingImageMask->IsInside(mappedPoint) )
+      {
+      continue;
+      }
+    if( !movingInterpolator->IsInsideBuffer(mappedPoint) )
+      {
+      continue;
+      }
+
+    const PDFValueType movingImageValue = movingInterpolator->Evaluate(mappedPoint);
+    // Outside the range the fractional position below leaves [0,1) and the
+    // Parzen weights extrapolate to negative mass, so these samples are
+    // dropped as in the superclass. The clamp only guards rounding at the ends.
+    if( movingImageValue < movingImageTrueMin || movingImageValue > movingImageTrueMax )
+      {
+      continue;
+      }
+    const PDFValueType movingImageParzenWindowTerm = movingImageValue / movingImageBinSize - movingImageNormalizedMin;
+    OffsetValueType    movingIndex = static_cast<OffsetValueType>( movingImageParzenWindowTerm );
+    movingIndex = std::max(movingIndex, static_cast<OffsetValueType>( HistogramPadding ) );
+    movingIndex = std::min(movingIndex, maximumMovingIndex);
+
+    // Cubic B-spline weights of bins movingIndex - 1 .. movingIndex + 2 and
+    // their derivatives with respect to (bin - term), as polynomials of the
+    // fractional position t of the term in bin movingIndex.
+    const PDFValueType t = movingImageParzenWindowTerm - static_cast<PDFValueType>( movingIndex );
+    const PDFValueType t2 = t * t;
+    const PDFValueType t3 = t2 * t;
+    const PDFValueType u = 1.0 - t;
+    const PDFValueType weights[4] =
+      { u * u * u / 6.0, ( 3.0 * t3 - 6.0 * t2 + 4.0 ) / 6.0, ( -3.0 * t3 + 3.0 * t2 + 3.0 * t + 1.0 ) / 6.0, t3 / 6.0 };
+
+    const OffsetValueType binOffset = sample.FixedIndex * numberOfBins + movingIndex - 1;
+    PDFValueType *        jointPDFBins = jointPDF + binOffset;
+    for( unsigned int k = 0; k < 4; ++k )
+      {
+      jointPDFBins[k] += weights[k];
+      }
+
+    if( jointPDFDerivatives != nullptr )
+      {
+      const PDFValueType derivativeWeights[4] =
+        { 0.5 * u * u, 2.0 * t - 1.5 * t2, -2.0 * u + 1.5 * u * u, -0.5 * t2 };
+
+      const typename MovingGradientCalculatorType::OutputType movingImageGradient =
+        gradientCalculator->Evaluate(mappedPoint);
+      // Outer product of the gradient and the homogeneous point relative to
+      // the Jacobian origin.
+      PDFValueType jacobianTerms[NumberOfJacobianTerms];
+      for( unsigned int j = 0; j <= ImageDimension; ++j )
+        {
+        const PDFValueType relativePoint = ( j < ImageDimension ) ? sample.Point[j] - str.JacobianOrigin[j] : 1.0;
+        for( unsigned int d = 0; d < ImageDimension; ++d )
+          {
+          jacobianTerms[j * ImageDimension + d] = movingImageGradient[d] * relativePoint;
+          }
+        }
+      PDFValueType *derivativeBins = jointPDFDerivatives + binOffset * NumberOfJacobianTerms;
+      for( unsigned int k = 0; k < 4; ++k )
+        {
+        for( unsigned int q = 0; q < NumberOfJacobianTerms; ++q )
+          {
+          derivativeBins[k * NumberOfJacobianTerms + q] += derivativeWeights[k] * jacobianTerms[q];
+          }
+        }
+      }
+    ++accumulator.NumberOfValidPoints;
+    }
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+ITK_THREAD_RETURN_TYPE
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::LinearKernelThreaderCallback(void *arg)
+{
+  typedef itk::MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType *          threadInfo = static_cast<ThreadInfoType *>( arg );
+  const itk::ThreadIdType   threadId = threadInfo->ThreadID;
+  const itk::ThreadIdType   threadCount = threadInfo->NumberOfThreads;
+  const LinearKernelStruct *str = static_cast<const LinearKernelStruct *>( threadInfo->UserData );
+
+  // Contiguous blocks keep each thread on neighbouring samples.
+  const SizeValueType numberOfSamples = static_cast<SizeValueType>( str->Metric->m_FixedSamples.size() );
+  const SizeValueType begin = numberOfSamples * threadId / threadCount;
+  const SizeValueType end = numberOfSamples * ( threadId + 1 ) / threadCount;
+  str->Metric->AccumulateSamples(*str, begin, end, str->Metric->m_ThreadAccumulators[threadId]);
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+void
+BRAINSMattesMutualInformationImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage,
+                                                  TInternalComputationValueType>
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "LinearKernelReady: " << this->m_LinearKernelReady << std::endl;
+  os << indent << "NumberOfLinearKernelSamples: " << this->GetNumberOfLinearKernelSamples() << std::endl;
+}
+} // end namespace itk
+
+#endif
@@ -72,6 +72,8 @@ BRAINSROIAutoImageFilter<TInputImage, TOutputImage>
   LFF->SetClosingSize(m_ClosingSize);
   LFF->SetDilateSize(m_DilateSize);
   LFF->SetThresholdCorrectionFactor(m_ThresholdCorrectionFactor);
+  // BRAINSROIAuto, FindCenterOfBrain and BRAINSFit mask the same volumes.
+  LFF->UseMaskCacheOn();
   LFF->Update();
   this->GraftOutput( LFF->GetOutput() );
 }
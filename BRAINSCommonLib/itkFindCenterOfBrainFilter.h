@@ -22,6 +22,7 @@
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkImageRegionIteratorWithIndex.h>
 #include "itkLargestForegroundFilledMaskImageFilter.h"
+#include "BRAINSThreadControl.h"
 
 namespace itk
 {
@@ -122,6 +123,13 @@ protected:
   void GenerateData() override;
 
 private:
+  /** Number of grid points of sampling line dIndex that fall in the mask.
+   *  When debugGridImage is given, the points are also written to it. */
+  unsigned int CountMaskSamplesInPlane(const MaskImageType *mask, const PointType & centerOfMass,
+                                       const int dIndex, const int numberOfSamplingLines,
+                                       const double rectangularGridRadius, const double samplingDistanceMM,
+                                       ImageType *debugGridImage) const;
+
   bool         m_Maximize;
   unsigned int m_Axis;
   double       m_OtsuPercentileThreshold;
@@ -23,6 +23,7 @@
 #include "itkImageMomentsCalculator.h"
 #include "itkImageDuplicator.h"
 #include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionIterator.h"
 
 // #define USE_DEBUGGIN_IMAGES
 #include "itksys/SystemTools.hxx"
@@ -91,6 +92,58 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
   this->GraftOutput(image);
 }
 
+template <class TInputImage, class TMaskImage>
+unsigned int
+FindCenterOfBrainFilter<TInputImage, TMaskImage>
+::CountMaskSamplesInPlane(const MaskImageType *mask, const PointType & centerOfMass,
+                          const int dIndex, const int numberOfSamplingLines,
+                          const double rectangularGridRadius, const double samplingDistanceMM,
+                          ImageType *debugGridImage) const
+{
+  unsigned int maskCount = 0;
+
+  typename TInputImage::PointType rectPhysPoint;
+  typename TInputImage::PointType currRotatedSampleGridLocation;
+  // Equally space the SI sampling around the COM for each index
+  const double percentage = ( static_cast<double>( dIndex + 1 ) /
+                              static_cast<double>( numberOfSamplingLines ) );
+  rectPhysPoint[2] =
+    ( rectangularGridRadius * 2.0 )*  percentage - rectangularGridRadius;
+  currRotatedSampleGridLocation[2] = centerOfMass[2] + rectPhysPoint[2];
+  for( rectPhysPoint[1] = -rectangularGridRadius;
+       rectPhysPoint[1] < rectangularGridRadius;
+       rectPhysPoint[1] += samplingDistanceMM )
+  // Raster through (-120mm,120mm)
+    {
+    currRotatedSampleGridLocation[1] = centerOfMass[1] + rectPhysPoint[1];
+    for( rectPhysPoint[0] = -rectangularGridRadius;
+         rectPhysPoint[0] < rectangularGridRadius;
+         rectPhysPoint[0] += samplingDistanceMM )
+    // Raster through (-120mm,120mm)
+      {
+      currRotatedSampleGridLocation[0] = centerOfMass[0] + rectPhysPoint[0];
+
+      typename TInputImage::IndexType currIndex;
+      const bool isValidRegion = mask->TransformPhysicalPointToIndex(
+          currRotatedSampleGridLocation,
+          currIndex);
+      if( isValidRegion && ( mask->GetPixel(currIndex) > 0 ) )
+        {
+        if( debugGridImage != nullptr )
+          {
+          debugGridImage->SetPixel( currIndex, ( numberOfSamplingLines + dIndex ) );
+          }
+        maskCount++;
+        }
+      else if( debugGridImage != nullptr && isValidRegion )
+        {
+        debugGridImage->SetPixel(currIndex, 0);
+        }
+      }
+    }
+  return maskCount;
+}
+
 template <class TInputImage, class TMaskImage>
 void
 FindCenterOfBrainFilter<TInputImage, TMaskImage>
@@ -103,6 +156,7 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
     LFF->SetInput( this->GetInput() );
     LFF->SetOtsuPercentileThreshold(this->m_OtsuPercentileThreshold);
     LFF->SetClosingSize(this->m_ClosingSize);
+    LFF->UseMaskCacheOn();
     LFF->Update();
     this->m_ImageMask = LFF->GetOutput();
     }
@@ -125,18 +179,25 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
 
   // //////////////////////////////////////////////////////////////////////
   //  This will find maximum Superior physical location of all image voxels.
+  //  The physical location is affine in the index, so the maximum is found at
+  // one of the corners of the voxel array.
   double maxSIDirection;
     {
-    typedef itk::ImageRegionIteratorWithIndex<MaskImageType> MaskIteratorType;
-    MaskIteratorType ItPixel( LFFimage, LFFimage->GetLargestPossibleRegion() );
-
-    typename MaskImageType::PointType PixelPhysicalPoint;
-    ItPixel.GoToBegin();
-    LFFimage->TransformIndexToPhysicalPoint(ItPixel.GetIndex(), PixelPhysicalPoint);
+    const typename MaskImageType::RegionType region = LFFimage->GetLargestPossibleRegion();
+    typename MaskImageType::PointType        PixelPhysicalPoint;
+    LFFimage->TransformIndexToPhysicalPoint(region.GetIndex(), PixelPhysicalPoint);
     maxSIDirection = PixelPhysicalPoint[m_Axis];
-    for( ; !ItPixel.IsAtEnd(); ++ItPixel )
+    for( unsigned int corner = 1; corner < ( 1U << MaskImageType::ImageDimension ); ++corner )
       {
-      LFFimage->TransformIndexToPhysicalPoint(ItPixel.GetIndex(), PixelPhysicalPoint);
+      typename MaskImageType::IndexType cornerIndex = region.GetIndex();
+      for( unsigned int d = 0; d < MaskImageType::ImageDimension; ++d )
+        {
+        if( corner & ( 1U << d ) )
+          {
+          cornerIndex[d] += static_cast<IndexValueType>( region.GetSize(d) ) - 1;
+          }
+        }
+      LFFimage->TransformIndexToPhysicalPoint(cornerIndex, PixelPhysicalPoint);
       if( PixelPhysicalPoint[m_Axis] > maxSIDirection )
         {
         maxSIDirection = PixelPhysicalPoint[m_Axis];
@@ -151,40 +212,40 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
   //  This will produce ForegroundLevel representing where to threshold the head
   // from the neck.
   // double ForegroundLevel = 1;
-  typename DistanceImageType::Pointer distanceMap = DistanceImageType::New();
-  distanceMap->CopyInformation(LFFimage);
-  distanceMap->SetRegions( LFFimage->GetLargestPossibleRegion() );
-  distanceMap->Allocate();
-  distanceMap->FillBuffer(0.0);
+  //  The distance map is only kept as a debugging image.
+  if( this->m_GenerateDebugImages )
     {
-    typedef itk::ImageRegionIteratorWithIndex<MaskImageType> TInputIteratorType;
-    TInputIteratorType ItPixel( LFFimage, LFFimage->GetLargestPossibleRegion() );
+    typename DistanceImageType::Pointer distanceMap = DistanceImageType::New();
+    distanceMap->CopyInformation(LFFimage);
+    distanceMap->SetRegions( LFFimage->GetLargestPossibleRegion() );
+    distanceMap->Allocate();
+    distanceMap->FillBuffer(0.0);
 
-    //    typedef itk::ImageRegionIterator< DistanceImageType >
-    // DistanceImageIteratorType;
-    //    DistanceImageIteratorType ItDistPixel( distanceMap,
-    // distanceMap->GetLargestPossibleRegion() );
+    const typename MaskImageType::RegionType region = LFFimage->GetLargestPossibleRegion();
+    BRAINSUtils::ParallelizeRange( region.GetSize(ImageDimension - 1),
+                                   [&](const SizeValueType begin, const SizeValueType end)
+                                     {
+                                     typedef itk::ImageRegionConstIteratorWithIndex<MaskImageType> TInputIteratorType;
+                                     TInputIteratorType ItPixel( LFFimage, BRAINSUtils::SliceRange(region, begin, end) );
 
-    typename MaskImageType::PointType PixelPhysicalPoint;
-    PixelPhysicalPoint.Fill(0.0);
-    for( ItPixel.GoToBegin(); !ItPixel.IsAtEnd(); ++ItPixel )
-      {
-      if( ItPixel.Get() != 0 )
-        {
-        const typename MaskImageType::IndexType tempIndex = ItPixel.GetIndex();
-        LFFimage->TransformIndexToPhysicalPoint(tempIndex, PixelPhysicalPoint);
-        double val =  vnl_math_rnd( vnl_math_abs(maxSIDirection
-                                                 - PixelPhysicalPoint[m_Axis]) );
-        distanceMap->SetPixel( tempIndex,
-                               static_cast<typename DistanceImageType::PixelType>( val ) );
-        }
-      // else, leave the LFFimage coded zero, not some positive distance from
-      // the top.
-      }
-    if( this->m_GenerateDebugImages )
-      {
-      this->m_DebugDistanceImage = distanceMap;
-      }
+                                     typename MaskImageType::PointType PixelPhysicalPoint;
+                                     PixelPhysicalPoint.Fill(0.0);
+                                     for( ItPixel.GoToBegin(); !ItPixel.IsAtEnd(); ++ItPixel )
+                                       {
+                                       if( ItPixel.Get() != 0 )
+                                         {
+                                         const typename MaskImageType::IndexType tempIndex = ItPixel.GetIndex();
+                                         LFFimage->TransformIndexToPhysicalPoint(tempIndex, PixelPhysicalPoint);
+                                         double val =  vnl_math_rnd( vnl_math_abs(maxSIDirection
+                                                                                  - PixelPhysicalPoint[m_Axis]) );
+                                         distanceMap->SetPixel( tempIndex,
+                                                                static_cast<typename DistanceImageType::PixelType>( val ) );
+                                         }
+                                       // else, leave the LFFimage coded zero, not some positive distance from
+                                       // the top.
+                                       }
+                                     } );
+    this->m_DebugDistanceImage = distanceMap;
     }
 
   double inferiorCutOff = -1000000;
@@ -232,50 +293,36 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
           }
         }
 
+      // The sampling lines are independent, so their mask counts are
+      // computed in parallel; the head volume is then accumulated from the
+      // top down as before.
+      BRAINSUtils::ParallelizeRange( numberOfSamplelingLines,
+                                     [&](const SizeValueType begin, const SizeValueType end)
+                                       {
+                                       for( SizeValueType line = begin; line < end; ++line )
+                                         {
+                                         maskCountsInPlane[line] =
+                                           this->CountMaskSamplesInPlane(LFFimage, CenterOfMass, static_cast<int>( line ),
+                                                                         numberOfSamplelingLines, rectangularGridRadius,
+                                                                         samplingDistanceMM, nullptr);
+                                         }
+                                       } );
+
       bool   exitCriteriaMet = false;
       double MaxVolumeBasedOnArea = 0.0;
-      typename TInputImage::PointType rectPhysPoint;
-      typename TInputImage::PointType currRotatedSampleGridLocation;
       for( int dIndex = numberOfSamplelingLines - 1; dIndex >= 0; dIndex-- )
         {
         // Equally space the SI sampling around the COM for each index
         const double percentage = ( static_cast<double>( dIndex + 1 ) /
             static_cast<double>( numberOfSamplelingLines ) );
-        rectPhysPoint[2] =
-          ( rectangularGridRadius * 2.0 )*  percentage - rectangularGridRadius;
-        currRotatedSampleGridLocation[2] = CenterOfMass[2] + rectPhysPoint[2];
-        for( rectPhysPoint[1] = -rectangularGridRadius;
-             rectPhysPoint[1] < rectangularGridRadius;
-             rectPhysPoint[1] += samplingDistanceMM )
-        // Raster through (-120mm,120mm)
+        const double currRotatedSampleGridLocationSI = CenterOfMass[2]
+          + ( ( rectangularGridRadius * 2.0 )*  percentage - rectangularGridRadius );
+        if( this->m_GenerateDebugImages )
           {
-          currRotatedSampleGridLocation[1] = CenterOfMass[1] + rectPhysPoint[1];
-          for( rectPhysPoint[0] = -rectangularGridRadius;
-               rectPhysPoint[0] < rectangularGridRadius;
-               rectPhysPoint[0] += samplingDistanceMM )
-          // Raster through (-120mm,120mm)
-            {
-            currRotatedSampleGridLocation[0] = CenterOfMass[0] + rectPhysPoint[0];
-
-            typename TInputImage::IndexType currIndex;
-            const bool isValidRegion = LFFimage->TransformPhysicalPointToIndex(
-                currRotatedSampleGridLocation,
-                currIndex);
-            if( isValidRegion && ( LFFimage->GetPixel(currIndex) > 0 ) )
-              {
-              // #ifdef USE_DEBUGGIN_IMAGES
-              if( this->m_GenerateDebugImages )
-                {
-                this->m_DebugGridImage->SetPixel( currIndex, ( numberOfSamplelingLines + dIndex ) );
-                }
-              maskCountsInPlane[dIndex]++;
-              }
-            // #ifdef USE_DEBUGGING_IMAGES
-            else if( this->m_GenerateDebugImages && isValidRegion )
-              {
-              this->m_DebugGridImage->SetPixel(currIndex, 0);
-              }
-            }
+          // Written in the original line order, later lines overwrite
+          // earlier ones.
+          this->CountMaskSamplesInPlane(LFFimage, CenterOfMass, dIndex, numberOfSamplelingLines,
+                                        rectangularGridRadius, samplingDistanceMM, this->m_DebugGridImage);
           }
 
         const double crossSectionalArea = maskCountsInPlane[dIndex] * samplingDistanceCM * samplingDistanceCM;
@@ -301,7 +348,7 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
             && ( this->m_HeadSizeEstimate > MaxVolumeBasedOnArea ) )
           {
           exitCriteriaMet = true;
-          inferiorCutOff = currRotatedSampleGridLocation[2];
+          inferiorCutOff = currRotatedSampleGridLocationSI;
           }
 
         if( this->m_GenerateDebugImages )
@@ -311,7 +358,7 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
                     << " CurrentCalculatedVolumeBasedOnArea: " << CurentVolumeBasedOnArea
                     << " CummulativeVolume: " << this->m_HeadSizeEstimate
                     << " ExitCriteriaMet: " << exitCriteriaMet
-                    << " Inferior Cut Off: " << currRotatedSampleGridLocation[2] << " " << inferiorCutOff
+                    << " Inferior Cut Off: " << currRotatedSampleGridLocationSI << " " << inferiorCutOff
                     << std::endl;
           }
         }
@@ -336,10 +383,6 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
       id->Update();
       this->m_ClippedImageMask = id->GetOutput();
       }
-    typedef typename itk::ImageRegionIteratorWithIndex<MaskImageType> MaskImageIteratorType;
-    MaskImageIteratorType ClippedMaskPixel( this->m_ClippedImageMask,
-                                            this->m_ClippedImageMask->GetLargestPossibleRegion() );
-
       {
       typename itk::ImageDuplicator<TInputImage>::Pointer id = itk::ImageDuplicator<TInputImage>::New();
       id->SetInputImage( this->GetInput() );
@@ -347,29 +390,40 @@ FindCenterOfBrainFilter<TInputImage, TMaskImage>
       this->m_TrimmedImage = id->GetOutput();
       }
 
-    typedef typename itk::ImageRegionIteratorWithIndex<TInputImage> TInputIteratorType;
-    TInputIteratorType ClippedImagePixel( this->m_TrimmedImage, this->m_TrimmedImage->GetLargestPossibleRegion() );
+    // The mask and the image are walked in step, one slab of slices per
+    // thread.
+    const typename MaskImageType::RegionType maskRegion = this->m_ClippedImageMask->GetLargestPossibleRegion();
+    const typename TInputImage::RegionType   imageRegion = this->m_TrimmedImage->GetLargestPossibleRegion();
+    BRAINSUtils::ParallelizeRange( imageRegion.GetSize(ImageDimension - 1),
+                                   [&](const SizeValueType begin, const SizeValueType end)
+                                     {
+                                     typedef typename itk::ImageRegionIterator<MaskImageType> MaskImageIteratorType;
+                                     MaskImageIteratorType ClippedMaskPixel( this->m_ClippedImageMask,
+                                                                             BRAINSUtils::SliceRange(maskRegion, begin, end) );
 
-    ClippedImagePixel.GoToBegin();
-    while( ( !ClippedImagePixel.IsAtEnd() ) )
-      {
-      typename TInputImage::PointType currLoc;
-      this->m_TrimmedImage->TransformIndexToPhysicalPoint(ClippedImagePixel.GetIndex(), currLoc);
-      if( currLoc[2] > inferiorCutOff && ( ClippedMaskPixel.Get() != 0 ) )
-      // If this mask voxel is in the foreground AND above the inferiorCutOff
-        {
-        ClippedMaskPixel.Set(1);
-        // putchar('1');
-        }
-      else
-        {
-        ClippedImagePixel.Set(this->m_BackgroundValue);
-        ClippedMaskPixel.Set(0);
-        // putchar('0');
-        }
-      ++ClippedImagePixel;
-      ++ClippedMaskPixel;
-      }
+                                     typedef typename itk::ImageRegionIteratorWithIndex<TInputImage> TInputIteratorType;
+                                     TInputIteratorType ClippedImagePixel( this->m_TrimmedImage,
+                                                                           BRAINSUtils::SliceRange(imageRegion, begin, end) );
+
+                                     typename TInputImage::PointType currLoc;
+                                     ClippedImagePixel.GoToBegin();
+                                     while( ( !ClippedImagePixel.IsAtEnd() ) )
+                                       {
+                                       this->m_TrimmedImage->TransformIndexToPhysicalPoint(ClippedImagePixel.GetIndex(), currLoc);
+                                       if( currLoc[2] > inferiorCutOff && ( ClippedMaskPixel.Get() != 0 ) )
+                                       // If this mask voxel is in the foreground AND above the inferiorCutOff
+                                         {
+                                         ClippedMaskPixel.Set(1);
+                                         }
+                                       else
+                                         {
+                                         ClippedImagePixel.Set(this->m_BackgroundValue);
+                                         ClippedMaskPixel.Set(0);
+                                         }
+                                       ++ClippedImagePixel;
+                                       ++ClippedMaskPixel;
+                                       }
+                                     } );
     }
   // #ifdef USE_DEBUGGIN_IMAGES
   if( this->m_GenerateDebugImages )
@@ -23,6 +23,8 @@
 #include <itkImageToImageFilter.h>
 #include <itkNumericTraits.h>
 
+#include <string>
+
 namespace itk
 {
 /**
@@ -119,6 +121,12 @@ public:
   itkGetMacro(OutsideValue, IntegerPixelType);
   itkSetMacro(ThresholdCorrectionFactor, double);
   itkGetConstMacro(ThresholdCorrectionFactor, double);
+  /** Reuse masks already computed for the same input voxels and parameters
+    * (see ForegroundMaskCache).  Off by default, since the lookup hashes
+    * every input voxel; turned on by the filters whose masks are repeated. */
+  itkSetMacro(UseMaskCache, bool);
+  itkGetConstMacro(UseMaskCache, bool);
+  itkBooleanMacro(UseMaskCache);
 protected:
   LargestForegroundFilledMaskImageFilter();
   ~LargestForegroundFilledMaskImageFilter() override;
@@ -133,8 +141,30 @@ private:
     * Low and High are set to the ?????? */
   unsigned int SetLowHigh(InputPixelType & low, InputPixelType & high);
 
+  /** Cache key covering the input image content and every parameter that
+    * changes the mask. */
+  std::string ComputeMaskCacheKey() const;
+
   void ImageMinMax(InputPixelType & min, InputPixelType & max) const;
 
+  /** Dilate (or erode) the voxels equal to foregroundValue by the same
+    * ellipsoid that BinaryBallStructuringElement builds for radius.
+    * Membership is decided from an exact Euclidean distance map computed in
+    * ball-normalized coordinates, so the cost no longer grows with the
+    * kernel volume. Dilated voxels are set to foregroundValue, eroded voxels
+    * to backgroundValue, and all other voxels are copied unchanged, matching
+    * BinaryDilateImageFilter and BinaryErodeImageFilter. */
+  typename IntegerImageType::Pointer BallMorphology(const IntegerImageType *image,
+                                                    const typename IntegerImageType::SizeType & radius,
+                                                    const IntegerPixelType foregroundValue,
+                                                    const IntegerPixelType backgroundValue,
+                                                    const bool dilate) const;
+
+  /** Label the face-connected components of the non-zero voxels and return a
+    * mask of the largest one, the same component RelabelComponentImageFilter
+    * would have ranked first, without rewriting the whole label image. */
+  typename IntegerImageType::Pointer LargestComponent(const IntegerImageType *image) const;
+
   // No longer used  double m_OtsuPercentileThreshold;
   double           m_OtsuPercentileLowerThreshold;
   double           m_OtsuPercentileUpperThreshold;
@@ -143,6 +173,7 @@ private:
   double           m_DilateSize;
   IntegerPixelType m_InsideValue;
   IntegerPixelType m_OutsideValue;
+  bool             m_UseMaskCache;
 };
 } // end namespace itk
 
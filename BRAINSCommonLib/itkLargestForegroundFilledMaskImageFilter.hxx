@@ -20,16 +20,14 @@
 #define __itkLargestForegroundFilledMaskImageFilter_hxx
 #include "itkLargestForegroundFilledMaskImageFilter.h"
 #include "itkComputeHistogramQuantileThresholds.h"
+#include "ForegroundMaskCache.h"
 
 #include <itkConnectedComponentImageFilter.h>
-#include <itkRelabelComponentImageFilter.h>
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkImageRegionIterator.h>
 // #include <itkSimpleFilterWatcher.h>
-#include <itkImageRegionIterator.h>
-#include <itkBinaryBallStructuringElement.h>
-#include <itkBinaryDilateImageFilter.h>
-#include <itkBinaryErodeImageFilter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkSignedMaurerDistanceMapImageFilter.h>
 #include <vnl/vnl_sample.h>
 #include <vnl/vnl_math.h>
 #include <itkConnectedThresholdImageFilter.h>
@@ -42,6 +40,8 @@
 #include <itkOtsuThresholdCalculator.h>
 #include <itkCastImageFilter.h>
 
+#include <vector>
+
 namespace itk
 {
 template <class TInputImage, class TOutputImage>
@@ -53,7 +53,8 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
   m_ClosingSize(9.0),
   m_DilateSize(0.0),
   m_InsideValue(NumericTraits<typename IntegerImageType::PixelType>::OneValue()),
-  m_OutsideValue(NumericTraits<typename IntegerImageType::PixelType>::ZeroValue())
+  m_OutsideValue(NumericTraits<typename IntegerImageType::PixelType>::ZeroValue()),
+  m_UseMaskCache(false)
 {
 }
 
@@ -79,7 +80,9 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
      << "InsideValue "
      << m_InsideValue << " "
      << "OutsideValue "
-     << m_OutsideValue << std::endl;
+     << m_OutsideValue << " "
+     << "UseMaskCache "
+     << m_UseMaskCache << std::endl;
 }
 
 template <class TInputImage, class TOutputImage>
@@ -96,6 +99,182 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
   imageMin = minmaxFilter->GetMinimum();
 }
 
+template <class TInputImage, class TOutputImage>
+std::string
+LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
+::ComputeMaskCacheKey() const
+{
+  ContentHashKeyHasher hasher;
+  // Bump the version string whenever the masking algorithm changes results.
+  hasher.Add(std::string("LargestForegroundFilledMask-v2") );
+  hasher.Add(static_cast<double>( sizeof( OutputPixelType ) ) );
+  hasher.Add(static_cast<double>( NumericTraits<OutputPixelType>::is_signed ) );
+  ForegroundMaskCache::AddImageToKey( hasher, this->GetInput() );
+  hasher.Add(this->m_OtsuPercentileLowerThreshold);
+  hasher.Add(this->m_OtsuPercentileUpperThreshold);
+  hasher.Add(this->m_ThresholdCorrectionFactor);
+  hasher.Add(this->m_ClosingSize);
+  hasher.Add(this->m_DilateSize);
+  hasher.Add(static_cast<double>( this->m_InsideValue ) );
+  hasher.Add(static_cast<double>( this->m_OutsideValue ) );
+  return hasher.GetKey();
+}
+
+template <class TInputImage, class TOutputImage>
+typename LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>::IntegerImageType::Pointer
+LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
+::BallMorphology(const IntegerImageType *image,
+                 const typename IntegerImageType::SizeType & radius,
+                 const IntegerPixelType foregroundValue,
+                 const IntegerPixelType backgroundValue,
+                 const bool dilate) const
+{
+  // Dilation grows the foreground into every voxel whose nearest foreground
+  // voxel lies inside the ball; erosion removes every foreground voxel whose
+  // nearest non-foreground voxel does.  In both cases the distance is
+  // measured to the set of voxels that is left untouched.
+  typedef BinaryThresholdImageFilter<IntegerImageType, IntegerImageType> IndicatorFilterType;
+  typename IndicatorFilterType::Pointer indicator = IndicatorFilterType::New();
+  indicator->SetInput(image);
+  indicator->SetLowerThreshold(foregroundValue);
+  indicator->SetUpperThreshold(foregroundValue);
+  indicator->SetInsideValue(dilate ? 1 : 0);
+  indicator->SetOutsideValue(dilate ? 0 : 1);
+  indicator->Update();
+  typename IntegerImageType::Pointer source = indicator->GetOutput();
+  source->DisconnectPipeline();
+
+  const typename IntegerImageType::RegionType region = image->GetLargestPossibleRegion();
+  typename IntegerImageType::Pointer result = IntegerImageType::New();
+  result->CopyInformation(image);
+  result->SetRegions(region);
+  result->Allocate();
+
+  bool sourceIsEmpty = true;
+  for( ImageRegionConstIterator<IntegerImageType> it(source, region); !it.IsAtEnd(); ++it )
+    {
+    if( it.Get() != 0 )
+      {
+      sourceIsEmpty = false;
+      break;
+      }
+    }
+  if( sourceIsEmpty )
+    {
+    // Nothing to grow from (dilate) or nothing to erode towards (erode; the
+    // image boundary counts as foreground, as in BinaryErodeImageFilter).
+    ImageRegionConstIterator<IntegerImageType> inIt(image, region);
+    ImageRegionIterator<IntegerImageType>      outIt(result, region);
+    for( ; !inIt.IsAtEnd(); ++inIt, ++outIt )
+      {
+      outIt.Set( inIt.Get() );
+      }
+    return result;
+    }
+
+  // BinaryBallStructuringElement keeps the offsets inside the ellipsoid with
+  // semi-axes radius+0.5, so measuring distances with a spacing of
+  // 1/(radius+0.5) turns that ellipsoid into the unit ball.
+  typename IntegerImageType::SpacingType ballSpacing;
+  for( unsigned int d = 0; d < IntegerImageType::ImageDimension; ++d )
+    {
+    ballSpacing[d] = 1.0 / ( static_cast<double>( radius[d] ) + 0.5 );
+    }
+  source->SetSpacing(ballSpacing);
+
+  typedef Image<float, IntegerImageType::ImageDimension>                          DistanceImageType;
+  typedef SignedMaurerDistanceMapImageFilter<IntegerImageType, DistanceImageType> DistanceFilterType;
+  typename DistanceFilterType::Pointer distanceFilter = DistanceFilterType::New();
+  distanceFilter->SetInput(source);
+  distanceFilter->SetBackgroundValue(0);
+  distanceFilter->SetSquaredDistance(true);
+  distanceFilter->SetUseImageSpacing(true);
+  distanceFilter->SetInsideIsPositive(false);
+  distanceFilter->Update();
+
+  // Offsets exactly on the ellipsoid belong to the ball; allow for float
+  // round-off in the squared distance.
+  const float unitBallSquared = 1.0F + 1.0e-5F;
+  const IntegerPixelType replaceValue = dilate ? foregroundValue : backgroundValue;
+
+  ImageRegionConstIterator<IntegerImageType>  inIt(image, region);
+  ImageRegionConstIterator<DistanceImageType> distIt(distanceFilter->GetOutput(), region);
+  ImageRegionIterator<IntegerImageType>       outIt(result, region);
+  for( ; !inIt.IsAtEnd(); ++inIt, ++distIt, ++outIt )
+    {
+    const float squaredDistance = distIt.Get();
+    if( squaredDistance > 0.0F && squaredDistance <= unitBallSquared )
+      {
+      outIt.Set(replaceValue);
+      }
+    else
+      {
+      outIt.Set( inIt.Get() );
+      }
+    }
+  return result;
+}
+
+template <class TInputImage, class TOutputImage>
+typename LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>::IntegerImageType::Pointer
+LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
+::LargestComponent(const IntegerImageType *image) const
+{
+  typedef ConnectedComponentImageFilter<IntegerImageType,
+                                        IntegerImageType> FilterType;
+  typename FilterType::Pointer labelConnectedComponentsFilter = FilterType::New();
+  labelConnectedComponentsFilter->SetInput(image);
+  try
+    {
+    labelConnectedComponentsFilter->Update();
+    }
+  catch( ExceptionObject & excep )
+    {
+    std::cerr << "ConnectedComponents: exception caught !" << std::endl;
+    std::cerr << excep << std::endl;
+    }
+
+  const IntegerImageType *labelImage = labelConnectedComponentsFilter->GetOutput();
+  std::vector<SizeValueType> componentSizes(
+    static_cast<size_t>( labelConnectedComponentsFilter->GetObjectCount() ) + 1, 0 );
+  for( ImageRegionConstIterator<IntegerImageType> it( labelImage, labelImage->GetBufferedRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const IntegerPixelType label = it.Get();
+    if( label < componentSizes.size() )
+      {
+      ++componentSizes[label];
+      }
+    }
+
+  // RelabelComponentImageFilter ranks by size and breaks ties by the lower
+  // original label, so keep the first label that reaches the maximum.
+  IntegerPixelType largestLabel = 0;
+  SizeValueType    largestSize = 0;
+  for( size_t label = 1; label < componentSizes.size(); ++label )
+    {
+    if( componentSizes[label] > largestSize )
+      {
+      largestSize = componentSizes[label];
+      largestLabel = static_cast<IntegerPixelType>( label );
+      }
+    }
+  // With no components at all no voxel carries label 1, so nothing is kept.
+  const IntegerPixelType selectedLabel = ( largestLabel > 0 ) ? largestLabel : 1;
+
+  typedef BinaryThresholdImageFilter<IntegerImageType,
+                                     IntegerImageType> ThresholdFilterType;
+  typename ThresholdFilterType::Pointer LargestFilter =
+    ThresholdFilterType::New();
+  LargestFilter->SetInput(labelImage);
+  LargestFilter->SetInsideValue(this->m_InsideValue);
+  LargestFilter->SetOutsideValue(this->m_OutsideValue);
+  LargestFilter->SetLowerThreshold(selectedLabel);
+  LargestFilter->SetUpperThreshold(selectedLabel);
+  LargestFilter->Update();
+  return LargestFilter->GetOutput();
+}
+
 template <class TInputImage, class TOutputImage>
 void
 LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
@@ -126,6 +305,19 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
                         << this->m_OtsuPercentileUpperThreshold << " ");
       }
     }
+  std::string maskCacheKey;
+  if( this->m_UseMaskCache )
+    {
+    maskCacheKey = this->ComputeMaskCacheKey();
+    typename OutputImageType::Pointer cachedMask =
+      ForegroundMaskCache::Find<OutputImageType>( maskCacheKey, this->GetInput() );
+    if( cachedMask.IsNotNull() )
+      {
+      this->GraftOutput(cachedMask);
+      return;
+      }
+    }
+
   this->AllocateOutputs();
 
   // This is to help with noisy data that has a few spurious very high/ very low values.
@@ -191,93 +383,31 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
             << static_cast<int>( threshold_hi_foreground ) << "]"
             << std::endl;
 
-  typedef ConnectedComponentImageFilter<IntegerImageType,
-                                        IntegerImageType> FilterType;
-  typename FilterType::Pointer labelConnectedComponentsFilter = FilterType::New();
-  //  SimpleFilterWatcher watcher(labelConnectedComponentsFilter);
-  //  watcher.QuietOn();
-  labelConnectedComponentsFilter->SetInput( threshold->GetOutput() );
-  // labelConnectedComponentsFilter->Update();
-
-  typedef RelabelComponentImageFilter<IntegerImageType,
-                                      IntegerImageType> RelabelType;
-  typename RelabelType::Pointer relabel = RelabelType::New();
-  relabel->SetInput( labelConnectedComponentsFilter->GetOutput() );
-
-  try
-    {
-    relabel->Update();
-    }
-  catch( ExceptionObject & excep )
-    {
-    std::cerr << "Relabel: exception caught !" << std::endl;
-    std::cerr << excep << std::endl;
-    }
+  const typename IntegerImageType::Pointer largestComponent = this->LargestComponent( threshold->GetOutput() );
 
   typedef BinaryThresholdImageFilter<IntegerImageType,
                                      IntegerImageType> ThresholdFilterType;
-  // unsigned short numObjects = relabel->GetNumberOfObjects();
-  // std::cout << "Removed " << numObjects - 1 << " smaller objects." <<
-  // std::endl;
-  typename ThresholdFilterType::Pointer LargestFilter =
-    ThresholdFilterType::New();
-  LargestFilter->SetInput( relabel->GetOutput() );
-  LargestFilter->SetInsideValue(this->m_InsideValue);
-  LargestFilter->SetOutsideValue(this->m_OutsideValue);
-  LargestFilter->SetLowerThreshold(1);
-  LargestFilter->SetUpperThreshold(1);
-  LargestFilter->Update();
-
-  typedef BinaryBallStructuringElement<typename IntegerImageType::
-                                       PixelType,
-                                       IntegerImageType::ImageDimension>
-    myKernelType;
 
-  typedef BinaryErodeImageFilter<IntegerImageType, IntegerImageType,
-                                 myKernelType> ErodeFilterType;
-  typename ErodeFilterType::Pointer ErodeFilter = ErodeFilterType::New();
+  typename IntegerImageType::Pointer closedMask = nullptr;
     {
-    myKernelType dilateBall;
-    myKernelType erodeBall;
-    typename myKernelType::SizeType dilateBallSize;
-    typename myKernelType::SizeType erodeBallSize;
+    typename IntegerImageType::SizeType closingBallSize;
     for( unsigned int d = 0; d < 3; ++d )
       {
-      const unsigned int ClosingVoxels = vnl_math_ceil( m_ClosingSize / ( relabel->GetOutput()->GetSpacing()[d] ) );
+      const unsigned int ClosingVoxels = vnl_math_ceil( m_ClosingSize / ( largestComponent->GetSpacing()[d] ) );
       if( ClosingVoxels > 20 )
         {
         std::cout << "WARNING:  Attempting to close with a very large number of voxels:  "
-                  << m_ClosingSize << " / " << ( relabel->GetOutput()->GetSpacing()[d] ) << " = " << ClosingVoxels
+                  << m_ClosingSize << " / " << ( largestComponent->GetSpacing()[d] ) << " = " << ClosingVoxels
                   << std::endl;
         std::cout << "Perhaps there is a mis-match between the voxel spacing"
                   << " and the assumption that  ClosingSize is given in mm"
                   << std::endl;
         }
-      dilateBallSize[d] = ClosingVoxels;
-      erodeBallSize[d]  = ClosingVoxels;
+      closingBallSize[d] = ClosingVoxels;
       }
-    dilateBall.SetRadius(dilateBallSize);
-    dilateBall.CreateStructuringElement();
-    erodeBall.SetRadius(erodeBallSize);
-    erodeBall.CreateStructuringElement();
-
-    typedef BinaryDilateImageFilter<IntegerImageType, IntegerImageType,
-                                    myKernelType> DilateFilterType;
-    typename DilateFilterType::Pointer DilateFilter = DilateFilterType::New();
-
-    // DilateFilter->SetForegroundValue(1);
-    DilateFilter->SetDilateValue(1);
-    DilateFilter->SetBackgroundValue(0);
-    DilateFilter->SetInput( LargestFilter->GetOutput() );
-    DilateFilter->SetKernel(dilateBall);
-    DilateFilter->Update();
-
-    // ErodeFilter->SetForegroundValue(1);
-    ErodeFilter->SetErodeValue(1);
-    ErodeFilter->SetBackgroundValue(0);
-    ErodeFilter->SetInput( DilateFilter->GetOutput() );
-    ErodeFilter->SetKernel(erodeBall);
-    ErodeFilter->Update();
+    const typename IntegerImageType::Pointer dilated =
+      this->BallMorphology(largestComponent, closingBallSize, 1, 0, true);
+    closedMask = this->BallMorphology(dilated, closingBallSize, 1, 0, false);
     }
 
   // silence warnings by converting the size to index
@@ -285,7 +415,7 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
   for(unsigned int _i = 0; _i < IntegerImageType::ImageDimension; ++_i)
     {
     IndImageSize[_i] = static_cast<typename IntegerImageType::IndexValueType>
-      (ErodeFilter->GetOutput()->GetLargestPossibleRegion().GetSize()[_i]);
+      (closedMask->GetLargestPossibleRegion().GetSize()[_i]);
     }
   // NOTE:  The most robust way to do this would be to find the largest
   // background labeled image, and then choose one of those locations as the
@@ -334,7 +464,7 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
   seededConnectedThresholdFilter->SetReplaceValue(100);
   seededConnectedThresholdFilter->SetUpper(0);
   seededConnectedThresholdFilter->SetLower(0);
-  seededConnectedThresholdFilter->SetInput( ErodeFilter->GetOutput() );
+  seededConnectedThresholdFilter->SetInput( closedMask );
   seededConnectedThresholdFilter->Update();
 
   typename IntegerImageType::Pointer dilateMask = nullptr;
@@ -351,26 +481,15 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
     if( m_DilateSize > 0.0 )
       {
       // Dilate to get some background to better drive BSplineRegistration
-      typedef itk::BinaryDilateImageFilter<IntegerImageType, IntegerImageType,
-                                           myKernelType> DilateType;
-
-      myKernelType dilateBall;
-      typename myKernelType::SizeType dilateBallSize;
+      typename IntegerImageType::SizeType dilateBallSize;
       for( unsigned int d = 0; d < 3; ++d )
         {
         const unsigned int DilateVoxels =
           vnl_math_ceil( m_DilateSize / ( FinalThreshold->GetOutput()->GetSpacing()[d] ) );
         dilateBallSize[d] = DilateVoxels;
         }
-      dilateBall.SetRadius(dilateBallSize);
-      dilateBall.CreateStructuringElement();
-
-      typename DilateType::Pointer dil = DilateType::New();
-      dil->SetDilateValue(this->m_InsideValue);
-      dil->SetKernel(dilateBall);
-      dil->SetInput( FinalThreshold->GetOutput() );
-      dil->Update();
-      dilateMask = dil->GetOutput();
+      dilateMask = this->BallMorphology(FinalThreshold->GetOutput(), dilateBallSize,
+                                        this->m_InsideValue, 0, true);
       }
     else
       {
@@ -385,6 +504,10 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>
   outputCaster->GraftOutput( this->GetOutput() );
   outputCaster->Update();
   this->GraftOutput( outputCaster->GetOutput() );
+  if( this->m_UseMaskCache )
+    {
+    ForegroundMaskCache::Store<OutputImageType>( maskCacheKey, this->GetOutput() );
+    }
   //  typename OutputImageType::Pointer outputMaskImage =
   // outputCaster->GetOutput();
   //  return outputMaskImage;
@@ -23,6 +23,7 @@
 #include <itkImageToImageFilter.h>
 #include <itkNumericTraits.h>
 #include <itkArray.h>
+#include "itkComputeHistogramQuantileThresholds.h"
 
 namespace itk
 {
@@ -60,6 +61,8 @@ public:
 
   typedef Array<double> ThresholdArrayType;
 
+  typedef ComputeHistogramQuantileThresholds<TInputImage, TOutputImage> QuantileCalculatorType;
+
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
 
@@ -82,6 +85,17 @@ public:
   itkGetConstMacro(InsideValue, IntegerPixelType);
   itkSetMacro(OutsideValue, IntegerPixelType);
   itkGetConstMacro(OutsideValue, IntegerPixelType);
+
+  /** Map the quantile window [quantileLower, quantileUpper] of one input to
+   *  its intensity window.  quantileCalculator holds the statistics of that
+   *  input, calculated with the quantiles linearQuantileThreshold and
+   *  1 - linearQuantileThreshold.  This is the window GenerateData applies,
+   *  exposed so that callers thresholding one image for many quantile
+   *  windows compute the statistics once. */
+  static void ComputeIntensityThresholds(const QuantileCalculatorType *quantileCalculator,
+                                         const double linearQuantileThreshold,
+                                         const double quantileLower, const double quantileUpper,
+                                         InputPixelType & intensityLower, InputPixelType & intensityUpper);
 protected:
   MultiModeHistogramThresholdBinaryImageFilter();
   ~MultiModeHistogramThresholdBinaryImageFilter() override;
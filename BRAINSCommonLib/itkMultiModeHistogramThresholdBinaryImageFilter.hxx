@@ -17,7 +17,6 @@
  *
  *=========================================================================*/
 #include "itkMultiModeHistogramThresholdBinaryImageFilter.h"
-#include "itkComputeHistogramQuantileThresholds.h"
 
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkMultiplyImageFilter.h>
@@ -65,6 +64,65 @@ MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>
      << m_OutsideValue << std::endl;
 }
 
+template <class TInputImage, class TOutputImage>
+void
+MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>
+::ComputeIntensityThresholds(const QuantileCalculatorType *quantileCalculator,
+                             const double linearQuantileThreshold,
+                             const double quantileLower, const double quantileUpper,
+                             InputPixelType & intensityLower, InputPixelType & intensityUpper)
+{
+  const InputPixelType thresholdLowerLinearRegion = quantileCalculator->GetLowerIntensityThresholdValue();
+  const InputPixelType thresholdUpperLinearRegion  = quantileCalculator->GetUpperIntensityThresholdValue();
+  const InputPixelType imageMinValue  = quantileCalculator->GetImageMin();
+  const InputPixelType imageMaxValue  = quantileCalculator->GetImageMax();
+  const unsigned int   numNonZeroHistogramBins = quantileCalculator->GetNumberOfValidHistogramsEntries();
+
+  InputPixelType thresholdLowerLinearRegion_foreground;
+  if( numNonZeroHistogramBins <= 2 )
+    {
+    thresholdLowerLinearRegion_foreground = thresholdUpperLinearRegion;
+    }
+  else
+    {
+    thresholdLowerLinearRegion_foreground = thresholdLowerLinearRegion;
+    }
+
+  if( quantileLower < linearQuantileThreshold )
+    {
+    const double range = ( linearQuantileThreshold - 0.0 );
+    const double percentValue = ( quantileLower - 0.0 ) / range;
+    intensityLower =
+      static_cast<InputPixelType>(
+        imageMinValue + ( thresholdLowerLinearRegion_foreground - imageMinValue ) * percentValue );
+    }
+  else
+    {
+    const double range = ( 1.0 - linearQuantileThreshold ) - linearQuantileThreshold;
+    const double percentValue = ( quantileLower - linearQuantileThreshold ) / range;
+    intensityLower =
+      static_cast<InputPixelType>(
+        thresholdLowerLinearRegion_foreground
+        + ( thresholdUpperLinearRegion - thresholdLowerLinearRegion_foreground ) * percentValue );
+    }
+  if( quantileUpper > ( 1.0 - linearQuantileThreshold ) )
+    {
+    const double range = 1.0 - linearQuantileThreshold;
+    const double percentValue = ( quantileUpper - linearQuantileThreshold ) / range;
+    intensityUpper = static_cast<InputPixelType>(
+        thresholdUpperLinearRegion
+        + ( imageMaxValue - thresholdUpperLinearRegion ) * percentValue );
+    }
+  else
+    {
+    const double range = ( 1.0 - linearQuantileThreshold ) - linearQuantileThreshold;
+    const double percentValue = ( quantileUpper - linearQuantileThreshold ) / range;
+    intensityUpper = static_cast<InputPixelType>(
+        thresholdLowerLinearRegion_foreground
+        + ( thresholdUpperLinearRegion - thresholdLowerLinearRegion_foreground ) * percentValue );
+    }
+}
+
 template <class TInputImage, class TOutputImage>
 void
 MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>
@@ -93,25 +151,15 @@ MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>
     ImageCalc->SetBinaryPortionImage(this->m_BinaryPortionImage);
     ImageCalc->Calculate();
 
+    typename InputImageType::PixelType intensity_thresholdLowerLinearRegion;
+    typename InputImageType::PixelType intensity_thresholdUpperLinearRegion;
+    Self::ComputeIntensityThresholds(ImageCalc.GetPointer(), m_LinearQuantileThreshold,
+                                     m_QuantileLowerThreshold.GetElement(j), m_QuantileUpperThreshold.GetElement(j),
+                                     intensity_thresholdLowerLinearRegion, intensity_thresholdUpperLinearRegion);
     const typename InputImageType::PixelType thresholdLowerLinearRegion = ImageCalc->GetLowerIntensityThresholdValue();
     const typename InputImageType::PixelType thresholdUpperLinearRegion  = ImageCalc->GetUpperIntensityThresholdValue();
     const typename InputImageType::PixelType imageMinValue  = ImageCalc->GetImageMin();
     const typename InputImageType::PixelType imageMaxValue  = ImageCalc->GetImageMax();
-    const unsigned int numNonZeroHistogramBins = ImageCalc->GetNumberOfValidHistogramsEntries();
-
-    typename InputImageType::PixelType thresholdLowerLinearRegion_foreground;
-    if( numNonZeroHistogramBins <= 2 )
-      {
-      thresholdLowerLinearRegion_foreground = thresholdUpperLinearRegion;
-      }
-    else
-      {
-      thresholdLowerLinearRegion_foreground = thresholdLowerLinearRegion;
-      }
-
-    std::cout << "LowHigh Thresholds: [ " << thresholdLowerLinearRegion << ", "
-              << thresholdLowerLinearRegion_foreground << ", " << thresholdUpperLinearRegion << " ]"
-              << std::endl;
 
     typedef BinaryThresholdImageFilter<InputImageType,
                                        IntegerImageType>
@@ -121,41 +169,6 @@ MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>
     threshold->SetInput( this->GetInput(j) );
     threshold->SetInsideValue(this->m_InsideValue);
     threshold->SetOutsideValue(this->m_OutsideValue);
-    typename InputImageType::PixelType intensity_thresholdLowerLinearRegion;
-    typename InputImageType::PixelType intensity_thresholdUpperLinearRegion;
-    if( m_QuantileLowerThreshold.GetElement(j) < m_LinearQuantileThreshold )
-      {
-      const double range = ( m_LinearQuantileThreshold - 0.0 );
-      const double percentValue = ( m_QuantileLowerThreshold.GetElement(j) - 0.0 ) / range;
-      intensity_thresholdLowerLinearRegion =
-        static_cast<typename InputImageType::PixelType>(
-          imageMinValue + ( thresholdLowerLinearRegion_foreground - imageMinValue ) * percentValue );
-      }
-    else
-      {
-      const double range = ( 1.0 - m_LinearQuantileThreshold ) - m_LinearQuantileThreshold;
-      const double percentValue = ( m_QuantileLowerThreshold.GetElement(j) - m_LinearQuantileThreshold ) / range;
-      intensity_thresholdLowerLinearRegion =
-        static_cast<typename InputImageType::PixelType>(
-          thresholdLowerLinearRegion_foreground
-          + ( thresholdUpperLinearRegion - thresholdLowerLinearRegion_foreground ) * percentValue );
-      }
-    if( m_QuantileUpperThreshold.GetElement(j) > ( 1.0 - m_LinearQuantileThreshold ) )
-      {
-      const double range = 1.0 - m_LinearQuantileThreshold;
-      const double percentValue = ( m_QuantileUpperThreshold.GetElement(j) - m_LinearQuantileThreshold ) / range;
-      intensity_thresholdUpperLinearRegion = static_cast<typename InputImageType::PixelType>(
-          thresholdUpperLinearRegion
-          + ( imageMaxValue - thresholdUpperLinearRegion ) * percentValue );
-      }
-    else
-      {
-      const double range = ( 1.0 - m_LinearQuantileThreshold ) - m_LinearQuantileThreshold;
-      const double percentValue = ( m_QuantileUpperThreshold.GetElement(j) - m_LinearQuantileThreshold ) / range;
-      intensity_thresholdUpperLinearRegion = static_cast<typename InputImageType::PixelType>(
-          thresholdLowerLinearRegion_foreground
-          + ( thresholdUpperLinearRegion - thresholdLowerLinearRegion_foreground ) * percentValue );
-      }
     std::cout << "DEBUG:MINMAX:DEBUG: ["
               << imageMinValue << "," << imageMaxValue << "]" << std::endl;
     std::cout << "DEBUG:LINLOWHIGH:DEBUG: ["
@@ -0,0 +1,123 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRunningAverageImageAccumulator_h
+#define __itkRunningAverageImageAccumulator_h
+
+#include "itkImage.h"
+#include "itkMultiThreaderBase.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+namespace itk
+{
+/** \class RunningAverageImageAccumulator
+ *
+ * \brief Pixelwise average of images that are added one at a time.
+ *
+ * \ingroup ITKBRAINSFilterPack
+ * AddImage() adds an image to a compensated (Kahan) running sum, in threads
+ * over slabs of the image, and GetAverage() returns the average of the
+ * images added so far.  Only the sum and its compensation, two images of the
+ * real pixel type, are kept between calls, so each image can be released as
+ * soon as it has been added.  This gives the same average as
+ * AverageImageFilter without holding all inputs in memory together.
+ *
+ * All images must have the same buffered region, and a pixel type of fixed
+ * size.  As in AverageImageFilter, the average is cast to the output pixel
+ * type without rounding.
+ */
+template <typename TInputImage, typename TOutputImage = TInputImage>
+class RunningAverageImageAccumulator : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef RunningAverageImageAccumulator Self;
+  typedef Object                         Superclass;
+  typedef SmartPointer<Self>             Pointer;
+  typedef SmartPointer<const Self>       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods) */
+  itkTypeMacro(RunningAverageImageAccumulator, Object);
+
+  static constexpr unsigned int ImageDimension = TOutputImage::ImageDimension;
+
+  typedef TInputImage                                       InputImageType;
+  typedef TOutputImage                                      OutputImageType;
+  typedef typename OutputImageType::Pointer                 OutputImagePointer;
+  typedef typename OutputImageType::PixelType               OutputPixelType;
+  typedef typename NumericTraits<OutputPixelType>::RealType RealPixelType;
+  typedef Image<RealPixelType, ImageDimension>              AccumulatorImageType;
+
+  /** Add one image to the running sum */
+  void AddImage(const InputImageType *image);
+
+  /** The average of the images added so far */
+  OutputImagePointer GetAverage() const;
+
+  /** Release the running sum and start again */
+  void Reset();
+
+  itkGetConstMacro(NumberOfImages, unsigned int);
+
+  /** Number of threads used by AddImage() and GetAverage() */
+  itkSetMacro(NumberOfThreads, ThreadIdType);
+  itkGetConstMacro(NumberOfThreads, ThreadIdType);
+
+protected:
+  RunningAverageImageAccumulator();
+  ~RunningAverageImageAccumulator() override {}
+
+  void PrintSelf(std::ostream&, Indent) const override;
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(RunningAverageImageAccumulator);
+
+  struct ThreadStruct
+    {
+    const Self           *Accumulator;
+    const InputImageType *Image;
+    OutputImageType      *Output;
+    };
+
+  /** Run callback on one piece of the accumulator region per thread */
+  void RunOnAccumulatorRegion(ThreadFunctionType callback, ThreadStruct & str) const;
+
+  static ITK_THREAD_RETURN_TYPE AddImageThreaderCallback(void *arg);
+
+  static ITK_THREAD_RETURN_TYPE GetAverageThreaderCallback(void *arg);
+
+  /** The piece of the accumulator region of thread threadId */
+  bool GetAccumulatorSplit(const ThreadIdType threadId, const ThreadIdType threadCount,
+                           typename AccumulatorImageType::RegionType & split) const;
+
+  typename AccumulatorImageType::Pointer m_Sum;
+  typename AccumulatorImageType::Pointer m_Compensation;
+  unsigned int                           m_NumberOfImages;
+  ThreadIdType                           m_NumberOfThreads;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkRunningAverageImageAccumulator.hxx"
+#endif
+
+#endif
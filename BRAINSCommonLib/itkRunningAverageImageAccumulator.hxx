@@ -0,0 +1,205 @@
+/*=========================================================================
+ *
+ *  Copyright Insight Software Consortium
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRunningAverageImageAccumulator_hxx
+#define __itkRunningAverageImageAccumulator_hxx
+
+#include "itkRunningAverageImageAccumulator.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkNumericTraits.h"
+
+namespace itk
+{
+template< typename TInputImage, typename TOutputImage >
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::RunningAverageImageAccumulator() :
+  m_NumberOfImages(0),
+  m_NumberOfThreads(MultiThreaderBase::GetGlobalDefaultNumberOfThreads() )
+{
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "NumberOfImages: " << this->m_NumberOfImages << std::endl;
+  os << indent << "NumberOfThreads: " << this->m_NumberOfThreads << std::endl;
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::AddImage(const InputImageType *image)
+{
+  if( image == nullptr )
+    {
+    itkExceptionMacro(<< "Null image added to the running average");
+    }
+  if( this->m_Sum.IsNull() )
+    {
+    this->m_Sum = AccumulatorImageType::New();
+    this->m_Sum->CopyInformation(image);
+    this->m_Sum->SetRegions(image->GetBufferedRegion() );
+    this->m_Sum->Allocate();
+    this->m_Sum->FillBuffer(NumericTraits<RealPixelType>::ZeroValue() );
+
+    this->m_Compensation = AccumulatorImageType::New();
+    this->m_Compensation->CopyInformation(image);
+    this->m_Compensation->SetRegions(image->GetBufferedRegion() );
+    this->m_Compensation->Allocate();
+    this->m_Compensation->FillBuffer(NumericTraits<RealPixelType>::ZeroValue() );
+    this->m_NumberOfImages = 0;
+    }
+  else if( image->GetBufferedRegion() != this->m_Sum->GetBufferedRegion() )
+    {
+    itkExceptionMacro(<< "Image region " << image->GetBufferedRegion()
+                      << " differs from the running average region " << this->m_Sum->GetBufferedRegion() );
+    }
+
+  ThreadStruct str;
+  str.Accumulator = this;
+  str.Image = image;
+  str.Output = nullptr;
+  this->RunOnAccumulatorRegion(Self::AddImageThreaderCallback, str);
+  ++this->m_NumberOfImages;
+  this->Modified();
+}
+
+template< typename TInputImage, typename TOutputImage >
+typename RunningAverageImageAccumulator< TInputImage, TOutputImage >::OutputImagePointer
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::GetAverage() const
+{
+  if( this->m_NumberOfImages == 0 )
+    {
+    itkExceptionMacro(<< "No image was added to the running average");
+    }
+  OutputImagePointer average = OutputImageType::New();
+  average->CopyInformation(this->m_Sum);
+  average->SetRegions(this->m_Sum->GetBufferedRegion() );
+  average->Allocate();
+
+  ThreadStruct str;
+  str.Accumulator = this;
+  str.Image = nullptr;
+  str.Output = average.GetPointer();
+  this->RunOnAccumulatorRegion(Self::GetAverageThreaderCallback, str);
+  return average;
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::Reset()
+{
+  this->m_Sum = nullptr;
+  this->m_Compensation = nullptr;
+  this->m_NumberOfImages = 0;
+  this->Modified();
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::RunOnAccumulatorRegion(ThreadFunctionType callback, ThreadStruct & str) const
+{
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->SetNumberOfThreads(this->m_NumberOfThreads);
+  threader->SetSingleMethod(callback, &str);
+  threader->SingleMethodExecute();
+}
+
+template< typename TInputImage, typename TOutputImage >
+bool
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::GetAccumulatorSplit(const ThreadIdType threadId, const ThreadIdType threadCount,
+                      typename AccumulatorImageType::RegionType & split) const
+{
+  ImageRegionSplitterSlowDimension::Pointer splitter = ImageRegionSplitterSlowDimension::New();
+  split = this->m_Sum->GetBufferedRegion();
+  const unsigned int numberOfPieces = splitter->GetNumberOfSplits(split, threadCount);
+  if( threadId >= numberOfPieces )
+    {
+    return false;
+    }
+  splitter->GetSplit(threadId, numberOfPieces, split);
+  return true;
+}
+
+template< typename TInputImage, typename TOutputImage >
+ITK_THREAD_RETURN_TYPE
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::AddImageThreaderCallback(void *arg)
+{
+  typedef MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType *    threadInfo = static_cast<ThreadInfoType *>( arg );
+  const ThreadStruct *str = static_cast<const ThreadStruct *>( threadInfo->UserData );
+
+  typename AccumulatorImageType::RegionType split;
+  if( !str->Accumulator->GetAccumulatorSplit(threadInfo->ThreadID, threadInfo->NumberOfThreads, split) )
+    {
+    return ITK_THREAD_RETURN_VALUE;
+    }
+
+  ImageRegionConstIterator<InputImageType>  in(str->Image, split);
+  ImageRegionIterator<AccumulatorImageType> sum(str->Accumulator->m_Sum, split);
+  ImageRegionIterator<AccumulatorImageType> compensation(str->Accumulator->m_Compensation, split);
+  for( ; !in.IsAtEnd(); ++in, ++sum, ++compensation )
+    {
+    // Kahan summation, as in AverageImageFilter
+    const RealPixelType y = static_cast<RealPixelType>( in.Get() ) - compensation.Get();
+    const RealPixelType t = sum.Get() + y;
+    compensation.Set( ( t - sum.Get() ) - y );
+    sum.Set( t );
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template< typename TInputImage, typename TOutputImage >
+ITK_THREAD_RETURN_TYPE
+RunningAverageImageAccumulator< TInputImage, TOutputImage >
+::GetAverageThreaderCallback(void *arg)
+{
+  typedef MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType *    threadInfo = static_cast<ThreadInfoType *>( arg );
+  const ThreadStruct *str = static_cast<const ThreadStruct *>( threadInfo->UserData );
+
+  typename AccumulatorImageType::RegionType split;
+  if( !str->Accumulator->GetAccumulatorSplit(threadInfo->ThreadID, threadInfo->NumberOfThreads, split) )
+    {
+    return ITK_THREAD_RETURN_VALUE;
+    }
+
+  const double scale = 1.0 / str->Accumulator->m_NumberOfImages;
+  ImageRegionConstIterator<AccumulatorImageType> sum(str->Accumulator->m_Sum, split);
+  ImageRegionIterator<OutputImageType>           out(str->Output, split);
+  for( ; !sum.IsAtEnd(); ++sum, ++out )
+    {
+    RealPixelType average = sum.Get();
+    average *= scale;
+    out.Set( (OutputPixelType) average );
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,98 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/**
+ * Benchmarks of the BRAINSConstellationDetector kernels: the Hough eye
+ * detector voting and the exhaustive reflective correlation search of the
+ * mid-sagittal plane, on the phantom whose two eyes are 12 mm spheres.
+ */
+#include "BRAINSBenchmark.h"
+#include "itkHoughTransformRadialVotingImageFilter.h"
+#include "itkReflectiveCorrelationCenterToImageMetric.h"
+#include "landmarksConstellationCommon.h"
+
+namespace
+{
+BRAINSBenchmark::Kernel HoughEyeVotingKernel(const unsigned int size)
+{
+  typedef itk::Image<double, 3>                                                  AccumulatorImageType;
+  typedef itk::HoughTransformRadialVotingImageFilter<SImageType, AccumulatorImageType> HoughFilterType;
+
+  const SImageType::Pointer image = BRAINSBenchmark::CreatePhantomImage<SImageType>(size, 1, 21);
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  kernel.Run = [image]()
+    {
+      // Parameters of BRAINSHoughEyeDetector and HoughFilterTestProgram.
+      HoughFilterType::Pointer houghFilter = HoughFilterType::New();
+      houghFilter->SetInput(image);
+      houghFilter->SetNumberOfSpheres(2);
+      houghFilter->SetMinimumRadius(11.);
+      houghFilter->SetMaximumRadius(13.);
+      houghFilter->SetSigmaGradient(1.);
+      houghFilter->SetVariance(1.);
+      houghFilter->SetSphereRadiusRatio(1.);
+      houghFilter->SetVotingRadiusRatio(.5);
+      houghFilter->SetThreshold(10.);
+      houghFilter->SetOutputThreshold(.8);
+      houghFilter->SetGradientThreshold(0.);
+      houghFilter->SetNbOfThreads(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() );
+      houghFilter->SetSamplingRatio(.2);
+      houghFilter->SetHoughEyeDetectorMode(1);
+      houghFilter->Update();
+    };
+  return kernel;
+}
+
+BRAINSBenchmark::Kernel ReflectiveCorrelationKernel(const unsigned int size)
+{
+  typedef Rigid3DCenterReflectorFunctor<itk::PowellOptimizerv4<double> > ReflectionFunctorType;
+
+  SImageType::Pointer image = BRAINSBenchmark::CreatePhantomImage<SImageType>(size, 0, 22);
+
+  SImageType::PointType centerOfHeadMass;
+  centerOfHeadMass.Fill(0.0);
+
+  const ReflectionFunctorType::Pointer reflectionFunctor = ReflectionFunctorType::New();
+  reflectionFunctor->SetCenterOfHeadMass(centerOfHeadMass);
+  reflectionFunctor->InitializeImage(image);
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  kernel.Run = [reflectionFunctor]()
+    {
+      reflectionFunctor->Initialize();
+    };
+  return kernel;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  BRAINSBenchmark::BenchmarkRunner runner("BRAINSConstellationDetector", argc, argv);
+
+  std::vector<unsigned int> imageSizes;
+  imageSizes.push_back(64);
+  imageSizes.push_back(128);
+  imageSizes.push_back(192);
+
+  runner.Add("HoughEyeVoting", imageSizes, HoughEyeVotingKernel);
+  runner.Add("ReflectiveCorrelationSearch", imageSizes, ReflectiveCorrelationKernel);
+  return runner.Execute();
+}
@@ -19,6 +19,7 @@
 /*
  */
 #include "BRAINSConstellationDetectorPrimary.h"
+#include "BRAINSTrace.h"
 
 BRAINSConstellationDetectorPrimary::BRAINSConstellationDetectorPrimary()
 {
@@ -75,6 +76,7 @@ BRAINSConstellationDetectorPrimary::BRAINSConstellationDetectorPrimary()
 bool BRAINSConstellationDetectorPrimary::Compute( void )
 {
   const BRAINSUtils::StackPushITKDefaultNumberOfThreads TempDefaultNumberOfThreadsHolder(this->m_numberOfThreads);
+  BRAINS_TRACE_SCOPE("BRAINSConstellationDetector");
 
   // ------------------------------------
   // Read external files
@@ -167,7 +169,10 @@ bool BRAINSConstellationDetectorPrimary::Compute( void )
   findCenterFilter->SetClosingSize( 7 );
   findCenterFilter->SetHeadSizeLimit( 700 );
   findCenterFilter->SetBackgroundValue( 0 );
-  findCenterFilter->Update();
+    {
+    BRAINS_TRACE_SCOPE("BRAINSConstellationDetector::FindCenterOfHead");
+    findCenterFilter->Update();
+    }
   ImagePointType centerOfHeadMass = findCenterFilter->GetCenterOfBrain();
 
   // ------------------------------------
@@ -196,6 +201,7 @@ bool BRAINSConstellationDetectorPrimary::Compute( void )
     houghEyeDetector->SetCenterOfHeadMass( centerOfHeadMass );
     try
       {
+      BRAINS_TRACE_SCOPE("BRAINSConstellationDetector::HoughEyeDetector");
       houghEyeDetector->Update();
       }
     catch( itk::ExceptionObject & excep )
@@ -279,7 +285,10 @@ bool BRAINSConstellationDetectorPrimary::Compute( void )
   constellation2->SetatlasVolume( this->m_atlasVolume );
   constellation2->SetatlasLandmarks( this->m_atlasLandmarks );
   constellation2->SetatlasLandmarkWeights( this->m_atlasLandmarkWeights );
-  constellation2->Update();
+    {
+    BRAINS_TRACE_SCOPE("BRAINSConstellationDetector::LandmarkDetection");
+    constellation2->Update();
+    }
 
 
   // Save landmarks in input/output or original/aligned space
@@ -34,6 +34,7 @@
 #include "itkStatisticsImageFilter.h"
 #include "itkNumberToString.h"
 #include "itkCompensatedSummation.h"
+#include "itkMultiThreaderBase.h"
 
 // Optimize the A,B,C vector
 template<typename TOptimizerType>
@@ -56,6 +57,10 @@ public:
   typedef typename OptimizerType::Pointer       OptimizerPointer;
   typedef itk::CompensatedSummation< double >   CompensatedSummationType;
 
+  typedef itk::Matrix<double, SpaceDimension, SpaceDimension>  IndexMatrixType;
+  typedef itk::Vector<double, SpaceDimension>                  IndexOffsetType;
+  typedef LinearInterpolatorType::ContinuousIndexType          ContinuousIndexType;
+
   Rigid3DCenterReflectorFunctor() :
   m_params(),
   m_OriginalImage(nullptr),
@@ -217,40 +222,51 @@ public:
   {
   // starting parameters are optimal parameters from previous level
   const ParametersType starting_params (opt_params);
-  // new search parameters
-  ParametersType current_params;
-  current_params.set_size(SpaceDimension);
 #ifdef WRITE_CSV_FILE
   std::stringstream csvFileOfMetricValues;
 #endif
   const double degree_to_rad = vnl_math::pi / 180.0;
 
+  // Enumerate the whole search grid first so that the candidates can be
+  // evaluated concurrently.  The selection below walks the candidates in
+  // the original LR/HA/BA order, so the chosen optimum does not depend on
+  // the number of threads.
+  std::vector<ParametersType> candidate_params;
   for( double LR = -LRRange; LR <= LRRange; LR += LRStepSize)
     {
     for( double HA = -HARange; HA <= HARange; HA += HAStepSize )
       {
       for( double BA = -BARange; BA <= BARange; BA += BAStepSize )
         {
+        ParametersType current_params;
+        current_params.set_size(SpaceDimension);
         current_params[0] = starting_params[0]+HA * degree_to_rad;
         current_params[1] = starting_params[1]+BA * degree_to_rad;
         current_params[2] = starting_params[2]+LR;
+        candidate_params.push_back(current_params);
+        }
+      }
+    }
 
-        const double current_cc = this->f(current_params);
-        if( current_cc < opt_cc )
-          {
-          opt_params = current_params;
-          opt_cc = current_cc;
-          }
+  std::vector<double> candidate_cc;
+  this->EvaluateCandidates(candidate_params, candidate_cc);
+
+  for( size_t i = 0; i < candidate_params.size(); ++i )
+    {
+    const double current_cc = candidate_cc[i];
+    if( current_cc < opt_cc )
+      {
+      opt_params = candidate_params[i];
+      opt_cc = current_cc;
+      }
 
 #ifdef WRITE_CSV_FILE
-        csvFileOfMetricValues << current_params[0]/degree_to_rad
-                              << "," << current_params[1]/degree_to_rad
-                              << "," << current_params[2]
-                              << "," << current_cc
-                              << std::endl;
+    csvFileOfMetricValues << candidate_params[i][0]/degree_to_rad
+                          << "," << candidate_params[i][1]/degree_to_rad
+                          << "," << candidate_params[i][2]
+                          << "," << current_cc
+                          << std::endl;
 #endif
-        }
-      }
     }
 #ifdef WRITE_CSV_FILE
   if( CSVFileName != "" )
@@ -268,6 +284,32 @@ public:
 #endif
   }
 
+  /* -- */
+  /** Evaluate the cost function for every candidate parameter set.
+   *  The candidates are spread over the ITK threads; each evaluation only
+   *  reads shared state, so no synchronization is needed. */
+  void EvaluateCandidates(const std::vector<ParametersType> & candidates,
+                          std::vector<double> & values) const
+  {
+    values.resize( candidates.size() );
+    if( candidates.empty() )
+      {
+      return;
+      }
+
+    CandidateEvaluationStruct str;
+    str.Metric = this;
+    str.Candidates = &candidates;
+    str.Values = &values;
+
+    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+    const itk::ThreadIdType numberOfThreads = static_cast<itk::ThreadIdType>(
+      std::min( static_cast<size_t>( threader->GetNumberOfThreads() ), candidates.size() ) );
+    threader->SetNumberOfThreads( numberOfThreads );
+    threader->SetSingleMethod( Self::EvaluateCandidatesThreaderCallback, &str );
+    threader->SingleMethodExecute();
+  }
+
   double f(const ParametersType & params) const
   {
   constexpr double MaxUnpenalizedAllowedDistance = 8.0;
@@ -304,8 +346,10 @@ public:
 
   RigidTransformType::Pointer GetTransformToMSP(void) const
   {
-    // Here we try to make MSP plane as the mid slice of the output image voxel lattice
-    SImageType::Pointer image = GetResampledImageToOutputBox(this->m_params);
+    // Here we try to make MSP plane as the mid slice of the output image voxel lattice.
+    // The resampled image shares the lattice of the reference image, so its
+    // center is found without resampling.
+    SImageType::Pointer image = this->m_ResamplerReferenceImage;
     // it should be the msp location
     SImageType::PointType physCenter = GetImageCenterPhysicalPoint(image);
 
@@ -357,6 +401,7 @@ public:
   void SetDownSampledReferenceImage(SImageType::Pointer & NewImage)
   {
     this->m_OriginalImage = NewImage;
+    this->m_imInterp->SetInputImage(this->m_OriginalImage);
     // Update the output reference image for the resampler every time the OriginalImage is updated
     this->CreateResamplerReferenceImage();
   }
@@ -431,29 +476,71 @@ public:
     this->m_ResamplerReferenceImage->SetDirection(outputImageDirection);
     this->m_ResamplerReferenceImage->SetSpacing(outputImageSpacing);
     this->m_ResamplerReferenceImage->SetRegions(outputImageRegion);
-    this->m_ResamplerReferenceImage->Allocate();
+    // NOTE: Only the lattice of the reference image is used, so its buffer is never allocated.
+
+    // Precompute the parameter independent parts of the mapping from the
+    // output lattice to the continuous index space of the original image.
+    this->m_OutputBoxIndexToPhysicalPoint.Fill(0.0);
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+      this->m_OutputBoxIndexToPhysicalPoint[i][i] = outputImageSpacing[i];
+      }
+    IndexMatrixType originalIndexToPhysicalPoint;
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+        {
+        originalIndexToPhysicalPoint[i][j] = this->m_OriginalImage->GetDirection()[i][j]
+          * this->m_OriginalImage->GetSpacing()[j];
+        }
+      }
+    this->m_PhysicalPointToOriginalIndex = originalIndexToPhysicalPoint.GetInverse();
   }
 
   /* -- */
-  SImageType::Pointer GetResampledImageToOutputBox(ParametersType const & params) const
+  /** Compute the affine mapping from an index of the output box lattice to
+   *  the continuous index of the original image for the given parameters:
+   *    cindex = indexMatrix * index + indexOffset
+   *  Sampling the original image through this mapping is equivalent to
+   *  resampling it into the output box, without the intermediate image. */
+  void ComputeOutputBoxToOriginalIndexMapping(ParametersType const & params,
+                                              IndexMatrixType & indexMatrix,
+                                              IndexOffsetType & indexOffset) const
   {
-    /*
-     * Resample the image
-     */
-    ResampleFilterType::Pointer       resampleFilter = ResampleFilterType::New();
-    resampleFilter->SetInterpolator(this->m_imInterp);
-    resampleFilter->SetDefaultPixelValue(0);
-    resampleFilter->UseReferenceImageOn();
-    resampleFilter->SetReferenceImage(this->m_ResamplerReferenceImage);
-    resampleFilter->SetInput(this->m_OriginalImage);
-    resampleFilter->SetTransform( this->GetTransformFromParams(params) );
-    resampleFilter->Update();
-    return resampleFilter->GetOutput();
+    RigidTransformType::Pointer transform = this->GetTransformFromParams(params);
+
+    indexMatrix = this->m_PhysicalPointToOriginalIndex * transform->GetMatrix()
+      * this->m_OutputBoxIndexToPhysicalPoint;
+
+    const SImageType::PointType movedOutputBoxOrigin =
+      transform->TransformPoint( this->m_ResamplerReferenceImage->GetOrigin() );
+    indexOffset = this->m_PhysicalPointToOriginalIndex * ( movedOutputBoxOrigin - this->m_OriginalImage->GetOrigin() );
+  }
+
+  /* -- */
+  /** Sample the original image at a continuous index the same way the
+   *  resampler does: zero outside of the buffer, and the interpolated
+   *  value cast to the pixel type of the output box. */
+  double SampleOriginalImage(const ContinuousIndexType & cindex) const
+  {
+    if( !this->m_imInterp->IsInsideBuffer(cindex) )
+      {
+      return 0.0;
+      }
+    return static_cast<double>(
+      static_cast<SImageType::PixelType>( this->m_imInterp->EvaluateAtContinuousIndex(cindex) ) );
   }
 
   double CenterImageReflection_crossCorrelation(ParametersType const & params) const
   {
-    SImageType::Pointer  internalResampledForReflectiveComputationImage = GetResampledImageToOutputBox(params);
+    /*
+     * Sample the two mirrored points directly from the original image.
+     * This visits the same points, in the same order, as iterating over the
+     * left half of the image resampled into the output box.
+     */
+    IndexMatrixType indexMatrix;
+    IndexOffsetType indexOffset;
+    this->ComputeOutputBoxToOriginalIndexMapping(params, indexMatrix, indexOffset);
 
     /*
      * Compute the reflective correlation
@@ -464,14 +551,9 @@ public:
     double               sumVoxelValuesReflected = 0.0F;
     double               sumSquaredVoxelValuesReflected = 0.0F;
     int                  N = 0;
-    SImageType::SizeType rasterResampleSize = internalResampledForReflectiveComputationImage->GetLargestPossibleRegion().GetSize();
+    const SImageType::SizeType rasterResampleSize = this->m_ResamplerReferenceImage->GetLargestPossibleRegion().GetSize();
     const SImageType::SizeType::SizeValueType xMaxIndexResampleSize = rasterResampleSize[0] - 1;
-    rasterResampleSize[0] /= 2; // Only need to do 1/2 in the x direction;
-    SImageType::RegionType rasterRegion;
-    rasterRegion.SetSize(rasterResampleSize);
-    rasterRegion.SetIndex( internalResampledForReflectiveComputationImage->GetLargestPossibleRegion().GetIndex() );
-    itk::ImageRegionConstIteratorWithIndex<SImageType> halfIt(internalResampledForReflectiveComputationImage,
-                                                              rasterRegion);
+    const SImageType::SizeType::SizeValueType xHalfResampleSize = rasterResampleSize[0] / 2; // Only need to do 1/2 in the x direction;
 
     CompensatedSummationType  CS_sumVoxelValuesQR;
     CompensatedSummationType  CS_sumSquaredVoxelValuesReflected;
@@ -479,28 +561,47 @@ public:
     CompensatedSummationType  CS_sumSquaredVoxelValues;
     CompensatedSummationType  CS_sumVoxelValues;
 
-    for( halfIt.GoToBegin(); !halfIt.IsAtEnd(); ++halfIt )
+    ContinuousIndexType rowStart;
+    ContinuousIndexType cindex;
+    for( SImageType::SizeType::SizeValueType z = 0; z < rasterResampleSize[2]; ++z )
       {
-      // NOTE:  Only need to compute left half of space because of reflection.
-      const double _f = halfIt.Get();
-      if( _f < this->m_BackgroundValue )  // don't worry about background
-                                          // voxels.
+      for( SImageType::SizeType::SizeValueType y = 0; y < rasterResampleSize[1]; ++y )
         {
-        continue;
-        }
-      SImageType::IndexType ReflectedIndex = halfIt.GetIndex();
-      ReflectedIndex[0] = xMaxIndexResampleSize - ReflectedIndex[0];
-      const double g = internalResampledForReflectiveComputationImage->GetPixel(ReflectedIndex);
-      if( g < this->m_BackgroundValue )  // don't worry about background voxels.
-        {
-        continue;
+        for( unsigned int d = 0; d < SpaceDimension; ++d )
+          {
+          rowStart[d] = indexOffset[d] + indexMatrix[d][1] * y + indexMatrix[d][2] * z;
+          }
+        for( SImageType::SizeType::SizeValueType x = 0; x < xHalfResampleSize; ++x )
+          {
+          // NOTE:  Only need to compute left half of space because of reflection.
+          for( unsigned int d = 0; d < SpaceDimension; ++d )
+            {
+            cindex[d] = rowStart[d] + indexMatrix[d][0] * x;
+            }
+          const double _f = this->SampleOriginalImage(cindex);
+          if( _f < this->m_BackgroundValue )  // don't worry about background
+                                              // voxels.
+            {
+            continue;
+            }
+          const SImageType::SizeType::SizeValueType reflectedX = xMaxIndexResampleSize - x;
+          for( unsigned int d = 0; d < SpaceDimension; ++d )
+            {
+            cindex[d] = rowStart[d] + indexMatrix[d][0] * reflectedX;
+            }
+          const double g = this->SampleOriginalImage(cindex);
+          if( g < this->m_BackgroundValue )  // don't worry about background voxels.
+            {
+            continue;
+            }
+          CS_sumVoxelValuesQR += _f * g;
+          CS_sumSquaredVoxelValuesReflected += g * g;
+          CS_sumVoxelValuesReflected += g;
+          CS_sumSquaredVoxelValues += _f * _f;
+          CS_sumVoxelValues += _f;
+          N++;
+          }
         }
-      CS_sumVoxelValuesQR += _f * g;
-      CS_sumSquaredVoxelValuesReflected += g * g;
-      CS_sumVoxelValuesReflected += g;
-      CS_sumSquaredVoxelValues += _f * _f;
-      CS_sumVoxelValues += _f;
-      N++;
       }
     sumVoxelValuesQR = CS_sumVoxelValuesQR.GetSum();
     sumSquaredVoxelValuesReflected = CS_sumSquaredVoxelValuesReflected.GetSum();
@@ -595,7 +696,27 @@ private:
     return this->m_CenterOfHeadMass;
   }
 
-  typedef itk::ResampleImageFilter<SImageType, SImageType> ResampleFilterType;
+  struct CandidateEvaluationStruct
+    {
+    const Self *                        Metric;
+    const std::vector<ParametersType> * Candidates;
+    std::vector<double> *               Values;
+    };
+
+  static ITK_THREAD_RETURN_TYPE EvaluateCandidatesThreaderCallback(void *arg)
+  {
+    typedef itk::MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+    ThreadInfoType * threadInfo = static_cast<ThreadInfoType *>( arg );
+    const itk::ThreadIdType threadId = threadInfo->ThreadID;
+    const itk::ThreadIdType threadCount = threadInfo->NumberOfThreads;
+    CandidateEvaluationStruct * str = static_cast<CandidateEvaluationStruct *>( threadInfo->UserData );
+
+    for( size_t i = threadId; i < str->Candidates->size(); i += threadCount )
+      {
+      ( *str->Values )[i] = str->Metric->f( ( *str->Candidates )[i] );
+      }
+    return ITK_THREAD_RETURN_VALUE;
+  }
 
   ParametersType                    m_params;
   SImageType::Pointer               m_OriginalImage;
@@ -608,6 +729,8 @@ private:
   LinearInterpolatorType::Pointer   m_imInterp;
   double                            m_cc;
   bool                              m_HasLocalSupport;
+  IndexMatrixType                   m_OutputBoxIndexToPhysicalPoint;
+  IndexMatrixType                   m_PhysicalPointToOriginalIndex;
 };
 
 #ifndef ITK_MANUAL_INSTANTIATION
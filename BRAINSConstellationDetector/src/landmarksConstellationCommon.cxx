@@ -23,6 +23,7 @@
  */
 
 #include "itkIO.h"
+#include "BRAINSTrace.h"
 #include <itkImageMomentsCalculator.h>
 #include "itkRecursiveGaussianImageFilter.h"
 
@@ -95,6 +96,7 @@ void ComputeMSP(SImageType::Pointer image,
                 const int qualityLevel,
                 double & cc)
 {
+  BRAINS_TRACE_SCOPE("BRAINSConstellationDetector::ComputeMSP");
   if( qualityLevel == -1 )  // Assume image was pre-aligned outside of the
                             // program
     {
@@ -25,6 +25,7 @@
 #include "landmarksConstellationDetector.h"
 // landmarkIO has to be included after landmarksConstellationDetector
 #include "landmarkIO.h"
+#include "BRAINSTrace.h"
 #include "itkOrthogonalize3DRotationMatrix.h"
 
 #include "itkFindCenterOfBrainFilter.h"
@@ -81,6 +82,7 @@ landmarksConstellationDetector::ComputeACPCAlignedZeroCenteredTransform(void)
 void
 landmarksConstellationDetector::ComputeFinalRefinedACPCAlignedTransform(void)
 {
+  BRAINS_TRACE_SCOPE("BRAINSConstellationDetector::RefineACPCAlignment");
   ////////////////////////////
   // START BRAINSFit alternative
   if( ! this->m_atlasVolume.empty() )
@@ -23,7 +23,7 @@
 #include "itkVersorRigid3DTransform.h"
 #include "itkTransformFactory.h"
 
-#include "BRAINSThreadControl.h"
+#include "BRAINSThreadBudget.h"
 #include "BRAINSCutGenerateProbability.h"
 #include "BRAINSCutCreateVector.h"
 #include "BRAINSCutVectorTrainingSet.h"
@@ -37,6 +37,8 @@ int main(int argc, char * *argv)
 {
   PARSE_ARGS;
   BRAINSRegisterAlternateIO();
+  // One budget for the ITK filters, the TBB loops and OpenCV ML training
+  BRAINSUtils::ThreadBudget threadBudget(numberOfThreads);
 
   if( !netConfiguration.empty() && modelConfigurationFilename.empty() )
     {
@@ -52,7 +54,8 @@ int main(int argc, char * *argv)
     }
   BRAINSCutDataHandler m_dataHandler( modelConfigurationFilename );
 
-  BRAINSCutGenerateRegistrations m_registrationGenerator( m_dataHandler );
+  BRAINSCutGenerateRegistrations m_registrationGenerator( m_dataHandler, threadBudget );
+  m_registrationGenerator.SetNumberOfConcurrentRegistrations( std::max( numberOfConcurrentRegistrations, 1 ) );
   const bool                     m_applyDataSetOff = false;
   const bool                     m_shuffleTrainVector = (NoTrainingVectorShuffling != true );
 
@@ -65,7 +68,17 @@ int main(int argc, char * *argv)
     m_registrationGenerator.GenerateRegistrations();
 
     BRAINSCutGenerateProbability m_probabilityMapGenerator( m_dataHandler );
-    m_probabilityMapGenerator.GenerateProbabilityMaps();
+    threadBudget.Execute( [&]()
+      {
+      if( generateProbabilityBySubject )
+        {
+        m_probabilityMapGenerator.GenerateProbabilityMapsBySubject();
+        }
+      else
+        {
+        m_probabilityMapGenerator.GenerateProbabilityMaps();
+        }
+      } );
     }
   if( createVectors )
     {
@@ -17,6 +17,7 @@
  *
  *=========================================================================*/
 #include "BRAINSCutApplyModel.h"
+#include "BRAINSTrace.h"
 #include "BRAINSCutUtilities.h"
 #include "FeatureInputVector.h"
 #include "TrainingPrameters.h"
@@ -136,6 +137,7 @@ void
 BRAINSCutApplyModel
 ::Apply()
 {
+  BRAINS_TRACE_SCOPE("BRAINSCut::ApplyModel");
   if( m_method ==  "ANN" )
     {
     this->m_myDataHandler->SetANNTestingSSEFilename();
@@ -17,6 +17,7 @@
  *
  *=========================================================================*/
 #include "BRAINSCutCreateVector.h"
+#include "BRAINSTrace.h"
 
 BRAINSCutCreateVector
 ::BRAINSCutCreateVector( BRAINSCutDataHandler dataHandler ) :
@@ -37,6 +38,7 @@ void
 BRAINSCutCreateVector
 ::CreateVectors()
 {
+  BRAINS_TRACE_SCOPE("BRAINSCut::CreateVectors");
   typedef BRAINSCutConfiguration::TrainDataSetListType::iterator
     TrainSubjectIteratorType;
 
@@ -17,11 +17,24 @@
  *
  *=========================================================================*/
 #include "BRAINSCutGenerateProbability.h"
+#include "BRAINSTrace.h"
 #include "XMLConfigurationFileParser.h"
 #include "BRAINSCutConfiguration.h"
 #include "BRAINSCutDataHandler.h"
 
 #include "itkIO.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/mutex.h"
+
+namespace
+{
+/** HDF5 transform IO is not thread safe, so registration files are read one at a time. */
+tbb::mutex registrationReadMutex;
+}
 
 /** constructors */
 BRAINSCutGenerateProbability
@@ -73,6 +86,7 @@ void
 BRAINSCutGenerateProbability
 ::GenerateProbabilityMaps()
 {
+  BRAINS_TRACE_SCOPE("BRAINSCut::GenerateProbabilityMaps");
   /** generating spherical coordinate image does not have to be here */
   GenerateSymmetricalSphericalCoordinateImage();
   /** iterate through the rois*/
@@ -110,36 +124,218 @@ BRAINSCutGenerateProbability
         AddImageToAccumulator( currentDeformedROI, currentAccumulatedImages );
       } /** end of iteration for subject */
 
-    /** average the accumulator based on the counts */
-    WorkingImagePointer currentProbabilityImage =
-      ImageMultiplyConstant<WorkingImageType>( currentAccumulatedImages,
-                                               1.0F / static_cast<float>( currentROISubjectsCounter ) );
+    WriteProbabilityMap( currentROIID, currentAccumulatedImages, currentROISubjectsCounter );
+    } /** end of iteration for roi */
+}
+
+void
+BRAINSCutGenerateProbability
+::GenerateProbabilityMapsBySubject()
+{
+  BRAINS_TRACE_SCOPE("BRAINSCut::GenerateProbabilityMapsBySubject");
+  /** generating spherical coordinate image does not have to be here */
+  GenerateSymmetricalSphericalCoordinateImage();
 
-    /** get roi object */
+  const WorkingImageType::Pointer atlasImage = myDataHandler->GetAtlasImage();
+  const size_t                    numberOfVoxels = atlasImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  const unsigned int              roiCount = myDataHandler->GetROICount();
+  const DataSet::StringVectorType roiIDsInOrder = myDataHandler->GetROIIDsInOrder();
+
+  /** collect all filenames up front, so the workers do not touch the configuration */
+  std::vector<std::string>              registrationFilenames;
+  std::vector<std::vector<std::string> > roiFilenames;
+  for( std::list<DataSet *>::iterator currentSubjectIt = trainingDataSetList.begin();
+       currentSubjectIt != trainingDataSetList.end();
+       ++currentSubjectIt )
+    {
+    registrationFilenames.push_back( myDataHandler->GetSubjectToAtlasRegistrationFilename( *(*currentSubjectIt) ) );
 
-    ProbabilityMapParser *currentROISet =
-      myDataHandler->GetROIDataList()->GetMatching<ProbabilityMapParser>(
-        "StructureID", currentROIID.c_str() );
-    /** smooth the accumulated image */
-    float               GaussianSigma = currentROISet->GetAttribute<FloatValue>("Gaussian");
-    WorkingImagePointer currentSmoothProbabilityImage = SmoothImage( currentProbabilityImage, GaussianSigma );
+    std::vector<std::string> currentROIFilenames;
+    for( unsigned int currentROIAt = 0; currentROIAt < roiCount; ++currentROIAt )
+      {
+      currentROIFilenames.push_back( ( *currentSubjectIt )->GetMaskFilenameByType( roiIDsInOrder[currentROIAt] ) );
+      }
+    roiFilenames.push_back( currentROIFilenames );
+    }
+  const unsigned int numberOfSubjects = static_cast<unsigned int>( registrationFilenames.size() );
 
-    /** get filename */
-    std::string currentProbabilityMapFilename( currentROISet->GetAttribute<StringValue>("Filename") );
+  /** one count image per roi shared by all subjects, so the memory does not grow with the thread count */
+  std::vector<ROICountVectorType> roiCounts( roiCount );
+  for( unsigned int currentROIAt = 0; currentROIAt < roiCount; ++currentROIAt )
+    {
+    roiCounts[currentROIAt].reset( new ROICountType[numberOfVoxels]() );
+    }
 
-    /** check the directory */
-    std::string path = itksys::SystemTools::GetFilenamePath( currentProbabilityMapFilename );
-    if( !itksys::SystemTools::FileExists( path.c_str(), false ) )
+  tbb::parallel_for( tbb::blocked_range<unsigned int>( 0, numberOfSubjects, 1 ),
+                     [&]( const tbb::blocked_range<unsigned int> & r )
+                       {
+                       for( unsigned int currentSubjectAt = r.begin(); currentSubjectAt < r.end(); ++currentSubjectAt )
+                         {
+                         /** evaluate the registration once on the atlas grid */
+                         MappedPointVectorType atlasToSubjectPoints;
+                         ComputeAtlasToSubjectMapping( registrationFilenames[currentSubjectAt],
+                                                       atlasImage, atlasToSubjectPoints );
+                         /** deform every ROI of this subject to atlas through that mapping */
+                         for( unsigned int currentROIAt = 0; currentROIAt < roiCount; ++currentROIAt )
+                           {
+                           AccumulateWarpedROI( roiFilenames[currentSubjectAt][currentROIAt],
+                                                atlasToSubjectPoints, roiCounts[currentROIAt].get() );
+                           }
+                         }
+                       } );
+
+  for( unsigned int currentROIAt = 0; currentROIAt < roiCount; ++currentROIAt )
+    {
+    WorkingImageType::Pointer currentAccumulatedImages;
+    CreateNewFloatImageFromTemplate( currentAccumulatedImages, atlasImage );
+    WorkingPixelType *   accumulatedBuffer = currentAccumulatedImages->GetBufferPointer();
+    const ROICountType * currentROICounts = roiCounts[currentROIAt].get();
+    for( size_t i = 0; i < numberOfVoxels; ++i )
       {
-      std::cout << " Probability map directory does not exist. Create as following:: "
-                << path.c_str()
-                << std::endl;
-      itksys::SystemTools::MakeDirectory( path.c_str() );
+      accumulatedBuffer[i] = static_cast<WorkingPixelType>( currentROICounts[i].load( std::memory_order_relaxed ) );
       }
+    roiCounts[currentROIAt].reset();
+    WriteProbabilityMap( roiIDsInOrder[currentROIAt], currentAccumulatedImages, numberOfSubjects );
+    }
+}
 
-    /** write image */
-    itkUtil::WriteImage<WorkingImageType>( currentSmoothProbabilityImage, currentProbabilityMapFilename );
-    } /** end of iteration for roi */
+BRAINSCutGenerateProbability::GenericTransformType::Pointer
+BRAINSCutGenerateProbability
+::ReadRegistrationTransform( const std::string & RegistrationFilename )
+{
+  const bool useTransform = ( RegistrationFilename.find(".mat") != std::string::npos ||
+                              RegistrationFilename.find(".h5") != std::string::npos ||
+                              RegistrationFilename.find(".hdf5") != std::string::npos ||
+                              RegistrationFilename.find(".txt") != std::string::npos
+                              );
+
+  tbb::mutex::scoped_lock lock( registrationReadMutex );
+  // An empty SmartPointer constructor sets up someTransform.IsNull() to
+  // represent a not-supplied state:
+  GenericTransformType::Pointer genericTransform;
+  // if there is no *mat file.
+  //
+  // HACK ALERT HACK ALERT
+  // The GenericTransformImage function would apply either a
+  // 'generic' transform or a DisplacementField transform. If both
+  // were non-null, the DisplacementField took precedence. To get
+  // the same behavior with the DisplacementField parameter removed
+  // you have to enforce this 'OR NOT AND' behavior at the point of
+  // call
+  if( !useTransform )  // that is, it's a warp by deformation field:
+    {
+    typedef itk::Vector<double, 3>                LocalVectorPixelType;
+    typedef itk::Image<LocalVectorPixelType,  3> LocalDisplacementFieldType;
+    typedef itk::ImageFileReader<LocalDisplacementFieldType> DefFieldReaderType;
+    DefFieldReaderType::Pointer fieldImageReader = DefFieldReaderType::New();
+    fieldImageReader->SetFileName(RegistrationFilename);
+    fieldImageReader->Update();
+    LocalDisplacementFieldType::Pointer DisplacementField = fieldImageReader->GetOutput();
+
+    typedef itk::DisplacementFieldTransform<DeformationScalarType,LocalDisplacementFieldType::ImageDimension>
+      DisplacementFieldTransformType;
+    DisplacementFieldTransformType::Pointer dispXfrm =
+      DisplacementFieldTransformType::New();
+    dispXfrm->SetDisplacementField(DisplacementField.GetPointer());
+    genericTransform = dispXfrm.GetPointer();
+    }
+  else // there EXIST *mat file.
+    {
+    std::cout << "!!!!!!!!!!!! CAUTION !!!!!!!!!!!!!!!!!!!" << std::endl
+              << "* Mat file exists!" << std::endl
+              << "!!!!!!!!!!!! CAUTION !!!!!!!!!!!!!!!!!!!" << std::endl;
+    genericTransform = itk::ReadTransformFromDisk(RegistrationFilename);
+    }
+  return genericTransform;
+}
+
+void
+BRAINSCutGenerateProbability
+::ComputeAtlasToSubjectMapping( const std::string & RegistrationFilename,
+                                const WorkingImageType::Pointer & atlasImage,
+                                MappedPointVectorType & mappedPoints )
+{
+  GenericTransformType::Pointer genericTransform = ReadRegistrationTransform( RegistrationFilename );
+
+  mappedPoints.resize( atlasImage->GetLargestPossibleRegion().GetNumberOfPixels() );
+
+  /** the same points the resampler would visit, in buffer order */
+  itk::ImageRegionConstIteratorWithIndex<WorkingImageType> it( atlasImage, atlasImage->GetLargestPossibleRegion() );
+  GenericTransformType::InputPointType atlasPoint;
+  size_t                               i = 0;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it, ++i )
+    {
+    atlasImage->TransformIndexToPhysicalPoint( it.GetIndex(), atlasPoint );
+    mappedPoints[i] = genericTransform->TransformPoint( atlasPoint );
+    }
+}
+
+void
+BRAINSCutGenerateProbability
+::AccumulateWarpedROI( const std::string & ROIFilename,
+                       const MappedPointVectorType & mappedPoints,
+                       ROICountType * roiCounts )
+{
+  typedef itk::ImageFileReader<WorkingImageType> ReaderType;
+  ReaderType::Pointer imageReader = ReaderType::New();
+  imageReader->SetFileName( ROIFilename );
+  imageReader->Update();
+  WorkingImageType::Pointer roiImage = imageReader->GetOutput();
+
+  typedef itk::LinearInterpolateImageFunction<WorkingImageType, double> InterpolatorType;
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage( roiImage );
+
+  /** linear interpolation with zero outside, followed by the 0.1 threshold of AddImageToAccumulator */
+  constexpr WorkingPixelType           lowerThreshold = 0.1F;
+  InterpolatorType::ContinuousIndexType subjectIndex;
+  for( size_t i = 0; i < mappedPoints.size(); ++i )
+    {
+    roiImage->TransformPhysicalPointToContinuousIndex( mappedPoints[i], subjectIndex );
+    if( interpolator->IsInsideBuffer( subjectIndex )
+        && static_cast<WorkingPixelType>( interpolator->EvaluateAtContinuousIndex( subjectIndex ) ) >= lowerThreshold )
+      {
+      /** counts are integers, so the order of the subjects does not matter */
+      roiCounts[i].fetch_add( 1, std::memory_order_relaxed );
+      }
+    }
+}
+
+void
+BRAINSCutGenerateProbability
+::WriteProbabilityMap( const std::string & ROIID,
+                       WorkingImageType::Pointer & accumulatedImage,
+                       const unsigned int numberOfSubjects )
+{
+  /** average the accumulator based on the counts */
+  WorkingImagePointer currentProbabilityImage =
+    ImageMultiplyConstant<WorkingImageType>( accumulatedImage,
+                                             1.0F / static_cast<float>( numberOfSubjects ) );
+
+  /** get roi object */
+
+  ProbabilityMapParser *currentROISet =
+    myDataHandler->GetROIDataList()->GetMatching<ProbabilityMapParser>(
+      "StructureID", ROIID.c_str() );
+  /** smooth the accumulated image */
+  float               GaussianSigma = currentROISet->GetAttribute<FloatValue>("Gaussian");
+  WorkingImagePointer currentSmoothProbabilityImage = SmoothImage( currentProbabilityImage, GaussianSigma );
+
+  /** get filename */
+  std::string currentProbabilityMapFilename( currentROISet->GetAttribute<StringValue>("Filename") );
+
+  /** check the directory */
+  std::string path = itksys::SystemTools::GetFilenamePath( currentProbabilityMapFilename );
+  if( !itksys::SystemTools::FileExists( path.c_str(), false ) )
+    {
+    std::cout << " Probability map directory does not exist. Create as following:: "
+              << path.c_str()
+              << std::endl;
+    itksys::SystemTools::MakeDirectory( path.c_str() );
+    }
+
+  /** write image */
+  itkUtil::WriteImage<WorkingImageType>( currentSmoothProbabilityImage, currentProbabilityMapFilename );
 }
 
 inline WorkingImageType::IndexType::IndexValueType
@@ -24,6 +24,9 @@
 #include "itkDisplacementFieldTransform.h"
 #include <itkIO.h>
 
+#include <atomic>
+#include <memory>
+
 class BRAINSCutGenerateProbability
 {
 public:
@@ -33,12 +36,38 @@ public:
 
   void GenerateProbabilityMaps();
 
+  /** Same maps as GenerateProbabilityMaps, but iterates subjects in the outer
+   * loop: each subject's registration is read and evaluated on the atlas grid
+   * once, all of its ROIs are warped through that mapping, and subjects are
+   * processed in parallel into one shared count image per ROI. */
+  void GenerateProbabilityMapsBySubject();
+
 private:
   BRAINSCutDataHandler* myDataHandler;
 
   /** DataSets */
   std::list<DataSet *> trainingDataSetList;
 
+  typedef itk::Transform<double, 3, 3>    GenericTransformType;
+  typedef itk::Point<double, DIMENSION>   MappedPointType;
+  typedef std::vector<MappedPointType>    MappedPointVectorType;
+  typedef std::atomic<unsigned short>     ROICountType;
+  typedef std::unique_ptr<ROICountType[]> ROICountVectorType;
+
+  GenericTransformType::Pointer ReadRegistrationTransform( const std::string & RegistrationFilename );
+
+  void ComputeAtlasToSubjectMapping( const std::string & RegistrationFilename,
+                                     const WorkingImageType::Pointer & atlasImage,
+                                     MappedPointVectorType & mappedPoints );
+
+  void AccumulateWarpedROI( const std::string & ROIFilename,
+                            const MappedPointVectorType & mappedPoints,
+                            ROICountType * roiCounts );
+
+  void WriteProbabilityMap( const std::string & ROIID,
+                            WorkingImageType::Pointer & accumulatedImage,
+                            const unsigned int numberOfSubjects );
+
   void GenerateSymmetricalSphericalCoordinateImage();
 
   void CreateNewFloatImageFromTemplate( WorkingImageType::Pointer & PointerToOutputImage,
@@ -52,12 +81,6 @@ private:
                                                   const std::string & ImageName,
                                                   typename WarperImageType::Pointer ReferenceImage  )
   {
-    const bool useTransform = ( RegistrationFilename.find(".mat") != std::string::npos ||
-                                RegistrationFilename.find(".h5") != std::string::npos ||
-                                RegistrationFilename.find(".hdf5") != std::string::npos ||
-                                RegistrationFilename.find(".txt") != std::string::npos
-                                );
-
     typename WarperImageType::Pointer PrincipalOperandImage; // One name for the
                                                              // image to be
                                                              // warped.
@@ -74,51 +97,8 @@ private:
     typedef typename itk::Vector<VectorComponentType, 3> VectorPixelType;
     typedef typename itk::Image<VectorPixelType,  3>     LocalDisplacementFieldType;
 
-    // An empty SmartPointer constructor sets up someImage.IsNull() to represent
-    // a
-    // not-supplied state:
-    typename LocalDisplacementFieldType::Pointer DisplacementField;
-    // An empty SmartPointer constructor sets up someTransform.IsNull() to
-    // represent a not-supplied state:
-    typedef  itk::Transform<double, 3, 3> GenericTransformType;
-    typename GenericTransformType::Pointer genericTransform;
-    // typename WarperImageType::Pointer ReferenceImage;
-    // if there is no *mat file.
-    //
-    // HACK ALERT HACK ALERT
-    // The GenericTransformImage function would apply either a
-    // 'generic' transform or a DisplacementField transform. If both
-    // were non-null, the DisplacementField took precedence. To get
-    // the same behavior with the DisplacementField parameter removed
-    // you have to enforce this 'OR NOT AND' behavior at the point of
-    // call
-    if( !useTransform )  // that is, it's a warp by deformation field:
-      {
-      typedef typename itk::ImageFileReader<LocalDisplacementFieldType> DefFieldReaderType;
-      typename DefFieldReaderType::Pointer fieldImageReader = DefFieldReaderType::New();
-      fieldImageReader->SetFileName(RegistrationFilename);
-      fieldImageReader->Update();
-      DisplacementField = fieldImageReader->GetOutput();
-
-      // Resample deformation filed to reference image size Check that
-      // deformation
-      // field and reference image have same dimensions.
-
-      // and---  ReferenceImage.IsNull() represents the delayed default
-      typedef itk::DisplacementFieldTransform<DeformationScalarType,LocalDisplacementFieldType::ImageDimension>
-        DisplacementFieldTransformType;
-      typename DisplacementFieldTransformType::Pointer dispXfrm =
-        DisplacementFieldTransformType::New();
-      dispXfrm->SetDisplacementField(DisplacementField.GetPointer());
-      genericTransform = dispXfrm.GetPointer();
-      }
-    else // there EXIST *mat file.
-      {
-      std::cout << "!!!!!!!!!!!! CAUTION !!!!!!!!!!!!!!!!!!!" << std::endl
-                << "* Mat file exists!" << std::endl
-                << "!!!!!!!!!!!! CAUTION !!!!!!!!!!!!!!!!!!!" << std::endl;
-      genericTransform = itk::ReadTransformFromDisk(RegistrationFilename);
-      }
+    GenericTransformType::Pointer genericTransform = ReadRegistrationTransform( RegistrationFilename );
+
     constexpr double defaultValue = 0;
     const typename std::string interpolationMode = "Linear";
     const typename std::string pixelType = "short";
@@ -20,13 +20,33 @@
 
 #include "itkBRAINSROIAutoImageFilter.h"
 #include "BRAINSFitHelper.h"
+#include "BRAINSThreadControl.h"
+#include "BRAINSTrace.h"
+#include "itkTimeProbe.h"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "tbb/partitioner.h"
+#include "tbb/mutex.h"
+
+namespace
+{
+/** HDF5 transform IO is not thread safe, so concurrent registrations write their transforms one at a time. */
+tbb::mutex transformWriteMutex;
+}
 
 // ----------------------------------------------------- //
 BRAINSCutGenerateRegistrations
-::BRAINSCutGenerateRegistrations(  BRAINSCutDataHandler& dataHandler ) :
+::BRAINSCutGenerateRegistrations(  BRAINSCutDataHandler& dataHandler, BRAINSUtils::ThreadBudget& threadBudget ) :
   myDataHandler(nullptr),
+  myThreadBudget(&threadBudget),
   atlasToSubjectRegistraionOn(false),
-  subjectDataSets()
+  subjectDataSets(),
+  numberOfConcurrentRegistrations(1)
 {
   myDataHandler =  &dataHandler;
   myDataHandler->SetRegistrationParameters();
@@ -57,11 +77,22 @@ BRAINSCutGenerateRegistrations
     }
 }
 
+// ----------------------------------------------------- //
+void
+BRAINSCutGenerateRegistrations
+::SetNumberOfConcurrentRegistrations( unsigned int concurrentRegistrations )
+{
+  numberOfConcurrentRegistrations = std::max( concurrentRegistrations, 1U );
+}
+
 // ----------------------------------------------------- //
 void
 BRAINSCutGenerateRegistrations
 ::GenerateRegistrations()
 {
+  BRAINS_TRACE_SCOPE("BRAINSCut::GenerateRegistrations");
+  /** collect the registrations that are not up to date */
+  std::vector<RegistrationJob> registrationJobs;
   for( std::list<DataSet *>::iterator subjectIt = subjectDataSets.begin();
        subjectIt != subjectDataSets.end();
        ++subjectIt )
@@ -78,45 +109,181 @@ BRAINSCutGenerateRegistrations
     const std::string SubjectBinaryFilename
       ( (*subjectIt)->GetMaskFilenameByType( "RegistrationROI" ) );
 
-    if( atlasToSubjectRegistraionOn &&
-        (!itksys::SystemTools::FileExists( AtlasToSubjRegistrationFilename.c_str() ) ) )
+    RegistrationJob currentJob;
+    currentJob.SubjectID = (*subjectIt)->GetAttribute<StringValue>("Name");
+    if( atlasToSubjectRegistraionOn )
+      {
+      currentJob.MovingImageFilename = myDataHandler->GetAtlasFilename();
+      currentJob.FixedImageFilename = subjectFilename;
+      currentJob.MovingBinaryImageFilename = myDataHandler->GetAtlasBinaryFilename();
+      currentJob.FixedBinaryImageFilename = SubjectBinaryFilename;
+      currentJob.OutputRegName = AtlasToSubjRegistrationFilename;
+      }
+    else
+      {
+      currentJob.MovingImageFilename = subjectFilename;
+      currentJob.FixedImageFilename = myDataHandler->GetAtlasFilename();
+      currentJob.MovingBinaryImageFilename = SubjectBinaryFilename;
+      currentJob.FixedBinaryImageFilename = myDataHandler->GetAtlasBinaryFilename();
+      currentJob.OutputRegName = SubjectToAtlasRegistrationFilename;
+      }
+
+    if( IsRegistrationUpToDate( currentJob ) )
       {
-      // create directories
-      std::string directory = itksys::SystemTools::GetParentDirectory(
-          SubjectToAtlasRegistrationFilename.c_str() );
-
-      if( !itksys::SystemTools::FileExists( directory.c_str() ) )
-        {
-        itksys::SystemTools::MakeDirectory( directory.c_str() );
-        }
-      CreateTransformFile(  myDataHandler->GetAtlasFilename(),        // moving image
-                            subjectFilename,                          // fixed image
-                            myDataHandler->GetAtlasBinaryFilename(),  // moving ROI
-                            SubjectBinaryFilename,                    // fixed ROI
-                            AtlasToSubjRegistrationFilename,
-                            false );
+      std::cout << "Registration is up to date, skipping :: " << currentJob.OutputRegName << std::endl;
+      continue;
       }
-    else if( (!atlasToSubjectRegistraionOn) &&
-             (!itksys::SystemTools::FileExists( SubjectToAtlasRegistrationFilename.c_str() ) ) )
+
+    // create directories
+    std::string directory = itksys::SystemTools::GetParentDirectory(
+        currentJob.OutputRegName.c_str() );
+
+    if( !itksys::SystemTools::FileExists( directory.c_str() ) )
       {
-      // create directories
-      std::string directory = itksys::SystemTools::GetParentDirectory(
-          SubjectToAtlasRegistrationFilename.c_str() );
-
-      if( !itksys::SystemTools::FileExists( directory.c_str() ) )
-        {
-        itksys::SystemTools::MakeDirectory( directory.c_str() );
-        }
-      CreateTransformFile(  subjectFilename,                         // moving image
-                            myDataHandler->GetAtlasFilename(),       // fixed image
-                            SubjectBinaryFilename,                   // moving ROI
-                            myDataHandler->GetAtlasBinaryFilename(), // fixed ROI
-                            SubjectToAtlasRegistrationFilename,
-                            false );
+      itksys::SystemTools::MakeDirectory( directory.c_str() );
       }
+    registrationJobs.push_back( currentJob );
+    }
+
+  if( registrationJobs.empty() )
+    {
+    return;
+    }
+
+  /** split the thread budget among the concurrent registrations */
+  const unsigned int budgetThreads = static_cast<unsigned int>( myThreadBudget->GetNumberOfThreads() );
+  const unsigned int concurrentRegistrations =
+    std::min( std::min( numberOfConcurrentRegistrations, budgetThreads ),
+              static_cast<unsigned int>( registrationJobs.size() ) );
+  const int threadsPerRegistration =
+    std::max( static_cast<int>( budgetThreads / concurrentRegistrations ), 1 );
+  std::cout << "Running " << registrationJobs.size() << " registrations, "
+            << concurrentRegistrations << " at a time with "
+            << threadsPerRegistration << " threads each." << std::endl;
+
+  std::vector<itk::RealTimeClock::TimeStampType> registrationTimes( registrationJobs.size(), 0.0 );
+    {
+    const BRAINSUtils::StackPushITKDefaultNumberOfThreads registrationThreadsHolder( threadsPerRegistration );
+
+    /** one work item per concurrent registration, each taking the next job
+     *  until none are left, so at most concurrentRegistrations are in flight */
+    std::atomic<size_t> nextJob( 0 );
+    myThreadBudget->Execute( [&]()
+      {
+      tbb::parallel_for( tbb::blocked_range<unsigned int>( 0, concurrentRegistrations, 1 ),
+                         [&]( const tbb::blocked_range<unsigned int> & )
+                           {
+                           for( size_t jobIndex = nextJob++; jobIndex < registrationJobs.size();
+                                jobIndex = nextJob++ )
+                             {
+                             BRAINS_TRACE_SCOPE("BRAINSCut::Registration");
+                             const RegistrationJob & currentJob = registrationJobs[jobIndex];
+                             itk::TimeProbe registrationTimer;
+                             registrationTimer.Start();
+                             CreateTransformFile( currentJob.MovingImageFilename,
+                                                  currentJob.FixedImageFilename,
+                                                  currentJob.MovingBinaryImageFilename,
+                                                  currentJob.FixedBinaryImageFilename,
+                                                  currentJob.OutputRegName,
+                                                  false );
+                             WriteRegistrationInputSignature( currentJob );
+                             registrationTimer.Stop();
+                             registrationTimes[jobIndex] = registrationTimer.GetTotal();
+                             }
+                           },
+                         tbb::simple_partitioner() );
+      } );
+    }
+
+  std::cout << "Registration timings (seconds):" << std::endl;
+  for( size_t jobIndex = 0; jobIndex < registrationJobs.size(); ++jobIndex )
+    {
+    std::cout << "  " << registrationJobs[jobIndex].SubjectID
+              << " : " << registrationTimes[jobIndex]
+              << " :: " << registrationJobs[jobIndex].OutputRegName
+              << std::endl;
     }
 }
 
+// ----------------------------------------------------- //
+std::string
+BRAINSCutGenerateRegistrations
+::GetRegistrationInputSignature( const RegistrationJob & job ) const
+{
+  const std::string inputFilenames[4] = { job.MovingImageFilename,
+                                          job.FixedImageFilename,
+                                          job.MovingBinaryImageFilename,
+                                          job.FixedBinaryImageFilename };
+
+  /** one line per input: filename, size in bytes and modification time */
+  std::ostringstream signature;
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    signature << inputFilenames[i];
+    if( itksys::SystemTools::FileExists( inputFilenames[i].c_str(), true ) )
+      {
+      signature << " " << itksys::SystemTools::FileLength( inputFilenames[i] )
+                << " " << itksys::SystemTools::ModifiedTime( inputFilenames[i] );
+      }
+    signature << std::endl;
+    }
+  return signature.str();
+}
+
+// ----------------------------------------------------- //
+std::string
+BRAINSCutGenerateRegistrations
+::GetRegistrationInputSignatureFilename( const RegistrationJob & job ) const
+{
+  return job.OutputRegName + "_inputs.txt";
+}
+
+// ----------------------------------------------------- //
+bool
+BRAINSCutGenerateRegistrations
+::IsRegistrationUpToDate( const RegistrationJob & job ) const
+{
+  if( !itksys::SystemTools::FileExists( job.OutputRegName.c_str(), true ) )
+    {
+    return false;
+    }
+
+  const std::string signatureFilename = GetRegistrationInputSignatureFilename( job );
+  if( itksys::SystemTools::FileExists( signatureFilename.c_str(), true ) )
+    {
+    std::ifstream      signatureFile( signatureFilename.c_str() );
+    std::ostringstream recordedSignature;
+    recordedSignature << signatureFile.rdbuf();
+    return recordedSignature.str() == GetRegistrationInputSignature( job );
+    }
+
+  /** transforms written before the signature files existed: the output must be newer than every input */
+  const std::string inputFilenames[4] = { job.MovingImageFilename,
+                                          job.FixedImageFilename,
+                                          job.MovingBinaryImageFilename,
+                                          job.FixedBinaryImageFilename };
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    int timeComparison = 0;
+    if( itksys::SystemTools::FileExists( inputFilenames[i].c_str(), true ) &&
+        itksys::SystemTools::FileTimeCompare( job.OutputRegName, inputFilenames[i], &timeComparison ) &&
+        timeComparison < 0 )
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+// ----------------------------------------------------- //
+void
+BRAINSCutGenerateRegistrations
+::WriteRegistrationInputSignature( const RegistrationJob & job ) const
+{
+  std::ofstream signatureFile( GetRegistrationInputSignatureFilename( job ).c_str() );
+  signatureFile << GetRegistrationInputSignature( job );
+}
+
 void
 BRAINSCutGenerateRegistrations
 ::CreateTransformFile(const std::string & MovingImageFilename,
@@ -304,8 +471,11 @@ BRAINSCutGenerateRegistrations
               << " :: " << OutputRegName
               << std::endl;
     }
-  itk::WriteTransformToDisk<double>( BSplineRegistrationHelper->GetCurrentGenericTransform(),
-                        OutputRegName );
+    {
+    tbb::mutex::scoped_lock lock( transformWriteMutex );
+    itk::WriteTransformToDisk<double>( BSplineRegistrationHelper->GetCurrentGenericTransform(),
+                          OutputRegName );
+    }
   // Write out Transformed Output As Well
   // - EX. from GenericTransformImage.hxx
 
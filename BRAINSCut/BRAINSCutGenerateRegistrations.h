@@ -20,6 +20,7 @@
 #define BRAINSCutGenerateRegistrations_h
 
 #include "BRAINSCutDataHandler.h"
+#include "BRAINSThreadBudget.h"
 
 typedef itk::Image<unsigned char, DIMENSION> BinaryImageType;
 typedef BinaryImageType::Pointer             BinaryImagePointer;
@@ -27,21 +28,48 @@ typedef BinaryImageType::Pointer             BinaryImagePointer;
 class BRAINSCutGenerateRegistrations
 {
 public:
-  BRAINSCutGenerateRegistrations( BRAINSCutDataHandler& dataHandler );
+  /** The registrations run in the TBB arena of threadBudget and share its threads */
+  BRAINSCutGenerateRegistrations( BRAINSCutDataHandler& dataHandler, BRAINSUtils::ThreadBudget& threadBudget );
 
   void SetAtlasToSubjectRegistrationOn(bool atalsToSubjectRegistration );
 
   void SetDataSet( bool applyDataSet );
 
+  /** Number of subject registrations run at the same time, at most the
+   * number of threads of the budget. The ITK thread budget is split evenly
+   * among them. Default is 1 (one at a time). */
+  void SetNumberOfConcurrentRegistrations( unsigned int concurrentRegistrations );
+
   void GenerateRegistrations();
 
 private:
-  BRAINSCutDataHandler* myDataHandler;
-  bool                  atlasToSubjectRegistraionOn;
-  std::list<DataSet *>  subjectDataSets;
+  BRAINSCutDataHandler*      myDataHandler;
+  BRAINSUtils::ThreadBudget* myThreadBudget;
+  bool                       atlasToSubjectRegistraionOn;
+  std::list<DataSet *>       subjectDataSets;
+  unsigned int               numberOfConcurrentRegistrations;
+
+  /** all the inputs and the output of one subject registration */
+  struct RegistrationJob
+    {
+    std::string SubjectID;
+    std::string MovingImageFilename;
+    std::string FixedImageFilename;
+    std::string MovingBinaryImageFilename;
+    std::string FixedBinaryImageFilename;
+    std::string OutputRegName;
+    };
 
   /** private functions */
 
+  std::string GetRegistrationInputSignature( const RegistrationJob & job ) const;
+
+  std::string GetRegistrationInputSignatureFilename( const RegistrationJob & job ) const;
+
+  bool IsRegistrationUpToDate( const RegistrationJob & job ) const;
+
+  void WriteRegistrationInputSignature( const RegistrationJob & job ) const;
+
   void  CreateTransformFile(const std::string & MovingImageFilename, const std::string & FixedImageFilename,
                             const std::string & MovingBinaryImageFilename, const std::string & FixedBinaryImageFilename,
                             const std::string & OutputRegName, bool verbose);
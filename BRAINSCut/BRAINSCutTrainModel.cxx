@@ -17,6 +17,7 @@
  *
  *=========================================================================*/
 #include "BRAINSCutTrainModel.h"
+#include "BRAINSTrace.h"
 #include "TrainingVectorConfigurationType.h"
 #include <fstream>
 
@@ -249,6 +250,7 @@ void
 BRAINSCutTrainModel
 ::TrainANN()
 {
+  BRAINS_TRACE_SCOPE("BRAINSCut::TrainANN");
   cv::Ptr<OpenCVMLPType>  trainner =  OpenCVMLPType::create();
   int             layer[3];
 
@@ -301,6 +303,7 @@ void
 BRAINSCutTrainModel
 ::TrainRandomForestAt( const int depth, const int numberOfTree )
 {
+  BRAINS_TRACE_SCOPE("BRAINSCut::TrainRandomForest");
   cv::Ptr<cv::ml::RTrees> forest = cv::ml::RTrees::create();
   forest->setMaxDepth(depth);
   forest->setMinSampleCount(m_trainMinSampleCount);
@@ -126,8 +126,6 @@ int main(int argc, char *argv[])
   modleAttributeFilter->SetGMVolume( gmReader->GetOutput() );
   modleAttributeFilter->SetWMVolume( wmReader->GetOutput() );
 
-  // not thread-safe, yet!
-  modleAttributeFilter->SetNumberOfThreads(1);
   modleAttributeFilter->SetStrength(Strength);
   modleAttributeFilter->SetScale(Scale);
   modleAttributeFilter->Update();
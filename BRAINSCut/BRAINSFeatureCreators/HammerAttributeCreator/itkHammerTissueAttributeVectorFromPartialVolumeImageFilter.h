@@ -207,7 +207,9 @@ protected:
     *
     * \sa ImageToImageFilter::ThreadedGenerateData(),
     *     ImageToImageFilter::GenerateData() */
-  void GenerateData() override;
+  void BeforeThreadedGenerateData() override;
+
+  void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId) override;
 
 private:
   HammerTissueAttributeVectorFromPartialVolumeImageFilter(const Self &);   // purposely not
@@ -247,6 +249,10 @@ private:
 
   std::vector<NeighborOffsetType> m_FeatureNeighborhood;
   std::vector<InputIndexType>     m_N1Neighborhood;
+  // buffer offsets of the two neighborhoods, shared by the three tissue
+  // images
+  std::vector<OffsetValueType> m_FeatureLinearOffsets;
+  std::vector<OffsetValueType> m_N1LinearOffsets;
   // indices in the spherical neighborhood
   std::vector<NeighborOffsetType> m_OffsetInSphericalNeighborhood;
 };
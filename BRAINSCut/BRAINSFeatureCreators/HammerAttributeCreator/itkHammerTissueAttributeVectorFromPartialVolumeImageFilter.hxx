@@ -42,6 +42,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include "itkHammerTissueAttributeVectorFromPartialVolumeImageFilter.h"
 
 #include "itkImageRegionIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
 #include "itkNeighborhoodAlgorithm.h"
 #include "itkZeroFluxNeumannBoundaryCondition.h"
 #include "itkProgressReporter.h"
@@ -251,227 +252,236 @@ HammerTissueAttributeVectorFromPartialVolumeImageFilter<TInputImage, TOutputImag
 template <class TInputImage, class TOutputImage>
 void
 HammerTissueAttributeVectorFromPartialVolumeImageFilter<TInputImage, TOutputImage>
-::GenerateData()
+::BeforeThreadedGenerateData()
 {
-  printf("* GenerateData() \n ");
-  this->AllocateOutputs();
+  itkDebugMacro(<< "BeforeThreadedGenerateData");
+  const InputImageType *inputGMVolume = this->GetInput(0);
+  const InputImageType *inputWMVolume = this->GetInput(1);
+  const InputImageType *inputCSFVolume = this->GetInput(2);
 
-  typename TOutputImage::PixelType attributeVector;
+  // The three tissue images are addressed with the same buffer offsets.
+  if( inputGMVolume->GetBufferedRegion() != inputWMVolume->GetBufferedRegion()
+      || inputCSFVolume->GetBufferedRegion() != inputWMVolume->GetBufferedRegion() )
+    {
+    itkExceptionMacro(<< "The GM, WM and CSF volumes must have the same buffered region");
+    }
+
+  // Create the neighbor
+  CreateN1Neighbor();
+  CreateFeatureNeighbor( static_cast<int>( m_Scale ) );
+
+  // Buffer offsets of both neighborhoods, in the order they are summed.
+  const typename InputImageType::OffsetValueType *offsetTable = inputWMVolume->GetOffsetTable();
+  m_N1LinearOffsets.resize(m_N1Neighborhood.size() );
+  for( unsigned int k = 0; k < m_N1Neighborhood.size(); k++ )
+    {
+    m_N1LinearOffsets[k] = 0;
+    for( unsigned int s = 0; s < InputImageDimension; s++ )
+      {
+      m_N1LinearOffsets[k] += m_N1Neighborhood[k][s] * offsetTable[s];
+      }
+    }
+  m_FeatureLinearOffsets.resize(m_FeatureNeighborhood.size() );
+  for( unsigned int t = 0; t < m_FeatureNeighborhood.size(); t++ )
+    {
+    m_FeatureLinearOffsets[t] = 0;
+    for( unsigned int s = 0; s < InputImageDimension; s++ )
+      {
+      m_FeatureLinearOffsets[t] += m_FeatureNeighborhood[t][s] * offsetTable[s];
+      }
+    }
+}
 
+template <class TInputImage, class TOutputImage>
+void
+HammerTissueAttributeVectorFromPartialVolumeImageFilter<TInputImage, TOutputImage>
+::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId)
+{
   // Get the input and output
   OutputImageType * outputImage = this->GetOutput();
 
   const InputImageType *inputGMVolume = this->GetInput(0);
   const InputImageType *inputWMVolume = this->GetInput(1);
   const InputImageType *inputCSFVolume = this->GetInput(2);
+  const InputPixelType *GMBuffer = inputGMVolume->GetBufferPointer();
+  const InputPixelType *WMBuffer = inputWMVolume->GetBufferPointer();
+  const InputPixelType *CSFBuffer = inputCSFVolume->GetBufferPointer();
 
   // Use inputVolume as a reference volume for image information
   //
+  const InputRegionType dummyRegion = inputWMVolume->GetLargestPossibleRegion();
 
-  InputRegionType dummyRegion = inputWMVolume->GetLargestPossibleRegion();
-  // Create the neighbor
-  CreateN1Neighbor();
-  CreateFeatureNeighbor( static_cast<int>( m_Scale ) );
-
-  // Initialize
-  outputImage->SetLargestPossibleRegion(
-    inputWMVolume->GetLargestPossibleRegion() );
-  ImageRegionIteratorWithIndex<OutputImageType> it( outputImage, outputImage->GetLargestPossibleRegion() );
+  // Every voxel is computed in one visit: the WM posterior, the edge type
+  // from its 6 neighbors, and for edge voxels the GMIs over the feature
+  // neighborhood.  The sums run in the same order as the former serial
+  // passes, so the attribute vectors are identical.
+  //
+  // TODO make strength as a input parameter.
+  //
+  const int   strength = 1;
+  const float pixelNumInBubble = m_FeatureNeighborhood.size();
 
-  ImageRegionConstIteratorWithIndex<InputImageType> source( inputWMVolume, inputWMVolume->GetLargestPossibleRegion() );
-  attributeVector.Fill( 0 );
-  for( it.GoToBegin(), source.GoToBegin(); !it.IsAtEnd(); ++it, ++source )
+  ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+  typename TOutputImage::PixelType attributeVector;
+  InputIndexType                   centerIdx, neighborIdx;
+  for( ImageRegionIteratorWithIndex<OutputImageType> it( outputImage, outputRegionForThread );
+       !it.IsAtEnd(); ++it, progress.CompletedPixel() )
     {
+    centerIdx = it.GetIndex();
+    const OffsetValueType centerOffset = inputWMVolume->ComputeOffset(centerIdx);
+
     //
     // copy the WM Posterior to the attirubuteVector[1]
     // For WHAT though??????
     //
-    attributeVector[1] = source.Get();
-    it.Set(attributeVector);
-    }
+    attributeVector.Fill( 0 );
+    attributeVector[1] = WMBuffer[centerOffset];
 
-  // Compute the Edge Information
-  float flag_GM, flag_CSF, flag_WM;
-  //
-  // TODO make strength as a input parameter.
-  //
-  int strength = 1;
-  typename InputImageType::PixelType centerPixel;
-  typename InputImageType::PixelType PWm, PGm, PCsf;
-  std::string    centerTissueType = ""; // WM, GM, or CSF
-  InputIndexType centerIdx, neighborIdx;
-  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
-    {
     //
     // [WM edge]
     // For voxle WM > 0.3, in 6 neghibors
     //     if #( GM > 0.3) > #( CSF > 0.3) ==> WM || GM edge
     //     else if #( CSF > 0.3) > 0        ==> WM || CSF edge
     //
-    attributeVector = it.Get();
-    centerIdx = it.GetIndex();
-
-    // determin which tissue type it belongs to.
+    // Determin which Bondary the edge is
     //
-
-    PWm = inputWMVolume->GetPixel( centerIdx );
-    PGm = inputGMVolume->GetPixel( centerIdx );
-    PCsf = inputCSFVolume->GetPixel( centerIdx );
-
-    if( PWm > PGm )
-      {
-      if( PWm > PCsf )
-        {
-        centerTissueType = "WM"; centerPixel = PWm;
-        }
-      else
-        {
-        centerTissueType = "CSF"; centerPixel = PCsf;
-        }
-      }
-    else
+    const bool onBoundary =
+      centerIdx[0] == 0 || centerIdx[1] == 0 || centerIdx[2] == 0
+      || centerIdx[0] == static_cast<signed int>(dummyRegion.GetSize()[0] - 1)
+      || centerIdx[1] == static_cast<signed int>(dummyRegion.GetSize()[1] - 1)
+      || centerIdx[2] == static_cast<signed int>(dummyRegion.GetSize()[2] - 1);
+    if( !onBoundary )
       {
-      if( PGm > PCsf )
+      // determin which tissue type it belongs to.
+      //
+      const InputPixelType PWm = WMBuffer[centerOffset];
+      const InputPixelType PGm = GMBuffer[centerOffset];
+      const InputPixelType PCsf = CSFBuffer[centerOffset];
+
+      enum { NONE, WM, GM, CSF } centerTissueType;
+      InputPixelType centerPixel;
+      if( PWm > PGm )
         {
-        centerTissueType = "GM"; centerPixel = PGm;
+        if( PWm > PCsf )
+          {
+          centerTissueType = WM; centerPixel = PWm;
+          }
+        else
+          {
+          centerTissueType = CSF; centerPixel = PCsf;
+          }
         }
       else
         {
-        centerTissueType = "CSF"; centerPixel = PCsf;
+        if( PGm > PCsf )
+          {
+          centerTissueType = GM; centerPixel = PGm;
+          }
+        else
+          {
+          centerTissueType = CSF; centerPixel = PCsf;
+          }
         }
-      }
-
-    if( centerPixel < 0.1 )
-      {
-      centerTissueType = "NONE";
-      centerPixel = 0;
-      }
 
-    // Determin which Bondary the edge is
-    //
-    if( centerIdx[0] == 0 || centerIdx[1] == 0 || centerIdx[2] == 0 )
-      {
-      continue;
-      }
-    if( centerIdx[0] == static_cast<signed int>(dummyRegion.GetSize()[0] - 1) ||
-        centerIdx[1] == static_cast<signed int>(dummyRegion.GetSize()[1] - 1) ||
-        centerIdx[2] == static_cast<signed int>(dummyRegion.GetSize()[2] - 1) )
-      {
-      continue;
-      }
-    flag_GM = 0.0F;
-    flag_CSF = 0.0F;
-    flag_WM = 0.0F;
-    for( unsigned int k = 0; k < m_N1Neighborhood.size(); k++ )
-      {
-      for( int s = 0; s < InputImageDimension; s++ )
+      if( centerPixel < 0.1 )
         {
-        neighborIdx[s] = centerIdx[s] + m_N1Neighborhood[k][s];
+        centerTissueType = NONE;
         }
 
-      // Sum
-      flag_GM += inputGMVolume->GetPixel( neighborIdx);
-      flag_CSF += inputCSFVolume->GetPixel( neighborIdx);
-      flag_WM += inputWMVolume->GetPixel( neighborIdx);
-      }
-    if( centerTissueType == "WM" )
-      {
-      if( flag_GM > flag_CSF && flag_GM > strength )
+      float flag_GM = 0.0F;
+      float flag_CSF = 0.0F;
+      float flag_WM = 0.0F;
+      for( unsigned int k = 0; k < m_N1LinearOffsets.size(); k++ )
         {
-        attributeVector[0] = m_WMGMEDGE;
-        it.Set(attributeVector);
+        const OffsetValueType neighborOffset = centerOffset + m_N1LinearOffsets[k];
+        // Sum
+        flag_GM += GMBuffer[neighborOffset];
+        flag_CSF += CSFBuffer[neighborOffset];
+        flag_WM += WMBuffer[neighborOffset];
         }
-      if( flag_GM <= flag_CSF && flag_CSF > strength )
+      if( centerTissueType == WM )
         {
-        attributeVector[0] = m_WMCSFEDGE;
-        it.Set(attributeVector);
+        if( flag_GM > flag_CSF && flag_GM > strength )
+          {
+          attributeVector[0] = m_WMGMEDGE;
+          }
+        if( flag_GM <= flag_CSF && flag_CSF > strength )
+          {
+          attributeVector[0] = m_WMCSFEDGE;
+          }
         }
-      }
-    if( centerTissueType == "GM" )
-      {
-      if( flag_WM > flag_CSF && flag_WM > strength )
+      if( centerTissueType == GM )
         {
-        attributeVector[0] = m_WMGMEDGE;
-        it.Set(attributeVector);
+        if( flag_WM > flag_CSF && flag_WM > strength )
+          {
+          attributeVector[0] = m_WMGMEDGE;
+          }
+        if( flag_WM <= flag_CSF && flag_CSF > strength )
+          {
+          attributeVector[0] = m_WMCSFEDGE;
+          }
         }
-      if( flag_WM <= flag_CSF && flag_CSF > strength )
+      if( centerTissueType == CSF )
         {
-        attributeVector[0] = m_WMCSFEDGE;
-        it.Set(attributeVector);
+        if( flag_GM > flag_WM && flag_GM > strength )
+          {
+          attributeVector[0] = m_WMCSFEDGE;
+          }
+        if( flag_GM <= flag_WM && flag_GM > strength )
+          {
+          attributeVector[0] = m_GMCSFEDGE;
+          }
         }
-      }
-    if( centerTissueType == "CSF" )
+      } // end of Edge computation
+
+    //
+    // [Compute the GMIs]
+    //
+    if( attributeVector.GetEdge() != 0 )
       {
-      if( flag_GM > flag_WM && flag_GM > strength )
-        {
-        attributeVector[0] = m_WMCSFEDGE;
-        it.Set(attributeVector);
-        }
-      if( flag_GM <= flag_WM && flag_GM > strength )
+      float NonWM_value = 0.0F;
+      float CSF_value = 0.0F;
+      float GM_value = 0.0F;
+      bool  anyNeighborInside = false;
+      for( unsigned int t = 0; t < m_FeatureNeighborhood.size(); t++ )
         {
-        attributeVector[0] = m_GMCSFEDGE;
-        it.Set(attributeVector);
-        }
-      }
-    } // end of Edge computation
+        for( int s = 0; s < InputImageDimension; s++ )
+          {
+          neighborIdx[s] = centerIdx[s] + (int)m_FeatureNeighborhood[t][s];
+          }
+        if( neighborIdx[0] < 0 || neighborIdx[1] < 0 || neighborIdx[2] < 0 )
+          {
+          continue;
+          }
 
-  //
-  // [Compute the GMIs]
-  //
-  float NonWM_value, CSF_value, GM_value;
-  float pixelNumInBubble = m_FeatureNeighborhood.size();
-  printf("* Here we compute GMIs\n");
-  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
-    {
-    attributeVector = it.Get();
-    centerIdx = it.GetIndex();
+        if( neighborIdx[0] >= static_cast<signed int>(dummyRegion.GetSize()[0]) ||
+            neighborIdx[1] >= static_cast<signed int>(dummyRegion.GetSize()[1]) ||
+            neighborIdx[2] >= static_cast<signed int>(dummyRegion.GetSize()[2]) )
+          {
+          continue;
+          }
 
-    // float sum = inputWMVolume->GetPixel(centerIdx) +
-    //            inputGMVolume->GetPixel(centerIdx) +
-    //            inputCSFVolume->GetPixel(centerIdx) ;
-    // if( sum < 0.1F )
-    if( attributeVector.GetEdge() == 0 )
-      {
-      continue;
-      }
-    NonWM_value = 0.0F;
-    CSF_value = 0.0F;
-    GM_value = 0.0F;
-    for( unsigned int t = 0; t < m_FeatureNeighborhood.size(); t++ )
-      {
-      for( int s = 0; s < InputImageDimension; s++ )
-        {
-        neighborIdx[s] = centerIdx[s] + (int)m_FeatureNeighborhood[t][s];
+        // Sum all the probaiblity in the ball
+        //
+        const OffsetValueType neighborOffset = centerOffset + m_FeatureLinearOffsets[t];
+        NonWM_value += (1.0F - WMBuffer[neighborOffset] );
+        CSF_value   += (float)(CSFBuffer[neighborOffset] );
+        GM_value    += (float)(GMBuffer[neighborOffset] );
+        anyNeighborInside = true;
         }
-      if( neighborIdx[0] < 0 || neighborIdx[1] < 0 || neighborIdx[2] < 0 )
+      if( anyNeighborInside )
         {
-        continue;
-        }
+        float degree = (NonWM_value / pixelNumInBubble);
+        attributeVector[2] = degree * 100.0F;
 
-      if( neighborIdx[0] >= static_cast<signed int>(dummyRegion.GetSize()[0]) ||
-          neighborIdx[1] >= static_cast<signed int>(dummyRegion.GetSize()[1]) ||
-          neighborIdx[2] >= static_cast<signed int>(dummyRegion.GetSize()[2]) )
-        {
-        continue;
-        }
+        float CSF_degree = CSF_value / pixelNumInBubble;
+        attributeVector[3] = CSF_degree * 100.0F;
 
-      // Sum all the probaiblity in the ball
-      //
-      NonWM_value += (1.0F - inputWMVolume->GetPixel(neighborIdx) );
-      CSF_value   += (float)(inputCSFVolume->GetPixel(neighborIdx) );
-      GM_value    += (float)(inputGMVolume->GetPixel(neighborIdx) );
-
-      float degree = (NonWM_value / pixelNumInBubble);
-      attributeVector[2] = degree * 100.0F;
-
-      float CSF_degree = CSF_value / pixelNumInBubble;
-      attributeVector[3] = CSF_degree * 100.0F;
-
-      float GM_degree = GM_value / pixelNumInBubble;
-      attributeVector[4] = GM_degree * 100.0F;
-
-      it.Set(attributeVector);
+        float GM_degree = GM_value / pixelNumInBubble;
+        attributeVector[4] = GM_degree * 100.0F;
+        }
       }
+    it.Set(attributeVector);
     }
 }
 
@@ -30,6 +30,7 @@
 #include "itkImageFileWriter.h"
 
 #include "itkScalarImageToTextureFeaturesFilter.h"
+#include "itkCooccurrenceTextureFeatureMapsImageFilter.h"
 #include "itkRescaleIntensityImageFilter.h"
 
 #include "TextureMeasureFilterCLP.h"
@@ -260,5 +261,93 @@ int main( int argc, char *argv[] )
     }
 
   outputFileStream.close();
+
+  /** local texture feature maps */
+  if( outputFeatureMapBase != "" )
+    {
+    if( numberOfGrayLevels < 1 || numberOfGrayLevels > 256 || windowRadius < 1 )
+      {
+      std::cerr << "numberOfGrayLevels must be in [1,256] and windowRadius positive" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    typedef itk::Image<float, Dimension> FeatureMapImageType;
+    typedef itk::CooccurrenceTextureFeatureMapsImageFilter<InternalImageType, InternalImageType, FeatureMapImageType>
+      FeatureMapsFilterType;
+    typedef FeatureMapsFilterType::TextureFeaturesFilterType MapFeaturesType;
+
+    const std::string featureNames[] =
+      { "Energy", "Entropy", "Correlation", "InverseDifferenceMoment", "Inertia", "ClusterShade",
+      "ClusterProminence", "HaralickCorrelation" };
+    FeatureMapsFilterType::FeatureNameVectorType mapFeatures;
+    for( unsigned int f = 0; f < featureMaps.size(); f++ )
+      {
+      unsigned int name = 0;
+      while( name < MapFeaturesType::InvalidFeatureName && featureNames[name] != featureMaps[f] )
+        {
+        name++;
+        }
+      if( name == MapFeaturesType::InvalidFeatureName )
+        {
+        std::cerr << "Unknown texture feature " << featureMaps[f] << std::endl;
+        return EXIT_FAILURE;
+        }
+      mapFeatures.push_back( static_cast<FeatureMapsFilterType::TextureFeatureName>( name ) );
+      }
+
+    /** the maps are restricted to the ROI; the CSV measures above keep their
+     *  own mask, which selects the whole image */
+    BinaryFilterType::Pointer roiFilter = BinaryFilterType::New();
+    roiFilter->SetInput( binaryImageReader->GetOutput() );
+    roiFilter->SetLowerThreshold(1.0);
+    roiFilter->SetInsideValue(1);
+    roiFilter->SetOutsideValue(0);
+
+    /** the volume is quantized once for all features */
+    typedef itk::RescaleIntensityImageFilter<InputImageType, InternalImageType> QuantizerType;
+    QuantizerType::Pointer quantizer = QuantizerType::New();
+    quantizer->SetInput( inputImageReader->GetOutput() );
+    quantizer->SetOutputMinimum(0);
+    quantizer->SetOutputMaximum( numberOfGrayLevels - 1 );
+
+    FeatureMapsFilterType::OffsetVectorType mapOffsets;
+    for( offSetIt  = requestedOffsets->Begin();
+         offSetIt != requestedOffsets->End();
+         ++offSetIt )
+      {
+      mapOffsets.push_back( offSetIt.Value() );
+      }
+
+    FeatureMapsFilterType::SizeType radius;
+    radius.Fill( windowRadius );
+
+    FeatureMapsFilterType::Pointer featureMapsFilter = FeatureMapsFilterType::New();
+    featureMapsFilter->SetInput( quantizer->GetOutput() );
+    featureMapsFilter->SetMaskImage( roiFilter->GetOutput() );
+    featureMapsFilter->SetNumberOfBinsPerAxis( numberOfGrayLevels );
+    featureMapsFilter->SetWindowRadius( radius );
+    featureMapsFilter->SetOffsets( mapOffsets );
+    featureMapsFilter->SetRequestedFeatures( mapFeatures );
+    try
+      {
+      featureMapsFilter->Update();
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      std::cerr << "Exception Object Caught! " << std::endl;
+      std::cerr << err << std::endl;
+      throw;
+      }
+
+    for( unsigned int f = 0; f < mapFeatures.size(); f++ )
+      {
+      typedef itk::ImageFileWriter<FeatureMapImageType> FeatureMapWriterType;
+      FeatureMapWriterType::Pointer featureMapWriter = FeatureMapWriterType::New();
+      featureMapWriter->UseCompressionOn();
+      featureMapWriter->SetFileName( outputFeatureMapBase + "_" + featureNames[mapFeatures[f]] + ".nii.gz" );
+      featureMapWriter->SetInput( featureMapsFilter->GetFeatureOutput(f) );
+      featureMapWriter->Update();
+      }
+    }
   return 0;
 }
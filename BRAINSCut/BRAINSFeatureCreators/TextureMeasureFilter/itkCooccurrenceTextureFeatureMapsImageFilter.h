@@ -0,0 +1,163 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCooccurrenceTextureFeatureMapsImageFilter_h
+#define __itkCooccurrenceTextureFeatureMapsImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkHistogram.h"
+#include "itkHistogramToTextureFeaturesFilter.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class CooccurrenceTextureFeatureMapsImageFilter
+ * \brief Local Haralick texture features of a quantized image, one output per feature.
+ *
+ * For every voxel inside the mask, the gray level co-occurrence matrix of
+ * each offset is accumulated over the window of radius WindowRadius centered
+ * on the voxel.  Pairs are counted symmetrically and only when both voxels
+ * are in the window and in the mask, as ScalarImageToCooccurrenceMatrixFilter
+ * does.  The features of every offset are computed with the formulas of
+ * HistogramToTextureFeaturesFilter and averaged over the offsets, which
+ * matches the feature means of ScalarImageToTextureFeaturesFilter with
+ * FastCalculationsOff.
+ *
+ * All requested features are produced by one threaded pass over the image;
+ * output i holds the feature RequestedFeatures[i].  The input gray levels
+ * must lie in [0, NumberOfBinsPerAxis), e.g. the output of a
+ * RescaleIntensityImageFilter.  Voxels outside the mask are set to zero.
+ *
+ * The co-occurrence matrices are kept as per thread counts with the list of
+ * touched entries, so the features cost time proportional to the number of
+ * distinct pairs in the window rather than to NumberOfBinsPerAxis^2.
+ */
+template <class TInputImage, class TMaskImage, class TOutputImage>
+class CooccurrenceTextureFeatureMapsImageFilter :
+  public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef CooccurrenceTextureFeatureMapsImageFilter     Self;
+  typedef ImageToImageFilter<TInputImage, TOutputImage> Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(CooccurrenceTextureFeatureMapsImageFilter, ImageToImageFilter);
+
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  typedef TInputImage                              InputImageType;
+  typedef typename InputImageType::PixelType       InputPixelType;
+  typedef typename InputImageType::IndexType       IndexType;
+  typedef typename InputImageType::SizeType        SizeType;
+  typedef typename InputImageType::OffsetType      OffsetType;
+  typedef typename InputImageType::RegionType      RegionType;
+  typedef TMaskImage                               MaskImageType;
+  typedef typename MaskImageType::PixelType        MaskPixelType;
+  typedef TOutputImage                             OutputImageType;
+  typedef typename OutputImageType::PixelType      OutputPixelType;
+  typedef typename OutputImageType::RegionType     OutputImageRegionType;
+  typedef std::vector<OffsetType>                  OffsetVectorType;
+
+  typedef Statistics::HistogramToTextureFeaturesFilter<Statistics::Histogram<double> > TextureFeaturesFilterType;
+  typedef typename TextureFeaturesFilterType::TextureFeatureName                      TextureFeatureName;
+  typedef std::vector<TextureFeatureName>                                             FeatureNameVectorType;
+
+  /** Optional mask; without it every voxel is inside */
+  void SetMaskImage(const MaskImageType *mask);
+
+  const MaskImageType * GetMaskImage() const;
+
+  itkSetMacro(InsidePixelValue, MaskPixelType);
+  itkGetConstMacro(InsidePixelValue, MaskPixelType);
+
+  itkSetMacro(NumberOfBinsPerAxis, unsigned int);
+  itkGetConstMacro(NumberOfBinsPerAxis, unsigned int);
+
+  itkSetMacro(WindowRadius, SizeType);
+  itkGetConstReferenceMacro(WindowRadius, SizeType);
+
+  /** Co-occurrence offsets; the default is the half neighborhood of radius 1,
+   *  the default of ScalarImageToTextureFeaturesFilter */
+  void SetOffsets(const OffsetVectorType & offsets);
+
+  itkGetConstReferenceMacro(Offsets, OffsetVectorType);
+
+  /** One output is created per requested feature, in this order */
+  void SetRequestedFeatures(const FeatureNameVectorType & features);
+
+  itkGetConstReferenceMacro(RequestedFeatures, FeatureNameVectorType);
+
+  /** The feature map of RequestedFeatures[i] */
+  OutputImageType * GetFeatureOutput(unsigned int i);
+
+protected:
+  CooccurrenceTextureFeatureMapsImageFilter();
+  ~CooccurrenceTextureFeatureMapsImageFilter() override
+  {
+  }
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** The windows reach outside the output region, so the whole input and
+   *  mask are requested */
+  void GenerateInputRequestedRegion() override;
+
+  void BeforeThreadedGenerateData() override;
+
+  void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId) override;
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(CooccurrenceTextureFeatureMapsImageFilter);
+
+  /** Co-occurrence counts of one offset and one window */
+  struct CooccurrenceMatrix
+    {
+    std::vector<unsigned int> Counts;
+    std::vector<unsigned int> TouchedEntries;
+    unsigned int              NumberOfPairs;
+    };
+
+  inline void AddPair(CooccurrenceMatrix & matrix, const unsigned int first, const unsigned int second) const;
+
+  /** Adds the features of matrix to featureSums and clears matrix */
+  void AccumulateFeatures(CooccurrenceMatrix & matrix, std::vector<double> & marginalSums,
+                          std::vector<double> & featureSums) const;
+
+  MaskPixelType         m_InsidePixelValue;
+  unsigned int          m_NumberOfBinsPerAxis;
+  SizeType              m_WindowRadius;
+  OffsetVectorType      m_Offsets;
+  FeatureNameVectorType m_RequestedFeatures;
+
+  // buffer offsets of m_Offsets, valid during GenerateData
+  std::vector<OffsetValueType> m_LinearOffsets;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCooccurrenceTextureFeatureMapsImageFilter.hxx"
+#endif
+
+#endif
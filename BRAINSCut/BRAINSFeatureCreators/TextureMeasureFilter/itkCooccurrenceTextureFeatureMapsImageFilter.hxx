@@ -0,0 +1,422 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCooccurrenceTextureFeatureMapsImageFilter_hxx
+#define __itkCooccurrenceTextureFeatureMapsImageFilter_hxx
+
+#include "itkCooccurrenceTextureFeatureMapsImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+#include "itkMath.h"
+#include "itkProgressReporter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+template <class TInputImage, class TMaskImage, class TOutputImage>
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::CooccurrenceTextureFeatureMapsImageFilter() :
+  m_InsidePixelValue(NumericTraits<MaskPixelType>::OneValue() ),
+  m_NumberOfBinsPerAxis(256)
+{
+  this->SetNumberOfRequiredInputs(1);
+  m_WindowRadius.Fill(2);
+
+  // The offsets that precede the center of a radius 1 neighborhood, first
+  // index running fastest.
+  unsigned int numberOfNeighbors = 1;
+  for( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    numberOfNeighbors *= 3;
+    }
+  OffsetVectorType offsets;
+  for( unsigned int n = 0; n < numberOfNeighbors / 2; n++ )
+    {
+    OffsetType   offset;
+    unsigned int remainder = n;
+    for( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      offset[d] = static_cast<OffsetValueType>( remainder % 3 ) - 1;
+      remainder /= 3;
+      }
+    offsets.push_back(offset);
+    }
+  this->SetOffsets(offsets);
+
+  FeatureNameVectorType features;
+  features.push_back(TextureFeaturesFilterType::Energy);
+  features.push_back(TextureFeaturesFilterType::Entropy);
+  features.push_back(TextureFeaturesFilterType::Correlation);
+  features.push_back(TextureFeaturesFilterType::InverseDifferenceMoment);
+  features.push_back(TextureFeaturesFilterType::Inertia);
+  features.push_back(TextureFeaturesFilterType::ClusterShade);
+  features.push_back(TextureFeaturesFilterType::ClusterProminence);
+  features.push_back(TextureFeaturesFilterType::HaralickCorrelation);
+  this->SetRequestedFeatures(features);
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::SetMaskImage(const MaskImageType *mask)
+{
+  this->ProcessObject::SetNthInput(1, const_cast<MaskImageType *>( mask ) );
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+const typename CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>::MaskImageType *
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::GetMaskImage() const
+{
+  return dynamic_cast<const MaskImageType *>( this->ProcessObject::GetInput(1) );
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::SetOffsets(const OffsetVectorType & offsets)
+{
+  this->m_Offsets = offsets;
+  this->Modified();
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::SetRequestedFeatures(const FeatureNameVectorType & features)
+{
+  this->m_RequestedFeatures = features;
+  this->SetNumberOfIndexedOutputs(features.size() );
+  for( unsigned int i = 0; i < features.size(); i++ )
+    {
+    if( this->ProcessObject::GetOutput(i) == nullptr )
+      {
+      this->ProcessObject::SetNthOutput(i, this->MakeOutput(i) );
+      }
+    }
+  this->Modified();
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+typename CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>::OutputImageType *
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::GetFeatureOutput(unsigned int i)
+{
+  return dynamic_cast<OutputImageType *>( this->ProcessObject::GetOutput(i) );
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImageType *input = const_cast<InputImageType *>( this->GetInput() );
+  if( input )
+    {
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+  MaskImageType *mask = const_cast<MaskImageType *>( this->GetMaskImage() );
+  if( mask )
+    {
+    mask->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::BeforeThreadedGenerateData()
+{
+  if( m_NumberOfBinsPerAxis == 0 )
+    {
+    itkExceptionMacro(<< "NumberOfBinsPerAxis must be positive");
+    }
+  for( unsigned int f = 0; f < m_RequestedFeatures.size(); f++ )
+    {
+    if( m_RequestedFeatures[f] >= TextureFeaturesFilterType::InvalidFeatureName )
+      {
+      itkExceptionMacro(<< "Invalid texture feature " << m_RequestedFeatures[f]);
+      }
+    }
+
+  const InputImageType *input = this->GetInput();
+  const MaskImageType * mask = this->GetMaskImage();
+  if( mask && mask->GetBufferedRegion() != input->GetBufferedRegion() )
+    {
+    itkExceptionMacro(<< "The mask must have the same buffered region as the input");
+    }
+
+  // Input and mask are addressed with the same buffer offsets.
+  const OffsetValueType *offsetTable = input->GetOffsetTable();
+  m_LinearOffsets.resize(m_Offsets.size() );
+  for( unsigned int k = 0; k < m_Offsets.size(); k++ )
+    {
+    m_LinearOffsets[k] = 0;
+    for( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      m_LinearOffsets[k] += m_Offsets[k][d] * offsetTable[d];
+      }
+    }
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::AddPair(CooccurrenceMatrix & matrix, const unsigned int first, const unsigned int second) const
+{
+  const unsigned int forward = first * m_NumberOfBinsPerAxis + second;
+  const unsigned int backward = second * m_NumberOfBinsPerAxis + first;
+
+  if( matrix.Counts[forward]++ == 0 )
+    {
+    matrix.TouchedEntries.push_back(forward);
+    }
+  if( matrix.Counts[backward]++ == 0 )
+    {
+    matrix.TouchedEntries.push_back(backward);
+    }
+  matrix.NumberOfPairs += 2;
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::AccumulateFeatures(CooccurrenceMatrix & matrix, std::vector<double> & marginalSums,
+                     std::vector<double> & featureSums) const
+{
+  const unsigned int binsPerAxis = m_NumberOfBinsPerAxis;
+  const double       totalFrequency = matrix.NumberOfPairs;
+
+  // Means and variances, as in HistogramToTextureFeaturesFilter.
+  double pixelMean = 0.0;
+  std::fill(marginalSums.begin(), marginalSums.end(), 0.0);
+  for( unsigned int e = 0; e < matrix.TouchedEntries.size(); e++ )
+    {
+    const unsigned int entry = matrix.TouchedEntries[e];
+    const double       frequency = matrix.Counts[entry] / totalFrequency;
+    pixelMean += ( entry / binsPerAxis ) * frequency;
+    marginalSums[entry / binsPerAxis] += frequency;
+    }
+
+  double marginalMean = marginalSums[0];
+  double marginalDevSquared = 0.0;
+  for( unsigned int arrayIndex = 1; arrayIndex < binsPerAxis; arrayIndex++ )
+    {
+    const double k = arrayIndex + 1;
+    const double M_k_minus_1 = marginalMean;
+    const double x_k = marginalSums[arrayIndex];
+    const double M_k = M_k_minus_1 + ( x_k - M_k_minus_1 ) / k;
+
+    marginalDevSquared += ( x_k - M_k_minus_1 ) * ( x_k - M_k );
+    marginalMean = M_k;
+    }
+  marginalDevSquared = marginalDevSquared / binsPerAxis;
+
+  double pixelVariance = 0.0;
+  for( unsigned int e = 0; e < matrix.TouchedEntries.size(); e++ )
+    {
+    const unsigned int entry = matrix.TouchedEntries[e];
+    const double       frequency = matrix.Counts[entry] / totalFrequency;
+    const double       deviation = ( entry / binsPerAxis ) - pixelMean;
+    pixelVariance += deviation * deviation * frequency;
+    }
+
+  double pixelVarianceSquared = pixelVariance * pixelVariance;
+  if( Math::FloatAlmostEqual( pixelVarianceSquared, 0.0, 4, 2 * NumericTraits<double>::epsilon() ) )
+    {
+    pixelVarianceSquared = 1.0;
+    }
+
+  const double log2 = std::log(2.0);
+  double       features[TextureFeaturesFilterType::InvalidFeatureName] = { 0.0 };
+  for( unsigned int e = 0; e < matrix.TouchedEntries.size(); e++ )
+    {
+    const unsigned int entry = matrix.TouchedEntries[e];
+    const double       frequency = matrix.Counts[entry] / totalFrequency;
+    const double       i = entry / binsPerAxis;
+    const double       j = entry % binsPerAxis;
+    const double       clusterTerm = ( i - pixelMean ) + ( j - pixelMean );
+
+    features[TextureFeaturesFilterType::Energy] += frequency * frequency;
+    features[TextureFeaturesFilterType::Entropy] -= ( frequency > 0.0001 ) ? frequency * std::log(frequency) / log2 : 0;
+    features[TextureFeaturesFilterType::Correlation] += ( ( i - pixelMean ) * ( j - pixelMean ) * frequency )
+      / pixelVarianceSquared;
+    features[TextureFeaturesFilterType::InverseDifferenceMoment] += frequency / ( 1.0 + ( i - j ) * ( i - j ) );
+    features[TextureFeaturesFilterType::Inertia] += ( i - j ) * ( i - j ) * frequency;
+    features[TextureFeaturesFilterType::ClusterShade] += clusterTerm * clusterTerm * clusterTerm * frequency;
+    features[TextureFeaturesFilterType::ClusterProminence] += clusterTerm * clusterTerm * clusterTerm * clusterTerm
+      * frequency;
+    features[TextureFeaturesFilterType::HaralickCorrelation] += i * j * frequency;
+
+    matrix.Counts[entry] = 0;
+    }
+  features[TextureFeaturesFilterType::HaralickCorrelation] =
+    ( features[TextureFeaturesFilterType::HaralickCorrelation] - marginalMean * marginalMean ) / marginalDevSquared;
+
+  for( unsigned int f = 0; f < m_RequestedFeatures.size(); f++ )
+    {
+    featureSums[f] += features[m_RequestedFeatures[f]];
+    }
+
+  matrix.TouchedEntries.clear();
+  matrix.NumberOfPairs = 0;
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId)
+{
+  const InputImageType *input = this->GetInput();
+  const MaskImageType * mask = this->GetMaskImage();
+  const InputPixelType *inputBuffer = input->GetBufferPointer();
+  const MaskPixelType * maskBuffer = mask ? mask->GetBufferPointer() : nullptr;
+  const RegionType      bufferedRegion = input->GetBufferedRegion();
+  const unsigned int    numberOfFeatures = m_RequestedFeatures.size();
+  const unsigned int    numberOfOffsets = m_Offsets.size();
+  const unsigned int    maximumLevel = m_NumberOfBinsPerAxis - 1;
+
+  // Per thread co-occurrence matrices, one per offset, reused by every window
+  std::vector<CooccurrenceMatrix> matrices(numberOfOffsets);
+  for( unsigned int k = 0; k < numberOfOffsets; k++ )
+    {
+    matrices[k].Counts.assign(m_NumberOfBinsPerAxis * m_NumberOfBinsPerAxis, 0);
+    matrices[k].NumberOfPairs = 0;
+    }
+  std::vector<double> marginalSums(m_NumberOfBinsPerAxis);
+  std::vector<double> featureSums(numberOfFeatures);
+
+  typedef ImageRegionIterator<OutputImageType> OutputIteratorType;
+  std::vector<OutputIteratorType> outputIts;
+  for( unsigned int f = 0; f < numberOfFeatures; f++ )
+    {
+    outputIts.push_back(OutputIteratorType(this->GetFeatureOutput(f), outputRegionForThread) );
+    }
+
+  IndexType lower;
+  IndexType upper;
+  IndexType windowIndex;
+  IndexType neighborIndex;
+
+  ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+  for( ImageRegionConstIteratorWithIndex<InputImageType> it(input, outputRegionForThread);
+       !it.IsAtEnd(); ++it, progress.CompletedPixel() )
+    {
+    const IndexType centerIndex = it.GetIndex();
+    std::fill(featureSums.begin(), featureSums.end(), 0.0);
+    unsigned int numberOfValidOffsets = 0;
+
+    if( maskBuffer == nullptr || maskBuffer[input->ComputeOffset(centerIndex)] == m_InsidePixelValue )
+      {
+      for( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        lower[d] = std::max<IndexValueType>(centerIndex[d] - static_cast<IndexValueType>( m_WindowRadius[d] ),
+                                            bufferedRegion.GetIndex()[d]);
+        upper[d] = std::min<IndexValueType>(centerIndex[d] + static_cast<IndexValueType>( m_WindowRadius[d] ),
+                                            bufferedRegion.GetIndex()[d]
+                                            + static_cast<IndexValueType>( bufferedRegion.GetSize()[d] ) - 1);
+        }
+
+      // Accumulate the pairs of every offset in one sweep over the window.
+      windowIndex = lower;
+      bool windowDone = false;
+      while( !windowDone )
+        {
+        const OffsetValueType windowOffset = input->ComputeOffset(windowIndex);
+        if( maskBuffer == nullptr || maskBuffer[windowOffset] == m_InsidePixelValue )
+          {
+          const InputPixelType windowValue = inputBuffer[windowOffset];
+          const unsigned int   first = windowValue <= 0 ? 0 :
+            std::min(static_cast<unsigned int>( windowValue ), maximumLevel);
+          for( unsigned int k = 0; k < numberOfOffsets; k++ )
+            {
+            bool inside = true;
+            for( unsigned int d = 0; d < ImageDimension && inside; d++ )
+              {
+              neighborIndex[d] = windowIndex[d] + m_Offsets[k][d];
+              inside = neighborIndex[d] >= lower[d] && neighborIndex[d] <= upper[d];
+              }
+            if( !inside )
+              {
+              continue;
+              }
+            const OffsetValueType neighborOffset = windowOffset + m_LinearOffsets[k];
+            if( maskBuffer != nullptr && maskBuffer[neighborOffset] != m_InsidePixelValue )
+              {
+              continue;
+              }
+            const InputPixelType neighborValue = inputBuffer[neighborOffset];
+            const unsigned int   second = neighborValue <= 0 ? 0 :
+              std::min(static_cast<unsigned int>( neighborValue ), maximumLevel);
+            this->AddPair(matrices[k], first, second);
+            }
+          }
+
+        // next index of the window, first index running fastest
+        unsigned int d = 0;
+        for( ; d < ImageDimension; d++ )
+          {
+          if( ++windowIndex[d] <= upper[d] )
+            {
+            break;
+            }
+          windowIndex[d] = lower[d];
+          }
+        windowDone = ( d == ImageDimension );
+        }
+
+      for( unsigned int k = 0; k < numberOfOffsets; k++ )
+        {
+        if( matrices[k].NumberOfPairs > 0 )
+          {
+          this->AccumulateFeatures(matrices[k], marginalSums, featureSums);
+          ++numberOfValidOffsets;
+          }
+        }
+      }
+
+    for( unsigned int f = 0; f < numberOfFeatures; f++ )
+      {
+      outputIts[f].Set( numberOfValidOffsets > 0 ?
+                        static_cast<OutputPixelType>( featureSums[f] / numberOfValidOffsets ) :
+                        NumericTraits<OutputPixelType>::ZeroValue() );
+      ++outputIts[f];
+      }
+    }
+}
+
+template <class TInputImage, class TMaskImage, class TOutputImage>
+void
+CooccurrenceTextureFeatureMapsImageFilter<TInputImage, TMaskImage, TOutputImage>
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "InsidePixelValue: "
+     << static_cast<typename NumericTraits<MaskPixelType>::PrintType>( m_InsidePixelValue ) << std::endl;
+  os << indent << "NumberOfBinsPerAxis: " << m_NumberOfBinsPerAxis << std::endl;
+  os << indent << "WindowRadius: " << m_WindowRadius << std::endl;
+  os << indent << "NumberOfOffsets: " << m_Offsets.size() << std::endl;
+  os << indent << "NumberOfRequestedFeatures: " << m_RequestedFeatures.size() << std::endl;
+}
+} // end namespace itk
+
+#endif
@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <cmath>
+#include <iostream>
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkRegionOfInterestImageFilter.h"
+#include "itkScalarImageToTextureFeaturesFilter.h"
+#include "itkCooccurrenceTextureFeatureMapsImageFilter.h"
+
+/**
+ * Compare the feature maps at single voxels with ScalarImageToTextureFeaturesFilter
+ * run on the window of that voxel, once inside the image and once where the
+ * window is clipped by the image boundary.
+ */
+int
+main(int /*argc*/, char * [] /*argv*/)
+{
+  typedef itk::Image<unsigned char, 3> ImageType;
+  typedef itk::Image<float, 3>         FeatureImageType;
+  typedef itk::CooccurrenceTextureFeatureMapsImageFilter<ImageType, ImageType, FeatureImageType>
+    FeatureMapsFilterType;
+  typedef itk::Statistics::ScalarImageToTextureFeaturesFilter<ImageType> TextureFilterType;
+
+  const unsigned int numberOfGrayLevels = 8;
+
+  ImageType::Pointer image = ImageType::New();
+  ImageType::SizeType size;
+  size.Fill(9);
+  image->SetRegions(size);
+  image->Allocate();
+  for( itk::ImageRegionIteratorWithIndex<ImageType> it( image, image->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const ImageType::IndexType index = it.GetIndex();
+    it.Set( static_cast<unsigned char>( ( 3 * index[0] + 5 * index[1] + 7 * index[2] + index[0] * index[1] )
+                                        % numberOfGrayLevels ) );
+    }
+
+  FeatureMapsFilterType::SizeType radius;
+  radius.Fill(2);
+
+  FeatureMapsFilterType::Pointer featureMapsFilter = FeatureMapsFilterType::New();
+  featureMapsFilter->SetInput(image);
+  featureMapsFilter->SetNumberOfBinsPerAxis(numberOfGrayLevels);
+  featureMapsFilter->SetWindowRadius(radius);
+  featureMapsFilter->Update();
+  const FeatureMapsFilterType::FeatureNameVectorType & features = featureMapsFilter->GetRequestedFeatures();
+
+  ImageType::IndexType voxels[2];
+  voxels[0].Fill(4);
+  voxels[1][0] = 0; voxels[1][1] = 1; voxels[1][2] = 4;
+
+  int status = EXIT_SUCCESS;
+  for( unsigned int v = 0; v < 2; ++v )
+    {
+    ImageType::RegionType window;
+    for( unsigned int d = 0; d < 3; ++d )
+      {
+      window.SetIndex(d, voxels[v][d] - static_cast<itk::IndexValueType>( radius[d] ) );
+      window.SetSize(d, 2 * radius[d] + 1);
+      }
+    window.Crop( image->GetLargestPossibleRegion() );
+
+    typedef itk::RegionOfInterestImageFilter<ImageType, ImageType> WindowFilterType;
+    WindowFilterType::Pointer windowFilter = WindowFilterType::New();
+    windowFilter->SetInput(image);
+    windowFilter->SetRegionOfInterest(window);
+
+    TextureFilterType::FeatureNameVectorPointer requestedFeatures = TextureFilterType::FeatureNameVector::New();
+    for( unsigned int f = 0; f < features.size(); ++f )
+      {
+      requestedFeatures->push_back(features[f]);
+      }
+
+    TextureFilterType::Pointer textureFilter = TextureFilterType::New();
+    textureFilter->SetInput( windowFilter->GetOutput() );
+    textureFilter->SetNumberOfBinsPerAxis(numberOfGrayLevels);
+    textureFilter->SetPixelValueMinMax(0, numberOfGrayLevels - 1);
+    textureFilter->FastCalculationsOff();
+    textureFilter->SetRequestedFeatures(requestedFeatures);
+    textureFilter->Update();
+
+    const TextureFilterType::FeatureValueVector *means = textureFilter->GetFeatureMeans();
+    for( unsigned int f = 0; f < features.size(); ++f )
+      {
+      const double expected = means->GetElement(f);
+      const double actual = featureMapsFilter->GetFeatureOutput(f)->GetPixel(voxels[v]);
+      std::cout << "Voxel " << voxels[v] << ", feature " << features[f] << ": " << actual
+                << " (expected " << expected << ")" << std::endl;
+      if( std::abs(actual - expected) > 1e-5 * ( std::abs(expected) + 1.0 ) )
+        {
+        std::cerr << "Feature map differs from ScalarImageToTextureFeaturesFilter" << std::endl;
+        status = EXIT_FAILURE;
+        }
+      }
+    }
+  return status;
+}
@@ -0,0 +1,210 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkHammerTissueAttributeVectorFromPartialVolumeImageFilter.h"
+
+typedef itk::Image<float, 3>                                                         ImageType;
+typedef itk::HammerTissueAttributeVector                                             AttributeVectorType;
+typedef itk::Image<AttributeVectorType, 3>                                           AttributeImageType;
+typedef itk::HammerTissueAttributeVectorFromPartialVolumeImageFilter<ImageType, AttributeImageType> AttributeFilterType;
+
+struct TissueImages
+  {
+  ImageType::Pointer WM;
+  ImageType::Pointer GM;
+  ImageType::Pointer CSF;
+  };
+
+static ImageType::Pointer AllocateTissueImage(const unsigned int sizePerSide)
+{
+  ImageType::SizeType size;
+  size.Fill(sizePerSide);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+  return image;
+}
+
+/** WM, GM and CSF slabs along x, with partial volume voxels at x = 3..6 */
+static TissueImages MakeSlabPhantom()
+{
+  const float profile[7][3] = { { 1.0F, 0.0F, 0.0F },
+                                { 1.0F, 0.0F, 0.0F },
+                                { 1.0F, 0.0F, 0.0F },
+                                { 0.7F, 0.3F, 0.0F },
+                                { 0.2F, 0.715F, 0.085F },
+                                { 0.0F, 0.545F, 0.455F },
+                                { 0.0F, 0.135F, 0.865F } };
+  TissueImages tissues;
+  tissues.WM = AllocateTissueImage(10);
+  tissues.GM = AllocateTissueImage(10);
+  tissues.CSF = AllocateTissueImage(10);
+  for( itk::ImageRegionIteratorWithIndex<ImageType> it(tissues.WM, tissues.WM->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const ImageType::IndexType index = it.GetIndex();
+    const bool                 inProfile = index[0] < 7;
+    it.Set(inProfile ? profile[index[0]][0] : 0.0F);
+    tissues.GM->SetPixel(index, inProfile ? profile[index[0]][1] : 0.0F);
+    tissues.CSF->SetPixel(index, inProfile ? profile[index[0]][2] : 1.0F);
+    }
+  return tissues;
+}
+
+/** A WM ball inside a GM shell inside CSF, with smooth transitions */
+static TissueImages MakeBallPhantom()
+{
+  TissueImages tissues;
+  tissues.WM = AllocateTissueImage(24);
+  tissues.GM = AllocateTissueImage(24);
+  tissues.CSF = AllocateTissueImage(24);
+  for( itk::ImageRegionIteratorWithIndex<ImageType> it(tissues.WM, tissues.WM->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const ImageType::IndexType index = it.GetIndex();
+    double                     radiusSquared = 0.0;
+    for( unsigned int d = 0; d < 3; ++d )
+      {
+      radiusSquared += ( index[d] - 11.3 ) * ( index[d] - 11.3 );
+      }
+    const double radius = std::sqrt(radiusSquared);
+    const float  wm = static_cast<float>( std::min(std::max( ( 7.0 - radius ) / 3.0, 0.0), 1.0) );
+    const float  csf = static_cast<float>( std::min(std::max( ( radius - 8.0 ) / 3.0, 0.0), 1.0) );
+    it.Set(wm);
+    tissues.GM->SetPixel(index, std::max(1.0F - wm - csf, 0.0F) );
+    tissues.CSF->SetPixel(index, csf);
+    }
+  return tissues;
+}
+
+static AttributeImageType::Pointer ComputeAttributes(const TissueImages & tissues, const float scale,
+                                                     const itk::ThreadIdType numberOfThreads)
+{
+  AttributeFilterType::Pointer filter = AttributeFilterType::New();
+  filter->SetGMVolume(tissues.GM);
+  filter->SetWMVolume(tissues.WM);
+  filter->SetCSFVolume(tissues.CSF);
+  filter->SetScale(scale);
+  filter->SetNumberOfThreads(numberOfThreads);
+  filter->Update();
+  return filter->GetOutput();
+}
+
+static bool CheckVoxel(const AttributeImageType * attributes, const int x, const int y, const int z,
+                       const unsigned char expected[5])
+{
+  AttributeImageType::IndexType index;
+  index[0] = x;
+  index[1] = y;
+  index[2] = z;
+  const AttributeVectorType & actual = attributes->GetPixel(index);
+  for( unsigned int k = 0; k < 5; ++k )
+    {
+    if( actual[k] != expected[k] )
+      {
+      std::cerr << "Attribute " << k << " at " << index << " is " << static_cast<int>( actual[k] )
+                << " instead of " << static_cast<int>( expected[k] ) << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+/**
+ * The slab phantom is checked against hand computed attribute vectors at a
+ * few voxels, including voxels on and next to the image boundary, and the
+ * ball phantom is checked for identical output with one and with several
+ * threads.
+ */
+int
+main(int /*argc*/, char * [] /*argv*/)
+{
+  bool passed = true;
+
+  // With Scale 1 the feature neighborhood has 7 entries: the center three
+  // times (the z offsets of +-1 are divided by 1.5 and truncated to 0) and
+  // the 4 neighbors along x and y.  Attributes are unsigned char, so the
+  // GMIs 100 * sum / 7 are truncated.
+  const AttributeImageType::Pointer slab = ComputeAttributes(MakeSlabPhantom(), 1.0F, 4);
+  // x = 3, WM center, GM 6-neighbor sum 4 * 0.3 + 0.715 > CSF sum 0.085: WM/GM edge.
+  // non-WM (5 * 0.3 + 0 + 0.8) / 7, CSF 0.085 / 7, GM (5 * 0.3 + 0.715) / 7
+  const unsigned char wmEdge[5] = { 255, 0, 32, 1, 31 };
+  passed = CheckVoxel(slab, 3, 5, 5, wmEdge) && passed;
+  // Next to the boundary the 6-neighbors are still inside the image.
+  passed = CheckVoxel(slab, 3, 1, 1, wmEdge) && passed;
+  // x = 4, GM center, WM sum 4 * 0.2 + 0.7 > CSF sum 4 * 0.085 + 0.455: WM/GM edge.
+  // non-WM (5 * 0.8 + 0.3 + 1) / 7, CSF (5 * 0.085 + 0.455) / 7, GM (5 * 0.715 + 0.3 + 0.545) / 7
+  const unsigned char gmEdge[5] = { 255, 0, 75, 12, 63 };
+  passed = CheckVoxel(slab, 4, 5, 5, gmEdge) && passed;
+  // x = 5, GM center, WM sum 0.2 <= CSF sum 4 * 0.455 + 0.085 + 0.865: WM/CSF edge.
+  // non-WM (5 + 0.8 + 1) / 7, CSF (5 * 0.455 + 0.085 + 0.865) / 7, GM (5 * 0.545 + 0.715 + 0.135) / 7
+  const unsigned char gmCSFEdge[5] = { 180, 0, 97, 46, 51 };
+  passed = CheckVoxel(slab, 5, 5, 5, gmCSFEdge) && passed;
+  // x = 6, CSF center, GM sum 4 * 0.135 + 0.545 > WM sum 0: WM/CSF edge.
+  // non-WM 7 / 7, CSF (5 * 0.865 + 0.455 + 1) / 7, GM (5 * 0.135 + 0.545) / 7
+  const unsigned char csfEdge[5] = { 180, 0, 100, 82, 17 };
+  passed = CheckVoxel(slab, 6, 5, 5, csfEdge) && passed;
+  // x = 2, pure WM, GM sum 0.3 is not above the strength: no edge, no GMIs.
+  const unsigned char pureWM[5] = { 0, 1, 0, 0, 0 };
+  passed = CheckVoxel(slab, 2, 5, 5, pureWM) && passed;
+  passed = CheckVoxel(slab, 0, 5, 5, pureWM) && passed;
+  // Boundary voxels get no edge, even where the interior voxels have one.
+  const unsigned char noEdge[5] = { 0, 0, 0, 0, 0 };
+  passed = CheckVoxel(slab, 4, 5, 0, noEdge) && passed;
+  passed = CheckVoxel(slab, 5, 9, 5, noEdge) && passed;
+
+  // The multithreaded output is identical to the single threaded output.
+  const TissueImages                ball = MakeBallPhantom();
+  const AttributeImageType::Pointer serial = ComputeAttributes(ball, 3.0F, 1);
+  const AttributeImageType::Pointer threaded = ComputeAttributes(ball, 3.0F, 4);
+  unsigned int                      edgeVoxels = 0;
+  for( itk::ImageRegionConstIteratorWithIndex<AttributeImageType> it(serial, serial->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const AttributeVectorType & expected = it.Get();
+    const AttributeVectorType & actual = threaded->GetPixel(it.GetIndex() );
+    edgeVoxels += ( expected[0] != 0 ) ? 1 : 0;
+    for( unsigned int k = 0; k < 5; ++k )
+      {
+      if( actual[k] != expected[k] )
+        {
+        std::cerr << "Threaded attribute " << k << " at " << it.GetIndex() << " is "
+                  << static_cast<int>( actual[k] ) << " instead of " << static_cast<int>( expected[k] )
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  if( edgeVoxels == 0 )
+    {
+    std::cerr << "The ball phantom has no edge voxels" << std::endl;
+    passed = false;
+    }
+
+  if( !passed )
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "PASSED" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -21,7 +21,9 @@
 #include "itkExtractImageFilter.h"
 #include "BRAINSCommonLib.h"
 #include "BRAINSThreadControl.h"
+#include "BRAINSTrace.h"
 #include "BRAINSFitHelper.h"
+#include "RegistrationTrace.h"
 #include "BRAINSFitCLP.h"
 
 #include "BRAINSToolsVersion.h"
@@ -116,6 +118,11 @@ int main(int argc, char *argv[])
 
   BRAINSRegisterAlternateIO();
 
+  if( !registrationTraceFile.empty() )
+    {
+    BRAINSFit::RegistrationTrace::GetInstance().SetFileName(registrationTraceFile);
+    }
+
 #ifdef USE_DebugImageViewer
   if( UseDebugImageViewer )
     {
@@ -125,6 +132,7 @@ int main(int argc, char *argv[])
   typedef itk::Transform<double, 3, 3> GenericTransformType;
 
   const BRAINSUtils::StackPushITKDefaultNumberOfThreads TempDefaultNumberOfThreadsHolder(numberOfThreads);
+  BRAINS_TRACE_SCOPE("BRAINSFit");
   if( debugLevel > 1 )
     {
     std::cout << "Number Of Threads used: " << numberOfThreads << std::endl;
@@ -408,6 +416,7 @@ int main(int argc, char *argv[])
       return EXIT_FAILURE;
       }
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::ROIAutoFixed");
       typedef itk::BRAINSROIAutoImageFilter<FixedVolumeType, itk::Image<unsigned char, 3> > ROIAutoType;
       ROIAutoType::Pointer ROIFilter = ROIAutoType::New();
       ROIFilter->SetInput(extractFixedVolume);
@@ -417,6 +426,7 @@ int main(int argc, char *argv[])
       fixedMask = ROIFilter->GetSpatialObjectROI();
       }
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::ROIAutoMoving");
       typedef itk::BRAINSROIAutoImageFilter<MovingVolumeType, itk::Image<unsigned char, 3> > ROIAutoType;
       ROIAutoType::Pointer ROIFilter = ROIAutoType::New();
       ROIFilter->SetInput(extractMovingVolume);
@@ -515,6 +525,10 @@ int main(int argc, char *argv[])
     myHelper->SetMaskInferiorCutOffFromCenter(maskInferiorCutOffFromCenter);
     myHelper->SetCurrentGenericTransform(currentGenericTransform);
     myHelper->SetSplineGridSize(BSplineGridSize);
+    myHelper->SetShrinkFactorsPerLevel(shrinkFactorsPerLevel);
+    myHelper->SetSmoothingSigmasPerLevel(smoothingSigmasPerLevel);
+    myHelper->SetBSplineShrinkFactorsPerLevel(bsplineShrinkFactorsPerLevel);
+    myHelper->SetBSplineSmoothingSigmasPerLevel(bsplineSmoothingSigmasPerLevel);
     myHelper->SetCostFunctionConvergenceFactor(costFunctionConvergenceFactor);
     myHelper->SetProjectedGradientTolerance(projectedGradientTolerance);
     myHelper->SetMaxBSplineDisplacement(maxBSplineDisplacement);
@@ -568,6 +582,7 @@ int main(int argc, char *argv[])
       }
 
       {
+      BRAINS_TRACE_SCOPE("BRAINSFit::ResampleOutput");
       typedef float                                                                     VectorComponentType;
       typedef itk::Vector<VectorComponentType, 3> VectorPixelType;
       typedef itk::Image<VectorPixelType,  3>     DisplacementFieldType;
@@ -29,122 +29,36 @@
 #include "itkComposeImageFilter.h"
 #include "itkResampleImageFilter.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
+#include "itkMultiThreaderBase.h"
+#include "BRAINSThreadControl.h"
+#include "BRAINSSnapShotWriterUtilities.h"
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 
 #include "BRAINSSnapShotWriterCLP.h"
 
-/*
- * extracting slice numbers in index
- */
-
-typedef std::vector<size_t> ExtractIndexType;
-
-typedef std::vector<int> IndexType;
-typedef std::vector<int> PercentIndexType;
-typedef std::vector<float> PhysicalPointIndexType;
-
 constexpr size_t NN_INTERP = 0;
 constexpr size_t LINEAR_INTERP = 1;
 
-template<class TImageType>
-ExtractIndexType GetSliceIndexToExtract(
-  typename TImageType::Pointer referenceImage,
-  std::vector<int> planes,
-  IndexType inputSliceToExtractInIndex,
-  PercentIndexType inputSliceToExtractInPercent,
-  PhysicalPointIndexType inputSliceToExtractInPhysicalPoint)
-{
-  if (inputSliceToExtractInIndex.empty() &&
-      inputSliceToExtractInPercent.empty() &&
-      inputSliceToExtractInPhysicalPoint.empty())
-  {
-    std::cout << "ERROR:: one of input index has to be entered "
-    << std::endl;
-    exit(EXIT_FAILURE);
-  }
-
-  ExtractIndexType sliceIndexToExtract;
-  if (!inputSliceToExtractInIndex.empty())
-  {
-    for (size_t i = 0; i < inputSliceToExtractInIndex.size(); i++)
-    {
-      sliceIndexToExtract.push_back(inputSliceToExtractInIndex[i]);
-    }
-  }
-  else if (!inputSliceToExtractInPhysicalPoint.empty())
-  {
-    for (unsigned int i = 0; i < inputSliceToExtractInPhysicalPoint.size(); i++)
-    {
-      typename TImageType::PointType physicalPoints;
-      typename TImageType::IndexType dummyIndex;
-      for (unsigned int p = 0; p < physicalPoints.Size(); p++)
-      {
-        // fill the same value
-        physicalPoints[p] = inputSliceToExtractInPhysicalPoint[i];
-      }
-      referenceImage->TransformPhysicalPointToIndex(physicalPoints,
-                                                    dummyIndex);
-
-      std::cout << inputSliceToExtractInPhysicalPoint[i]
-      << "-->"
-      << dummyIndex[planes[i]]
-      << std::endl;
-      sliceIndexToExtract.push_back(dummyIndex[planes[i]]);
-    }
-  }
-  else if (!inputSliceToExtractInPercent.empty())
-  {
-    for (unsigned int i = 0; i < inputSliceToExtractInPercent.size(); i++)
-    {
-      if (inputSliceToExtractInPercent[i] < 0.0F ||
-          inputSliceToExtractInPercent[i] > 100.0F)
-      {
-        std::cout << "ERROR: Percent has to be between 0 and 100 "
-        << std::endl;
-        exit(EXIT_FAILURE);
-      }
-      unsigned int size = (referenceImage->GetBufferedRegion()).GetSize()[planes[i]];
-      unsigned int index =
-        static_cast<unsigned int>((float) inputSliceToExtractInPercent[i] / 100.0F) * size;
-
-      std::cout << inputSliceToExtractInPercent[i]
-      << "-->"
-      << index
-      << std::endl;
-      sliceIndexToExtract.push_back(index);
-    }
-  }
+/* type definition */
+typedef itk::Image<double, 3> Image3DVolumeType;
+typedef itk::Image<double, 2> Image2DVolumeType;
+typedef itk::Image<unsigned char, 3> Image3DBinaryType;
 
-  return sliceIndexToExtract;
-}
+typedef std::vector<std::string> ImageFilenameVectorType;
+typedef std::vector<Image3DVolumeType::Pointer> Image3DVolumeVectorType;
+typedef std::vector<Image3DBinaryType::Pointer> Image3DBinaryVectorType;
 
-/*
- * change orientation
- */
-template<class TImageType>
-// input parameter type
-typename TImageType::Pointer ChangeOrientOfImage(typename TImageType::Pointer imageVolume,
-                                                 itk::FixedArray<bool, 3> flipAxes)
-{
-  typedef itk::FlipImageFilter<TImageType> FlipImageFilterType;
+typedef itk::ImageFileReader<Image3DVolumeType> Image3DVolumeReaderType;
 
-  typename FlipImageFilterType::Pointer flipFilter =
-    FlipImageFilterType::New();
+typedef itk::ImageFileReader<Image3DBinaryType> Image3DBinaryReaderType;
 
-  flipFilter->SetInput(imageVolume);
-  flipFilter->SetFlipAxes(flipAxes);
-  try
-  {
-    flipFilter->Update();
-  }
-  catch (...)
-  {
-    std::cout << "ERROR: Fail to flip the image "
-    << std::endl;
-  }
+typedef itk::Image<unsigned char, 2> OutputGreyImageType;
 
-  return flipFilter->GetOutput();
-}
+typedef itk::RGBPixel<unsigned char> RGBPixelType;
+typedef itk::Image<RGBPixelType, 2> OutputRGBImageType;
 
 /*
  * template reading function
@@ -187,12 +101,8 @@ TImageVectorType ReadImageVolumes(TStringVectorType filenameVector, const size_t
 
     OutputImagePointerType image = reader->GetOutput();
 
-    itk::FixedArray<bool, 3> flipAxes;
-    flipAxes[0] = 0;
-    flipAxes[1] = 0;
-    flipAxes[2] = 1;
     OutputImagePointerType orientedImage =
-      ChangeOrientOfImage<OutImageType>(image, flipAxes);
+      ChangeOrientOfImage<OutImageType>(image, GetSnapShotFlipAxes());
     if (i > 0)
     {
       typename ResampleType::Pointer resampler = ResampleType::New();
@@ -308,6 +218,367 @@ Rescale(const typename TInputImage::Pointer inputImage,
   return outputImage;
 }
 
+/*
+ * streaming mode
+ *
+ * Only the slab holding each requested slice is read from disk (formats that
+ * support streamed reading read just that region), the slice is taken
+ * directly from the slab, and the grey scale window is computed from a
+ * sampled histogram of the slice.  Many subjects can be rendered by one
+ * process, one subject per thread.
+ */
+struct SnapShotJob
+{
+  std::string             OutputFilename;
+  ImageFilenameVectorType InputVolumes;
+  ImageFilenameVectorType InputBinaryVolumes;
+};
+
+struct SnapShotSettings
+{
+  std::vector<int>       Planes;
+  IndexType              SliceInIndex;
+  PercentIndexType       SliceInPercent;
+  PhysicalPointIndexType SliceInPhysicalPoint;
+  float                  LowerPercentile;
+  float                  UpperPercentile;
+};
+
+/*
+ * read the single slice slab of a volume that holds slice sliceNumber of the
+ * flipped volume, and return it as a 2D image in ExtractSlice layout
+ */
+template<class TImageType>
+typename itk::Image<typename TImageType::PixelType, 2>::Pointer
+ReadSliceFromSlab(const std::string & filename,
+                  const int plane,
+                  const itk::IndexValueType sliceNumber)
+{
+  typedef itk::ImageFileReader<TImageType>                     ReaderType;
+  typedef itk::Image<typename TImageType::PixelType, 2>        SliceType;
+
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(filename);
+  reader->UpdateOutputInformation();
+
+  const typename TImageType::RegionType largestRegion = reader->GetOutput()->GetLargestPossibleRegion();
+  const typename TImageType::IndexType start = largestRegion.GetIndex();
+  const typename TImageType::SizeType size = largestRegion.GetSize();
+  if (plane < 0 || plane > 2)
+  {
+    itkGenericExceptionMacro(<< "Extracting plane should be between 0 and 2(0,1,or 2)");
+  }
+  if (sliceNumber < start[plane] ||
+      sliceNumber >= start[plane] + static_cast<itk::IndexValueType>(size[plane]))
+  {
+    itkGenericExceptionMacro(<< "Slice " << sliceNumber << " is outside of " << filename);
+  }
+
+  /* the third axis is flipped, so an axial slice maps to the mirrored slab */
+  typename TImageType::RegionType slabRegion = largestRegion;
+  slabRegion.SetSize(plane, 1);
+  slabRegion.SetIndex(plane,
+                      (plane == 2) ? start[2] + static_cast<itk::IndexValueType>(size[2]) - 1 - (sliceNumber - start[2])
+                                   : sliceNumber);
+  reader->GetOutput()->SetRequestedRegion(slabRegion);
+  reader->Update();
+  const TImageType *slab = reader->GetOutput();
+
+  unsigned int sliceAxes[2];
+  for (unsigned int d = 0, a = 0; d < 3; ++d)
+  {
+    if (static_cast<int>(d) != plane)
+    {
+      sliceAxes[a++] = d;
+    }
+  }
+
+  typename SliceType::SizeType sliceSize;
+  typename SliceType::SpacingType sliceSpacing;
+  for (unsigned int a = 0; a < 2; ++a)
+  {
+    sliceSize[a] = size[sliceAxes[a]];
+    sliceSpacing[a] = slab->GetSpacing()[sliceAxes[a]];
+  }
+  typename SliceType::Pointer slice = SliceType::New();
+  slice->SetRegions(sliceSize);
+  slice->SetSpacing(sliceSpacing);
+  slice->Allocate();
+
+  typename TImageType::IndexType slabIndex = slabRegion.GetIndex();
+  typename SliceType::IndexType sliceIndex;
+  for (sliceIndex[1] = 0; sliceIndex[1] < static_cast<itk::IndexValueType>(sliceSize[1]); ++sliceIndex[1])
+  {
+    for (sliceIndex[0] = 0; sliceIndex[0] < static_cast<itk::IndexValueType>(sliceSize[0]); ++sliceIndex[0])
+    {
+      for (unsigned int a = 0; a < 2; ++a)
+      {
+        const unsigned int d = sliceAxes[a];
+        slabIndex[d] = (d == 2) ? start[2] + static_cast<itk::IndexValueType>(size[2]) - 1 - sliceIndex[a]
+                                : start[d] + sliceIndex[a];
+      }
+      slice->SetPixel(sliceIndex, slab->GetPixel(slabIndex));
+    }
+  }
+  return slice;
+}
+
+/*
+ * scaling between 0-255 with a window from a sampled histogram; percentiles
+ * 0 and 100 give the same min/max window as Rescale
+ */
+OutputGreyImageType::Pointer
+RescaleWithSampledWindow(const Image2DVolumeType *inputImage,
+                         const float lowerPercentile,
+                         const float upperPercentile)
+{
+  const size_t numberOfPixels = inputImage->GetBufferedRegion().GetNumberOfPixels();
+  const double *buffer = inputImage->GetBufferPointer();
+
+  constexpr size_t maximumNumberOfSamples = 16384;
+  const size_t sampleStride = std::max<size_t>(1, numberOfPixels / maximumNumberOfSamples);
+  std::vector<double> samples;
+  samples.reserve(numberOfPixels / sampleStride + 1);
+  for (size_t i = 0; i < numberOfPixels; i += sampleStride)
+  {
+    samples.push_back(buffer[i]);
+  }
+
+  double windowMin = 0.0;
+  double windowMax = 0.0;
+  if (lowerPercentile <= 0.0F && upperPercentile >= 100.0F)
+  {
+    const std::pair<const double *, const double *> minMax =
+      std::minmax_element(buffer, buffer + numberOfPixels);
+    windowMin = *minMax.first;
+    windowMax = *minMax.second;
+  }
+  else if (!samples.empty())
+  {
+    const size_t lowerRank = static_cast<size_t>(lowerPercentile / 100.0F * (samples.size() - 1));
+    const size_t upperRank = static_cast<size_t>(upperPercentile / 100.0F * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + lowerRank, samples.end());
+    windowMin = samples[lowerRank];
+    std::nth_element(samples.begin(), samples.begin() + upperRank, samples.end());
+    windowMax = samples[upperRank];
+  }
+
+  OutputGreyImageType::Pointer outputImage = OutputGreyImageType::New();
+  outputImage->CopyInformation(inputImage);
+  outputImage->SetRegions(inputImage->GetBufferedRegion());
+  outputImage->Allocate();
+  unsigned char *outputBuffer = outputImage->GetBufferPointer();
+  const double scale = (windowMax > windowMin) ? 255.0 / (windowMax - windowMin) : 0.0;
+  for (size_t i = 0; i < numberOfPixels; ++i)
+  {
+    const double value = std::min(std::max((buffer[i] - windowMin) * scale, 0.0), 255.0);
+    outputBuffer[i] = static_cast<unsigned char>(value);
+  }
+  return outputImage;
+}
+
+/*
+ * render one montage; returns false (after reporting) on failure so that the
+ * other subjects can continue
+ */
+bool RenderSnapShotStreaming(const SnapShotJob &job, const SnapShotSettings &settings)
+{
+  try
+  {
+    if (job.InputVolumes.empty())
+    {
+      itkGenericExceptionMacro(<< "Input image volume is required for " << job.OutputFilename);
+    }
+    Image3DVolumeReaderType::Pointer referenceReader = Image3DVolumeReaderType::New();
+    referenceReader->SetFileName(job.InputVolumes[0]);
+    referenceReader->UpdateOutputInformation();
+    Image3DVolumeType::Pointer referenceImage =
+      FlippedImageInformation<Image3DVolumeType>(referenceReader->GetOutput(), GetSnapShotFlipAxes());
+
+    const ExtractIndexType extractingSlices =
+      GetSliceIndexToExtract<Image3DVolumeType>(referenceImage,
+                                                settings.Planes,
+                                                settings.SliceInIndex,
+                                                settings.SliceInPercent,
+                                                settings.SliceInPhysicalPoint);
+
+    typedef itk::LabelOverlayImageFilter<OutputGreyImageType, OutputGreyImageType, OutputRGBImageType> LabelOverlayFilter;
+    typedef itk::ComposeImageFilter<OutputGreyImageType, OutputRGBImageType> RGBComposeFilter;
+    typedef itk::TileImageFilter<OutputRGBImageType, OutputRGBImageType> TileFilterType;
+
+    const size_t numberOfImgs = job.InputVolumes.size();
+    TileFilterType::Pointer tileFilter = TileFilterType::New();
+    itk::FixedArray<unsigned int, 2> layout;
+    layout[0] = numberOfImgs;
+    layout[1] = 0;
+    tileFilter->SetLayout(layout);
+    tileFilter->SetDefaultPixelValue(128);
+    tileFilter->SetNumberOfThreads(1);
+
+    for (unsigned int plane = 0; plane < settings.Planes.size(); plane++)
+    {
+      /** combine binary slices, label color zero is grey */
+      OutputGreyImageType::Pointer labelSlice;
+      for (unsigned int b = 0; b < job.InputBinaryVolumes.size(); b++)
+      {
+        itk::Image<unsigned char, 2>::Pointer binarySlice =
+          ReadSliceFromSlab<Image3DBinaryType>(job.InputBinaryVolumes[b], settings.Planes[plane],
+                                               extractingSlices[plane]);
+        if (labelSlice.IsNull())
+        {
+          labelSlice = OutputGreyImageType::New();
+          labelSlice->CopyInformation(binarySlice);
+          labelSlice->SetRegions(binarySlice->GetBufferedRegion());
+          labelSlice->Allocate(true);
+        }
+        const size_t numberOfPixels = labelSlice->GetBufferedRegion().GetNumberOfPixels();
+        unsigned char *labels = labelSlice->GetBufferPointer();
+        const unsigned char *binary = binarySlice->GetBufferPointer();
+        for (size_t i = 0; i < numberOfPixels; ++i)
+        {
+          if (job.InputBinaryVolumes.size() == 1)
+          {
+            labels[i] = binary[i];
+          }
+          else if (binary[i] > 0)
+          {
+            labels[i] = b + 1;
+          }
+        }
+      }
+
+      for (unsigned int i = 0; i < numberOfImgs; i++)
+      {
+        Image2DVolumeType::Pointer imageSlice =
+          ReadSliceFromSlab<Image3DVolumeType>(job.InputVolumes[i], settings.Planes[plane], extractingSlices[plane]);
+        OutputGreyImageType::Pointer greyScaleSlice =
+          RescaleWithSampledWindow(imageSlice, settings.LowerPercentile, settings.UpperPercentile);
+
+        OutputRGBImageType::Pointer rgbSlice;
+        if (labelSlice.IsNotNull())
+        {
+          LabelOverlayFilter::Pointer rgbComposer = LabelOverlayFilter::New();
+          rgbComposer->SetLabelImage(labelSlice);
+          rgbComposer->SetInput(greyScaleSlice);
+          rgbComposer->SetOpacity(.5F);
+          rgbComposer->SetNumberOfThreads(1);
+          rgbComposer->Update();
+          rgbSlice = rgbComposer->GetOutput();
+        }
+        else
+        {
+          RGBComposeFilter::Pointer rgbComposer = RGBComposeFilter::New();
+          rgbComposer->SetInput1(greyScaleSlice);
+          rgbComposer->SetInput2(greyScaleSlice);
+          rgbComposer->SetInput3(greyScaleSlice);
+          rgbComposer->SetNumberOfThreads(1);
+          rgbComposer->Update();
+          rgbSlice = rgbComposer->GetOutput();
+        }
+        tileFilter->SetInput(i + plane * numberOfImgs, rgbSlice);
+      }
+    }
+
+    typedef itk::ImageFileWriter<OutputRGBImageType> RGBFileWriterType;
+    RGBFileWriterType::Pointer rgbFileWriter = RGBFileWriterType::New();
+    rgbFileWriter->SetInput(tileFilter->GetOutput());
+    rgbFileWriter->SetFileName(job.OutputFilename);
+    rgbFileWriter->Update();
+  }
+  catch (itk::ExceptionObject &e)
+  {
+    std::cout << "ERROR:  Could not create snapshot " << job.OutputFilename << std::endl;
+    std::cout << "ERROR:  " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * subject list: one montage per line,
+ *   outputFilename inputVolume1[,inputVolume2...] [inputBinaryVolume1[,inputBinaryVolume2...]]
+ */
+std::vector<SnapShotJob> ReadSnapShotJobs(const std::string &subjectListFile)
+{
+  std::vector<SnapShotJob> jobs;
+  std::ifstream listFile(subjectListFile.c_str());
+  if (!listFile.is_open())
+  {
+    std::cout << "ERROR:  Could not read subject list " << subjectListFile << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::string line;
+  while (std::getline(listFile, line))
+  {
+    std::istringstream fields(line);
+    std::string volumes;
+    std::string binaries;
+    SnapShotJob job;
+    if (!(fields >> job.OutputFilename >> volumes) || job.OutputFilename[0] == '#')
+    {
+      continue;
+    }
+    fields >> binaries;
+    std::istringstream volumeList(volumes);
+    for (std::string name; std::getline(volumeList, name, ',');)
+    {
+      job.InputVolumes.push_back(name);
+    }
+    std::istringstream binaryList(binaries);
+    for (std::string name; std::getline(binaryList, name, ',');)
+    {
+      job.InputBinaryVolumes.push_back(name);
+    }
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+struct SnapShotThreadStruct
+{
+  const std::vector<SnapShotJob> *Jobs;
+  const SnapShotSettings         *Settings;
+  std::vector<char>              *Succeeded;
+};
+
+ITK_THREAD_RETURN_TYPE RenderSnapShotsThreaderCallback(void *arg)
+{
+  typedef itk::MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType *threadInfo = static_cast<ThreadInfoType *>(arg);
+  SnapShotThreadStruct *str = static_cast<SnapShotThreadStruct *>(threadInfo->UserData);
+  for (size_t j = threadInfo->ThreadID; j < str->Jobs->size(); j += threadInfo->NumberOfThreads)
+  {
+    (*str->Succeeded)[j] = RenderSnapShotStreaming((*str->Jobs)[j], *str->Settings);
+  }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+int RenderSnapShotsStreaming(const std::vector<SnapShotJob> &jobs, const SnapShotSettings &settings)
+{
+  std::vector<char> succeeded(jobs.size(), 0);
+  SnapShotThreadStruct str;
+  str.Jobs = &jobs;
+  str.Settings = &settings;
+  str.Succeeded = &succeeded;
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  threader->SetNumberOfThreads(
+    std::max<itk::ThreadIdType>(1, std::min<itk::ThreadIdType>(threader->GetNumberOfThreads(), jobs.size())));
+  threader->SetSingleMethod(RenderSnapShotsThreaderCallback, &str);
+  threader->SingleMethodExecute();
+
+  const size_t numberOfFailures = std::count(succeeded.begin(), succeeded.end(), 0);
+  for (size_t j = 0; j < jobs.size(); ++j)
+  {
+    if (!succeeded[j])
+    {
+      std::cout << "FAILED: " << jobs[j].OutputFilename << std::endl;
+    }
+  }
+  std::cout << "Wrote " << jobs.size() - numberOfFailures << " of " << jobs.size() << " snapshots." << std::endl;
+  return (numberOfFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 /*
  * main
  */
@@ -317,8 +588,9 @@ main(int argc, char **argv)
 {
   PARSE_ARGS;
   BRAINSRegisterAlternateIO();
+  const BRAINSUtils::StackPushITKDefaultNumberOfThreads TempDefaultNumberOfThreadsHolder(numberOfThreads);
 
-  if (inputVolumes.empty())
+  if (inputVolumes.empty() && subjectListFile.empty())
   {
     std::cout << "Input image volume is required "
     << std::endl;
@@ -348,25 +620,41 @@ main(int argc, char **argv)
     exit(EXIT_FAILURE);
   }
 
-  const size_t numberOfImgs = inputVolumes.size();
-
-  /* type definition */
-  typedef itk::Image<double, 3> Image3DVolumeType;
-  typedef itk::Image<double, 2> Image2DVolumeType;
-  typedef itk::Image<unsigned char, 3> Image3DBinaryType;
-
-  typedef std::vector<std::string> ImageFilenameVectorType;
-  typedef std::vector<Image3DVolumeType::Pointer> Image3DVolumeVectorType;
-  typedef std::vector<Image3DBinaryType::Pointer> Image3DBinaryVectorType;
-
-  typedef itk::ImageFileReader<Image3DVolumeType> Image3DVolumeReaderType;
-
-  typedef itk::ImageFileReader<Image3DBinaryType> Image3DBinaryReaderType;
-
-  typedef itk::Image<unsigned char, 2> OutputGreyImageType;
+  if (streamSlices || !subjectListFile.empty())
+  {
+    if (rescaleWindowPercentiles.size() != 2 ||
+        rescaleWindowPercentiles[0] < 0.0F || rescaleWindowPercentiles[1] > 100.0F ||
+        rescaleWindowPercentiles[0] >= rescaleWindowPercentiles[1])
+    {
+      std::cout << "ERROR: rescaleWindowPercentiles must be two increasing values between 0 and 100 "
+      << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    SnapShotSettings settings;
+    settings.Planes = inputPlaneDirection;
+    settings.SliceInIndex = inputSliceToExtractInIndex;
+    settings.SliceInPercent = inputSliceToExtractInPercent;
+    settings.SliceInPhysicalPoint = inputSliceToExtractInPhysicalPoint;
+    settings.LowerPercentile = rescaleWindowPercentiles[0];
+    settings.UpperPercentile = rescaleWindowPercentiles[1];
+
+    std::vector<SnapShotJob> jobs;
+    if (!subjectListFile.empty())
+    {
+      jobs = ReadSnapShotJobs(subjectListFile);
+    }
+    else
+    {
+      SnapShotJob job;
+      job.OutputFilename = outputFilename;
+      job.InputVolumes = inputVolumes;
+      job.InputBinaryVolumes = inputBinaryVolumes;
+      jobs.push_back(job);
+    }
+    return RenderSnapShotsStreaming(jobs, settings);
+  }
 
-  typedef itk::RGBPixel<unsigned char> RGBPixelType;
-  typedef itk::Image<RGBPixelType, 2> OutputRGBImageType;
+  const size_t numberOfImgs = inputVolumes.size();
 
   /* read in image volumes */
   Image3DVolumeVectorType image3DVolumes = ReadImageVolumes<ImageFilenameVectorType,
@@ -380,12 +668,21 @@ main(int argc, char **argv)
     Image3DBinaryVectorType>
     (inputBinaryVolumes, NN_INTERP);
 
-  ExtractIndexType extractingSlices =
-    GetSliceIndexToExtract<Image3DVolumeType>(image3DVolumes[0],
-                                              inputPlaneDirection,
-                                              inputSliceToExtractInIndex,
-                                              inputSliceToExtractInPercent,
-                                              inputSliceToExtractInPhysicalPoint);
+  ExtractIndexType extractingSlices;
+  try
+  {
+    extractingSlices =
+      GetSliceIndexToExtract<Image3DVolumeType>(image3DVolumes[0],
+                                                inputPlaneDirection,
+                                                inputSliceToExtractInIndex,
+                                                inputSliceToExtractInPercent,
+                                                inputSliceToExtractInPhysicalPoint);
+  }
+  catch (itk::ExceptionObject &e)
+  {
+    std::cout << "ERROR:  " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
 
   /* combine binary images */
   Image3DVolumeType::Pointer labelMap = Image3DVolumeType::New();
@@ -0,0 +1,173 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef BRAINSSnapShotWriterUtilities_h
+#define BRAINSSnapShotWriterUtilities_h
+
+#include "itkFlipImageFilter.h"
+#include "itkMacro.h"
+
+#include <iostream>
+#include <vector>
+
+/*
+ * extracting slice numbers in index
+ */
+
+typedef std::vector<size_t> ExtractIndexType;
+
+typedef std::vector<int> IndexType;
+typedef std::vector<int> PercentIndexType;
+typedef std::vector<float> PhysicalPointIndexType;
+
+/*
+ * Throws an itk::ExceptionObject on bad input, so that a failing subject in
+ * batch mode does not end the other subjects' threads.
+ */
+template<class TImageType>
+ExtractIndexType GetSliceIndexToExtract(
+  typename TImageType::Pointer referenceImage,
+  std::vector<int> planes,
+  IndexType inputSliceToExtractInIndex,
+  PercentIndexType inputSliceToExtractInPercent,
+  PhysicalPointIndexType inputSliceToExtractInPhysicalPoint)
+{
+  if (inputSliceToExtractInIndex.empty() &&
+      inputSliceToExtractInPercent.empty() &&
+      inputSliceToExtractInPhysicalPoint.empty())
+  {
+    itkGenericExceptionMacro(<< "one of input index has to be entered");
+  }
+
+  ExtractIndexType sliceIndexToExtract;
+  if (!inputSliceToExtractInIndex.empty())
+  {
+    for (size_t i = 0; i < inputSliceToExtractInIndex.size(); i++)
+    {
+      sliceIndexToExtract.push_back(inputSliceToExtractInIndex[i]);
+    }
+  }
+  else if (!inputSliceToExtractInPhysicalPoint.empty())
+  {
+    for (unsigned int i = 0; i < inputSliceToExtractInPhysicalPoint.size(); i++)
+    {
+      typename TImageType::PointType physicalPoints;
+      typename TImageType::IndexType dummyIndex;
+      for (unsigned int p = 0; p < physicalPoints.Size(); p++)
+      {
+        // fill the same value
+        physicalPoints[p] = inputSliceToExtractInPhysicalPoint[i];
+      }
+      referenceImage->TransformPhysicalPointToIndex(physicalPoints,
+                                                    dummyIndex);
+
+      std::cout << inputSliceToExtractInPhysicalPoint[i]
+      << "-->"
+      << dummyIndex[planes[i]]
+      << std::endl;
+      sliceIndexToExtract.push_back(dummyIndex[planes[i]]);
+    }
+  }
+  else if (!inputSliceToExtractInPercent.empty())
+  {
+    for (unsigned int i = 0; i < inputSliceToExtractInPercent.size(); i++)
+    {
+      if (inputSliceToExtractInPercent[i] < 0.0F ||
+          inputSliceToExtractInPercent[i] > 100.0F)
+      {
+        itkGenericExceptionMacro(<< "Percent has to be between 0 and 100");
+      }
+      unsigned int size = (referenceImage->GetBufferedRegion()).GetSize()[planes[i]];
+      unsigned int index =
+        static_cast<unsigned int>((float) inputSliceToExtractInPercent[i] / 100.0F) * size;
+
+      std::cout << inputSliceToExtractInPercent[i]
+      << "-->"
+      << index
+      << std::endl;
+      sliceIndexToExtract.push_back(index);
+    }
+  }
+
+  return sliceIndexToExtract;
+}
+
+/*
+ * the axes flipped when the volumes are read
+ */
+inline itk::FixedArray<bool, 3> GetSnapShotFlipAxes()
+{
+  itk::FixedArray<bool, 3> flipAxes;
+  flipAxes[0] = 0;
+  flipAxes[1] = 0;
+  flipAxes[2] = 1;
+  return flipAxes;
+}
+
+/*
+ * change orientation
+ */
+template<class TImageType>
+// input parameter type
+typename TImageType::Pointer ChangeOrientOfImage(typename TImageType::Pointer imageVolume,
+                                                 itk::FixedArray<bool, 3> flipAxes)
+{
+  typedef itk::FlipImageFilter<TImageType> FlipImageFilterType;
+
+  typename FlipImageFilterType::Pointer flipFilter =
+    FlipImageFilterType::New();
+
+  flipFilter->SetInput(imageVolume);
+  flipFilter->SetFlipAxes(flipAxes);
+  try
+  {
+    flipFilter->Update();
+  }
+  catch (...)
+  {
+    std::cout << "ERROR: Fail to flip the image "
+    << std::endl;
+  }
+
+  return flipFilter->GetOutput();
+}
+
+/*
+ * image information (no pixels) of ChangeOrientOfImage(image, flipAxes),
+ * taken from the output information of the same FlipImageFilter
+ */
+template<class TImageType>
+typename TImageType::Pointer FlippedImageInformation(TImageType *image,
+                                                     itk::FixedArray<bool, 3> flipAxes)
+{
+  typedef itk::FlipImageFilter<TImageType> FlipImageFilterType;
+
+  typename FlipImageFilterType::Pointer flipFilter =
+    FlipImageFilterType::New();
+
+  flipFilter->SetInput(image);
+  flipFilter->SetFlipAxes(flipAxes);
+  flipFilter->UpdateOutputInformation();
+
+  typename TImageType::Pointer flipped = TImageType::New();
+  flipped->CopyInformation(flipFilter->GetOutput());
+  flipped->SetRegions(flipFilter->GetOutput()->GetLargestPossibleRegion());
+  return flipped;
+}
+
+#endif // BRAINSSnapShotWriterUtilities_h
@@ -0,0 +1,117 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <iostream>
+#include "itkEuler3DTransform.h"
+#include "BRAINSSnapShotWriterUtilities.h"
+
+/**
+ * The streaming mode selects slices from the header-only FlippedImageInformation
+ * of the reference volume, the default mode from the flipped volume itself.
+ * Both must pick the same slice for a physical point, also on an oblique
+ * volume, and a bad slice request must throw instead of exiting.
+ */
+int
+main(int /*argc*/, char * [] /*argv*/)
+{
+  typedef itk::Image<double, 3> ImageType;
+
+  ImageType::SizeType size;
+  size[0] = 11;
+  size[1] = 13;
+  size[2] = 9;
+  ImageType::IndexType start;
+  start[0] = 2;
+  start[1] = -3;
+  start[2] = 5;
+  ImageType::RegionType region(start, size);
+
+  ImageType::SpacingType spacing;
+  spacing[0] = 1.5;
+  spacing[1] = 1.0;
+  spacing[2] = 2.5;
+
+  ImageType::PointType origin;
+  origin[0] = -7.25;
+  origin[1] = 4.5;
+  origin[2] = -12.0;
+
+  typedef itk::Euler3DTransform<double> RotationType;
+  RotationType::Pointer rotation = RotationType::New();
+  rotation->SetRotation(0.3, -0.2, 0.45);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
+  image->SetDirection(rotation->GetMatrix());
+  image->Allocate();
+  image->FillBuffer(0.0);
+
+  const ImageType::Pointer flippedImage = ChangeOrientOfImage<ImageType>(image, GetSnapShotFlipAxes());
+  const ImageType::Pointer flippedInformation = FlippedImageInformation<ImageType>(image, GetSnapShotFlipAxes());
+
+  int status = EXIT_SUCCESS;
+  if( flippedImage->GetOrigin() != flippedInformation->GetOrigin()
+      || flippedImage->GetDirection() != flippedInformation->GetDirection()
+      || flippedImage->GetSpacing() != flippedInformation->GetSpacing()
+      || flippedImage->GetLargestPossibleRegion() != flippedInformation->GetLargestPossibleRegion() )
+    {
+    std::cout << "The flipped image information differs from the flipped image" << std::endl;
+    status = EXIT_FAILURE;
+    }
+
+  std::vector<int>       planes;
+  PhysicalPointIndexType physicalPoints;
+  for( int plane = 0; plane < 3; ++plane )
+    {
+    for( float point = -10.0F; point <= 10.0F; point += 2.5F )
+      {
+      planes.push_back(plane);
+      physicalPoints.push_back(point);
+      }
+    }
+
+  const ExtractIndexType fromFlippedImage =
+    GetSliceIndexToExtract<ImageType>(flippedImage, planes, IndexType(), PercentIndexType(), physicalPoints);
+  const ExtractIndexType fromFlippedInformation =
+    GetSliceIndexToExtract<ImageType>(flippedInformation, planes, IndexType(), PercentIndexType(), physicalPoints);
+  for( size_t i = 0; i < planes.size(); ++i )
+    {
+    if( fromFlippedImage[i] != fromFlippedInformation[i] )
+      {
+      std::cout << "Plane " << planes[i] << " point " << physicalPoints[i] << ": slice "
+                << fromFlippedInformation[i] << " instead of " << fromFlippedImage[i] << std::endl;
+      status = EXIT_FAILURE;
+      }
+    }
+
+  PercentIndexType badPercent(1, 120);
+  try
+    {
+    GetSliceIndexToExtract<ImageType>(flippedInformation, std::vector<int>(1, 2), IndexType(), badPercent,
+                                      PhysicalPointIndexType() );
+    std::cout << "A percent above 100 was accepted" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  catch( itk::ExceptionObject & )
+    {
+    }
+
+  return status;
+}
@@ -0,0 +1,113 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/**
+ * Benchmark of the spherical diffeomorphic demons used by
+ * MultiResolutionRegistration.  The size is the resolution of the
+ * icosahedral spheres (IC3 has 642 points, each level has about four times
+ * more); the moving scalars are the fixed pattern rotated about the z axis.
+ */
+#include "BRAINSBenchmark.h"
+#include "itkIcosahedralRegularSphereMeshSource.h"
+#include "itkQuadEdgeMesh.h"
+#include "itkQuadEdgeMeshSphericalDiffeomorphicDemonsFilter.h"
+
+namespace
+{
+typedef itk::QuadEdgeMesh<float, 3> MeshType;
+
+const double SphereRadius = 100.0;
+
+/** Sphere of the given icosahedral resolution carrying a smooth scalar
+ *  pattern, rotated by angle (radians) about the z axis */
+MeshType::Pointer CreatePatternSphere(const unsigned int resolution, const double angle)
+{
+  typedef itk::IcosahedralRegularSphereMeshSource<MeshType> SphereMeshSourceType;
+  SphereMeshSourceType::Pointer sphereMeshSource = SphereMeshSourceType::New();
+
+  SphereMeshSourceType::PointType center;
+  center.Fill(0.0);
+  SphereMeshSourceType::PointType::VectorType scaleVector;
+  scaleVector.Fill(SphereRadius);
+  sphereMeshSource->SetCenter(center);
+  sphereMeshSource->SetScale(scaleVector);
+  sphereMeshSource->SetResolution(resolution);
+  sphereMeshSource->Update();
+
+  MeshType::Pointer mesh = sphereMeshSource->GetOutput();
+  mesh->DisconnectPipeline();
+
+  const double cosine = std::cos(angle);
+  const double sine = std::sin(angle);
+  for( MeshType::PointsContainer::ConstIterator pointIt = mesh->GetPoints()->Begin();
+       pointIt != mesh->GetPoints()->End(); ++pointIt )
+    {
+    const MeshType::PointType & point = pointIt.Value();
+    const double                x = ( cosine * point[0] - sine * point[1] ) / SphereRadius;
+    const double                y = ( sine * point[0] + cosine * point[1] ) / SphereRadius;
+    const double                z = point[2] / SphereRadius;
+    const float                 value = static_cast<float>( 10.0 * std::sin(3.0 * x) * std::cos(2.0 * y) + 5.0 * z * z );
+    mesh->SetPointData(pointIt.Index(), value);
+    }
+  return mesh;
+}
+
+BRAINSBenchmark::Kernel SphericalDemonsKernel(const unsigned int resolution)
+{
+  typedef itk::QuadEdgeMeshSphericalDiffeomorphicDemonsFilter<MeshType, MeshType, MeshType> DemonsFilterType;
+
+  const MeshType::Pointer fixedMesh = CreatePatternSphere(resolution, 0.0);
+  const MeshType::Pointer movingMesh = CreatePatternSphere(resolution, 0.1);
+
+  BRAINSBenchmark::Kernel kernel;
+  kernel.NumberOfItems = fixedMesh->GetNumberOfPoints();
+  kernel.Run = [fixedMesh, movingMesh]()
+    {
+      // The single level settings of MultiResolutionQuadEdgeMeshSphericalDiffeomorphicDemonsFilter.
+      DemonsFilterType::PointType center;
+      center.Fill(0.0);
+      DemonsFilterType::Pointer demonsFilter = DemonsFilterType::New();
+      demonsFilter->SetFixedMesh(fixedMesh);
+      demonsFilter->SetMovingMesh(movingMesh);
+      demonsFilter->SetSphereCenter(center);
+      demonsFilter->SetSphereRadius(SphereRadius);
+      demonsFilter->SetMaximumNumberOfIterations(5);
+      demonsFilter->SetMaximumNumberOfSmoothingIterations(10);
+      demonsFilter->SetEpsilon(0.016);
+      demonsFilter->SetSigmaX(8.0);
+      demonsFilter->SetLambda(1.0);
+      demonsFilter->SetMetricSignificance(1.0);
+      demonsFilter->SelfRegulatedModeOn();
+      demonsFilter->Update();
+    };
+  return kernel;
+}
+}
+
+int main(int argc, char *argv[])
+{
+  BRAINSBenchmark::BenchmarkRunner runner("BRAINSSurfaceTools", argc, argv);
+
+  std::vector<unsigned int> sphereResolutions;
+  sphereResolutions.push_back(3);
+  sphereResolutions.push_back(4);
+  sphereResolutions.push_back(5);
+
+  runner.Add("SphericalDiffeomorphicDemons", sphereResolutions, SphericalDemonsKernel);
+  return runner.Execute();
+}
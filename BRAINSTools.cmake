@@ -65,6 +65,9 @@ if(USE_BRAINSABC)
   if( NOT USE_AutoWorkup )
      message(FATAL_ERROR "BRAINSABC requires USE_AutoWorkup to be ON: ${USE_BRAINSABC} != ${USE_AutoWorkup}")
   endif()
+endif()
+
+if(USE_BRAINSABC OR USE_BRAINSCut)
   find_package(TBB REQUIRED tbb tbbmalloc)
   # set(VTK_SMP_IMPLEMENTATION_LIBRARIES ${tbb_LIBRARY})
   include_directories(${tbb_INCLUDE_DIRS})
@@ -121,6 +124,18 @@ endif()
 option(ENABLE_EXTENDED_TESTING "Enable tests that are long running, or where the test itself is in error." OFF)
 mark_as_advanced(ENABLE_EXTENDED_TESTING)
 
+# Benchmarks of the core kernels on synthetic phantoms.  Building the
+# BRAINSToolsBenchmarks target runs all of them and appends their JSON lines
+# results to BRAINSTools_BENCHMARK_RESULTS_DIR.
+option(BRAINSTools_BUILD_BENCHMARKS "Build the performance benchmarks of the core processing kernels." OFF)
+mark_as_advanced(BRAINSTools_BUILD_BENCHMARKS)
+if(BRAINSTools_BUILD_BENCHMARKS)
+  set(BRAINSTools_BENCHMARK_RESULTS_DIR ${CMAKE_CURRENT_BINARY_DIR}/BenchmarkResults CACHE PATH "Directory where the benchmark results are appended.")
+  set(BRAINSTools_BENCHMARK_ARGS "" CACHE STRING "Extra arguments given to every benchmark program, e.g. --sizes;64,128;--threads;1,8")
+  mark_as_advanced(BRAINSTools_BENCHMARK_RESULTS_DIR BRAINSTools_BENCHMARK_ARGS)
+  add_custom_target(BRAINSToolsBenchmarks)
+endif()
+
 #Set the global max TIMEOUT for CTest jobs.  This is very large for the moment
 #and should be revisted to reduce based on "LONG/SHORT" test times, set to 1 hr for now
 set(CTEST_TEST_TIMEOUT 1800 CACHE STRING "Maximum seconds allowed before CTest will kill the test." FORCE)
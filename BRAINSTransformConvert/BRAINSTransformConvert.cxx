@@ -28,6 +28,7 @@
 #include "itkCompositeTransform.h"
 #include "itkDisplacementFieldTransform.h"
 #include "itkComposeDisplacementFieldsImageFilter.h"
+#include "TransformToDisplacementField.h"
 
 //
 // transform ranking,
@@ -289,23 +290,12 @@ DoConversion( int argc, char *argv[] )
       std::cerr << "Can't read Reference Volume " << referenceVolume << std::endl;
       return EXIT_FAILURE;
       }
-    // Allocate Displacement Field
+    // Evaluate (or reuse from BRAINS_DISPLACEMENT_FIELD_CACHE) the displacement field
     typedef itk::Vector<float, 3>     VectorType;
     typedef itk::Image<VectorType, 3> DisplacementFieldType;
     DisplacementFieldType::Pointer displacementField =
-      itkUtil::AllocateImageFromExample<ReferenceImageType, DisplacementFieldType>(referenceImage);
-
-    typedef itk::ImageRegionIterator<DisplacementFieldType> DisplacementIteratorType;
-    for( DisplacementIteratorType it(displacementField, displacementField->GetLargestPossibleRegion() );
-         !it.IsAtEnd(); ++it )
-      {
-      DisplacementFieldType::IndexType dispIndex = it.GetIndex();
-      DisplacementFieldType::PointType fixedPoint, movingPoint;
-      displacementField->TransformIndexToPhysicalPoint(dispIndex, fixedPoint);
-      movingPoint = inputXfrm->TransformPoint(fixedPoint);
-      VectorType displacement = movingPoint - fixedPoint;
-      it.Set(displacement);
-      }
+      CachedTransformToDisplacementField<DisplacementFieldType::Pointer>(referenceImage.GetPointer(),
+                                                                         inputXfrm.GetPointer() );
 
     try
       {
@@ -57,10 +57,12 @@ DICOM Data Dictionary: http://medical.nema.org/Dicom/2011/11_06pu.pdf
 #undef HAVE_SSTREAM
 #include "DWIConvertCLP.h"
 #include "DWIConvertLib.h"
+#include "BRAINSTrace.h"
 
 int main(int argc, char *argv[])
 {
     PARSE_ARGS;
+    BRAINS_TRACE_SCOPE("DWIConvert");
     //const std::string version = commandLine.getVersion();
     //BRAINSRegisterAlternateIO();
 
@@ -92,6 +94,7 @@ int main(int argc, char *argv[])
     dWIConvert.setOutputDirectory(outputDirectory);
     dWIConvert.setOutputBValues(outputBValues);
     dWIConvert.setOutputBVectors(outputBVectors);
+    dWIConvert.setUseCompression(useCompression);
 
     int result = dWIConvert.read();
     if (EXIT_SUCCESS == result)
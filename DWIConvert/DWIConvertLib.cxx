@@ -3,6 +3,7 @@
 //
 
 #include "DWIConvertLib.h"
+#include "BRAINSTrace.h"
 
 #include "dcmtk/oflog/helpers/loglog.h"
 #include "dcmtk/dcmimgle/dcmimage.h"
@@ -30,6 +31,7 @@ DWIConvert::DWIConvert()
     m_allowLossyConversion = false; //defualt: false
     m_useIdentityMeasurementFrame = false; //default: false
     m_useBMatrixGradientDirections = false; //default: false
+    m_useCompression = false; //default: false
 
     m_outputVolume = emptyString;
     m_outputDirectory = ".";  //default: "."
@@ -59,6 +61,7 @@ DWIConvert::~DWIConvert(){
 
 int DWIConvert::read()
 {
+  BRAINS_TRACE_SCOPE("DWIConvert::Read");
   if (emptyString == getInputFileType()){
     std::cerr << "illegal input file type, exit" << std::endl;
     return EXIT_FAILURE;
@@ -148,6 +151,7 @@ int DWIConvert::read()
 
 int DWIConvert::write(const std::string& outputVolume)
 {
+  BRAINS_TRACE_SCOPE("DWIConvert::Write");
   setOutputFileType(outputVolume);
   const std::string version = "5.0.0";
   if ("FSL" == getOutputFileType())
@@ -192,7 +196,7 @@ int DWIConvert::write(const std::string& outputVolume)
       const std::string commentSection = m_converter->MakeFileComment(version, m_useBMatrixGradientDirections,
                                                                       m_useIdentityMeasurementFrame,
                                                                       m_smallGradientThreshold, getInputFileType());
-      m_converter->ManualWriteNRRDFile(outputVolumeHeaderName, commentSection);
+      m_converter->ManualWriteNRRDFile(outputVolumeHeaderName, commentSection, m_useCompression);
   }
   else
   {
@@ -249,6 +253,7 @@ DWIConverter * DWIConvert::CreateDicomConverter(
 // read Dicom directory
   try
   {
+    BRAINS_TRACE_SCOPE("DWIConvert::LoadDicom");
     converter->SetAllowLossyConversion(allowLossyConversion);
     converter->LoadFromDisk();
   }
@@ -414,6 +419,14 @@ void DWIConvert::setUseBMatrixGradientDirections(bool useBMatrixGradientDirectio
   m_useBMatrixGradientDirections = useBMatrixGradientDirections;
 }
 
+bool DWIConvert::isUseCompression() const {
+  return m_useCompression;
+}
+
+void DWIConvert::setUseCompression(bool useCompression) {
+  m_useCompression = useCompression;
+}
+
 const std::string &DWIConvert::getOutputVolume() const {
   return m_outputVolume;
 }
@@ -80,6 +80,10 @@ public:
 
     void setUseBMatrixGradientDirections(bool useBMatrixGradientDirections);
 
+    bool isUseCompression() const;
+
+    void setUseCompression(bool useCompression);
+
     const std::string &getOutputVolume() const;
 
     void setOutputVolume(const std::string &outputVolume);
@@ -120,6 +124,7 @@ private:
     bool m_allowLossyConversion; //defualt: false
     bool m_useIdentityMeasurementFrame; //default: false
     bool m_useBMatrixGradientDirections; //default: false
+    bool m_useCompression; //default: false
 
     std::string m_outputVolume;
     std::string m_outputDirectory;  //default: "."
@@ -3,7 +3,9 @@
 //
 
 #include "DWIConverter.h"
-#include "itkFlipImageFilter.h"
+#include "itkByteSwapper.h"
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
 DWIConverter::DWIConverter( const FileNamesContainer &inputFileNames )
         :
         m_InputFileNames(inputFileNames),
@@ -73,17 +75,13 @@ Volume4DType::Pointer DWIConverter::OrientForFSLConventions( const bool toFSL)
   static const double FSLDesiredDirectionFlipsWRTLPS[4] = {1,-1,1,1};
   static const double DicomDesiredDirectionFlipsWRTLPS[4] = {1,1,1,1};
   this->ConvertBVectorsToIdentityMeasurementFrame();
-  Volume4DType::Pointer image4D = ThreeDToFourDImage(this->GetDiffusionVolume());
-  Volume4DType::DirectionType direction=image4D->GetDirection();
-  direction.GetVnlMatrix().get_row(0).magnitude();
+  const Volume3DUnwrappedType::DirectionType direction = this->m_Volume->GetDirection();
   //LPS to RAI as FSL desires images to be formatted for viewing purposes.
   // This conversion makes FSLView display the images in
   // a way that is most easily interpretable.
-  typedef itk::FlipImageFilter<Volume4DType> FlipperType;
-  FlipperType::Pointer myFlipper = FlipperType::New();
-  myFlipper->SetInput( image4D ) ;
-  FlipperType::FlipAxesArrayType arrayAxisFlip;
-  for(size_t i=0; i< Volume4DType::ImageDimension; ++i)
+  // The gradient axis is never flipped, so only the three spatial axes are considered.
+  bool arrayAxisFlip[3];
+  for(size_t i=0; i< Volume3DUnwrappedType::ImageDimension; ++i)
   {
     if( toFSL )
     {
@@ -110,15 +108,89 @@ Volume4DType::Pointer DWIConverter::OrientForFSLConventions( const bool toFSL)
    */
   //
   // FSL wants the second and third dimensions flipped with regards to LPS orientation
-  // FSL wants the second and third dimeinsions flipped with regards to LPS orientation
-  myFlipper->SetFlipAxes(arrayAxisFlip);
-  myFlipper->FlipAboutOriginOff();  //Flip the image and direction cosignes
+  // Flip the image and direction cosignes in place,
   // this is similar to a transform of [1 0 0; 0 -1 0; 0 0 -1]
-  myFlipper->Update();
-  Volume4DType::Pointer temp = myFlipper->GetOutput();
-  temp->SetMetaDataDictionary( image4D->GetMetaDataDictionary());
-  this->m_Volume = FourDToThreeDImage(temp);
-  return temp;
+  this->FlipDiffusionVolumeInPlace(arrayAxisFlip);
+  // The 4D view shares the pixel buffer with m_Volume
+  return ThreeDToFourDImage(this->m_Volume);
+}
+
+void DWIConverter::FlipDiffusionVolumeInPlace(const bool flipAxes[3])
+{
+  if( !flipAxes[0] && !flipAxes[1] && !flipAxes[2] )
+  {
+    return;
+  }
+  const Volume3DUnwrappedType::SizeType size3D = this->m_Volume->GetLargestPossibleRegion().GetSize();
+  const size_t nCols = size3D[0];
+  const size_t nRows = size3D[1];
+  const size_t nSlicesPerVolume = this->GetSlicesPerVolume();
+  const size_t sliceSize = nCols * nRows;
+  const size_t nVolumes = this->GetNVolume();
+  if( nSlicesPerVolume * nVolumes != size3D[2] )
+  {
+    itkGenericExceptionMacro(
+            << "#of slices in volume not evenly divisible by"
+            << " the number of volumes: slices = " << size3D[2]
+            << " volumes = " << nVolumes << std::endl);
+  }
+
+  // Each slice of the unwrapped volume is flipped in x and y, and the slices are
+  // exchanged within each gradient volume, so every voxel moves exactly once.
+  PixelValueType * const buffer = this->m_Volume->GetBufferPointer();
+  for( size_t vol = 0; vol < nVolumes; ++vol )
+  {
+    PixelValueType * const volumeStart = buffer + vol * nSlicesPerVolume * sliceSize;
+    for( size_t slice = 0; slice < nSlicesPerVolume; ++slice )
+    {
+      PixelValueType * const sliceStart = volumeStart + slice * sliceSize;
+      if( flipAxes[1] )
+      {
+        for( size_t row = 0; row < nRows / 2; ++row )
+        {
+          std::swap_ranges(sliceStart + row * nCols, sliceStart + ( row + 1 ) * nCols,
+                           sliceStart + ( nRows - 1 - row ) * nCols);
+        }
+      }
+      if( flipAxes[0] )
+      {
+        for( size_t row = 0; row < nRows; ++row )
+        {
+          std::reverse(sliceStart + row * nCols, sliceStart + ( row + 1 ) * nCols);
+        }
+      }
+    }
+    if( flipAxes[2] )
+    {
+      for( size_t slice = 0; slice < nSlicesPerVolume / 2; ++slice )
+      {
+        std::swap_ranges(volumeStart + slice * sliceSize, volumeStart + ( slice + 1 ) * sliceSize,
+                         volumeStart + ( nSlicesPerVolume - 1 - slice ) * sliceSize);
+      }
+    }
+  }
+
+  // FlipAboutOriginOff: the voxel at the far end of each flipped axis becomes the new
+  // origin and the corresponding direction cosine changes sign.
+  Volume3DUnwrappedType::DirectionType direction = this->m_Volume->GetDirection();
+  Volume3DUnwrappedType::PointType     origin = this->m_Volume->GetOrigin();
+  const Volume3DUnwrappedType::SpacingType spacing = this->m_Volume->GetSpacing();
+  const size_t axisSize[3] = { nCols, nRows, nSlicesPerVolume };
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    if( !flipAxes[j] )
+    {
+      continue;
+    }
+    const double extent = spacing[j] * static_cast<double>( axisSize[j] - 1 );
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+      origin[i] += direction[i][j] * extent;
+      direction[i][j] = -direction[i][j];
+    }
+  }
+  this->m_Volume->SetOrigin(origin);
+  this->m_Volume->SetDirection(direction);
 }
 
 const std::vector<double>& DWIConverter::GetBValues() const { return this->m_BValues; }
@@ -307,7 +379,8 @@ std::string  DWIConverter::MakeFileComment(
 
 void DWIConverter::ManualWriteNRRDFile(
         const std::string& outputVolumeHeaderName,
-        const std::string commentstring) const
+        const std::string commentstring,
+        const bool useCompression) const
 {
   const size_t extensionPos = outputVolumeHeaderName.find(".nhdr");
   const bool nrrdSingleFileFormat = ( extensionPos != std::string::npos ) ? false : true;
@@ -316,7 +389,7 @@ void DWIConverter::ManualWriteNRRDFile(
   if( extensionPos != std::string::npos )
   {
     outputVolumeDataName = outputVolumeHeaderName.substr(0, extensionPos);
-    outputVolumeDataName += ".raw";
+    outputVolumeDataName += ( useCompression ? ".raw.gz" : ".raw" );
   }
 
   itk::NumberToString<double> DoubleConvert;
@@ -366,7 +439,7 @@ void DWIConverter::ManualWriteNRRDFile(
   header << "kinds: space space space list" << std::endl;
 
   header << "endian: little" << std::endl;
-  header << "encoding: raw" << std::endl;
+  header << "encoding: " << ( useCompression ? "gzip" : "raw" ) << std::endl;
   header << "space units: \"mm\" \"mm\" \"mm\"" << std::endl;
 
   const DWIConverter::Volume3DUnwrappedType::PointType ImageOrigin = this->GetOrigin();
@@ -423,34 +496,145 @@ void DWIConverter::ManualWriteNRRDFile(
   // write data in the same file is .nrrd was chosen
   header << std::endl;;
   if (nrrdSingleFileFormat) {
-    unsigned long nVoxels = this->GetDiffusionVolume()->GetBufferedRegion().GetNumberOfPixels();
-    header.write(reinterpret_cast<char*>(this->GetDiffusionVolume()->GetBufferPointer()),
-                 nVoxels*sizeof(short));
+    this->WriteNRRDVoxelData(header, useCompression);
   }
   else {
     // if we're writing out NRRD, and the split header/data NRRD
-    // format is used, write out the image as a raw volume.
-    itk::ImageFileWriter<DWIConverter::Volume3DUnwrappedType>::Pointer
-            rawWriter = itk::ImageFileWriter<DWIConverter::Volume3DUnwrappedType>::New();
-    itk::RawImageIO<PixelValueType,3>::Pointer rawIO
-            = itk::RawImageIO<PixelValueType,3>::New();
-    rawWriter->SetImageIO(rawIO);
-    rawIO->SetByteOrderToLittleEndian();
-    rawWriter->SetFileName(outputVolumeDataName.c_str());
-    rawWriter->SetInput(this->GetDiffusionVolume());
-    try {
-      rawWriter->Update();
-    }
-    catch (itk::ExceptionObject& excp) {
+    // format is used, stream the voxels to the detached data file.
+    std::ofstream dataFile(outputVolumeDataName.c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!dataFile.is_open()) {
       std::cerr << "Exception thrown while writing the series to"
-                << outputVolumeDataName << " " << excp << std::endl;
-      std::cerr << excp << std::endl;
+                << outputVolumeDataName << std::endl;
+    }
+    else {
+      this->WriteNRRDVoxelData(dataFile, useCompression);
+      dataFile.close();
     }
   }
   header.close();
   return;
 }
 
+namespace
+{
+/** One gradient volume worth of voxels, deflated into a standalone gzip member */
+struct NRRDCompressionChunk
+{
+  const PixelValueType *  Input;
+  size_t                  NumberOfPixels;
+  std::vector<Bytef>      Output;
+  bool                    Success;
+};
+
+struct NRRDCompressionStruct
+{
+  std::vector<NRRDCompressionChunk> * Chunks;
+};
+
+void CompressNRRDChunk(NRRDCompressionChunk & chunk)
+{
+  std::vector<PixelValueType> swapped;
+  const PixelValueType * input = chunk.Input;
+  if( itk::ByteSwapper<PixelValueType>::SystemIsBigEndian() )
+  {
+    swapped.assign(chunk.Input, chunk.Input + chunk.NumberOfPixels);
+    itk::ByteSwapper<PixelValueType>::SwapRangeFromSystemToLittleEndian(&swapped[0], swapped.size());
+    input = &swapped[0];
+  }
+
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  // windowBits + 16 requests a gzip wrapper; concatenated gzip members form a valid gzip stream
+  if( deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK )
+  {
+    chunk.Success = false;
+    return;
+  }
+  const uLong inputBytes = static_cast<uLong>( chunk.NumberOfPixels * sizeof(PixelValueType) );
+  chunk.Output.resize(deflateBound(&stream, inputBytes) + 32);
+  stream.next_in = reinterpret_cast<Bytef *>( const_cast<PixelValueType *>( input ) );
+  stream.avail_in = static_cast<uInt>( inputBytes );
+  stream.next_out = &chunk.Output[0];
+  stream.avail_out = static_cast<uInt>( chunk.Output.size() );
+  const int status = deflate(&stream, Z_FINISH);
+  chunk.Output.resize(stream.total_out);
+  chunk.Success = ( status == Z_STREAM_END );
+  deflateEnd(&stream);
+}
+
+ITK_THREAD_RETURN_TYPE CompressNRRDChunksThreaderCallback(void *arg)
+{
+  typedef itk::MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType * threadInfo = static_cast<ThreadInfoType *>( arg );
+  NRRDCompressionStruct * str = static_cast<NRRDCompressionStruct *>( threadInfo->UserData );
+  std::vector<NRRDCompressionChunk> & chunks = *( str->Chunks );
+  for( size_t i = threadInfo->ThreadID; i < chunks.size(); i += threadInfo->NumberOfThreads )
+  {
+    CompressNRRDChunk(chunks[i]);
+  }
+  return ITK_THREAD_RETURN_VALUE;
+}
+}
+
+void DWIConverter::WriteNRRDVoxelData(std::ostream & output, const bool useCompression) const
+{
+  const PixelValueType * const buffer = this->GetDiffusionVolume()->GetBufferPointer();
+  const size_t nVoxels = this->GetDiffusionVolume()->GetBufferedRegion().GetNumberOfPixels();
+  const size_t nVolumes = std::max<size_t>(this->GetNVolume(), 1);
+  const size_t chunkSize = ( nVoxels + nVolumes - 1 ) / nVolumes;
+
+  if( !useCompression )
+  {
+    std::vector<PixelValueType> swapped;
+    for( size_t start = 0; start < nVoxels; start += chunkSize )
+    {
+      const size_t count = std::min(chunkSize, nVoxels - start);
+      const PixelValueType * chunk = buffer + start;
+      if( itk::ByteSwapper<PixelValueType>::SystemIsBigEndian() )
+      {
+        swapped.assign(chunk, chunk + count);
+        itk::ByteSwapper<PixelValueType>::SwapRangeFromSystemToLittleEndian(&swapped[0], count);
+        chunk = &swapped[0];
+      }
+      output.write(reinterpret_cast<const char *>( chunk ), count * sizeof(PixelValueType));
+    }
+    return;
+  }
+
+  // Compress a batch of volumes in parallel, write it in order, then move on so that
+  // only one batch of compressed data is held in memory at a time.
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  const size_t batchSize = static_cast<size_t>( std::max(threader->GetNumberOfThreads(), 1U) );
+  std::vector<NRRDCompressionChunk> chunks;
+  for( size_t start = 0; start < nVoxels; start += batchSize * chunkSize )
+  {
+    chunks.clear();
+    for( size_t chunkStart = start; chunkStart < nVoxels && chunks.size() < batchSize; chunkStart += chunkSize )
+    {
+      NRRDCompressionChunk chunk;
+      chunk.Input = buffer + chunkStart;
+      chunk.NumberOfPixels = std::min(chunkSize, nVoxels - chunkStart);
+      chunk.Success = false;
+      chunks.push_back(chunk);
+    }
+    NRRDCompressionStruct str;
+    str.Chunks = &chunks;
+    threader->SetNumberOfThreads( static_cast<itk::ThreadIdType>( chunks.size() ) );
+    threader->SetSingleMethod( CompressNRRDChunksThreaderCallback, &str );
+    threader->SingleMethodExecute();
+    for( size_t i = 0; i < chunks.size(); ++i )
+    {
+      if( !chunks[i].Success )
+      {
+        itkGenericExceptionMacro( << "Failed to gzip compress NRRD voxel data" << std::endl);
+      }
+      output.write(reinterpret_cast<const char *>( &chunks[i].Output[0] ), chunks[i].Output.size());
+    }
+  }
+}
+
 Volume4DType::Pointer DWIConverter::ThreeDToFourDImage(Volume3DUnwrappedType::Pointer img) const
 {
   const int nVolumes = this->GetNVolume();
@@ -502,7 +686,9 @@ Volume4DType::Pointer DWIConverter::ThreeDToFourDImage(Volume3DUnwrappedType::Po
   img4D->SetDirection(direction4D);
   img4D->SetSpacing(spacing4D);
   img4D->SetOrigin(origin4D);
-  img4D->Allocate();
+  // Share the pixel container rather than copying: both images index the same
+  // x-fastest buffer, only the slice axis is split into (slices, volumes).
+  img4D->SetPixelContainer(img->GetPixelContainer());
 
   {
     img4D->SetMetaDataDictionary(img->GetMetaDataDictionary());
@@ -513,10 +699,6 @@ Volume4DType::Pointer DWIConverter::ThreeDToFourDImage(Volume3DUnwrappedType::Po
     itk::EncapsulateMetaData<double>( thisDic, "NRRD_thicknesses", GetThickness());
   }
 
-  const size_t bytecount = img4D->GetLargestPossibleRegion().GetNumberOfPixels()
-                           * sizeof(PixelValueType);
-
-  memcpy(img4D->GetBufferPointer(), img->GetBufferPointer(), bytecount);
   return img4D;
 }
 
@@ -570,7 +752,7 @@ DWIConverter::Volume3DUnwrappedType::Pointer DWIConverter::FourDToThreeDImage(Vo
   img->SetDirection(direction3D);
   img->SetSpacing(spacing3D);
   img->SetOrigin(origin3D);
-  img->Allocate();
+  img->SetPixelContainer(img4D->GetPixelContainer());
 
   {
     img->SetMetaDataDictionary(img4D->GetMetaDataDictionary());
@@ -581,10 +763,6 @@ DWIConverter::Volume3DUnwrappedType::Pointer DWIConverter::FourDToThreeDImage(Vo
     itk::EncapsulateMetaData<double>( thisDic, "NRRD_thicknesses", GetThickness());
   }
 
-  const size_t bytecount = img->GetLargestPossibleRegion().GetNumberOfPixels()
-                           * sizeof(PixelValueType);
-
-  memcpy(img->GetBufferPointer(), img4D->GetBufferPointer(), bytecount);
   return img;
 }
 
@@ -170,9 +170,18 @@ public:
             double smallGradientThreshold,
             const std::string conversionMode) const;
 
+  /**
+   * @brief Write the NRRD header followed by the voxel data streamed directly from
+   *        the diffusion volume buffer (no intermediate image copy).
+   * @param useCompression write "encoding: gzip" data, compressed per volume in parallel
+   */
   void ManualWriteNRRDFile(
             const std::string& outputVolumeHeaderName,
-            const std::string commentstring) const;
+            const std::string commentstring,
+            const bool useCompression = false) const;
+
+  /** The 3D unwrapped and 4D representations share the same pixel buffer,
+   *  only the image geometry is converted; no voxel data is copied. */
   Volume4DType::Pointer ThreeDToFourDImage(Volume3DUnwrappedType::Pointer img) const;
 
   Volume3DUnwrappedType::Pointer FourDToThreeDImage(Volume4DType::Pointer img4D) const;
@@ -200,6 +209,15 @@ protected:
   double ComputeMaxBvalue(const std::vector<double> &bValues) const;
   size_t has_valid_nifti_extension( std::string outputVolumeHeaderName ) const;
 
+  /** Flip the unwrapped volume in place along the requested axes (x, y, slice within
+   *  each volume), updating origin and direction the same way as
+   *  itk::FlipImageFilter with FlipAboutOriginOff. */
+  void FlipDiffusionVolumeInPlace(const bool flipAxes[3]);
+
+  /** Stream the diffusion volume buffer as little-endian shorts, one volume per chunk.
+   *  When compressing, chunks are deflated in parallel as consecutive gzip members. */
+  void WriteNRRDVoxelData(std::ostream & output, const bool useCompression) const;
+
   /** add vendor-specific flags; */
   virtual void AddFlagsToDictionary() = 0;
 
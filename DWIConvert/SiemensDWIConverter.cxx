@@ -2,6 +2,7 @@
 // Created by Hui Xie on 12/19/16.
 //
 #include "SiemensDWIConverter.h"
+#include "itkMultiThreaderBase.h"
 
 SiemensDWIConverter::SiemensDWIConverter (DWIDICOMConverterBase::DCMTKFileVector &allHeaders,
                                           DWIConverter::FileNamesContainer &inputFileNames,
@@ -475,37 +476,52 @@ void SiemensDWIConverter::DeMosaic()
   );
 
 
-  Volume3DUnwrappedType::RegionType dmRegion = this->m_Volume->GetLargestPossibleRegion();
-  dmRegion.SetSize(2, 1);
-  region.SetSize(0, dmSize[0]);
-  region.SetSize(1, dmSize[1]);
-  region.SetSize(2, 1);
+  // Every output slice is a tile of one mosaic image; copy the tile row by row with
+  // contiguous block copies, splitting the slices across threads.
+  DeMosaicStruct str;
+  str.Mosaic = previousImage->GetBufferPointer();
+  str.DeMosaic = this->m_Volume->GetBufferPointer();
+  str.MosaicCols = size[0];
+  str.MosaicRows = size[1];
+  str.TileCols = dmSize[0];
+  str.TileRows = dmSize[1];
+  str.TilesPerRow = this->m_MMosaic;
+  str.SlicesPerVolume = this->m_SlicesPerVolume;
+  str.NumberOfSlices = std::min<size_t>( original_slice_number, dmSize[2] );
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  threader->SetSingleMethod( SiemensDWIConverter::DeMosaicThreaderCallback, &str );
+  threader->SingleMethodExecute();
+}
 
-  for( unsigned int k = 0; k < original_slice_number; ++k )
+ITK_THREAD_RETURN_TYPE SiemensDWIConverter::DeMosaicThreaderCallback(void *arg)
+{
+  typedef itk::MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType * threadInfo = static_cast<ThreadInfoType *>( arg );
+  const DeMosaicStruct * str = static_cast<DeMosaicStruct *>( threadInfo->UserData );
+
+  const size_t tileRowBytes = str->TileCols * sizeof(PixelValueType);
+  const size_t tileSize = str->TileCols * str->TileRows;
+  const size_t mosaicSize = str->MosaicCols * str->MosaicRows;
+  for( size_t k = threadInfo->ThreadID; k < str->NumberOfSlices; k += threadInfo->NumberOfThreads )
   {
-    unsigned int new_k = k /* - bad_slice_counter */;
-
-    dmRegion.SetIndex(2, new_k);
-    itk::ImageRegionIteratorWithIndex<Volume3DUnwrappedType> dmIt( this->m_Volume, dmRegion );
-
-    // figure out the mosaic region for this slice
-    int sliceIndex = k;
-
-    // int nBlockPerSlice = this->m_Mosaic*this->m_NMosaic;
-    int slcMosaic = sliceIndex / (m_SlicesPerVolume);
-    sliceIndex -= slcMosaic * m_SlicesPerVolume;
-    int colMosaic = sliceIndex / this->m_MMosaic;
-    int rawMosaic = sliceIndex - this->m_MMosaic * colMosaic;
-    region.SetIndex( 0, rawMosaic * dmSize[0] );
-    region.SetIndex( 1, colMosaic * dmSize[1] );
-    region.SetIndex( 2, slcMosaic );
-
-    itk::ImageRegionConstIteratorWithIndex<Volume3DUnwrappedType> imIt( previousImage, region );
-    for( dmIt.GoToBegin(), imIt.GoToBegin(); !dmIt.IsAtEnd(); ++dmIt, ++imIt )
+    // figure out the mosaic tile for this slice
+    const size_t mosaicImage = k / str->SlicesPerVolume;
+    const size_t sliceIndex = k - mosaicImage * str->SlicesPerVolume;
+    const size_t tileRow = sliceIndex / str->TilesPerRow;
+    const size_t tileCol = sliceIndex - str->TilesPerRow * tileRow;
+
+    const PixelValueType * src = str->Mosaic + mosaicImage * mosaicSize
+      + tileRow * str->TileRows * str->MosaicCols + tileCol * str->TileCols;
+    PixelValueType * dst = str->DeMosaic + k * tileSize;
+    for( size_t row = 0; row < str->TileRows; ++row )
     {
-      dmIt.Set( imIt.Get() );
+      memcpy( dst, src, tileRowBytes );
+      src += str->MosaicCols;
+      dst += str->TileCols;
     }
   }
+  return ITK_THREAD_RETURN_VALUE;
 }
 
 unsigned int SiemensDWIConverter::ConvertFromCharPtr(const char *s)
@@ -150,6 +150,21 @@ protected:
   /** turn a mosaic image back into a sequential volume image */
   void DeMosaic();
 
+  /** buffers and tile geometry shared by the demosaicing threads */
+  struct DeMosaicStruct
+  {
+    const PixelValueType * Mosaic;
+    PixelValueType *       DeMosaic;
+    size_t                 MosaicCols;
+    size_t                 MosaicRows;
+    size_t                 TileCols;
+    size_t                 TileRows;
+    size_t                 TilesPerRow;
+    size_t                 SlicesPerVolume;
+    size_t                 NumberOfSlices;
+  };
+  static ITK_THREAD_RETURN_TYPE DeMosaicThreaderCallback(void *arg);
+
   unsigned int ConvertFromCharPtr(const char *s);
   /** pull data out of Siemens scans.
    *
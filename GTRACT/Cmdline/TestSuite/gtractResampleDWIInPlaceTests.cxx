@@ -23,8 +23,94 @@
 void RegisterTests()
 {
   REGISTER_TEST(gtractResampleDWIInPlaceTest);
+  REGISTER_TEST(gtractResampleDWIInPlaceSharedWeightsTest);
 }
 
+int gtractResampleDWIInPlaceSharedWeightsTest(int, char *[]);
+
 #undef main
 #define main gtractResampleDWIInPlaceTest
 #include "../gtractResampleDWIInPlace.cxx"
+
+#include "itkResampleImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+/**
+ * Compare ResampleVectorImageWithSharedWeights against ResampleImageFilter with a
+ * LinearInterpolateImageFunction, one component at a time, on a reference grid shifted by
+ * a quarter voxel so that the first output voxels sample the half voxel before the input start.
+ */
+int gtractResampleDWIInPlaceSharedWeightsTest(int, char *[])
+{
+  typedef itk::VectorImage<float, 3> VectorImageType;
+  typedef itk::Image<float, 3>       ScalarImageType;
+
+  const unsigned int numberOfComponents = 3;
+  VectorImageType::SizeType size;
+  size[0] = 5; size[1] = 6; size[2] = 4;
+  VectorImageType::SpacingType spacing;
+  spacing[0] = 1.0; spacing[1] = 1.5; spacing[2] = 2.0;
+
+  VectorImageType::Pointer inputImage = VectorImageType::New();
+  inputImage->SetRegions(size);
+  inputImage->SetSpacing(spacing);
+  inputImage->SetVectorLength(numberOfComponents);
+  inputImage->Allocate();
+  for( itk::ImageRegionIteratorWithIndex<VectorImageType> it( inputImage, inputImage->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const VectorImageType::IndexType index = it.GetIndex();
+    VectorImageType::PixelType       pixel(numberOfComponents);
+    for( unsigned int c = 0; c < numberOfComponents; ++c )
+      {
+      pixel[c] = static_cast<float>( 7 * index[0] + 3 * index[1] * index[1] + 11 * index[2] + 5 * c );
+      }
+    it.Set(pixel);
+    }
+
+  ScalarImageType::Pointer referenceImage = ScalarImageType::New();
+  referenceImage->SetRegions(size);
+  referenceImage->SetSpacing(spacing);
+  ScalarImageType::PointType referenceOrigin;
+  for( unsigned int d = 0; d < 3; ++d )
+    {
+    referenceOrigin[d] = -0.25 * spacing[d];
+    }
+  referenceImage->SetOrigin(referenceOrigin);
+
+  VectorImageType::Pointer sharedWeightsImage =
+    ResampleVectorImageWithSharedWeights<VectorImageType>(inputImage.GetPointer(), referenceImage.GetPointer(), nullptr);
+
+  int status = EXIT_SUCCESS;
+  for( unsigned int c = 0; c < numberOfComponents; ++c )
+    {
+    typedef itk::VectorIndexSelectionCastImageFilter<VectorImageType, ScalarImageType> SelectFilterType;
+    SelectFilterType::Pointer selectFilter = SelectFilterType::New();
+    selectFilter->SetInput(inputImage);
+    selectFilter->SetIndex(c);
+
+    typedef itk::ResampleImageFilter<ScalarImageType, ScalarImageType> ResampleFilterType;
+    ResampleFilterType::Pointer resampleFilter = ResampleFilterType::New();
+    resampleFilter->SetInput( selectFilter->GetOutput() );
+    resampleFilter->SetInterpolator( itk::LinearInterpolateImageFunction<ScalarImageType, double>::New() );
+    resampleFilter->SetOutputParametersFromImage(referenceImage);
+    resampleFilter->SetDefaultPixelValue(0);
+    resampleFilter->Update();
+
+    for( itk::ImageRegionConstIteratorWithIndex<ScalarImageType> it( resampleFilter->GetOutput(),
+                                                                      resampleFilter->GetOutput()->GetBufferedRegion() );
+         !it.IsAtEnd(); ++it )
+      {
+      const float sharedWeightsValue = sharedWeightsImage->GetPixel( it.GetIndex() )[c];
+      if( std::abs(sharedWeightsValue - it.Get() ) > 1e-4f )
+        {
+        std::cerr << "Component " << c << " at " << it.GetIndex() << ": " << sharedWeightsValue
+                  << " != " << it.Get() << std::endl;
+        status = EXIT_FAILURE;
+        }
+      }
+    }
+  return status;
+}
@@ -0,0 +1,112 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include <iostream>
+
+#include <itkImage.h>
+#include <itkVectorImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkMedianImageFilter.h>
+#include <itkVectorIndexSelectionCastImageFilter.h>
+
+#include "itkVectorImageComponentMedianImageFilter.h"
+
+/**
+ * Compare VectorImageComponentMedianImageFilter against MedianImageFilter run on
+ * each selected component, with radius 1, over the whole image including its boundary.
+ */
+int main(int, char *[])
+{
+  typedef itk::VectorImage<short, 3> VectorImageType;
+  typedef itk::Image<short, 3>       ScalarImageType;
+
+  const unsigned int        numberOfComponents = 4;
+  VectorImageType::SizeType size;
+  size[0] = 6; size[1] = 5; size[2] = 4;
+
+  VectorImageType::Pointer inputImage = VectorImageType::New();
+  inputImage->SetRegions(size);
+  inputImage->SetVectorLength(numberOfComponents);
+  inputImage->Allocate();
+  for( itk::ImageRegionIteratorWithIndex<VectorImageType> it( inputImage, inputImage->GetLargestPossibleRegion() );
+       !it.IsAtEnd(); ++it )
+    {
+    const VectorImageType::IndexType index = it.GetIndex();
+    VectorImageType::PixelType       pixel(numberOfComponents);
+    for( unsigned int c = 0; c < numberOfComponents; ++c )
+      {
+      pixel[c] = static_cast<short>( ( 37 * index[0] + 11 * index[1] * index[1] + 23 * index[2] + 97 * c
+                                       + index[0] * index[2] * ( c + 1 ) ) % 101 );
+      }
+    it.Set(pixel);
+    }
+
+  VectorImageType::SizeType radius;
+  radius.Fill(1);
+
+  // A subset of the components, out of order.
+  typedef itk::VectorImageComponentMedianImageFilter<VectorImageType, VectorImageType> VectorMedianFilterType;
+  VectorMedianFilterType::ComponentIndexListType components;
+  components.push_back(3);
+  components.push_back(0);
+  components.push_back(2);
+
+  VectorMedianFilterType::Pointer vectorMedianFilter = VectorMedianFilterType::New();
+  vectorMedianFilter->SetInput(inputImage);
+  vectorMedianFilter->SetRadius(radius);
+  vectorMedianFilter->SetComponentIndices(components);
+  vectorMedianFilter->Update();
+  const VectorImageType *vectorMedianImage = vectorMedianFilter->GetOutput();
+
+  if( vectorMedianImage->GetNumberOfComponentsPerPixel() != components.size() )
+    {
+    std::cerr << "Expected " << components.size() << " output components, found "
+              << vectorMedianImage->GetNumberOfComponentsPerPixel() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  int status = EXIT_SUCCESS;
+  for( unsigned int c = 0; c < components.size(); ++c )
+    {
+    typedef itk::VectorIndexSelectionCastImageFilter<VectorImageType, ScalarImageType> SelectFilterType;
+    SelectFilterType::Pointer selectFilter = SelectFilterType::New();
+    selectFilter->SetInput(inputImage);
+    selectFilter->SetIndex(components[c]);
+
+    typedef itk::MedianImageFilter<ScalarImageType, ScalarImageType> MedianFilterType;
+    MedianFilterType::Pointer medianFilter = MedianFilterType::New();
+    medianFilter->SetInput( selectFilter->GetOutput() );
+    medianFilter->SetRadius(radius);
+    medianFilter->Update();
+
+    for( itk::ImageRegionConstIteratorWithIndex<ScalarImageType> it( medianFilter->GetOutput(),
+                                                                      medianFilter->GetOutput()->GetBufferedRegion() );
+         !it.IsAtEnd(); ++it )
+      {
+      const short vectorMedianValue = vectorMedianImage->GetPixel( it.GetIndex() )[c];
+      if( vectorMedianValue != it.Get() )
+        {
+        std::cerr << "Component " << components[c] << " at " << it.GetIndex() << ": " << vectorMedianValue
+                  << " != " << it.Get() << std::endl;
+        status = EXIT_FAILURE;
+        }
+      }
+    }
+  return status;
+}
@@ -32,6 +32,7 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
 
 #include <itkImage.h>
 #include <itkVectorImage.h>
@@ -39,11 +40,9 @@
 #include <itkImageFileReader.h>
 #include <itkExceptionObject.h>
 #include <itkVectorIndexSelectionCastImageFilter.h>
-#include <itkComposeImageFilter.h>
 #include <itkImageRegionIterator.h>
 #include <itkImageRegionConstIterator.h>
-#include <itkResampleImageFilter.h>
-#include <itkVectorResampleImageFilter.h>
+#include <itkMultiThreaderBase.h>
 #include <itkTransformFileWriter.h>
 #include "DWIMetaDataDictionaryValidator.h"
 
@@ -84,6 +83,161 @@ SetVectorImageRigidTransformInPlace(typename itk::VersorRigid3DTransform<double>
   return OutputAlignedImage;
 }
 
+/**
+ * \brief Shared state for resampling all gradient components of a vector image in one pass.
+ */
+template <class IOImageType>
+struct SharedWeightsResampleStruct
+{
+  const IOImageType *                  Input;
+  IOImageType *                        Output;
+  const itk::Transform<double, 3, 3> * Transform;
+};
+
+/**
+ * \brief Each thread resamples a strided set of output slices.  The transform and the linear
+ * interpolation weights are computed once per output voxel and applied to every gradient
+ * component.  Boundary handling, background value and the cast back to the component type
+ * follow itk::ResampleImageFilter with itk::LinearInterpolateImageFunction.
+ */
+template <class IOImageType>
+ITK_THREAD_RETURN_TYPE
+SharedWeightsResampleThreaderCallback(void *arg)
+{
+  typedef itk::MultiThreaderBase::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType * threadInfo = static_cast<ThreadInfoType *>( arg );
+  const SharedWeightsResampleStruct<IOImageType> * str =
+    static_cast<SharedWeightsResampleStruct<IOImageType> *>( threadInfo->UserData );
+
+  typedef typename IOImageType::InternalPixelType      ComponentType;
+  typedef typename IOImageType::IndexType              IndexType;
+  typedef typename IOImageType::PointType              PointType;
+  typedef itk::ContinuousIndex<double, 3>              ContinuousIndexType;
+
+  const IOImageType * input = str->Input;
+  IOImageType *       output = str->Output;
+  const size_t        numberOfComponents = input->GetNumberOfComponentsPerPixel();
+
+  const typename IOImageType::RegionType inputRegion = input->GetBufferedRegion();
+  const IndexType                        inputStart = inputRegion.GetIndex();
+  const typename IOImageType::SizeType   inputSize = inputRegion.GetSize();
+  const ComponentType *                  inputBuffer = input->GetBufferPointer();
+
+  const typename IOImageType::RegionType outputRegion = output->GetLargestPossibleRegion();
+  const typename IOImageType::SizeType   outputSize = outputRegion.GetSize();
+  ComponentType *                        outputBuffer = output->GetBufferPointer();
+
+  const double minComponent = static_cast<double>( itk::NumericTraits<ComponentType>::NonpositiveMin() );
+  const double maxComponent = static_cast<double>( itk::NumericTraits<ComponentType>::max() );
+
+  std::vector<double> accumulator(numberOfComponents);
+  for( itk::SizeValueType z = threadInfo->ThreadID; z < outputSize[2]; z += threadInfo->NumberOfThreads )
+    {
+    IndexType outputIndex;
+    outputIndex[2] = outputRegion.GetIndex()[2] + z;
+    for( itk::SizeValueType y = 0; y < outputSize[1]; ++y )
+      {
+      outputIndex[1] = outputRegion.GetIndex()[1] + y;
+      ComponentType * outputPixel = outputBuffer + ( ( z * outputSize[1] + y ) * outputSize[0] ) * numberOfComponents;
+      for( itk::SizeValueType x = 0; x < outputSize[0]; ++x, outputPixel += numberOfComponents )
+        {
+        outputIndex[0] = outputRegion.GetIndex()[0] + x;
+        PointType outputPoint;
+        output->TransformIndexToPhysicalPoint(outputIndex, outputPoint);
+        const PointType inputPoint =
+          ( str->Transform != nullptr ) ? str->Transform->TransformPoint(outputPoint) : outputPoint;
+        ContinuousIndexType inputIndex;
+        input->TransformPhysicalPointToContinuousIndex(inputPoint, inputIndex);
+
+        // Same inside-buffer test as the interpolator: [start - 0.5, end + 0.5).
+        // As in the interpolator the neighbours of the floor index are clamped
+        // to the buffer, so the half voxel outside each edge takes the edge value.
+        bool isInside = true;
+        itk::IndexValueType lower[3];
+        itk::IndexValueType upper[3];
+        double              distance[3];
+        for( unsigned int d = 0; d < 3; ++d )
+          {
+          const double startContinuous = inputStart[d] - 0.5;
+          if( !( inputIndex[d] >= startContinuous && inputIndex[d] < startContinuous + inputSize[d] ) )
+            {
+            isInside = false;
+            break;
+            }
+          const itk::IndexValueType base = itk::Math::Floor<itk::IndexValueType>(inputIndex[d]);
+          const itk::IndexValueType end = inputStart[d] + static_cast<itk::IndexValueType>( inputSize[d] ) - 1;
+          distance[d] = inputIndex[d] - static_cast<double>( base );
+          lower[d] = std::max(base, static_cast<itk::IndexValueType>( inputStart[d] ) );
+          upper[d] = std::min(base + 1, end);
+          }
+        if( !isInside )
+          {
+          std::fill(outputPixel, outputPixel + numberOfComponents, ComponentType(0) );
+          continue;
+          }
+
+        std::fill(accumulator.begin(), accumulator.end(), 0.0);
+        for( unsigned int corner = 0; corner < 8; ++corner )
+          {
+          double weight = 1.0;
+          size_t offset = 0;
+          size_t stride = 1;
+          for( unsigned int d = 0; d < 3; ++d )
+            {
+            const bool isUpper = ( corner >> d ) & 1;
+            weight *= isUpper ? distance[d] : ( 1.0 - distance[d] );
+            offset += ( ( isUpper ? upper[d] : lower[d] ) - inputStart[d] ) * stride;
+            stride *= inputSize[d];
+            }
+          if( weight == 0.0 )
+            {
+            continue;
+            }
+          const ComponentType * inputPixel = inputBuffer + offset * numberOfComponents;
+          for( size_t c = 0; c < numberOfComponents; ++c )
+            {
+            accumulator[c] += weight * inputPixel[c];
+            }
+          }
+        for( size_t c = 0; c < numberOfComponents; ++c )
+          {
+          const double value = std::min(std::max(accumulator[c], minComponent), maxComponent);
+          outputPixel[c] = static_cast<ComponentType>( value );
+          }
+        }
+      }
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+/**
+ * \brief Resample every gradient volume of InputImage onto the ReferenceImage grid in a single
+ * threaded pass over output slabs (see SharedWeightsResampleThreaderCallback).
+ */
+template <class IOImageType>
+typename IOImageType::Pointer
+ResampleVectorImageWithSharedWeights(const IOImageType *InputImage,
+                                     const itk::ImageBase<3> *ReferenceImage,
+                                     const itk::Transform<double, 3, 3> *Transform)
+{
+  typename IOImageType::Pointer outputImage = IOImageType::New();
+  outputImage->CopyInformation(ReferenceImage);
+  outputImage->SetRegions(ReferenceImage->GetLargestPossibleRegion() );
+  outputImage->SetVectorLength(InputImage->GetNumberOfComponentsPerPixel() );
+  outputImage->Allocate();
+  outputImage->SetMetaDataDictionary(InputImage->GetMetaDataDictionary() );
+
+  SharedWeightsResampleStruct<IOImageType> str;
+  str.Input = InputImage;
+  str.Output = outputImage.GetPointer();
+  str.Transform = Transform;
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  threader->SetSingleMethod( SharedWeightsResampleThreaderCallback<IOImageType>, &str );
+  threader->SingleMethodExecute();
+  return outputImage;
+}
+
 int main(int argc, char *argv[])
 {
   PARSE_ARGS;
@@ -233,7 +387,15 @@ int main(int argc, char *argv[])
 
   DWIMetaDataDictionaryValidator::GradientTableType newGradTable( gradTable.size() );
 
-  // Rotate gradient vectors by rigid transform and inverse measurement frame
+  // Rotate the diffusion gradients with rigid transform and inverse measurement frame,
+  // the combined rotation is the same for every gradient.
+  RigidTransformType::Pointer inverseRigidTransform = RigidTransformType::New();
+  inverseRigidTransform->SetCenter( rigidTransform->GetCenter() );
+  inverseRigidTransform->SetIdentity();
+  rigidTransform->GetInverse(inverseRigidTransform);
+  const DWIMetaDataDictionaryValidator::RotationMatrixType gradientRotation =
+    inverseRigidTransform->GetMatrix() * DWIInverseMeasurementFrame;
+
   for( unsigned int i = 0; i < gradTable.size(); i++ )
     {
     // Get Current Gradient Direction
@@ -242,15 +404,7 @@ int main(int argc, char *argv[])
     curGradientDirection[1] = gradTable[i][1];
     curGradientDirection[2] = gradTable[i][2];
 
-    // Rotate the diffusion gradient with rigid transform and inverse measurement frame
-    RigidTransformType::Pointer inverseRigidTransform = RigidTransformType::New();
-    const NrrdImageType::PointType centerPoint = rigidTransform->GetCenter();
-    inverseRigidTransform->SetCenter( centerPoint );
-    inverseRigidTransform->SetIdentity();
-    rigidTransform->GetInverse(inverseRigidTransform);
-
-    curGradientDirection =
-      inverseRigidTransform->GetMatrix() * DWIInverseMeasurementFrame * curGradientDirection;
+    curGradientDirection = gradientRotation * curGradientDirection;
 
     newGradTable[i][0] = curGradientDirection[0];
     newGradTable[i][1] = curGradientDirection[1];
@@ -390,66 +544,40 @@ int main(int argc, char *argv[])
   paddedImage->SetMetaDataDictionary( resampleImage->GetMetaDataDictionary() );
   paddedImage->SetRegions( newSize );
   paddedImage->SetOrigin( newOrigin );
-  paddedImage->Allocate();
+  paddedImage->Allocate(true);
 
+  // Copy the input into the padded image one row (all gradient components) at a time
   NrrdImageType::Pointer finalImage;
-  typedef itk::ImageRegionIterator<NrrdImageType> IteratorType;
-  IteratorType InIt( resampleImage, resampleImage->GetRequestedRegion() );
-  for( InIt.GoToBegin(); !InIt.IsAtEnd(); ++InIt )
+  {
+  const size_t       numberOfComponents = resampleImage->GetNumberOfComponentsPerPixel();
+  const size_t       rowLength = inputSize[0] * numberOfComponents;
+  const PixelType *  inBuffer = resampleImage->GetBufferPointer();
+  PixelType *        outBuffer = paddedImage->GetBufferPointer();
+  for( size_t z = 0; z < inputSize[2]; ++z )
     {
-    NrrdImageType::IndexType InIndex = InIt.GetIndex();
-    NrrdImageType::IndexType OutIndex;
-    OutIndex[0] = InIndex[0] + imagePadding[0];
-    OutIndex[1] = InIndex[1] + imagePadding[1];
-    OutIndex[2] = InIndex[2] + imagePadding[2];
-
-    NrrdImageType::PixelType InImagePixel = resampleImage->GetPixel( InIndex );
-    paddedImage->SetPixel( OutIndex, InImagePixel );
+    for( size_t y = 0; y < inputSize[1]; ++y )
+      {
+      const size_t outRow = ( ( z + imagePadding[2] ) * newSize[1] + ( y + imagePadding[1] ) ) * newSize[0]
+        + imagePadding[0];
+      std::copy(inBuffer + ( z * inputSize[1] + y ) * rowLength,
+                inBuffer + ( z * inputSize[1] + y + 1 ) * rowLength,
+                outBuffer + outRow * numberOfComponents);
+      }
     }
-  paddedImage->Update();
+  }
 
   if(referenceVolume != "")
     {
-    //For each component, extract, resample to list, and finally compose back into a vector image.
+    // Resample all gradient components to the reference space in one pass, linear
+    // interpolation, identity transform unless --warpDWITransform, background value of 0.
     typedef itk::ImageFileReader<SingleComponentImageType> ReferenceFileReaderType;
     ReferenceFileReaderType::Pointer referenceImageReader = ReferenceFileReaderType::New();
     referenceImageReader->SetFileName(referenceVolume);
-    referenceImageReader->Update();
-
-    const size_t lengthOfPixelVector = paddedImage->GetVectorLength();
-
-    typedef itk::ComposeImageFilter<SingleComponentImageType, NrrdImageType> ComposeCovariantVectorImageFilterType;
-    ComposeCovariantVectorImageFilterType::Pointer composer= ComposeCovariantVectorImageFilterType::New();
+    referenceImageReader->UpdateOutputInformation();
 
-    typedef itk::VectorIndexSelectionCastImageFilter< NrrdImageType, SingleComponentImageType >
-        VectorIndexSelectionCastImageFilterType;
-    VectorIndexSelectionCastImageFilterType::Pointer vectorImageToImageSelector = VectorIndexSelectionCastImageFilterType::New();
-    vectorImageToImageSelector->SetInput(paddedImage);
-    for(size_t componentToExtract = 0 ; componentToExtract < lengthOfPixelVector; ++componentToExtract )
-      {
-      vectorImageToImageSelector->SetIndex( componentToExtract );
-      vectorImageToImageSelector->Update();
-
-      // Resample to a new space with basic linear/identity transform.
-      typedef itk::ResampleImageFilter<SingleComponentImageType,SingleComponentImageType> ComponentResamplerType;
-      ComponentResamplerType::Pointer componentResampler = ComponentResamplerType::New();
-      componentResampler->SetOutputParametersFromImage(referenceImageReader->GetOutput());
-      componentResampler->SetInput(vectorImageToImageSelector->GetOutput());
-      if(warpDWIXFRM.IsNotNull())
-        {
-        componentResampler->SetTransform(warpDWIXFRM);
-        }
-      //default to linear
-      //default to IdentityTransform
-      // TODO feed it composite transform.
-      //default background value of 0.
-      componentResampler->Update();
-      //Add to list for Compose
-      composer->SetInput(componentToExtract,componentResampler->GetOutput());
-      }
-    composer->Update();
-    finalImage = composer->GetOutput();
-    finalImage->SetMetaDataDictionary(paddedImage->GetMetaDataDictionary() );
+    finalImage = ResampleVectorImageWithSharedWeights<NrrdImageType>(paddedImage.GetPointer(),
+                                                                     referenceImageReader->GetOutput(),
+                                                                     warpDWIXFRM.GetPointer() );
     }
   else
     {
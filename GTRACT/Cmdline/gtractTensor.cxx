@@ -39,12 +39,10 @@
 
 #include <itkImage.h>
 #include <itkVectorIndexSelectionCastImageFilter.h>
-#include <itkMedianImageFilter.h>
 #include <itkResampleImageFilter.h>
 #include <itkLinearInterpolateImageFunction.h>
 #include <itkImageFileWriter.h>
 #include <itkImageFileReader.h>
-#include <itkComposeImageFilter.h>
 
 #include <itkExtractImageFilter.h>
 #include <itkImageMaskSpatialObject.h>
@@ -53,6 +51,7 @@
 #include "itkGtractImageIO.h"
 #include "itkGtractParameterIO.h"
 #include "itkComputeDiffusionTensorImageFilter.h"
+#include "itkVectorImageComponentMedianImageFilter.h"
 #include "itkVectorResampleImageFilter.h"
 #include "itkIdentityTransform.h"
 #include "itkMetaDataObject.h"
@@ -200,84 +199,9 @@ int main(int argc, char *argv[])
     DirectionContainerType;
   DirectionContainerType::Pointer gradientDirectionContainer = DirectionContainerType::New();
 
-  typedef itk::ComposeImageFilter<IndexImageType> VectorImageFilterType;
-  VectorImageFilterType::Pointer indexImageToVectorImageFilter = VectorImageFilterType::New();
-  int                            vectorIndex = 0;
+  std::vector<unsigned int> gradientComponents;
   for( unsigned int i = 0; i < vectorImageReader->GetOutput()->GetVectorLength(); i++ )
     {
-    typedef itk::VectorIndexSelectionCastImageFilter<VectorImageType, IndexImageType> VectorSelectFilterType;
-    typedef VectorSelectFilterType::Pointer                                           VectorSelectFilterPointer;
-
-    VectorSelectFilterPointer selectIndexImageFilter = VectorSelectFilterType::New();
-    selectIndexImageFilter->SetIndex( i );
-    selectIndexImageFilter->SetInput( vectorImageReader->GetOutput() );
-    try
-      {
-      selectIndexImageFilter->Update();
-      }
-    catch( itk::ExceptionObject & e )
-      {
-      std::cout << e << std::endl;
-      }
-
-    /* Median Filter */
-    IndexImageType::Pointer baseImage;
-    if( MedianFilterSize[0] > 0  ||  MedianFilterSize[1] > 0  ||  MedianFilterSize[2] > 0 )
-      {
-      typedef itk::MedianImageFilter<IndexImageType, IndexImageType> MedianFilterType;
-      MedianFilterType::Pointer filter = MedianFilterType::New();
-      filter->SetInput( selectIndexImageFilter->GetOutput() );
-      filter->SetRadius( MedianFilterSize );
-      filter->Update();
-      baseImage = filter->GetOutput();
-      }
-    else
-      {
-      baseImage = selectIndexImageFilter->GetOutput();
-      }
-
-    /* Resample To Isotropic Images */
-    IndexImageType::Pointer bvalueImage;
-    if( resampleIsotropic )
-      {
-      typedef itk::ResampleImageFilter<IndexImageType, IndexImageType> ResampleFilterType;
-      ResampleFilterType::Pointer resampler = ResampleFilterType::New();
-      resampler->SetInput( baseImage );
-
-      typedef itk::LinearInterpolateImageFunction<IndexImageType, double> InterpolatorType;
-      InterpolatorType::Pointer interpolator = InterpolatorType::New();
-      resampler->SetInterpolator( interpolator );
-      resampler->SetDefaultPixelValue( 0 );
-
-      IndexImageType::SpacingType spacing;
-      spacing[0] = voxelSize;
-      spacing[1] = voxelSize;
-      spacing[2] = voxelSize;
-      resampler->SetOutputSpacing( spacing );
-
-      // Use the same origin
-      resampler->SetOutputOrigin( selectIndexImageFilter->GetOutput()->GetOrigin() );
-
-      IndexImageType::SizeType    inputSize  = baseImage->GetLargestPossibleRegion().GetSize();
-      IndexImageType::SpacingType inputSpacing  = baseImage->GetSpacing();
-      typedef IndexImageType::SizeType::SizeValueType SizeValueType;
-      IndexImageType::SizeType size;
-      size[0] = static_cast<SizeValueType>( inputSize[0] * inputSpacing[0] / voxelSize );
-      size[1] = static_cast<SizeValueType>( inputSize[1] * inputSpacing[1] / voxelSize );
-      size[2] = static_cast<SizeValueType>( inputSize[2] * inputSpacing[2] / voxelSize );
-      resampler->SetSize( size );
-
-      typedef itk::IdentityTransform<double, 3> TransformType;
-      TransformType::Pointer transform = TransformType::New();
-      transform->SetIdentity();
-      resampler->SetTransform( transform );
-      resampler->Update();
-      bvalueImage = resampler->GetOutput();
-      }
-    else
-      {
-      bvalueImage = baseImage;
-      }
     char        tmpStr[64];
     std::string NrrdValue;
     sprintf(tmpStr, "DWMRI_gradient_%04u", i);
@@ -308,18 +232,77 @@ int main(int argc, char *argv[])
 
     if( useIndex )
       {
-      indexImageToVectorImageFilter->SetInput( vectorIndex, bvalueImage );
+      const unsigned int vectorIndex = gradientComponents.size();
+      gradientComponents.push_back(i);
       gradientDirectionContainer->CreateIndex(vectorIndex);
       gradientDirectionContainer->SetElement(vectorIndex, gradientDir);
       std::cout << "Add Gradient Direction " << vectorIndex << ":  " << gradientDir[0] << ",  " << gradientDir[1]
                 << ",  " << gradientDir[2] << std::endl;
-      vectorIndex++;
       }
     }
-  indexImageToVectorImageFilter->Update();
+
+  /* An empty component list would select every gradient of the input */
+  if( gradientComponents.empty() )
+    {
+    std::cerr << "Error: every gradient is excluded by ignoreIndex" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  /* Median Filter: selects the used gradients, and filters them when a
+     median size is given, in one pass over the vector image */
+  typedef itk::VectorImageComponentMedianImageFilter<VectorImageType, VectorImageType> MedianFilterType;
+  MedianFilterType::Pointer medianFilter = MedianFilterType::New();
+  medianFilter->SetInput( vectorImageReader->GetOutput() );
+  medianFilter->SetRadius( MedianFilterSize );
+  medianFilter->SetComponentIndices( gradientComponents );
+  medianFilter->Update();
+  VectorImageType::Pointer gradientImage = medianFilter->GetOutput();
+  gradientImage->DisconnectPipeline();
+  medianFilter = nullptr;
+
+  /* Resample To Isotropic Images */
+  if( resampleIsotropic )
+    {
+    typedef itk::ResampleImageFilter<VectorImageType, VectorImageType> ResampleFilterType;
+    ResampleFilterType::Pointer resampler = ResampleFilterType::New();
+    resampler->SetInput( gradientImage );
+
+    typedef itk::LinearInterpolateImageFunction<VectorImageType, double> InterpolatorType;
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    resampler->SetInterpolator( interpolator );
+    VectorImageType::PixelType defaultPixel( gradientImage->GetNumberOfComponentsPerPixel() );
+    defaultPixel.Fill( 0 );
+    resampler->SetDefaultPixelValue( defaultPixel );
+
+    VectorImageType::SpacingType spacing;
+    spacing[0] = voxelSize;
+    spacing[1] = voxelSize;
+    spacing[2] = voxelSize;
+    resampler->SetOutputSpacing( spacing );
+
+    // Use the same origin
+    resampler->SetOutputOrigin( gradientImage->GetOrigin() );
+
+    VectorImageType::SizeType    inputSize  = gradientImage->GetLargestPossibleRegion().GetSize();
+    VectorImageType::SpacingType inputSpacing  = gradientImage->GetSpacing();
+    typedef VectorImageType::SizeType::SizeValueType SizeValueType;
+    VectorImageType::SizeType size;
+    size[0] = static_cast<SizeValueType>( inputSize[0] * inputSpacing[0] / voxelSize );
+    size[1] = static_cast<SizeValueType>( inputSize[1] * inputSpacing[1] / voxelSize );
+    size[2] = static_cast<SizeValueType>( inputSize[2] * inputSpacing[2] / voxelSize );
+    resampler->SetSize( size );
+
+    typedef itk::IdentityTransform<double, 3> TransformType;
+    TransformType::Pointer transform = TransformType::New();
+    transform->SetIdentity();
+    resampler->SetTransform( transform );
+    resampler->Update();
+    gradientImage = resampler->GetOutput();
+    gradientImage->DisconnectPipeline();
+    }
 
   TensorFilterType::Pointer tensorFilter = TensorFilterType::New();
-  tensorFilter->SetGradientImage( gradientDirectionContainer, indexImageToVectorImageFilter->GetOutput() );
+  tensorFilter->SetGradientImage( gradientDirectionContainer, gradientImage );
   tensorFilter->SetThreshold( backgroundSuppressingThreshold );
   tensorFilter->SetBValue(BValue);     /* Required */
   tensorFilter->SetNumberOfThreads(1); /* Required */
@@ -0,0 +1,136 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/*=========================================================================
+
+ Program:   GTRACT (Guided Tensor Restore Anatomical Connectivity Tractography)
+ Module:    $RCSfile: $
+ Language:  C++
+ Date:      $Date: 2006/03/29 14:53:40 $
+ Version:   $Revision: 1.9 $
+
+   Copyright (c) University of Iowa Department of Radiology. All rights reserved.
+   See GTRACT-Copyright.txt or http://mri.radiology.uiowa.edu/copyright/GTRACT-Copyright.txt
+   for details.
+
+      This software is distributed WITHOUT ANY WARRANTY; without even
+      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+      PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __itkVectorImageComponentMedianImageFilter_h
+#define __itkVectorImageComponentMedianImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class VectorImageComponentMedianImageFilter
+ * \brief Median filter every selected component of a VectorImage in one pass.
+ *
+ * The output holds the components listed by SetComponentIndices() (all
+ * components when the list is empty), in that order, each replaced by the
+ * median of its (2 * radius + 1) neighborhood with zero flux Neumann
+ * boundaries, exactly as MedianImageFilter does for a scalar image.  A
+ * radius of 0 only selects the components.
+ *
+ * The neighborhood of a voxel is read once for all components, so a DWI
+ * is filtered without splitting it into one scalar image per gradient.
+ */
+template <class TInputImage, class TOutputImage = TInputImage>
+class VectorImageComponentMedianImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef VectorImageComponentMedianImageFilter         Self;
+  typedef ImageToImageFilter<TInputImage, TOutputImage> Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(VectorImageComponentMedianImageFilter, ImageToImageFilter);
+
+  /** Some convenient typedefs. */
+  typedef TInputImage                                InputImageType;
+  typedef typename InputImageType::ConstPointer      InputImageConstPointer;
+  typedef typename InputImageType::RegionType        InputImageRegionType;
+  typedef typename InputImageType::SizeType          InputSizeType;
+  typedef typename InputImageType::InternalPixelType InputComponentType;
+
+  typedef TOutputImage                                OutputImageType;
+  typedef typename OutputImageType::Pointer           OutputImagePointer;
+  typedef typename OutputImageType::RegionType        OutputImageRegionType;
+  typedef typename OutputImageType::InternalPixelType OutputComponentType;
+
+  typedef std::vector<unsigned int> ComponentIndexListType;
+
+  /** ImageDimension enumeration */
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  /** Neighborhood radius of the median, 0 in every direction disables it */
+  itkSetMacro(Radius, InputSizeType);
+  itkGetConstReferenceMacro(Radius, InputSizeType);
+
+  /** Components of the input kept in the output, all when empty */
+  void SetComponentIndices(const ComponentIndexListType & indices)
+  {
+    this->m_ComponentIndices = indices;
+    this->Modified();
+  }
+
+  const ComponentIndexListType & GetComponentIndices() const
+  {
+    return this->m_ComponentIndices;
+  }
+
+protected:
+  VectorImageComponentMedianImageFilter();
+  ~VectorImageComponentMedianImageFilter() override
+  {
+  }
+
+  void PrintSelf(std::ostream & os, Indent indent) const override;
+
+  void GenerateOutputInformation() override;
+
+  void GenerateInputRequestedRegion() override;
+
+  void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId) override;
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(VectorImageComponentMedianImageFilter);
+
+  /** The selected components, filled in from the input when none are set */
+  ComponentIndexListType GetSelectedComponents() const;
+
+  InputSizeType          m_Radius;
+  ComponentIndexListType m_ComponentIndices;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkVectorImageComponentMedianImageFilter.hxx"
+#endif
+
+#endif
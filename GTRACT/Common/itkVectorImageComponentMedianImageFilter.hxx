@@ -0,0 +1,215 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/*=========================================================================
+
+ Program:   GTRACT (Guided Tensor Restore Anatomical Connectivity Tractography)
+ Module:    $RCSfile: $
+ Language:  C++
+ Date:      $Date: 2006/03/29 14:53:40 $
+ Version:   $Revision: 1.9 $
+
+   Copyright (c) University of Iowa Department of Radiology. All rights reserved.
+   See GTRACT-Copyright.txt or http://mri.radiology.uiowa.edu/copyright/GTRACT-Copyright.txt
+   for details.
+
+      This software is distributed WITHOUT ANY WARRANTY; without even
+      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+      PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __itkVectorImageComponentMedianImageFilter_hxx
+#define __itkVectorImageComponentMedianImageFilter_hxx
+
+#include "itkVectorImageComponentMedianImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkProgressReporter.h"
+
+#include <algorithm>
+
+namespace itk
+{
+template <class TInputImage, class TOutputImage>
+VectorImageComponentMedianImageFilter<TInputImage, TOutputImage>
+::VectorImageComponentMedianImageFilter()
+{
+  m_Radius.Fill(0);
+}
+
+template <class TInputImage, class TOutputImage>
+typename VectorImageComponentMedianImageFilter<TInputImage, TOutputImage>::ComponentIndexListType
+VectorImageComponentMedianImageFilter<TInputImage, TOutputImage>
+::GetSelectedComponents() const
+{
+  const unsigned int numberOfInputComponents = this->GetInput()->GetNumberOfComponentsPerPixel();
+  if( this->m_ComponentIndices.empty() )
+    {
+    ComponentIndexListType allComponents(numberOfInputComponents);
+    for( unsigned int c = 0; c < numberOfInputComponents; ++c )
+      {
+      allComponents[c] = c;
+      }
+    return allComponents;
+    }
+  for( size_t c = 0; c < this->m_ComponentIndices.size(); ++c )
+    {
+    if( this->m_ComponentIndices[c] >= numberOfInputComponents )
+      {
+      itkExceptionMacro(<< "Component " << this->m_ComponentIndices[c] << " requested from an image with "
+                        << numberOfInputComponents << " components");
+      }
+    }
+  return this->m_ComponentIndices;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+VectorImageComponentMedianImageFilter<TInputImage, TOutputImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  this->GetOutput()->SetNumberOfComponentsPerPixel(this->GetSelectedComponents().size() );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+VectorImageComponentMedianImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImageType *inputPtr = const_cast<InputImageType *>( this->GetInput() );
+  if( inputPtr == nullptr )
+    {
+    return;
+    }
+  InputImageRegionType inputRequestedRegion = this->GetOutput()->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius(this->m_Radius);
+  inputRequestedRegion.Crop(inputPtr->GetLargestPossibleRegion() );
+  inputPtr->SetRequestedRegion(inputRequestedRegion);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+VectorImageComponentMedianImageFilter<TInputImage, TOutputImage>
+::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId)
+{
+  const InputImageType *       inputPtr = this->GetInput();
+  OutputImageType *            outputPtr = this->GetOutput();
+  const ComponentIndexListType components = this->GetSelectedComponents();
+  const unsigned int           numberOfComponents = components.size();
+  const unsigned int           numberOfInputComponents = inputPtr->GetNumberOfComponentsPerPixel();
+
+  // Offsets of the neighborhood, the first axis varying fastest.
+  std::vector<typename InputImageType::OffsetType> neighborhood;
+    {
+    typename InputImageType::OffsetType offset;
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+      offset[d] = -static_cast<OffsetValueType>( this->m_Radius[d] );
+      }
+    for( ;; )
+      {
+      neighborhood.push_back(offset);
+      unsigned int d = 0;
+      for( ; d < ImageDimension; ++d )
+        {
+        if( offset[d] < static_cast<OffsetValueType>( this->m_Radius[d] ) )
+          {
+          ++offset[d];
+          break;
+          }
+        offset[d] = -static_cast<OffsetValueType>( this->m_Radius[d] );
+        }
+      if( d == ImageDimension )
+        {
+        break;
+        }
+      }
+    }
+  const size_t neighborhoodSize = neighborhood.size();
+  const size_t medianPosition = neighborhoodSize / 2;
+
+  // Zero flux Neumann boundaries: neighbors outside the buffer take the
+  // value of the nearest voxel inside it.
+  const InputImageRegionType bufferedRegion = inputPtr->GetBufferedRegion();
+  IndexValueType             firstIndex[ImageDimension];
+  IndexValueType             lastIndex[ImageDimension];
+  for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+    firstIndex[d] = bufferedRegion.GetIndex()[d];
+    lastIndex[d] = firstIndex[d] + static_cast<IndexValueType>( bufferedRegion.GetSize()[d] ) - 1;
+    }
+
+  const InputComponentType *inputBuffer = inputPtr->GetBufferPointer();
+  OutputComponentType *     outputBuffer = outputPtr->GetBufferPointer();
+
+  // values[c * neighborhoodSize + n] holds component c of neighbor n.
+  std::vector<InputComponentType> values(numberOfComponents * neighborhoodSize);
+
+  ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+  for( ImageRegionConstIteratorWithIndex<OutputImageType> it(outputPtr, outputRegionForThread);
+       !it.IsAtEnd(); ++it )
+    {
+    const typename OutputImageType::IndexType index = it.GetIndex();
+    for( size_t n = 0; n < neighborhoodSize; ++n )
+      {
+      typename InputImageType::IndexType neighbor;
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+        {
+        neighbor[d] = std::min(lastIndex[d], std::max(firstIndex[d], index[d] + neighborhood[n][d]) );
+        }
+      const InputComponentType *pixel =
+        inputBuffer + inputPtr->ComputeOffset(neighbor) * numberOfInputComponents;
+      for( unsigned int c = 0; c < numberOfComponents; ++c )
+        {
+        values[c * neighborhoodSize + n] = pixel[components[c]];
+        }
+      }
+
+    OutputComponentType *outputPixel =
+      outputBuffer + outputPtr->ComputeOffset(index) * numberOfComponents;
+    for( unsigned int c = 0; c < numberOfComponents; ++c )
+      {
+      const typename std::vector<InputComponentType>::iterator first = values.begin() + c * neighborhoodSize;
+      const typename std::vector<InputComponentType>::iterator median = first + medianPosition;
+      std::nth_element(first, median, first + neighborhoodSize);
+      outputPixel[c] = static_cast<OutputComponentType>( *median );
+      }
+    progress.CompletedPixel();
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+VectorImageComponentMedianImageFilter<TInputImage, TOutputImage>
+::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Radius: " << m_Radius << std::endl;
+  os << indent << "ComponentIndices:";
+  for( size_t c = 0; c < m_ComponentIndices.size(); ++c )
+    {
+    os << " " << m_ComponentIndices[c];
+    }
+  os << std::endl;
+}
+} // end namespace itk
+
+#endif